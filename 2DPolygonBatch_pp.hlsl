@@ -0,0 +1,33 @@
+//--------------------------------------------------------------------------------------
+// 2D Polygon Batch Post-Processing Vertex Shader
+//--------------------------------------------------------------------------------------
+// As 2DPolygon_pp.hlsl, but draws every window of a polygon batch in one instanced draw. The corners of each window come
+// from the structured buffer of windows rather than the post-processing constant buffer
+
+#include "Common.hlsli"
+#include "PolygonBatch.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+PolygonBatchInput main(uint vertexId : SV_VertexID, uint instanceId : SV_InstanceID)
+{
+	PolygonBatchInput output;
+
+	// Fixed UVs for the polygon, as 2DPolygon_pp.hlsl
+	const float2 polygonUVs[4] = { float2(0.0, 0.0),   // Top-left
+	                               float2(0.0, 1.0),   // Bottom-left
+	                               float2(1.0, 0.0),   // Top-right
+	                               float2(1.0, 1.0) }; // Bottom-right
+
+	// Each instance is one window, the scene UVs are calculated from the x and y coordinates of its corners
+	output.window = gFirstPolygonInstance + instanceId;
+	output.projectedPosition = gPolygonInstances[output.window].points[vertexId];
+	output.areaUV = polygonUVs[vertexId];
+	output.sceneUV = (output.projectedPosition.xy / output.projectedPosition.w + 1.0f) * 0.5f;
+	output.sceneUV.y = 1.0f - output.sceneUV.y;
+
+	return output;
+}
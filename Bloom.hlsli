@@ -0,0 +1,33 @@
+//--------------------------------------------------------------------------------------
+// Helpers shared by the bloom chain shaders
+//--------------------------------------------------------------------------------------
+// See the bloom section of PostProcess.h for how the chain fits together. The CPU engine (CpuBloom.cpp) follows
+// these functions exactly
+
+
+// Number of levels in the bloom chain - must match NUM_BLOOM_LEVELS in PostProcess.h
+static const int NUM_BLOOM_LEVELS = 3;
+
+
+// Size of one texel of the given texture in UV units
+float2 TexelSize(Texture2D tex)
+{
+    float width, height;
+    tex.GetDimensions(width, height);
+    return float2(1.0f / width, 1.0f / height);
+}
+
+
+// Blur a texture while reading it with a 3x3 tent filter (weights 1 2 1 / 2 4 2 / 1 2 1). Nine bilinear reads one texel
+// apart. Used when moving up the bloom chain, so each level is blurred as it is added onto the larger level above
+float3 TentSample(Texture2D tex, SamplerState bilinear, float2 uv)
+{
+    float2 texel = TexelSize(tex);
+    
+    float3 colour = tex.Sample(bilinear, uv).rgb * 4.0f;
+    colour += (tex.Sample(bilinear, uv + float2(-texel.x, 0)).rgb + tex.Sample(bilinear, uv + float2(texel.x, 0)).rgb +
+               tex.Sample(bilinear, uv + float2(0, -texel.y)).rgb + tex.Sample(bilinear, uv + float2(0, texel.y)).rgb) * 2.0f;
+    colour +=  tex.Sample(bilinear, uv + float2(-texel.x, -texel.y)).rgb + tex.Sample(bilinear, uv + float2(texel.x, -texel.y)).rgb +
+               tex.Sample(bilinear, uv + float2(-texel.x,  texel.y)).rgb + tex.Sample(bilinear, uv + float2(texel.x,  texel.y)).rgb;
+    return colour / 16.0f;
+}
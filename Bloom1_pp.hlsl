@@ -22,7 +22,7 @@ float4 main(PostProcessingInput input) : SV_Target
 {
     
     float4 finalColour = float4(1.0, 0.0, 0.0, 1.0f);
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
     
         float3 vAdd = (0.1, 0.1, 0.1); // just a float3 for use later
@@ -25,7 +25,7 @@ SamplerState PointSample : register(s0); // We don't usually want to filter (bil
 float4 main(PostProcessingInput input) : SV_Target
 {
     float3 finalColour = float3(1.0, 0.0, 0.0);
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
     
         finalColour = (SceneTexture.Sample(PointSample, input.sceneUV).rgb + SceneTwoTexture.Sample(PointSample, input.sceneUV).rgb);
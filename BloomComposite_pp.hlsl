@@ -0,0 +1,42 @@
+//--------------------------------------------------------------------------------------
+// Bloom Composite Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Last pass of the bloom chain. Adds the blurred bright parts of the scene (the top level of the chain, which holds
+// the sum of every level) back onto the scene. Replaces the old Bloom2 pass and the copies that went with it
+
+#include "Common.hlsli"
+#include "Bloom.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The scene has been rendered to a texture, these variables allow access to that texture
+Texture2D SceneTexture : register(t0);
+Texture2D BloomTexture : register(t1); // Top (half size) level of the bloom chain
+SamplerState PointSample : register(s0); // We don't usually want to filter (bilinear, trilinear etc.) the scene texture when
+                                          // post-processing so this sampler will use "point sampling" - no filtering
+SamplerState BilinearClamp : register(s1);
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+float4 main(PostProcessingInput input) : SV_Target
+{
+    float3 finalColour = float3(1.0, 0.0, 0.0);
+    if (EffectSideOfMidLine(input.sceneUV))
+    {
+        // Each level of the chain adds a copy of the bright pixels, divide by the number of levels to keep the overall
+        // brightness of the bloom the same as a single blur
+        float3 bloom = TentSample(BloomTexture, BilinearClamp, input.sceneUV) / NUM_BLOOM_LEVELS;
+        finalColour = SceneTexture.Sample(PointSample, input.sceneUV).rgb + bloom;
+    }
+    else if (input.sceneUV.x >= (gMidLine + 0.002))
+    {
+        finalColour = SceneTexture.Sample(PointSample, input.sceneUV).rgb;
+    }
+    return float4(finalColour, 1.0f);
+}
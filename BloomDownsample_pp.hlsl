@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------
+// Bloom Downsample Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Renders one level of the bloom chain to a target half its size. Four bilinear reads placed on texel corners
+// average a 4x4 block of the larger level, which avoids the flickering a plain 2x2 average gives as things move
+
+#include "Common.hlsli"
+#include "Bloom.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The previous (larger) level of the bloom chain
+Texture2D BloomTexture : register(t0);
+SamplerState BilinearClamp : register(s1);
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+float4 main(PostProcessingInput input) : SV_Target
+{
+    float2 texel = TexelSize(BloomTexture);
+
+    float3 colour = BloomTexture.Sample(BilinearClamp, input.sceneUV + float2(-texel.x, -texel.y)).rgb +
+                    BloomTexture.Sample(BilinearClamp, input.sceneUV + float2( texel.x, -texel.y)).rgb +
+                    BloomTexture.Sample(BilinearClamp, input.sceneUV + float2(-texel.x,  texel.y)).rgb +
+                    BloomTexture.Sample(BilinearClamp, input.sceneUV + float2( texel.x,  texel.y)).rgb;
+
+    return float4(colour * 0.25f, 1.0f);
+}
@@ -0,0 +1,48 @@
+//--------------------------------------------------------------------------------------
+// Bloom Threshold and Downsample Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// First pass of the bloom chain. Renders to a half size target, keeping only the scene pixels brighter than the bloom
+// threshold. Each output pixel averages the 2x2 scene pixels it covers, thresholding each one as the old Bloom1 pass did
+
+#include "Common.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The scene has been rendered to a texture, these variables allow access to that texture
+Texture2D SceneTexture : register(t0);
+SamplerState PointSample : register(s0); // We don't usually want to filter (bilinear, trilinear etc.) the scene texture when
+                                          // post-processing so this sampler will use "point sampling" - no filtering
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// Return the scene pixel at the given UV, or black if it is below the bloom threshold
+float3 BrightPixel(float2 uv)
+{
+    float3 colour = SceneTexture.Sample(PointSample, uv).rgb;
+    if ((colour.r + colour.g + colour.b) / 3 < gBloomThreshold)
+    {
+        colour = float3(0.0f, 0.0f, 0.0f);
+    }
+    return colour;
+}
+
+float4 main(PostProcessingInput input) : SV_Target
+{
+    // The centre of this pixel lies on the corner between four scene pixels, read the centre of each
+    float width, height;
+    SceneTexture.GetDimensions(width, height);
+    float2 halfTexel = float2(0.5f / width, 0.5f / height);
+
+    float3 colour = BrightPixel(input.sceneUV + float2(-halfTexel.x, -halfTexel.y)) +
+                    BrightPixel(input.sceneUV + float2( halfTexel.x, -halfTexel.y)) +
+                    BrightPixel(input.sceneUV + float2(-halfTexel.x,  halfTexel.y)) +
+                    BrightPixel(input.sceneUV + float2( halfTexel.x,  halfTexel.y));
+
+    return float4(colour * 0.25f, 1.0f);
+}
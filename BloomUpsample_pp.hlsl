@@ -0,0 +1,27 @@
+//--------------------------------------------------------------------------------------
+// Bloom Upsample Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Blurs one level of the bloom chain with a tent filter while scaling it up to the size of the level above. The C++
+// side selects additive blending so the result is added onto what is already in the larger level
+
+#include "Common.hlsli"
+#include "Bloom.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The next (smaller) level of the bloom chain, already holding everything added from the levels below it
+Texture2D BloomTexture : register(t0);
+SamplerState BilinearClamp : register(s1);
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+float4 main(PostProcessingInput input) : SV_Target
+{
+    return float4(TentSample(BloomTexture, BilinearClamp, input.sceneUV), 1.0f);
+}
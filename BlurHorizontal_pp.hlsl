@@ -15,6 +15,9 @@ Texture2D SceneTexture : register(t0);
 SamplerState PointSample : register(s0); // We don't usually want to filter (bilinear, trilinear etc.) the scene texture when
                                           // post-processing so this sampler will use "point sampling" - no filtering
 
+// The blur taps use bilinear filtering so that one fetch placed between two pixels reads both of them (see BlurKernel.h)
+SamplerState BilinearClamp : register(s1);
+
 
 //--------------------------------------------------------------------------------------
 // Shader code
@@ -25,7 +28,7 @@ float4 main(PostProcessingInput input) : SV_Target
 {
     
     float3 finalColour = float3(1.0, 0.0, 0.0);
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
    
         float3 colour = SceneTexture.Sample(PointSample, input.sceneUV).rgb;
@@ -37,10 +40,12 @@ float4 main(PostProcessingInput input) : SV_Target
 
         finalColour = (0.0f, 0.0f, 0.0f);
     
-        for (int i = 0; i < gBlurStrength; i++)
+        // Taps are packed two per element as (weight, offset, weight, offset)
+        for (int i = 0; i < gBlurTapCount; i++)
         {
-            samp.x = input.sceneUV.x + gKernel[i].x * pixelWidth;
-            finalColour += SceneTexture.Sample(PointSample, samp.xy).rgb * gWeight[i].x;
+            float2 tap = (i % 2 == 0) ? gBlurTaps[i / 2].xy : gBlurTaps[i / 2].zw;
+            samp.x = input.sceneUV.x + tap.y * pixelWidth;
+            finalColour += SceneTexture.Sample(BilinearClamp, samp.xy).rgb * tap.x;
         }
     }
     else if (input.sceneUV.x >= (gMidLine + 0.002))
@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------------------
+// Gaussian blur kernels
+//--------------------------------------------------------------------------------------
+
+#include "BlurKernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+
+namespace
+{
+	// Kernel cache. Kernels are held by pointer so references handed out stay valid as the map grows
+	using BlurKernelKey = std::tuple<int, float, bool>;
+	std::map<BlurKernelKey, std::unique_ptr<BlurKernel>> gBlurKernels;
+	std::mutex gBlurKernelsMutex;
+
+
+	// Calculate the normalised Gaussian weights for each pixel covered by the kernel, centre pixel in the middle.
+	// Uses the same curve as the original blur code: exp(-(x / sigma)^2)
+	std::vector<double> GaussianWeights(int strength, float sigma)
+	{
+		std::vector<double> weights(strength);
+		double mean = (strength - 1) / 2;
+		double sum = 0.0;
+		for (int x = 0; x < strength; ++x)
+		{
+			double distance = (x - mean) / sigma;
+			weights[x] = std::exp(-distance * distance);
+			sum += weights[x];
+		}
+		for (auto& weight : weights)
+		{
+			weight /= sum;
+		}
+		return weights;
+	}
+
+
+	// Build the taps for a kernel
+	std::unique_ptr<BlurKernel> CreateBlurKernel(int strength, float sigma, bool linearSampling)
+	{
+		auto kernel = std::make_unique<BlurKernel>();
+		kernel->strength = strength;
+		kernel->sigma = sigma;
+		kernel->linearSampling = linearSampling;
+
+		std::vector<double> weights = GaussianWeights(strength, sigma);
+		int midpoint = (strength - 1) / 2;
+
+		double variance = 0.0;
+		for (int x = 0; x < strength; ++x)
+		{
+			variance += weights[x] * (x - midpoint) * (x - midpoint);
+		}
+		kernel->deviation = static_cast<float>(std::sqrt(variance));
+
+		if (!linearSampling)
+		{
+			for (int x = 0; x < strength; ++x)
+			{
+				kernel->taps.push_back({ static_cast<float>(weights[x]), static_cast<float>(x - midpoint) });
+			}
+			return kernel;
+		}
+
+		// Linear sampling: keep the centre tap on its own then merge pixels 1&2, 3&4... on each side. A bilinear fetch at an
+		// offset between two pixels returns a mix of both, so put the fetch where the mix matches the ratio of the two weights
+		std::vector<BlurTap> rightSide;
+		for (int x = 1; x <= midpoint; x += 2)
+		{
+			double weight1 = weights[midpoint + x];
+			double weight2 = (x + 1 <= midpoint) ? weights[midpoint + x + 1] : 0.0;
+			double weight = weight1 + weight2;
+			double offset = (x * weight1 + (x + 1) * weight2) / weight;
+			rightSide.push_back({ static_cast<float>(weight), static_cast<float>(offset) });
+		}
+		for (auto tap = rightSide.rbegin(); tap != rightSide.rend(); ++tap)
+		{
+			kernel->taps.push_back({ tap->weight, -tap->offset });
+		}
+		kernel->taps.push_back({ static_cast<float>(weights[midpoint]), 0.0f });
+		kernel->taps.insert(kernel->taps.end(), rightSide.begin(), rightSide.end());
+		return kernel;
+	}
+}
+
+
+// Get the kernel for the given settings, calculating it the first time it is requested
+const BlurKernel& GetBlurKernel(int strength, float sigma, bool linearSampling)
+{
+	strength = std::min(std::max(strength, 1), MAX_BLUR_STRENGTH);
+	if (strength % 2 == 0)
+	{
+		strength -= 1;
+	}
+
+	std::lock_guard<std::mutex> lock(gBlurKernelsMutex);
+	auto& kernel = gBlurKernels[BlurKernelKey(strength, sigma, linearSampling)];
+	if (!kernel)
+	{
+		kernel = CreateBlurKernel(strength, sigma, linearSampling);
+	}
+	return *kernel;
+}
+
+
+// Copy a kernel's taps into the post-processing constants, two taps per CVector4 (weight, offset, weight, offset)
+void PackBlurKernel(const BlurKernel& kernel, PostProcessingConstants& constants)
+{
+	int numTaps = static_cast<int>(kernel.taps.size());
+	for (int i = 0; i < numTaps; i += 2)
+	{
+		CVector4& packed = constants.blurTaps[i / 2];
+		packed.x = kernel.taps[i].weight;
+		packed.y = kernel.taps[i].offset;
+		packed.z = (i + 1 < numTaps) ? kernel.taps[i + 1].weight : 0.0f;
+		packed.w = (i + 1 < numTaps) ? kernel.taps[i + 1].offset : 0.0f;
+	}
+	constants.blurTapCount = numTaps;
+}
+
+
+// Number of kernels calculated so far
+int NumCachedBlurKernels()
+{
+	std::lock_guard<std::mutex> lock(gBlurKernelsMutex);
+	return static_cast<int>(gBlurKernels.size());
+}
@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------------------
+// Gaussian blur kernels
+//--------------------------------------------------------------------------------------
+// Builds the taps (weight + pixel offset) used by the separable BlurHorizontal / BlurVertical post-processes.
+// Kernels are calculated once for each (strength, sigma, sampling) combination and cached, so a blur pass only
+// needs to copy the packed taps into the constant buffer rather than recalculate the Gaussian every frame.
+//
+// Linear sampling mode merges each pair of neighbouring taps into a single bilinear fetch placed between the two
+// pixels at the point that gives the right mix of each - roughly halving the number of texture reads for the same result.
+// Portable C++ - shared by the GPU path and the CPU engine
+
+#ifndef _BLUR_KERNEL_H_INCLUDED_
+#define _BLUR_KERNEL_H_INCLUDED_
+
+#include "PostProcess.h"
+
+#include <vector>
+
+
+// Largest number of pixels a blur kernel can cover, limited by the size of the blurTaps array in the constant buffer
+const int MAX_BLUR_STRENGTH = 99;
+
+
+// A single blur tap. The offset is in pixels from the pixel being processed and is only fractional in linear sampling mode
+struct BlurTap
+{
+	float weight;
+	float offset;
+};
+
+// Taps for one blur kernel, weights sum to 1
+struct BlurKernel
+{
+	int   strength;       // Number of pixels covered (always odd)
+	float sigma;
+	bool  linearSampling; // Taps are placed between pixels for use with a bilinear sampler
+	float deviation;      // Standard deviation of the kernel in pixels, used to match the constant-time blur modes to it
+	std::vector<BlurTap> taps;
+};
+
+
+// Get the kernel for the given settings, calculating it the first time it is requested. Even strengths are reduced by one
+// so the kernel is centred, and strengths are limited to MAX_BLUR_STRENGTH. The returned reference stays valid for the
+// life of the program. Safe to call from multiple threads
+const BlurKernel& GetBlurKernel(int strength, float sigma, bool linearSampling);
+
+// Copy a kernel's taps into the post-processing constants, two taps per CVector4 (weight, offset, weight, offset)
+void PackBlurKernel(const BlurKernel& kernel, PostProcessingConstants& constants);
+
+// Number of kernels calculated so far
+int NumCachedBlurKernels();
+
+
+#endif //_BLUR_KERNEL_H_INCLUDED_
@@ -15,6 +15,9 @@ Texture2D SceneTexture : register(t0);
 SamplerState PointSample : register(s0); // We don't usually want to filter (bilinear, trilinear etc.) the scene texture when
                                           // post-processing so this sampler will use "point sampling" - no filtering
 
+// The blur taps use bilinear filtering so that one fetch placed between two pixels reads both of them (see BlurKernel.h)
+SamplerState BilinearClamp : register(s1);
+
 
 //--------------------------------------------------------------------------------------
 // Shader code
@@ -24,14 +27,14 @@ SamplerState PointSample : register(s0); // We don't usually want to filter (bil
 float4 main(PostProcessingInput input) : SV_Target
 {
     float3 finalColour = float3(1.0, 0.0, 0.0);
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
     
 	// Sample a pixel from the scene texture and multiply it with the tint colour (comes from a constant buffer defined in Common.hlsli)
         float3 colour = SceneTexture.Sample(PointSample, input.sceneUV).rgb;
    
     
-        float pixelWidth = (1 / gViewportHeight) /** gBlurStrength*/;
+        float pixelWidth = (1 / gViewportHeight);
 
         float2 samp = input.sceneUV;
 
@@ -40,10 +43,12 @@ float4 main(PostProcessingInput input) : SV_Target
 
         finalColour = (0.0f, 0.0f, 0.0f);
     
-        for (int j = 0; j < gBlurStrength; j++)
+        // Taps are packed two per element as (weight, offset, weight, offset)
+        for (int j = 0; j < gBlurTapCount; j++)
         {
-            samp.y = input.sceneUV.y + gKernel[j].x * pixelWidth;
-            finalColour += SceneTexture.Sample(PointSample, samp.xy).rgb * gWeight[j].x;
+            float2 tap = (j % 2 == 0) ? gBlurTaps[j / 2].xy : gBlurTaps[j / 2].zw;
+            samp.y = input.sceneUV.y + tap.y * pixelWidth;
+            finalColour += SceneTexture.Sample(BilinearClamp, samp.xy).rgb * tap.x;
         }
 
     }
@@ -4,12 +4,20 @@
 // Holds position, rotation, near/far clip and field of view. These to a view and projection matrices as required
 
 #include "Camera.h"
-#include "Common.h"
+#include "MatrixSimd.h"
+#include <cmath>
+
+// Speeds for Control, set in Scene.cpp (declared here rather than through Common.h to keep the camera free of DirectX)
+extern const float ROTATION_SPEED;
+extern const float MOVEMENT_SPEED;
 
 // Control the camera's position and rotation using keys provided
 void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
                                       KeyCode moveForward, KeyCode moveBackward, KeyCode moveLeft, KeyCode moveRight)
 {
+	CVector3 oldPosition = mPosition;
+	CVector3 oldRotation = mRotation;
+
 	//**** ROTATION ****
 	if (KeyHeld(Key_Down))
 	{
@@ -53,32 +61,51 @@ void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode
 		mPosition.y -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e21;
 		mPosition.z -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e22;
 	}
+
+	// Only rebuild the matrices if the camera has moved
+	if (mPosition.x != oldPosition.x || mPosition.y != oldPosition.y || mPosition.z != oldPosition.z ||
+	    mRotation.x != oldRotation.x || mRotation.y != oldRotation.y || mRotation.z != oldRotation.z)
+	{
+		mDirtyMatrices |= WORLD_DIRTY;
+	}
 }
 
 
-// Update the matrices used for the camera in the rendering pipeline
+// Update the matrices used for the camera in the rendering pipeline, if any settings have changed
 void Camera::UpdateMatrices()
 {
-    // "World" matrix for the camera - treat it like a model at first
-    mWorldMatrix = MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
-
-    // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
-    mViewMatrix = InverseAffine(mWorldMatrix);
-
-    // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
-    float tanFOVx = std::tan(mFOVx * 0.5f);
-    float scaleX = 1.0f / tanFOVx;
-    float scaleY = mAspectRatio / tanFOVx;
-    float scaleZa = mFarClip / (mFarClip - mNearClip);
-    float scaleZb = -mNearClip * scaleZa;
-
-    mProjectionMatrix = { scaleX,   0.0f,    0.0f,   0.0f,
-                            0.0f, scaleY,    0.0f,   0.0f,
-                            0.0f,   0.0f, scaleZa,   1.0f,
-                            0.0f,   0.0f, scaleZb,   0.0f };
+    if (mDirtyMatrices == 0)  return;
+
+    if (mDirtyMatrices & WORLD_DIRTY)
+    {
+        // "World" matrix for the camera - treat it like a model at first
+        mWorldMatrix = MultiplySimd(MultiplySimd(MultiplySimd(MatrixRotationZ(mRotation.z), MatrixRotationX(mRotation.x)),
+                                                 MatrixRotationY(mRotation.y)), MatrixTranslation(mPosition));
+
+        // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
+        mViewMatrix = InverseAffineSimd(mWorldMatrix);
+    }
+
+    if (mDirtyMatrices & PROJECTION_DIRTY)
+    {
+        // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
+        mTanHalfFOVx = std::tan(mFOVx * 0.5f);
+        float scaleX = 1.0f / mTanHalfFOVx;
+        float scaleY = mAspectRatio / mTanHalfFOVx;
+        float scaleZa = mFarClip / (mFarClip - mNearClip);
+        float scaleZb = -mNearClip * scaleZa;
+
+        mProjectionMatrix = { scaleX,   0.0f,    0.0f,   0.0f,
+                                0.0f, scaleY,    0.0f,   0.0f,
+                                0.0f,   0.0f, scaleZa,   1.0f,
+                                0.0f,   0.0f, scaleZb,   0.0f };
+    }
 
     // The view-projection matrix combines the two matrices usually used for the camera into one, which can save a multiply in the shaders (optional)
-    mViewProjectionMatrix = mViewMatrix * mProjectionMatrix;
+    mViewProjectionMatrix = MultiplySimd(mViewMatrix, mProjectionMatrix);
+
+    mDirtyMatrices = 0;
+    ++mNumMatrixUpdates;
 }
 
 
@@ -98,14 +125,14 @@ CVector3 Camera::PixelFromWorldPt(CVector3 worldPoint, unsigned int viewportWidt
 	UpdateMatrices();
 
 	// Transform world point into camera space and return immediately if point is behind camera near clip (it won't be on screen - no 2D pixel position)
-	CVector4 cameraPt = CVector4(worldPoint, 1.0f) * mViewMatrix;
+	CVector4 cameraPt = TransformSimd(CVector4(worldPoint, 1.0f), mViewMatrix);
 	if (cameraPt.z < mNearClip)
 	{
 		return { 0, 0, cameraPt.z };
 	}
 
 	// Now transform into viewport (2D) space
-	CVector4 viewportPt = cameraPt * mProjectionMatrix;
+	CVector4 viewportPt = TransformSimd(cameraPt, mProjectionMatrix);
 
 	viewportPt.x /= viewportPt.w;
 	viewportPt.y /= viewportPt.w;
@@ -124,8 +151,10 @@ CVector2 Camera::PixelSizeInWorldSpace(float Z, unsigned int viewportWidth, unsi
 	CVector2 size;
 
 	// Size of the entire viewport in world space at the near clip distance - uses same geometry work that was shown in the camera picking lecture
+	UpdateMatrices();
+
 	CVector2 viewportSizeAtNearClip;
-    viewportSizeAtNearClip.x = 2 * mNearClip * std::tan(mFOVx * 0.5f);
+    viewportSizeAtNearClip.x = 2 * mNearClip * mTanHalfFOVx;
     viewportSizeAtNearClip.y = viewportSizeAtNearClip.x /  mAspectRatio;
 
 	// Size of the entire viewport in world space at the given Z distance
@@ -134,3 +163,22 @@ CVector2 Camera::PixelSizeInWorldSpace(float Z, unsigned int viewportWidth, unsi
 	// Return world size of single pixel at given Z distance
 	return { viewportSizeAtZ.x / viewportWidth, viewportSizeAtZ.y / viewportHeight };
 }
+
+
+// Project an array of world points to the screen in one go
+void Camera::ProjectToScreen(const CVector3* worldPoints, int numPoints, unsigned int viewportWidth, unsigned int viewportHeight,
+                             ScreenPoints& results, CVector4* clipPoints)
+{
+	UpdateMatrices();
+	::ProjectToScreen(worldPoints, numPoints, mViewProjectionMatrix, mProjectionMatrix, mNearClip, viewportWidth, viewportHeight,
+	                  results, clipPoints);
+}
+
+// Project an array of model points placed by a world matrix to the screen in one go
+void Camera::ProjectToScreen(const CVector3* modelPoints, int numPoints, const CMatrix4x4& worldMatrix,
+                             unsigned int viewportWidth, unsigned int viewportHeight, ScreenPoints& results, CVector4* clipPoints)
+{
+	UpdateMatrices();
+	::ProjectToScreen(modelPoints, numPoints, MultiplySimd(worldMatrix, mViewProjectionMatrix), mProjectionMatrix, mNearClip,
+	                  viewportWidth, viewportHeight, results, clipPoints);
+}
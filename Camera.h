@@ -2,10 +2,14 @@
 // Class encapsulating a camera
 //--------------------------------------------------------------------------------------
 // Holds position, rotation, near/far clip and field of view. These to a view and projection matrices as required
+// The matrices are only rebuilt when they are asked for after a setting has changed, so they can be fetched as often as
+// needed. Changing the position or rotation leaves the projection alone and changing the FOV or clip planes leaves the
+// camera's world and view matrices alone
 
 #include "CVector2.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "ScreenProjection.h"
 #include "MathHelpers.h"
 #include "Input.h"
 
@@ -40,23 +44,27 @@ public:
 	// Getters / setters
 	CVector3 Position()  { return mPosition; }
 	CVector3 Rotation()  { return mRotation;	}
-	void SetPosition(CVector3 position)  { mPosition = position; }
-	void SetRotation(CVector3 rotation)  { mRotation = rotation; }
+	void SetPosition(CVector3 position)  { mPosition = position; mDirtyMatrices |= WORLD_DIRTY; }
+	void SetRotation(CVector3 rotation)  { mRotation = rotation; mDirtyMatrices |= WORLD_DIRTY; }
 
 	float FOV()       { return mFOVx;     }
 	float NearClip()  { return mNearClip; }
 	float FarClip()   { return mFarClip;  }
 
-	void SetFOV     (float fov     )  { mFOVx     = fov;      }
-	void SetNearClip(float nearClip)  { mNearClip = nearClip; }
-	void SetFarClip (float farClip )  { mFarClip  = farClip;  }
+	void SetFOV     (float fov     )  { mFOVx     = fov;      mDirtyMatrices |= PROJECTION_DIRTY; }
+	void SetNearClip(float nearClip)  { mNearClip = nearClip; mDirtyMatrices |= PROJECTION_DIRTY; }
+	void SetFarClip (float farClip )  { mFarClip  = farClip;  mDirtyMatrices |= PROJECTION_DIRTY; }
 
-	// Read only access to camera matrices, updated on request from position, rotation and camera settings
+	// Read only access to camera matrices, updated on request from position, rotation and camera settings if any have
+	// changed since the last request
 	CMatrix4x4 WorldMatrix()           { UpdateMatrices(); return mWorldMatrix; }
 	CMatrix4x4 ViewMatrix()            { UpdateMatrices(); return mViewMatrix;           }
 	CMatrix4x4 ProjectionMatrix()      { UpdateMatrices(); return mProjectionMatrix;     }
 	CMatrix4x4 ViewProjectionMatrix()  { UpdateMatrices(); return mViewProjectionMatrix; }
 
+	// Number of times the matrices have been rebuilt, to show how much matrix work is being done
+	int NumMatrixUpdates()  { return mNumMatrixUpdates; }
+
 
 	//-------------------------------------
 	// Camera Picking
@@ -74,14 +82,27 @@ public:
 	// Pass the viewport width and height
 	CVector2 PixelSizeInWorldSpace(float Z, unsigned int viewportWidth, unsigned int viewportHeight);
 
+	// Project an array of world points to the screen in one go, giving the same pixel coordinates and distances as
+	// PixelFromWorldPt along with depths, pixel sizes and masks of the points that can be seen (see ScreenProjection.h).
+	// The second version takes points in model space and the world matrix placing them. If clipPoints is given it
+	// receives the clip space position of each point
+	void ProjectToScreen(const CVector3* worldPoints, int numPoints, unsigned int viewportWidth, unsigned int viewportHeight,
+	                     ScreenPoints& results, CVector4* clipPoints = nullptr);
+	void ProjectToScreen(const CVector3* modelPoints, int numPoints, const CMatrix4x4& worldMatrix,
+	                     unsigned int viewportWidth, unsigned int viewportHeight, ScreenPoints& results, CVector4* clipPoints = nullptr);
+
 
 //-------------------------------------
 // Private members
 //-------------------------------------
 private:
-	// Update the matrices used for the camera in the rendering pipeline
+	// Update the matrices used for the camera in the rendering pipeline, if any settings have changed
 	void UpdateMatrices();
 
+	// Which matrices need rebuilding
+	static const unsigned int WORLD_DIRTY      = 1; // World, view and view-projection
+	static const unsigned int PROJECTION_DIRTY = 2; // Projection and view-projection
+
 	// Postition and rotations for the camera (rarely scale cameras)
 	CVector3 mPosition;
 	CVector3 mRotation;
@@ -100,6 +121,10 @@ private:
 	CMatrix4x4 mProjectionMatrix;     // Projection matrix holds the field of view and near/far clip distances
 	CMatrix4x4 mViewProjectionMatrix; // Combine (multiply) the view and projection matrices together, which
 	                                  // can sometimes save a matrix multiply in the shader (optional)
+
+	float        mTanHalfFOVx;       // Kept from building the projection matrix, used for camera picking
+	unsigned int mDirtyMatrices = WORLD_DIRTY | PROJECTION_DIRTY;
+	int          mNumMatrixUpdates = 0;
 };
 
 
@@ -0,0 +1,181 @@
+//--------------------------------------------------------------------------------------
+// 3D colour lookup tables for runs of colour-only post-processes
+//--------------------------------------------------------------------------------------
+
+#include "ColourLut.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+	// The tint colours of a fused stage (see SetFusedStageConstants)
+	const CVector4& TopColour   (const PostProcessingConstants& constants, int stage)  { return constants.fusedTintColours[2 * stage]; }
+	const CVector4& BottomColour(const PostProcessingConstants& constants, int stage)  { return constants.fusedTintColours[2 * stage + 1]; }
+
+	bool IsTint(PostProcess postProcess)
+	{
+		return postProcess == PostProcess::Tint || postProcess == PostProcess::HueTint;
+	}
+
+	// Whether a tint stage uses the same colour over the whole screen
+	bool IsUniformTint(const PostProcessingConstants& constants, int stage)
+	{
+		const CVector4& top = TopColour(constants, stage);
+		const CVector4& bottom = BottomColour(constants, stage);
+		return top.x == bottom.x && top.y == bottom.y && top.z == bottom.z;
+	}
+
+	float Saturate(float x)  { return std::min(std::max(x, 0.0f), 1.0f); }
+
+	// One colour-only stage - the same maths as FusedEffects.hlsli, clamped as the render targets would
+	CVector3 ApplyColourStage(PostProcess postProcess, const CVector4& tint, CVector3 colour)
+	{
+		switch (postProcess)
+		{
+			case PostProcess::Tint:
+			case PostProcess::HueTint:
+				colour = { colour.x * tint.x, colour.y * tint.y, colour.z * tint.z };
+				break;
+
+			case PostProcess::Inverted:
+				colour = { 1.0f - colour.x, 1.0f - colour.y, 1.0f - colour.z };
+				break;
+
+			case PostProcess::NightVision:
+			{
+				float average = (colour.x + colour.y + colour.z) * 4.0f / 3.0f;
+				if (average < 1.2f)
+				{
+					average /= 4.0f;
+				}
+				colour = { 0.0f, average, 0.0f };
+				break;
+			}
+
+			case PostProcess::Retro:
+				colour = { std::floor(colour.x * 10.0f) / 10.0f * 1.3f,
+				           std::floor(colour.y * 10.0f) / 10.0f * 1.3f,
+				           std::floor(colour.z * 10.0f) / 10.0f * 1.3f };
+				break;
+
+			default:
+				break;
+		}
+		return { Saturate(colour.x), Saturate(colour.y), Saturate(colour.z) };
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Planning
+//--------------------------------------------------------------------------------------
+
+// Decide whether the stages of a fused pass can use a colour LUT and how
+bool PlanColourLut(const std::vector<PostProcess>& stages, const PostProcessingConstants& constants, ColourLutPlan& plan)
+{
+	plan = ColourLutPlan();
+	int numStages = static_cast<int>(stages.size());
+	for (int stage = 0; stage < numStages; ++stage)
+	{
+		PostProcess postProcess = stages[stage];
+		if (IsTint(postProcess) && !IsUniformTint(constants, stage))
+		{
+			// A tint that changes down the screen can only be applied outside the table
+			if (stage == 0)                   plan.preTintStage = 0;
+			else if (stage == numStages - 1)  plan.postTintStage = stage;
+			else                              return false;
+		}
+		else if (postProcess == PostProcess::Retro && stage != 0)
+		{
+			return false; // Fused passes only allow Retro first
+		}
+		else
+		{
+			plan.retroSample |= (postProcess == PostProcess::Retro);
+			plan.bakedStages.push_back(stage);
+		}
+	}
+	return !plan.bakedStages.empty();
+}
+
+
+// Copy the settings of a plan into the colour LUT part of the constants
+void SetColourLutConstants(const ColourLutPlan& plan, int size, PostProcessingConstants& constants)
+{
+	const CVector4 white = { 1, 1, 1, 0 };
+	constants.lutPreTintColours[0]  = (plan.preTintStage  < 0) ? white : TopColour   (constants, plan.preTintStage);
+	constants.lutPreTintColours[1]  = (plan.preTintStage  < 0) ? white : BottomColour(constants, plan.preTintStage);
+	constants.lutPostTintColours[0] = (plan.postTintStage < 0) ? white : TopColour   (constants, plan.postTintStage);
+	constants.lutPostTintColours[1] = (plan.postTintStage < 0) ? white : BottomColour(constants, plan.postTintStage);
+	constants.lutSize = static_cast<float>(std::max(size, 2));
+	constants.lutRetroSample = plan.retroSample ? 1 : 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Baking
+//--------------------------------------------------------------------------------------
+
+// Evaluate the baked stages of a plan for every entry in a table of the given size
+void BakeColourLut(const std::vector<PostProcess>& stages, const ColourLutPlan& plan,
+                   const PostProcessingConstants& constants, int size, ColourLut& lut)
+{
+	lut.size = std::max(size, 2);
+	lut.entries.resize(static_cast<size_t>(lut.size) * lut.size * lut.size);
+
+	float scale = 1.0f / (lut.size - 1);
+	gThreadPool.ParallelFor(0, lut.size, [&](int firstSlice, int lastSlice)
+	{
+		for (int b = firstSlice; b < lastSlice; ++b)
+		{
+			for (int g = 0; g < lut.size; ++g)
+			{
+				CVector4* row = &lut.entries[(static_cast<size_t>(b) * lut.size + g) * lut.size];
+				for (int r = 0; r < lut.size; ++r)
+				{
+					CVector3 colour = { r * scale, g * scale, b * scale };
+					for (int stage : plan.bakedStages)
+					{
+						colour = ApplyColourStage(stages[stage], TopColour(constants, stage), colour);
+					}
+					row[r] = CVector4(colour, 0);
+				}
+			}
+		}
+	});
+}
+
+
+// Return the table for the given plan, rebaking it first if anything it depends on has changed
+const ColourLut& ColourLutCache::Get(const std::vector<PostProcess>& stages, const ColourLutPlan& plan,
+                                     const PostProcessingConstants& constants, int size)
+{
+	std::vector<PostProcess> bakedStages;
+	std::vector<CVector3>    bakedColours;
+	for (int stage : plan.bakedStages)
+	{
+		bakedStages.push_back(stages[stage]);
+		const CVector4& tint = TopColour(constants, stage);
+		bakedColours.push_back(IsTint(stages[stage]) ? CVector3{ tint.x, tint.y, tint.z } : CVector3{ 0, 0, 0 });
+	}
+
+	bool coloursMatch = bakedColours.size() == mBakedColours.size();
+	for (size_t i = 0; coloursMatch && i < bakedColours.size(); ++i)
+	{
+		coloursMatch = bakedColours[i].x == mBakedColours[i].x && bakedColours[i].y == mBakedColours[i].y &&
+		               bakedColours[i].z == mBakedColours[i].z;
+	}
+
+	mRebaked = (mLut.size != std::max(size, 2) || bakedStages != mBakedStages || !coloursMatch);
+	if (mRebaked)
+	{
+		BakeColourLut(stages, plan, constants, size, mLut);
+		mBakedStages = bakedStages;
+		mBakedColours = bakedColours;
+		++mNumBakes;
+	}
+	return mLut;
+}
@@ -0,0 +1,91 @@
+//--------------------------------------------------------------------------------------
+// 3D colour lookup tables for runs of colour-only post-processes
+//--------------------------------------------------------------------------------------
+// Inverted, NightVision, Retro's colour reduction and a Tint/HueTint with the same top and bottom colour only depend on
+// the colour of the pixel being processed. A run of them in a fused pass (see PostProcessFusion.h) is then just a fixed
+// function from one colour to another, which can be baked into a 3D table and applied with a single trilinear lookup per
+// pixel - the cost no longer depends on how many effects are in the run.
+//
+// Tints that blend from the top to the bottom of the screen depend on the pixel position as well, so they can't go in
+// the table. They are allowed at the very start or end of a run, and applied just before or after the lookup. Retro as
+// the first stage reads the scene at its snapped position, then its colour reduction goes in the table as usual.
+//
+// The table is only rebaked when the baked stages or their settings change (ColourLutCache). Colours between the table
+// entries are interpolated, which smooths out the hard steps in NightVision and Retro over the width of one table cell,
+// so a larger table gets closer to the separate effects.
+// Portable C++ - shared by the GPU path (PostProcessPasses.h uploads the table to a 3D texture) and the CPU engine
+
+#ifndef _COLOUR_LUT_H_INCLUDED_
+#define _COLOUR_LUT_H_INCLUDED_
+
+#include "PostProcess.h"
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Planning
+//--------------------------------------------------------------------------------------
+
+// How the stages of a fused pass are split up to use a colour LUT
+struct ColourLutPlan
+{
+	bool retroSample   = false; // The first stage is Retro - read the scene at its snapped position
+	int  preTintStage  = -1;    // Stage whose tint is applied before the lookup, -1 for none
+	int  postTintStage = -1;    // Stage whose tint is applied after the lookup, -1 for none
+	std::vector<int> bakedStages; // Stages evaluated into the table, in order
+};
+
+// Decide whether the stages of a fused pass can use a colour LUT and how. The constants must hold the settings of each
+// stage (see SetFusedStageConstants). Returns false if a tint blending from top to bottom is in the middle of the
+// stages, or if nothing would be left to bake into the table
+bool PlanColourLut(const std::vector<PostProcess>& stages, const PostProcessingConstants& constants, ColourLutPlan& plan);
+
+// Copy the settings of a plan into the colour LUT part of the constants (the tints not baked into the table are
+// taken from the fused stage settings, white if there is no tint)
+void SetColourLutConstants(const ColourLutPlan& plan, int size, PostProcessingConstants& constants);
+
+
+//--------------------------------------------------------------------------------------
+// Baking
+//--------------------------------------------------------------------------------------
+
+// A baked table of size x size x size RGB colours (w unused). The red index changes fastest, then green then blue, which
+// is the layout of a 3D texture. Entry (r, g, b) holds the result for input colour (r, g, b) / (size - 1)
+struct ColourLut
+{
+	int size = 0;
+	std::vector<CVector4> entries;
+};
+
+// Evaluate the baked stages of a plan for every entry in a table of the given size
+void BakeColourLut(const std::vector<PostProcess>& stages, const ColourLutPlan& plan,
+                   const PostProcessingConstants& constants, int size, ColourLut& lut);
+
+
+// Keeps the last table baked for one fused pass and only rebakes it when the baked stages, their settings or the table
+// size change. Keep one cache for each fused pass in the post-process list
+class ColourLutCache
+{
+public:
+	// Return the table for the given plan, rebaking it first if anything it depends on has changed
+	const ColourLut& Get(const std::vector<PostProcess>& stages, const ColourLutPlan& plan,
+	                     const PostProcessingConstants& constants, int size);
+
+	// Whether the last call to Get rebaked the table (so a GPU copy needs updating)
+	bool Rebaked() const  { return mRebaked; }
+
+	// Number of times the table has been baked
+	int NumBakes() const  { return mNumBakes; }
+
+private:
+	std::vector<PostProcess> mBakedStages;  // What the current table was baked from
+	std::vector<CVector3>    mBakedColours; // Tint colour of each baked stage
+
+	ColourLut mLut;
+	bool      mRebaked  = false;
+	int       mNumBakes = 0;
+};
+
+
+#endif //_COLOUR_LUT_H_INCLUDED_
@@ -0,0 +1,43 @@
+//--------------------------------------------------------------------------------------
+// Colour LUT Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Runs a fused pass of colour-only effects with a single lookup into a 3D colour table baked on the C++ side (see
+// ColourLut.h). Tints that change down the screen can't be baked, so they are applied before and after the lookup
+
+#include "Common.hlsli"
+#include "FusedEffects.hlsli" // Scene texture and the Retro sampling
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+Texture3D ColourLut : register(t1);
+SamplerState LutSample : register(s1); // Bilinear with clamp addressing - filtering a 3D texture is trilinear
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+float4 main(PostProcessingInput input) : SV_Target
+{
+    float3 colour = float3(1.0, 0.0, 0.0);
+    if (EffectSideOfMidLine(input.sceneUV))
+    {
+        colour = gLutRetroSample ? RetroSample(input.sceneUV) : SceneTexture.Sample(PointSample, input.sceneUV).rgb;
+        colour = saturate(colour * lerp(gLutPreTintColours[0].rgb, gLutPreTintColours[1].rgb, input.sceneUV.y));
+
+        // Table entries are at texel centres, so scale and offset the colour to sample between the first and last centres
+        float scale = (gLutSize - 1) / gLutSize;
+        float offset = 0.5 / gLutSize;
+        colour = ColourLut.Sample(LutSample, colour * scale + offset).rgb;
+
+        colour = saturate(colour * lerp(gLutPostTintColours[0].rgb, gLutPostTintColours[1].rgb, input.sceneUV.y));
+    }
+    else if (input.sceneUV.x >= (gMidLine + 0.002))
+    {
+        colour = SceneTexture.Sample(PointSample, input.sceneUV).rgb;
+    }
+
+    return float4(colour, 1.0f);
+}
@@ -7,6 +7,8 @@
 #include "CVector2.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "PostProcess.h"
+#include "ConstantBlocks.h"
 
 #include <d3d11.h>
 #include <string>
@@ -108,87 +110,10 @@ extern ID3D11Buffer*     gPerModelConstantBuffer; // This variable controls the
 
 //**************************
 
-// Settings used by post-processes - must match the similar structure in the Common.hlsli shader file
-struct PostProcessingConstants
-{
-	
-
-	CVector2 area2DTopLeft; // Top-left of post-process area on screen, provided as coordinate from 0.0->1.0 not as a pixel coordinate
-	CVector2 area2DSize;    // Size of post-process area on screen, provided as sizes from 0.0->1.0 (1 = full screen) not as a size in pixels
-	float    area2DDepth;   // Depth buffer value for area (0.0 nearest to 1.0 furthest). Full screen post-processing uses 0.0f
-	CVector3 paddingA;      // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
-
-	CVector4 polygon2DPoints[4]; // Four points of a polygon in 2D viewport space for polygon post-processing. Matrix transformations already done on C++ side
-	
-	float    MidLine;
-	CVector3 paddingZ;
-	
-	bool	 MidLineEnabled;
-	CVector3 paddingY;
-
-	bool	 IsFullScreen;
-	CVector3 paddingK;
-	
-	
-
-	// Tint post-process settings
-	CVector3 tintTopColour;
-	float    paddingB;  // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
-
-	CVector3 tintBottomColour;
-	float    paddingC;  // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
-
-	// HueTint post-process settings
-	float    HueWiggle;  // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
-	float    HueWiggleSpeed;
-	CVector2 paddingD;
-
-	// Underwater post-process settiings
-	CVector3 waterColour;
-	float    Wiggle;  // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
-
-	float    WiggleSpeed;
-	CVector3 paddingE;
-
-	//Retro post-processing settintgs
-
-	// Grey noise post-process settings
-    CVector2 noiseScale;
-	CVector2 noiseOffset;
-
-	// Burn post-process settings
-	float    burnHeight;
-	CVector3 paddingG;
-
-	// Distort post-process settings
-	float    distortLevel;
-	CVector3 paddingH;
-
-	// Spiral post-process settings
-	float    spiralLevel;
-	CVector3 paddingI;
-
-	// Heat haze post-process settings
-	float    heatHazeTimer;
-	CVector3 paddingJ;
-
-	// Bloom post processing effects
-	float bloomThreshold;
-	CVector3 paddingF;
-
-	// DOF post processing effects
-	float depthThreshold;
-	CVector3 paddingM;
-
-	// Blur post-process settings
-	CVector4 weight[100];
-	CVector4 kernel[100];
-	int blurStrength;
-	float paddingL;
-	
-};
+// Settings used by post-processes - the PostProcessingConstants structure is in PostProcess.h so it can be shared with the CPU engine
 extern PostProcessingConstants gPostProcessingConstants;      // This variable holds the CPU-side constant buffer described above
-extern ID3D11Buffer*           gPostProcessingConstantBuffer; // This variable controls the GPU-side constant buffer related to the above structure
+extern ID3D11Buffer*           gPostProcessingConstantBuffers[NUM_POST_PROCESS_CONSTANT_BLOCKS]; // These variables control the GPU-side constant buffers
+                                                                                                 // holding each block of the above structure
 
 //**************************
 
@@ -117,30 +117,39 @@ cbuffer PerModelConstants : register(b1) // The b1 gives this constant buffer th
 
 //**************************
 
+// Largest number of effects in one fused pass - must match MAX_FUSED_STAGES in PostProcess.h
+static const int MAX_FUSED_STAGES = 8;
+
 // This is where we receive post-processing settings from the C++ side
-// These variables must match exactly the gPostProcessingConstants structure in Scene.cpp
-// Note that this buffer reuses the same index (register) as the per-model buffer above since they won't be used together
+// These variables must match exactly the PostProcessingConstants structure in PostProcess.h, which is sent over in
+// blocks - one constant buffer for each block so a draw only receives the blocks that have changed (see ConstantBlocks.h)
+// Note that the area buffer reuses the same index (register) as the per-model buffer above since they won't be used together
 cbuffer PostProcessingConstants : register(b1) 
 {
-    
-    
 	float2 gArea2DTopLeft; // Top-left of post-process area on screen, provided as coordinate from 0.0->1.0 not as a pixel coordinate
 	float2 gArea2DSize;    // Size of post-process area on screen, provided as sizes from 0.0->1.0 (1 = full screen) not as a size in pixels
 	float  gArea2DDepth;   // Depth buffer value for area (0.0 nearest to 1.0 furthest). Full screen post-processing uses 0.0f
 	float3 paddingA;       // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
 
   	float4 gPolygon2DPoints[4]; // Four points of a polygon in 2D viewport space for polygon post-processing. Matrix transformations already done on C++ side
-   
+    
+    bool gIsFullScreen;
+    float3 paddingK;
+}
+
+// The split screen mid-line
+cbuffer PostProcessFrameConstants : register(b3)
+{
     float gMidLine;
     float3 paddingZ;
     
     bool gMidLineEnabled;
     float3 paddingY;
-    
-    bool gIsFullScreen;
-    float3 paddingK;
-    
-    
+}
+
+// Settings of the single effects
+cbuffer PostProcessEffectConstants : register(b4)
+{
 	// Tint post-process settings
     float3 gtintTopColour;
     float paddingB; // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
@@ -190,13 +199,46 @@ cbuffer PostProcessingConstants : register(b1)
     // DOF post processing effects
     float gDepthThreshold;
     float3 paddingM;
-    
-    // Blur post-process settings
-    float4 gWeight[100];
-    float4 gKernel[100];
-    int gBlurStrength;
-    float paddingL;
-   
+}
+
+// Blur kernel, only sent again when the blur settings change
+cbuffer PostProcessBlurConstants : register(b5)
+{
+    // Blur post-process settings - two taps packed in each element as (weight, offset, weight, offset)
+    float4 gBlurTaps[50];
+    int gBlurTapCount;
+    float3 paddingL;
+}
+
+// Settings of fused and colour LUT passes
+cbuffer PostProcessFusedConstants : register(b6)
+{
+    // Fused pass settings - the top and bottom tint colours for each stage (see FusedEffects.hlsli)
+    float4 gFusedTintColours[2 * MAX_FUSED_STAGES];
+    
+    // Colour LUT pass settings - top and bottom tint colours applied before and after the lookup (see ColourLut_pp.hlsl)
+    float4 gLutPreTintColours[2];
+    float4 gLutPostTintColours[2];
+    float gLutSize;
+    int gLutRetroSample;
+    float2 paddingN;
+}
+
+
+// Split-screen mid-line. Each effect shader is compiled in two variants (see ShaderVariant in PostProcess.h) - without
+// MIDLINE_SPLIT (the compiled .cso files) the check below is compiled out, with MIDLINE_SPLIT 1 it is made per pixel
+#ifndef MIDLINE_SPLIT
+#define MIDLINE_SPLIT 0
+#endif
+
+// Whether the effect is drawn at the given point - to the left of the mid-line, or everywhere if it isn't shown
+bool EffectSideOfMidLine(float2 sceneUV)
+{
+#if MIDLINE_SPLIT
+    return gMidLineEnabled == false || gIsFullScreen == false || sceneUV.x < (gMidLine - 0.002);
+#else
+    return true;
+#endif
 }
 
 //**************************
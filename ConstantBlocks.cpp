@@ -0,0 +1,123 @@
+//--------------------------------------------------------------------------------------
+// Sending post-processing constants to the GPU in blocks
+//--------------------------------------------------------------------------------------
+
+#include "ConstantBlocks.h"
+
+
+//--------------------------------------------------------------------------------------
+// Blocks
+//--------------------------------------------------------------------------------------
+
+// Each block starts at its first member and runs up to the start of the next block
+static const size_t BLOCK_STARTS[NUM_POST_PROCESS_CONSTANT_BLOCKS + 1] =
+{
+	offsetof(PostProcessingConstants, area2DTopLeft),
+	offsetof(PostProcessingConstants, MidLine),
+	offsetof(PostProcessingConstants, tintTopColour),
+	offsetof(PostProcessingConstants, blurTaps),
+	offsetof(PostProcessingConstants, fusedTintColours),
+	sizeof(PostProcessingConstants),
+};
+
+static_assert(offsetof(PostProcessingConstants, MidLine) % 16 == 0,          "Area block must be a multiple of 16 bytes");
+static_assert(offsetof(PostProcessingConstants, tintTopColour) % 16 == 0,    "Frame block must be a multiple of 16 bytes");
+static_assert(offsetof(PostProcessingConstants, blurTaps) % 16 == 0,         "Effect block must be a multiple of 16 bytes");
+static_assert(offsetof(PostProcessingConstants, fusedTintColours) % 16 == 0, "Blur block must be a multiple of 16 bytes");
+static_assert(sizeof(PostProcessingConstants) % 16 == 0,                     "Fused block must be a multiple of 16 bytes");
+
+
+// Position of a block in PostProcessingConstants and its size in bytes
+void PostProcessConstantBlockRange(PostProcessConstantBlock block, size_t& offset, size_t& size)
+{
+	int b = static_cast<int>(block);
+	offset = BLOCK_STARTS[b];
+	size = BLOCK_STARTS[b + 1] - BLOCK_STARTS[b];
+}
+
+
+// Blocks read by the shaders drawing a single post-process
+unsigned int PostProcessConstantBlocks(PostProcess postProcess)
+{
+	// Every draw needs the area for the vertex shader, and all the effect shaders check the mid-line
+	unsigned int blocks = ConstantBlockBit(PostProcessConstantBlock::Area);
+	switch (postProcess)
+	{
+		case PostProcess::None:
+		case PostProcess::Copy:
+			return blocks;
+
+		case PostProcess::Inverted:
+		case PostProcess::NightVision:
+		case PostProcess::Retro:
+		case PostProcess::Bloom2:
+			return blocks | ConstantBlockBit(PostProcessConstantBlock::Frame);
+
+		case PostProcess::BlurH:
+		case PostProcess::BlurV:
+			return blocks | ConstantBlockBit(PostProcessConstantBlock::Frame) | ConstantBlockBit(PostProcessConstantBlock::Blur);
+
+		default:
+			return blocks | ConstantBlockBit(PostProcessConstantBlock::Frame) | ConstantBlockBit(PostProcessConstantBlock::Effect);
+	}
+}
+
+
+// Blocks read by the shaders drawing a fused pass or its colour LUT version
+unsigned int FusedPassConstantBlocks()
+{
+	return ConstantBlockBit(PostProcessConstantBlock::Area) | ConstantBlockBit(PostProcessConstantBlock::Frame) |
+	       ConstantBlockBit(PostProcessConstantBlock::Fused);
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Tracking
+//--------------------------------------------------------------------------------------
+
+// Whether a block must be sent to the GPU before a draw
+bool ConstantBlockTracker::NeedsUpload(PostProcessConstantBlock block, const PostProcessingConstants& constants)
+{
+	size_t offset, size;
+	PostProcessConstantBlockRange(block, offset, size);
+	uint64_t hash = HashBytes(reinterpret_cast<const char*>(&constants) + offset, size);
+
+	int b = static_cast<int>(block);
+	if (mValid[b] && mHashes[b] == hash)
+	{
+		mFrameStats.numSkipped++;
+		mFrameStats.bytesSkipped += size;
+		return false;
+	}
+
+	mHashes[b] = hash;
+	mValid[b] = true;
+	mFrameStats.numUploads++;
+	mFrameStats.bytesUploaded += size;
+	return true;
+}
+
+
+// Forget the contents of all the blocks
+void ConstantBlockTracker::Reset()
+{
+	for (int b = 0; b < NUM_POST_PROCESS_CONSTANT_BLOCKS; ++b)
+	{
+		mHashes[b] = 0;
+		mValid[b] = false;
+	}
+}
+
+
+// 64-bit FNV-1a hash of some bytes
+uint64_t HashBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
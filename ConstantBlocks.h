@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// Sending post-processing constants to the GPU in blocks
+//--------------------------------------------------------------------------------------
+// PostProcessingConstants used to go to the GPU whole before every post-process draw, even a Copy that reads none of
+// it. Most of its size is the blur taps and the fused pass colours, which only a few passes read and which rarely
+// change. The structure is now split into blocks, each its own constant buffer on the GPU (see Common.hlsli):
+// - Area:   where the draw goes on screen, read by the vertex shaders (and whether the pass is full screen)
+// - Frame:  the split screen mid-line, which only changes when the user moves it
+// - Effect: the settings of the single effects
+// - Blur:   the blur kernel, which only changes with the blur settings
+// - Fused:  the settings of fused and colour LUT passes
+// Each draw sends only the blocks its shaders read (PostProcessConstantBlocks), and a block is only sent if its contents
+// have changed since it was last sent (ConstantBlockTracker keeps a hash of what each buffer holds).
+// Portable C++ - used by the GPU path (Scene.cpp), no Windows or DirectX dependencies
+
+#ifndef _CONSTANT_BLOCKS_H_INCLUDED_
+#define _CONSTANT_BLOCKS_H_INCLUDED_
+
+#include "PostProcess.h"
+
+#include <cstddef>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Blocks
+//--------------------------------------------------------------------------------------
+
+// Blocks of PostProcessingConstants, in the order they appear in the structure
+enum class PostProcessConstantBlock
+{
+	Area,   // Shader register b1
+	Frame,  // b3
+	Effect, // b4
+	Blur,   // b5
+	Fused,  // b6
+};
+const int NUM_POST_PROCESS_CONSTANT_BLOCKS = 5;
+
+// Bit for a block in a set of blocks
+inline unsigned int ConstantBlockBit(PostProcessConstantBlock block)  { return 1u << static_cast<int>(block); }
+
+// Position of a block in PostProcessingConstants and its size in bytes (a multiple of 16)
+void PostProcessConstantBlockRange(PostProcessConstantBlock block, size_t& offset, size_t& size);
+
+// Blocks read by the shaders drawing a single post-process (as ConstantBlockBit values)
+unsigned int PostProcessConstantBlocks(PostProcess postProcess);
+
+// Blocks read by the shaders drawing a fused pass (PostProcessFusion.h) or its colour LUT version (ColourLut.h)
+unsigned int FusedPassConstantBlocks();
+
+
+
+//--------------------------------------------------------------------------------------
+// Tracking
+//--------------------------------------------------------------------------------------
+
+// Bytes sent to the GPU for post-processing constants in a frame
+struct ConstantUploadStats
+{
+	int      numRequests   = 0; // Times the constants were needed by a draw
+	int      numUploads    = 0; // Blocks sent
+	int      numSkipped    = 0; // Blocks needed but unchanged since they were last sent
+	uint64_t bytesUploaded = 0;
+	uint64_t bytesSkipped  = 0;
+};
+
+// Remembers what each block's constant buffer holds, so a block is only sent when its contents change
+class ConstantBlockTracker
+{
+public:
+	ConstantBlockTracker()  { Reset(); }
+
+	// Whether a block must be sent to the GPU before a draw - the first time, and whenever its contents have changed
+	// since it was last sent. Returning true assumes the block is then sent. Counted in the frame's stats
+	bool NeedsUpload(PostProcessConstantBlock block, const PostProcessingConstants& constants);
+
+	// Count a draw needing the constants (the blocks are counted by NeedsUpload)
+	void CountRequest()  { mFrameStats.numRequests++; }
+
+	// Forget the contents of a block, or of all of them (e.g. if sending failed or the buffers were recreated)
+	void Invalidate(PostProcessConstantBlock block)  { mValid[static_cast<int>(block)] = false; }
+	void Reset();
+
+	// Start counting a new frame
+	void NewFrame()  { mFrameStats = ConstantUploadStats(); }
+	const ConstantUploadStats& FrameStats() const  { return mFrameStats; }
+
+private:
+	uint64_t mHashes[NUM_POST_PROCESS_CONSTANT_BLOCKS];
+	bool     mValid[NUM_POST_PROCESS_CONSTANT_BLOCKS];
+	ConstantUploadStats mFrameStats;
+};
+
+
+// 64-bit FNV-1a hash of some bytes
+uint64_t HashBytes(const void* data, size_t size);
+
+
+#endif //_CONSTANT_BLOCKS_H_INCLUDED_
@@ -0,0 +1,165 @@
+//--------------------------------------------------------------------------------------
+// Bloom chain for the CPU post-processing engine
+//--------------------------------------------------------------------------------------
+
+#include "CpuBloom.h"
+#include "CpuSimd.h"
+#include "ThreadPool.h"
+
+#include <array>
+
+
+namespace
+{
+	inline Float4 LoadColour(const CpuColour& colour)  { return Float4::Load(&colour.r); }
+	inline void   StoreColour(Float4 value, CpuColour& colour)  { value.Store(&colour.r); }
+
+	inline Float4 SamplePoint (const CpuImage& image, float u, float v)  { return LoadColour(image.SamplePoint(u, v)); }
+	inline Float4 SampleLinear(const CpuImage& image, float u, float v)  { return LoadColour(image.SampleLinearClamp(u, v)); }
+
+
+	//-------------------------------------
+	// Shaders
+	//-------------------------------------
+	// Each takes the UV of the centre of the pixel being written, as the shaders receive in sceneUV
+
+	// The source pixel at the given UV, or black if it is below the bloom threshold - BloomThreshold_pp.hlsl
+	inline Float4 BrightPixel(const CpuImage& source, float u, float v, float threshold)
+	{
+		CpuColour colour = source.SamplePoint(u, v);
+		if ((colour.r + colour.g + colour.b) / 3 < threshold)  return Float4(0.0f);
+		return LoadColour(colour);
+	}
+
+	// Average of the thresholded 2x2 source pixels under a half size pixel - BloomThreshold_pp.hlsl
+	Float4 ThresholdDownsample(const CpuImage& source, float u, float v, float threshold)
+	{
+		float halfTexelU = 0.5f / source.Width();
+		float halfTexelV = 0.5f / source.Height();
+		return (BrightPixel(source, u - halfTexelU, v - halfTexelV, threshold) + BrightPixel(source, u + halfTexelU, v - halfTexelV, threshold) +
+		        BrightPixel(source, u - halfTexelU, v + halfTexelV, threshold) + BrightPixel(source, u + halfTexelU, v + halfTexelV, threshold)) * 0.25f;
+	}
+
+	// Four bilinear reads on texel corners averaging a 4x4 block - BloomDownsample_pp.hlsl
+	Float4 Downsample(const CpuImage& source, float u, float v)
+	{
+		float texelU = 1.0f / source.Width();
+		float texelV = 1.0f / source.Height();
+		return (SampleLinear(source, u - texelU, v - texelV) + SampleLinear(source, u + texelU, v - texelV) +
+		        SampleLinear(source, u - texelU, v + texelV) + SampleLinear(source, u + texelU, v + texelV)) * 0.25f;
+	}
+
+	// 3x3 tent filter from nine bilinear reads one texel apart - TentSample in Bloom.hlsli
+	Float4 TentSample(const CpuImage& source, float u, float v)
+	{
+		float texelU = 1.0f / source.Width();
+		float texelV = 1.0f / source.Height();
+		Float4 colour = SampleLinear(source, u, v) * 4.0f;
+		colour = colour + (SampleLinear(source, u - texelU, v) + SampleLinear(source, u + texelU, v) +
+		                   SampleLinear(source, u, v - texelV) + SampleLinear(source, u, v + texelV)) * 2.0f;
+		colour = colour +  SampleLinear(source, u - texelU, v - texelV) + SampleLinear(source, u + texelU, v - texelV) +
+		                   SampleLinear(source, u - texelU, v + texelV) + SampleLinear(source, u + texelU, v + texelV);
+		return colour * (1.0f / 16.0f);
+	}
+
+
+	//-------------------------------------
+	// Pass driver
+	//-------------------------------------
+
+	// Write every pixel of dest with shader(u, v). Alpha is set to 1 as the shaders do. If add is true the result is added
+	// to the existing contents (additive blending). Chain levels are floating point on the GPU, so no saturation here
+	template <class Shader>
+	void RunLevelPass(CpuImage& dest, bool add, const Shader& shader)
+	{
+		int width = dest.Width();
+		float invWidth  = 1.0f / width;
+		float invHeight = 1.0f / dest.Height();
+		gThreadPool.ParallelFor(0, dest.Height(), [&](int firstRow, int lastRow)
+		{
+			for (int y = firstRow; y < lastRow; ++y)
+			{
+				CpuColour* out = dest.Row(y);
+				float v = (y + 0.5f) * invHeight;
+				for (int x = 0; x < width; ++x)
+				{
+					Float4 colour = shader((x + 0.5f) * invWidth, v) * Float4(1, 1, 1, 0);
+					if (add)  colour = colour + LoadColour(out[x]);
+					StoreColour(colour * Float4(1, 1, 1, 0) + Float4(0, 0, 0, 1), out[x]);
+				}
+			}
+		});
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Bloom
+//--------------------------------------------------------------------------------------
+
+// Run the whole bloom effect from source to dest using the bloomThreshold and split-screen settings in the constants
+void CpuBloomPostProcess(const PostProcessingConstants& constants, const CpuImage& source, CpuImage& dest)
+{
+	thread_local std::array<CpuImage, NUM_BLOOM_LEVELS> levels;
+	for (int level = 0; level < NUM_BLOOM_LEVELS; ++level)
+	{
+		int levelWidth, levelHeight;
+		BloomLevelSize(level, source.Width(), source.Height(), levelWidth, levelHeight);
+		if (levels[level].Width() != levelWidth || levels[level].Height() != levelHeight)
+		{
+			levels[level].Resize(levelWidth, levelHeight);
+		}
+	}
+
+	// Threshold into the half size level, then downsample to the smaller levels
+	float threshold = constants.bloomThreshold;
+	RunLevelPass(levels[0], false, [&](float u, float v) { return ThresholdDownsample(source, u, v, threshold); });
+	for (int level = 1; level < NUM_BLOOM_LEVELS; ++level)
+	{
+		const CpuImage& larger = levels[level - 1];
+		RunLevelPass(levels[level], false, [&](float u, float v) { return Downsample(larger, u, v); });
+	}
+
+	// Back up the chain, blurring each level and adding it onto the level above
+	for (int level = NUM_BLOOM_LEVELS - 1; level > 0; --level)
+	{
+		const CpuImage& smaller = levels[level];
+		RunLevelPass(levels[level - 1], true, [&](float u, float v) { return TentSample(smaller, u, v); });
+	}
+
+	// Composite onto the scene, with the split-screen mid-line logic - BloomComposite_pp.hlsl
+	dest.Resize(source.Width(), source.Height());
+	const CpuImage& top = levels[0];
+	bool splitScreen = PostProcessShaderVariant(constants) == ShaderVariant::MidLine;
+	float bloomScale = 1.0f / NUM_BLOOM_LEVELS;
+	int width = source.Width();
+	float invWidth  = 1.0f / width;
+	float invHeight = 1.0f / source.Height();
+	gThreadPool.ParallelFor(0, source.Height(), [&](int firstRow, int lastRow)
+	{
+		for (int y = firstRow; y < lastRow; ++y)
+		{
+			const CpuColour* in = source.Row(y);
+			CpuColour* out = dest.Row(y);
+			float v = (y + 0.5f) * invHeight;
+			for (int x = 0; x < width; ++x)
+			{
+				float u = (x + 0.5f) * invWidth;
+				Float4 colour;
+				if (!splitScreen || u < constants.MidLine - 0.002f)
+				{
+					colour = LoadColour(in[x]) + TentSample(top, u, v) * bloomScale;
+				}
+				else if (u >= constants.MidLine + 0.002f)
+				{
+					colour = LoadColour(in[x]);
+				}
+				else
+				{
+					colour = Float4(1, 0, 0, 1);
+				}
+				StoreColour(Saturate(colour * Float4(1, 1, 1, 0) + Float4(0, 0, 0, 1)), out[x]);
+			}
+		}
+	});
+}
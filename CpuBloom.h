@@ -0,0 +1,22 @@
+//--------------------------------------------------------------------------------------
+// Bloom chain for the CPU post-processing engine
+//--------------------------------------------------------------------------------------
+// CPU version of the bloom chain run by BloomPostProcess in PostProcessPasses.h (see the bloom section of PostProcess.h).
+// Each step follows the matching Bloom*_pp.hlsl shader, including the UV offsets used for its texture reads
+
+#ifndef _CPU_BLOOM_H_INCLUDED_
+#define _CPU_BLOOM_H_INCLUDED_
+
+#include "CpuPostProcess.h"
+
+
+//--------------------------------------------------------------------------------------
+// Bloom
+//--------------------------------------------------------------------------------------
+
+// Run the whole bloom effect from source to dest (different images of the same size) using the bloomThreshold and
+// split-screen settings in the constants. The levels of the chain are kept between calls
+void CpuBloomPostProcess(const PostProcessingConstants& constants, const CpuImage& source, CpuImage& dest);
+
+
+#endif //_CPU_BLOOM_H_INCLUDED_
@@ -0,0 +1,236 @@
+//--------------------------------------------------------------------------------------
+// Constant-time blurs for the CPU post-processing engine
+//--------------------------------------------------------------------------------------
+
+#include "CpuBlur.h"
+#include "CpuSimd.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace
+{
+	// Number of box blurs applied one after another in box mode. Three is enough to look Gaussian
+	const int NUM_BOX_PASSES = 3;
+
+
+	inline Float4 LoadColour(const CpuColour& colour)  { return Float4::Load(&colour.r); }
+	inline void   StoreColour(Float4 value, CpuColour& colour)  { value.Store(&colour.r); }
+
+
+	//-------------------------------------
+	// Box blur
+	//-------------------------------------
+
+	// Find the widths of NUM_BOX_PASSES box blurs that together give the requested standard deviation. The widths are odd so
+	// each box is centred, some boxes are one size up from the others to get closer to the target
+	void BoxWidthsForDeviation(float deviation, int widths[NUM_BOX_PASSES])
+	{
+		const int n = NUM_BOX_PASSES;
+		float variance = deviation * deviation;
+		int lowerWidth = static_cast<int>(std::floor(std::sqrt(12.0f * variance / n + 1.0f)));
+		if (lowerWidth % 2 == 0)  --lowerWidth;
+		lowerWidth = std::max(lowerWidth, 1);
+		int upperWidth = lowerWidth + 2;
+
+		// Number of boxes to use at the lower width
+		float idealCount = (12.0f * variance - n * lowerWidth * lowerWidth - 4.0f * n * lowerWidth - 3.0f * n) / (-4.0f * lowerWidth - 4.0f);
+		int lowerCount = std::min(std::max(static_cast<int>(std::round(idealCount)), 0), n);
+
+		for (int i = 0; i < n; ++i)
+		{
+			widths[i] = (i < lowerCount) ? lowerWidth : upperWidth;
+		}
+	}
+
+	// Box blur one row with a running sum - add the pixel entering the box and subtract the one leaving it
+	void BoxBlurRow(const CpuColour* in, CpuColour* out, int width, int radius)
+	{
+		const int last = width - 1;
+		Float4 scale(1.0f / (2 * radius + 1));
+
+		// Sum for the first pixel, the left edge pixel is repeated for the part of the box that is off the image
+		Float4 sum = LoadColour(in[0]) * static_cast<float>(radius + 1);
+		for (int x = 1; x <= radius; ++x)
+		{
+			sum = sum + LoadColour(in[std::min(x, last)]);
+		}
+
+		for (int x = 0; x < width; ++x)
+		{
+			StoreColour(sum * scale, out[x]);
+			sum = sum + LoadColour(in[std::min(x + radius + 1, last)]) - LoadColour(in[std::max(x - radius, 0)]);
+		}
+	}
+
+
+	//-------------------------------------
+	// Recursive Gaussian
+	//-------------------------------------
+
+	// Coefficients for the Young / van Vliet recursive Gaussian filter:
+	// "Recursive implementation of the Gaussian filter", I.T. Young and L.J. van Vliet, Signal Processing 44 (1995)
+	struct RecursiveCoefficients
+	{
+		float B;          // Weight of the input pixel
+		float b1, b2, b3; // Weights of the three previous outputs (already divided by b0)
+	};
+
+	RecursiveCoefficients RecursiveCoefficientsForDeviation(float deviation)
+	{
+		float sigma = std::max(deviation, 0.5f);
+		float q = (sigma >= 2.5f) ? 0.98711f * sigma - 0.96330f
+		                          : 3.97156f - 4.14554f * std::sqrt(1.0f - 0.26891f * sigma);
+		float q2 = q * q;
+		float q3 = q2 * q;
+		float b0 = 1.57825f + 2.44413f * q + 1.4281f * q2 + 0.422205f * q3;
+		float b1 = 2.44413f * q + 2.85619f * q2 + 1.26661f * q3;
+		float b2 = -(1.4281f * q2 + 1.26661f * q3);
+		float b3 = 0.422205f * q3;
+
+		RecursiveCoefficients coefficients;
+		coefficients.B  = 1.0f - (b1 + b2 + b3) / b0;
+		coefficients.b1 = b1 / b0;
+		coefficients.b2 = b2 / b0;
+		coefficients.b3 = b3 / b0;
+		return coefficients;
+	}
+
+	// Recursive Gaussian on one row - a causal pass left to right then an anti-causal pass right to left, treating the row
+	// as if the edge pixels continued forever so edges behave like a clamp sampler. Starting the causal pass at the left edge
+	// value is exact for that, but the anti-causal pass needs the causal result beyond the right edge, so the causal pass
+	// is run on into "padding" extra pixels first. work must hold width + padding pixels
+	void RecursiveBlurRow(const CpuColour* in, CpuColour* out, CpuColour* work, int width, int padding, const RecursiveCoefficients& c)
+	{
+		Float4 B(c.B), b1(c.b1), b2(c.b2), b3(c.b3);
+		Float4 rightEdge = LoadColour(in[width - 1]);
+
+		Float4 w1 = LoadColour(in[0]), w2 = w1, w3 = w1;
+		for (int x = 0; x < width + padding; ++x)
+		{
+			Float4 w = B * (x < width ? LoadColour(in[x]) : rightEdge) + b1 * w1 + b2 * w2 + b3 * w3;
+			StoreColour(w, work[x]);
+			w3 = w2;  w2 = w1;  w1 = w;
+		}
+
+		Float4 y1 = rightEdge, y2 = y1, y3 = y1;
+		for (int x = width + padding - 1; x >= 0; --x)
+		{
+			Float4 y = B * LoadColour(work[x]) + b1 * y1 + b2 * y2 + b3 * y3;
+			if (x < width)  StoreColour(y, out[x]);
+			y3 = y2;  y2 = y1;  y1 = y;
+		}
+	}
+
+
+	//-------------------------------------
+	// Row driver
+	//-------------------------------------
+
+	// Blur every row of source into dest with the given mode. Each worker works in its own pair of row buffers so the
+	// repeated box passes stay in cache
+	void BlurRows(BlurMode mode, float deviation, const CpuImage& source, CpuImage& dest)
+	{
+		int width = source.Width();
+		dest.Resize(width, source.Height());
+		if (width == 0)  return;
+
+		int boxWidths[NUM_BOX_PASSES];
+		BoxWidthsForDeviation(deviation, boxWidths);
+		RecursiveCoefficients coefficients = RecursiveCoefficientsForDeviation(deviation);
+		int recursivePadding = static_cast<int>(std::ceil(4.0f * deviation)) + 4; // Filter response has died away by here
+
+		gThreadPool.ParallelFor(0, source.Height(), [&](int firstRow, int lastRow)
+		{
+			std::vector<CpuColour> rowA(width + recursivePadding), rowB(width);
+			for (int y = firstRow; y < lastRow; ++y)
+			{
+				CpuColour* out = dest.Row(y);
+				if (mode == BlurMode::Box)
+				{
+					const CpuColour* in = source.Row(y);
+					for (int pass = 0; pass < NUM_BOX_PASSES; ++pass)
+					{
+						CpuColour* passOut = (pass == NUM_BOX_PASSES - 1) ? out : (pass % 2 == 0 ? rowA.data() : rowB.data());
+						BoxBlurRow(in, passOut, width, (boxWidths[pass] - 1) / 2);
+						in = passOut;
+					}
+				}
+				else
+				{
+					RecursiveBlurRow(source.Row(y), out, rowA.data(), width, recursivePadding, coefficients);
+				}
+
+				// The post-process outputs are opaque and stored in a 0->1 render target
+				for (int x = 0; x < width; ++x)
+				{
+					StoreColour(Saturate(LoadColour(out[x]) * Float4(1, 1, 1, 0) + Float4(0, 0, 0, 1)), out[x]);
+				}
+			}
+		});
+	}
+}
+
+
+// Transpose an image (rows become columns), working in tiles to stay cache friendly
+void TransposeCpuImage(const CpuImage& source, CpuImage& dest)
+{
+	const int tileSize = 32; // 32x32 pixels of 16 bytes = 16KB per tile, reads and writes both fit in L1 cache
+	int width = source.Width();
+	int height = source.Height();
+	dest.Resize(height, width);
+
+	int numTileRows = (height + tileSize - 1) / tileSize;
+	gThreadPool.ParallelFor(0, numTileRows, [&](int firstTileRow, int lastTileRow)
+	{
+		for (int tileY = firstTileRow * tileSize; tileY < std::min(lastTileRow * tileSize, height); tileY += tileSize)
+		{
+			int tileBottom = std::min(tileY + tileSize, height);
+			for (int tileX = 0; tileX < width; tileX += tileSize)
+			{
+				int tileRight = std::min(tileX + tileSize, width);
+				for (int y = tileY; y < tileBottom; ++y)
+				{
+					const CpuColour* in = source.Row(y);
+					for (int x = tileX; x < tileRight; ++x)
+					{
+						dest.Pixel(y, x) = in[x];
+					}
+				}
+			}
+		}
+	});
+}
+
+
+// Blur source into dest in one direction using the given mode
+void CpuBlurPass(BlurMode mode, bool vertical, float deviation, const CpuImage& source, CpuImage& dest)
+{
+	if (!vertical)
+	{
+		BlurRows(mode, deviation, source, dest);
+		return;
+	}
+
+	// Work images are kept between calls to avoid allocating two full screen images every pass
+	thread_local CpuImage transposed;
+	thread_local CpuImage blurred;
+	TransposeCpuImage(source, transposed);
+	BlurRows(mode, deviation, transposed, blurred);
+	TransposeCpuImage(blurred, dest);
+}
+
+
+// Number of source pixel reads per output pixel made by a single pass of the given mode
+int CpuBlurReadsPerPixel(BlurMode mode)
+{
+	switch (mode)
+	{
+		case BlurMode::Box:       return 2 * NUM_BOX_PASSES; // One pixel added and one removed from the running sum per box
+		case BlurMode::Recursive: return 2;                  // One read in each direction
+		default:                  return 0;
+	}
+}
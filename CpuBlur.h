@@ -0,0 +1,27 @@
+//--------------------------------------------------------------------------------------
+// Constant-time blurs for the CPU post-processing engine
+//--------------------------------------------------------------------------------------
+// Blurs whose cost per pixel doesn't depend on the blur radius, used for the BlurMode::Box and BlurMode::Recursive
+// settings. Each works along the rows of an image with the rows spread over the worker threads. Vertical passes
+// transpose the image in small tiles, blur the rows of the transposed image and transpose back, which keeps memory
+// access sequential (walking down columns of a large image misses the cache on almost every pixel)
+
+#ifndef _CPU_BLUR_H_INCLUDED_
+#define _CPU_BLUR_H_INCLUDED_
+
+#include "CpuPostProcess.h"
+
+
+// Blur source into dest in one direction using the given mode, approximating a Gaussian with the given standard
+// deviation in pixels. BlurMode::Gaussian is not handled here (see the BlurH/BlurV shaders in CpuPostProcess.cpp).
+// Pixels beyond the image edges repeat the edge pixel, as with a clamp sampler. Output alpha is 1
+void CpuBlurPass(BlurMode mode, bool vertical, float deviation, const CpuImage& source, CpuImage& dest);
+
+// Transpose an image (rows become columns), working in tiles to stay cache friendly
+void TransposeCpuImage(const CpuImage& source, CpuImage& dest);
+
+// Number of source pixel reads per output pixel made by a single pass of the given mode - to compare against tap counts
+int CpuBlurReadsPerPixel(BlurMode mode);
+
+
+#endif //_CPU_BLUR_H_INCLUDED_
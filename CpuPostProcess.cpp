@@ -0,0 +1,1364 @@
+//--------------------------------------------------------------------------------------
+// CPU reference implementation of the post-processing effects
+//--------------------------------------------------------------------------------------
+// Each effect below is a direct translation of the matching _pp.hlsl file, including the quirks of those shaders
+// (e.g. the HeatHaze alpha is always 1 because the shader's inner alpha variable hides the outer one). Keep them in
+// step with the shaders if either changes
+
+#include "CpuPostProcess.h"
+#include "PostProcessFusion.h"
+#include "PostProcessGraph.h"
+#include "PolygonBatch.h"
+#include "CpuSimd.h"
+#include "CpuBlur.h"
+#include "CpuBloom.h"
+#include "BlurKernel.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <type_traits>
+
+
+//--------------------------------------------------------------------------------------
+// CpuImage
+//--------------------------------------------------------------------------------------
+
+// Change the size of the image, contents are lost
+void CpuImage::Resize(int width, int height)
+{
+	mWidth  = std::max(0, width);
+	mHeight = std::max(0, height);
+	mPixels.assign(static_cast<size_t>(mWidth) * mHeight, CpuColour{ 0, 0, 0, 0 });
+}
+
+// Set every pixel to the given colour
+void CpuImage::Fill(CpuColour colour)
+{
+	std::fill(mPixels.begin(), mPixels.end(), colour);
+}
+
+
+// Load from RGBA8 data, rowPitch is the number of bytes per row
+void CpuImage::LoadRGBA8(const uint8_t* data, int width, int height, int rowPitch)
+{
+	Resize(width, height);
+	for (int y = 0; y < mHeight; ++y)
+	{
+		const uint8_t* in = data + static_cast<size_t>(y) * rowPitch;
+		CpuColour* out = Row(y);
+		for (int x = 0; x < mWidth; ++x, in += 4)
+		{
+			out[x] = { in[0] / 255.0f, in[1] / 255.0f, in[2] / 255.0f, in[3] / 255.0f };
+		}
+	}
+}
+
+// Store as RGBA8 data (values are clamped to 0->1 and rounded as the GPU does), rowPitch is the number of bytes per row
+void CpuImage::StoreRGBA8(uint8_t* data, int rowPitch) const
+{
+	auto toByte = [](float value) { return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+	for (int y = 0; y < mHeight; ++y)
+	{
+		const CpuColour* in = Row(y);
+		uint8_t* out = data + static_cast<size_t>(y) * rowPitch;
+		for (int x = 0; x < mWidth; ++x, out += 4)
+		{
+			out[0] = toByte(in[x].r);
+			out[1] = toByte(in[x].g);
+			out[2] = toByte(in[x].b);
+			out[3] = toByte(in[x].a);
+		}
+	}
+}
+
+
+// Point sampling with clamp addressing - matches gPointSampler
+CpuColour CpuImage::SamplePoint(float u, float v) const
+{
+	int x = std::min(std::max(static_cast<int>(std::floor(u * mWidth)),  0), mWidth  - 1);
+	int y = std::min(std::max(static_cast<int>(std::floor(v * mHeight)), 0), mHeight - 1);
+	return Pixel(x, y);
+}
+
+
+// Helper for the bilinear samplers - blend the four texels around the given UV using the given function to
+// convert texel coordinates that are outside the image
+template <class Address>
+static CpuColour SampleBilinear(const CpuImage& image, float u, float v, Address address)
+{
+	// Texel centres are at 0.5, so offset by half a texel to find the four texels to blend
+	float x = u * image.Width()  - 0.5f;
+	float y = v * image.Height() - 0.5f;
+	float x0 = std::floor(x);
+	float y0 = std::floor(y);
+	float fx = x - x0;
+	float fy = y - y0;
+
+	int left   = address(static_cast<int>(x0),     image.Width());
+	int right  = address(static_cast<int>(x0) + 1, image.Width());
+	int top    = address(static_cast<int>(y0),     image.Height());
+	int bottom = address(static_cast<int>(y0) + 1, image.Height());
+
+	Float4 upper = Lerp(Float4::Load(&image.Pixel(left, top).r),    Float4::Load(&image.Pixel(right, top).r),    fx);
+	Float4 lower = Lerp(Float4::Load(&image.Pixel(left, bottom).r), Float4::Load(&image.Pixel(right, bottom).r), fx);
+	CpuColour result;
+	Lerp(upper, lower, fy).Store(&result.r);
+	return result;
+}
+
+// Bilinear sampling with wrap addressing - matches the top mip level of gTrilinearSampler
+CpuColour CpuImage::SampleLinearWrap(float u, float v) const
+{
+	return SampleBilinear(*this, u, v, [](int i, int size) { i %= size;  return i < 0 ? i + size : i; });
+}
+
+// Bilinear sampling with clamp addressing
+CpuColour CpuImage::SampleLinearClamp(float u, float v) const
+{
+	return SampleBilinear(*this, u, v, [](int i, int size) { return std::min(std::max(i, 0), size - 1); });
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Pixel shaders
+//--------------------------------------------------------------------------------------
+namespace
+{
+	// Data shared by every pixel in a single post-process pass
+	struct PassContext
+	{
+		const PostProcessingConstants& constants;
+		const CpuPostProcessTextures&  textures;
+		const CpuImage&                source;
+		float invWidth;  // Size of a pixel in UV space, same as 1 / gViewportWidth in the shaders
+		float invHeight;
+
+		// HueTint colours, the shader calculates these for every pixel but they only depend on the constants
+		Float4 hueTopColour;
+		Float4 hueBottomColour;
+	};
+
+	// Equivalent of the PostProcessingInput structure received by the shaders, plus the pixel coordinate
+	struct PixelInput
+	{
+		int   x, y;
+		float sceneU, sceneV;
+		float areaU, areaV;
+	};
+
+
+	//-------------------------------------
+	// Helpers
+	//-------------------------------------
+
+	inline Float4 LoadColour(const CpuColour& colour)  { return Float4::Load(&colour.r); }
+
+	inline CpuColour StoreColour(Float4 colour)
+	{
+		CpuColour result;
+		colour.Store(&result.r);
+		return result;
+	}
+
+	// Replace the alpha of a colour
+	inline Float4 SetAlpha(Float4 colour, float alpha)
+	{
+		return colour * Float4(1, 1, 1, 0) + Float4(0, 0, 0, alpha);
+	}
+
+	// Point sample of the scene texture with clamp addressing
+	inline Float4 SampleScene(const PassContext& context, float u, float v)
+	{
+		return LoadColour(context.source.SamplePoint(u, v));
+	}
+
+	// The scene texture pixel under the one being processed - the same as point sampling at sceneUV
+	inline Float4 ScenePixel(const PassContext& context, const PixelInput& pixel)
+	{
+		return LoadColour(context.source.Pixel(pixel.x, pixel.y));
+	}
+
+	// Soft circle used by several shaders, based on the fact that the circle has a radius of 0.5 (as area UVs go from 0->1)
+	inline float SoftCircleAlpha(const PixelInput& pixel, float softEdge)
+	{
+		float dx = pixel.areaU - 0.5f;
+		float dy = pixel.areaV - 0.5f;
+		float centreLengthSq = dx * dx + dy * dy;
+		return 1.0f - std::min(std::max((centreLengthSq - 0.25f + softEdge) / softEdge, 0.0f), 1.0f);
+	}
+
+
+	// Shift the hue of a tint colour as HueTint_pp.hlsl does (see PostProcess.cpp)
+	Float4 HueShiftColour(CVector3 colour, float hueWiggle)
+	{
+		CVector3 RGB = HueShiftTintColour(colour, hueWiggle);
+		return Float4(RGB.x, RGB.y, RGB.z, 0.0f);
+	}
+
+
+	//-------------------------------------
+	// Effects
+	//-------------------------------------
+	// One function object per shader, returns the colour that the shader's effect branch produces
+
+	struct TintShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			const auto& c = context.constants;
+			Float4 tint = Lerp(Float4(c.tintTopColour.x,    c.tintTopColour.y,    c.tintTopColour.z,    0),
+			                   Float4(c.tintBottomColour.x, c.tintBottomColour.y, c.tintBottomColour.z, 0), pixel.sceneV);
+			return SetAlpha(ScenePixel(context, pixel) * tint, 1.0f);
+		}
+	};
+
+	struct GreyNoiseShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			const auto& c = context.constants;
+			const float noiseStrength = 0.5f;
+			CpuColour sceneColour = context.source.Pixel(pixel.x, pixel.y);
+			float grey = (sceneColour.r + sceneColour.g + sceneColour.b) / 3.0f;
+			float noise = context.textures.noiseMap->SampleLinearWrap(pixel.sceneU * c.noiseScale.x + c.noiseOffset.x,
+			                                                          pixel.sceneV * c.noiseScale.y + c.noiseOffset.y).r;
+			grey += noiseStrength * (noise - 0.5f);
+			return Float4(grey, grey, grey, SoftCircleAlpha(pixel, 0.20f));
+		}
+	};
+
+	struct BurnShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			const auto& c = context.constants;
+			const Float4 burnColour(0.8f, 0.4f, 0.0f, 0.0f);
+			const Float4 glowColour(1.0f, 0.8f, 0.0f, 0.0f);
+			const float glowAmount = 0.25f;
+			const float crinkle = 0.15f;
+
+			CpuColour burnTexture = context.textures.burnMap->SampleLinearWrap(pixel.areaU, pixel.areaV);
+			float burnLevelMax = c.burnHeight + glowAmount;
+
+			Float4 outputColour;
+			if (burnTexture.r <= c.burnHeight)
+			{
+				outputColour = Float4(0.0f);
+			}
+			else if (burnTexture.r >= burnLevelMax)
+			{
+				outputColour = ScenePixel(context, pixel);
+			}
+			else
+			{
+				float glowLevel = 1.0f - (burnTexture.r - c.burnHeight) / glowAmount;
+				float crinkleX = burnTexture.g - 0.5f;
+				float crinkleY = burnTexture.b - 0.5f;
+				Float4 texColour = SampleScene(context, pixel.sceneU - glowLevel * crinkle * crinkleX,
+				                                        pixel.sceneV - glowLevel * crinkle * crinkleY);
+				glowLevel *= 2.0f;
+				if (glowLevel < 1.0f)
+				{
+					outputColour = Lerp(texColour, burnColour * texColour, glowLevel);
+				}
+				else
+				{
+					outputColour = Lerp(burnColour * texColour, glowColour, glowLevel - 1.0f);
+				}
+			}
+			return SetAlpha(outputColour, 1.0f);
+		}
+	};
+
+	struct DistortShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			const auto& c = context.constants;
+			const float lightStrength = 0.015f;
+			const float glassDarken = 0.8f;
+
+			CpuColour distortTexture = context.textures.distortMap->SampleLinearWrap(pixel.areaU, pixel.areaV);
+			float distortX = distortTexture.g - 0.5f;
+			float distortY = distortTexture.b - 0.5f;
+
+			// normalize() of a zero vector is undefined in HLSL, treat it as no light
+			float length = std::sqrt(distortX * distortX + distortY * distortY);
+			float light = length > 0 ? (distortX + distortY) / length * 0.707f * lightStrength : 0.0f;
+
+			Float4 sceneColour = SampleScene(context, pixel.sceneU + c.distortLevel * distortX, pixel.sceneV + c.distortLevel * distortY);
+			return SetAlpha(Float4(light) + sceneColour * glassDarken, 1.0f);
+		}
+	};
+
+	struct SpiralShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			const auto& c = context.constants;
+			float centreU = c.area2DTopLeft.x + c.area2DSize.x * 0.5f;
+			float centreV = c.area2DTopLeft.y + c.area2DSize.y * 0.5f;
+			float offsetU = pixel.sceneU - centreU;
+			float offsetV = pixel.sceneV - centreV;
+			float centreDistance = std::sqrt(offsetU * offsetU + offsetV * offsetV);
+
+			float angle = centreDistance * c.spiralLevel * c.spiralLevel;
+			float s = std::sin(angle);
+			float co = std::cos(angle);
+			float rotatedU = offsetU * co - offsetV * s; // mul(row vector, {c, s, -s, c})
+			float rotatedV = offsetU * s  + offsetV * co;
+
+			Float4 colour = SampleScene(context, centreU + rotatedU, centreV + rotatedV);
+			return SetAlpha(colour, SoftCircleAlpha(pixel, 0.10f));
+		}
+	};
+
+	struct HeatHazeShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			const auto& c = context.constants;
+			const float effectStrength = 0.01f;
+			const float degreesToRadians = 3.14159265f / 180.0f;
+
+			// The shader declares a second "alpha" inside its effect branch, so the soft circle only affects the strength
+			// of the haze and the output alpha stays at 1
+			float innerAlpha = SoftCircleAlpha(pixel, 0.15f);
+			float SinX = std::sin(pixel.areaU * 1440.0f * degreesToRadians + c.heatHazeTimer * 3.0f);
+			float SinY = std::sin(pixel.areaV * 3600.0f * degreesToRadians + c.heatHazeTimer * 3.7f);
+			float hazeU = SinY * effectStrength * innerAlpha * c.area2DSize.x;
+			float hazeV = SinX * effectStrength * innerAlpha * c.area2DSize.y;
+			return SetAlpha(SampleScene(context, pixel.sceneU + hazeU, pixel.sceneV + hazeV), 1.0f);
+		}
+	};
+
+	struct HueTintShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			Float4 tint = Lerp(context.hueTopColour, context.hueBottomColour, pixel.sceneV);
+			return SetAlpha(ScenePixel(context, pixel) * tint, 1.0f);
+		}
+	};
+
+	// Horizontal or vertical blur using the packed taps from BlurKernel.h. Tap offsets are in pixels and may fall between
+	// two pixels (linear sampling mode), in which case the two are blended as the GPU's bilinear clamp sampler does
+	template <bool Vertical>
+	struct BlurShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			const auto& c = context.constants;
+			const CpuImage& source = context.source;
+			int size   = Vertical ? source.Height() : source.Width();
+			int centre = Vertical ? pixel.y : pixel.x;
+
+			Float4 colour(0.0f);
+			for (int i = 0; i < c.blurTapCount; ++i)
+			{
+				const CVector4& packed = c.blurTaps[i / 2];
+				float weight = (i % 2 == 0) ? packed.x : packed.z;
+				float offset = (i % 2 == 0) ? packed.y : packed.w;
+
+				float position = centre + offset;
+				float first = std::floor(position);
+				float blend = position - first;
+				int index0 = std::min(std::max(static_cast<int>(first), 0), size - 1);
+				int index1 = std::min(index0 + 1, size - 1);
+				if (first < 0)  index1 = 0;
+
+				const CpuColour& texel0 = Vertical ? source.Pixel(pixel.x, index0) : source.Pixel(index0, pixel.y);
+				Float4 sample = LoadColour(texel0);
+				if (blend > 0)
+				{
+					const CpuColour& texel1 = Vertical ? source.Pixel(pixel.x, index1) : source.Pixel(index1, pixel.y);
+					sample = Lerp(sample, LoadColour(texel1), blend);
+				}
+				colour = colour + sample * weight;
+			}
+			return SetAlpha(colour, 1.0f);
+		}
+	};
+
+	struct UnderwaterShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			const auto& c = context.constants;
+			const float twoPi = 2.0f * 3.14159265f;
+			float sinY = std::sin(pixel.sceneV * twoPi + c.Wiggle) * 0.012f;
+			Float4 colour = SampleScene(context, pixel.sceneU, pixel.sceneV + 0.314f * sinY);
+			return SetAlpha(colour * Float4(c.waterColour.x, c.waterColour.y, c.waterColour.z, 0), 1.0f);
+		}
+	};
+
+	struct InvertedShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			return SetAlpha(Float4(1.0f) - ScenePixel(context, pixel), 1.0f);
+		}
+	};
+
+	struct NightVisionShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			// The shader adds the same sample four times, then divides by four again unless the result is bright
+			CpuColour sample = context.source.Pixel(pixel.x, pixel.y);
+			float average = (sample.r + sample.g + sample.b) * 4.0f / 3.0f;
+			if (average < 1.2f)
+			{
+				average /= 4.0f;
+			}
+			return Float4(0.0f, average, 0.0f, 1.0f);
+		}
+	};
+
+	// Read the scene at the top-left of the large "retro" pixel containing this one
+	inline Float4 RetroSample(const PassContext& context, const PixelInput& pixel)
+	{
+		const float pixelWidth = 15;  // Low res pixel size
+		const float pixelHeight = 10;
+		float pixelU = pixelWidth  * context.invWidth;
+		float pixelV = pixelHeight * context.invHeight;
+		return SampleScene(context, pixelU * std::floor(pixel.sceneU / pixelU), pixelV * std::floor(pixel.sceneV / pixelV));
+	}
+
+	struct RetroShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			Float4 colour = RetroSample(context, pixel);
+			return SetAlpha(Floor(colour * 10.0f) / Float4(10.0f) * 1.3f, 1.0f);
+		}
+	};
+
+	struct Bloom1Shader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			CpuColour colour = context.source.Pixel(pixel.x, pixel.y);
+			if ((colour.r + colour.g + colour.b) / 3 < context.constants.bloomThreshold)
+			{
+				return Float4(0, 0, 0, 1);
+			}
+			return SetAlpha(LoadColour(colour), 1.0f);
+		}
+	};
+
+	struct Bloom2Shader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			Float4 base = LoadColour(context.textures.bloomBase->Pixel(pixel.x, pixel.y));
+			return SetAlpha(ScenePixel(context, pixel) + base, 1.0f);
+		}
+	};
+
+	struct DepthOfFieldShader
+	{
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			Float4 colour = ScenePixel(context, pixel);
+			float depthValue = context.textures.depthMap->Pixel(pixel.x, pixel.y).r;
+			if (depthValue >= context.constants.depthThreshold)
+			{
+				colour = colour * Float4(1, 0, 0, 0);
+			}
+			return SetAlpha(colour, 1.0f);
+		}
+	};
+
+	// A run of per-pixel effects collapsed into one pass - the CPU equivalent of the shaders generated by
+	// GenerateFusedShaderSource (PostProcessFusion.cpp). Each stage is saturated as if it had been written to a
+	// target, but there is no 8-bit rounding between stages (the CPU images are float anyway)
+	struct FusedShader
+	{
+		const PostProcess* stages;
+		int                numStages;
+
+		// Tint colours for each stage, taken from fusedTintColours
+		Float4 topColours[MAX_FUSED_STAGES];
+		Float4 bottomColours[MAX_FUSED_STAGES];
+
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			// Retro can only be the first stage because it reads the scene at a different position
+			int firstStage = 0;
+			Float4 colour;
+			if (stages[0] == PostProcess::Retro)
+			{
+				colour = Saturate(RetroShader()(context, pixel));
+				firstStage = 1;
+			}
+			else
+			{
+				colour = ScenePixel(context, pixel);
+			}
+
+			for (int s = firstStage; s < numStages; ++s)
+			{
+				colour = Saturate(StageColour(stages[s], s, colour, pixel));
+			}
+			return SetAlpha(colour, 1.0f);
+		}
+
+		Float4 StageColour(PostProcess stage, int s, Float4 colour, const PixelInput& pixel) const
+		{
+			switch (stage)
+			{
+				case PostProcess::Tint:
+				case PostProcess::HueTint:
+					return colour * Lerp(topColours[s], bottomColours[s], pixel.sceneV);
+
+				case PostProcess::Inverted:
+					return Float4(1.0f) - colour;
+
+				case PostProcess::NightVision:
+				{
+					CpuColour sample = StoreColour(colour);
+					float average = (sample.r + sample.g + sample.b) * 4.0f / 3.0f;
+					if (average < 1.2f)
+					{
+						average /= 4.0f;
+					}
+					return Float4(0.0f, average, 0.0f, 1.0f);
+				}
+
+				case PostProcess::Retro:
+					return Floor(colour * 10.0f) / Float4(10.0f) * 1.3f;
+
+				default:
+					return colour;
+			}
+		}
+	};
+
+
+	// A fused pass using a baked colour lookup table - the CPU equivalent of ColourLut_pp.hlsl
+	struct ColourLutShader
+	{
+		const ColourLut& lut;
+		bool   retroSample;
+		Float4 preTopColour,  preBottomColour;
+		Float4 postTopColour, postBottomColour;
+
+		Float4 operator()(const PassContext& context, const PixelInput& pixel) const
+		{
+			Float4 colour = retroSample ? RetroSample(context, pixel) : ScenePixel(context, pixel);
+			colour = Saturate(colour * Lerp(preTopColour, preBottomColour, pixel.sceneV));
+			colour = Lookup(StoreColour(colour));
+			return SetAlpha(Saturate(colour * Lerp(postTopColour, postBottomColour, pixel.sceneV)), 1.0f);
+		}
+
+		// Trilinear lookup, colour components must be in the range 0->1
+		Float4 Lookup(const CpuColour& colour) const
+		{
+			int last = lut.size - 1;
+			float r = colour.r * last, g = colour.g * last, b = colour.b * last;
+			int r0 = std::min(static_cast<int>(r), last - 1);
+			int g0 = std::min(static_cast<int>(g), last - 1);
+			int b0 = std::min(static_cast<int>(b), last - 1);
+			float fr = r - r0, fg = g - g0, fb = b - b0;
+
+			auto entry = [&](int ri, int gi, int bi)
+			{
+				const CVector4& e = lut.entries[(static_cast<size_t>(bi) * lut.size + gi) * lut.size + ri];
+				return Float4(e.x, e.y, e.z, 0.0f);
+			};
+			auto plane = [&](int bi)
+			{
+				return Lerp(Lerp(entry(r0, g0,     bi), entry(r0 + 1, g0,     bi), fr),
+				            Lerp(entry(r0, g0 + 1, bi), entry(r0 + 1, g0 + 1, bi), fr), fg);
+			};
+			return Lerp(plane(b0), plane(b0 + 1), fb);
+		}
+	};
+
+
+	//-------------------------------------
+	// Pass drivers
+	//-------------------------------------
+
+	// Prepare the data shared by all pixels in a pass
+	PassContext MakePassContext(PostProcess postProcess, const PostProcessingConstants& constants,
+	                            const CpuPostProcessTextures& textures, const CpuImage& source)
+	{
+		PassContext context{ constants, textures, source, 1.0f / source.Width(), 1.0f / source.Height(), Float4(0.0f), Float4(0.0f) };
+		if (postProcess == PostProcess::HueTint)
+		{
+			context.hueTopColour    = HueShiftColour(constants.tintTopColour,    constants.HueWiggle);
+			context.hueBottomColour = HueShiftColour(constants.tintBottomColour, constants.HueWiggle);
+		}
+		return context;
+	}
+
+	// Check the additional textures needed by a post-process have been provided
+	bool HasRequiredTextures(PostProcess postProcess, const CpuPostProcessTextures& textures, const CpuImage& source)
+	{
+		auto matchesSource = [&](const CpuImage* image)
+		{
+			return image != nullptr && image->Width() == source.Width() && image->Height() == source.Height();
+		};
+
+		switch (postProcess)
+		{
+			case PostProcess::None:         return false;
+			case PostProcess::GreyNoise:    return textures.noiseMap   != nullptr && textures.noiseMap->Width()   > 0;
+			case PostProcess::Burn:         return textures.burnMap    != nullptr && textures.burnMap->Width()    > 0;
+			case PostProcess::Distort:      return textures.distortMap != nullptr && textures.distortMap->Width() > 0;
+			case PostProcess::Bloom2:       return matchesSource(textures.bloomBase);
+			case PostProcess::DepthOfField: return matchesSource(textures.depthMap);
+			default:                        return true;
+		}
+	}
+
+	// Call pass(shader) with the shader function object for the given post-process. Returns false for unsupported post-processes
+	template <class Pass>
+	bool DispatchShader(PostProcess postProcess, Pass&& pass)
+	{
+		switch (postProcess)
+		{
+			case PostProcess::Tint:         pass(TintShader());          return true;
+			case PostProcess::GreyNoise:    pass(GreyNoiseShader());     return true;
+			case PostProcess::Burn:         pass(BurnShader());          return true;
+			case PostProcess::Distort:      pass(DistortShader());       return true;
+			case PostProcess::Spiral:       pass(SpiralShader());        return true;
+			case PostProcess::HeatHaze:     pass(HeatHazeShader());      return true;
+			case PostProcess::HueTint:      pass(HueTintShader());       return true;
+			case PostProcess::BlurH:        pass(BlurShader<false>());   return true;
+			case PostProcess::BlurV:        pass(BlurShader<true>());    return true;
+			case PostProcess::Underwater:   pass(UnderwaterShader());    return true;
+			case PostProcess::Inverted:     pass(InvertedShader());      return true;
+			case PostProcess::NightVision:  pass(NightVisionShader());   return true;
+			case PostProcess::Retro:        pass(RetroShader());         return true;
+			case PostProcess::Bloom1:       pass(Bloom1Shader());        return true;
+			case PostProcess::Bloom2:       pass(Bloom2Shader());        return true;
+			case PostProcess::DepthOfField: pass(DepthOfFieldShader());  return true;
+			default:                        return false;
+		}
+	}
+
+
+	// Call pass(midLine) with std::true_type if the constants select the MidLine shader variant (see PostProcess.h),
+	// otherwise std::false_type - the CPU version of choosing a compiled shader variant, so the passes below check the
+	// mid-line settings once rather than for every pixel
+	template <class Pass>
+	void DispatchVariant(const PostProcessingConstants& c, Pass&& pass)
+	{
+		if (PostProcessShaderVariant(c) == ShaderVariant::MidLine)  pass(std::true_type());
+		else                                                        pass(std::false_type());
+	}
+
+	// Run a shader for one pixel. The MidLine variant adds the split-screen logic the effect shaders have with
+	// MIDLINE_SPLIT set (EffectSideOfMidLine in Common.hlsli)
+	template <bool MidLine, class Shader>
+	inline Float4 ShadePixel(const PassContext& context, const Shader& shader, const PixelInput& pixel)
+	{
+		if constexpr (MidLine)
+		{
+			const auto& c = context.constants;
+			if (pixel.sceneU >= c.MidLine + 0.002f)  return SetAlpha(ScenePixel(context, pixel), 1.0f);
+			if (pixel.sceneU >= c.MidLine - 0.002f)  return Float4(1, 0, 0, 1);
+		}
+		return shader(context, pixel);
+	}
+
+
+	// Overwrite the part of a processed image to the right of the split-screen mid-line. Used by passes that process whole
+	// rows at once rather than going through ShadePixel
+	void ApplyMidLine(const PostProcessingConstants& c, const CpuImage& source, CpuImage& dest)
+	{
+		if (!c.MidLineEnabled || !c.IsFullScreen)  return;
+
+		float invWidth = 1.0f / dest.Width();
+		gThreadPool.ParallelFor(0, dest.Height(), [&](int firstRow, int lastRow)
+		{
+			for (int y = firstRow; y < lastRow; ++y)
+			{
+				const CpuColour* in = source.Row(y);
+				CpuColour* out = dest.Row(y);
+				for (int x = 0; x < dest.Width(); ++x)
+				{
+					float u = (x + 0.5f) * invWidth;
+					if (u < c.MidLine - 0.002f)  continue;
+					out[x] = (u >= c.MidLine + 0.002f) ? CpuColour{ in[x].r, in[x].g, in[x].b, 1.0f } : CpuColour{ 1, 0, 0, 1 };
+				}
+			}
+		});
+	}
+
+
+	// Copy the source to the dest with alpha set to 1 - the Copy_pp shader
+	void CopyImage(const CpuImage& source, CpuImage& dest)
+	{
+		gThreadPool.ParallelFor(0, source.Height(), [&](int firstRow, int lastRow)
+		{
+			for (int y = firstRow; y < lastRow; ++y)
+			{
+				const CpuColour* in = source.Row(y);
+				CpuColour* out = dest.Row(y);
+				for (int x = 0; x < source.Width(); ++x)
+				{
+					out[x] = { in[x].r, in[x].g, in[x].b, 1.0f };
+				}
+			}
+		});
+	}
+
+
+	// Copy the pixels of source inside some rectangles to a scratch image, for effects updating source in place to read
+	// from - the CPU version of the scratch target in PostProcessPasses.h. Pixels outside the rectangles are left as they were, as
+	// the effects never read them. The image is kept between calls so it is only reallocated when the size changes
+	const CpuImage& CopyImageBounds(const CpuImage& source, const std::vector<PixelRect>& rects)
+	{
+		// Named through a reference - inside the lambda below the thread_local itself would be each worker's own copy
+		static thread_local CpuImage scratchImage;
+		CpuImage& scratch = scratchImage;
+		if (scratch.Width() != source.Width() || scratch.Height() != source.Height())
+		{
+			scratch.Resize(source.Width(), source.Height());
+		}
+
+		PixelRect bounds;
+		for (auto& rect : rects)  bounds = UnionPixelRect(bounds, rect);
+		gThreadPool.ParallelFor(bounds.top, bounds.bottom, [&](int firstRow, int lastRow)
+		{
+			for (int y = firstRow; y < lastRow; ++y)
+			{
+				for (auto& rect : rects)
+				{
+					if (y < rect.top || y >= rect.bottom)  continue;
+					std::copy(source.Row(y) + rect.left, source.Row(y) + rect.right, scratch.Row(y) + rect.left);
+				}
+			}
+		});
+		return scratch;
+	}
+
+
+	// Run a shader over the entire image
+	template <class Shader>
+	void RunFullScreen(const PassContext& context, const Shader& shader, CpuImage& dest)
+	{
+		int width = dest.Width();
+		DispatchVariant(context.constants, [&](auto midLine)
+		{
+			gThreadPool.ParallelFor(0, dest.Height(), [&](int firstRow, int lastRow)
+			{
+				for (int y = firstRow; y < lastRow; ++y)
+				{
+					CpuColour* out = dest.Row(y);
+					float v = (y + 0.5f) * context.invHeight;
+					for (int x = 0; x < width; ++x)
+					{
+						float u = (x + 0.5f) * context.invWidth;
+						PixelInput pixel = { x, y, u, v, u, v };
+						out[x] = StoreColour(Saturate(ShadePixel<decltype(midLine)::value>(context, shader, pixel)));
+					}
+				}
+			});
+		});
+	}
+
+
+	// Run a shader over the rectangle given by area2DTopLeft / area2DSize, alpha blending over the existing contents of dest
+	template <class Shader>
+	void RunArea(const PassContext& context, const Shader& shader, CpuImage& dest)
+	{
+		const auto& c = context.constants;
+		if (c.area2DSize.x <= 0 || c.area2DSize.y <= 0)  return;
+
+		// Pixels are covered if their centre is in the area (left/top edges included, right/bottom excluded)
+		int width  = dest.Width();
+		int height = dest.Height();
+		int left   = std::max(0,      static_cast<int>(std::ceil(c.area2DTopLeft.x * width - 0.5f)));
+		int right  = std::min(width,  static_cast<int>(std::ceil((c.area2DTopLeft.x + c.area2DSize.x) * width - 0.5f)));
+		int top    = std::max(0,      static_cast<int>(std::ceil(c.area2DTopLeft.y * height - 0.5f)));
+		int bottom = std::min(height, static_cast<int>(std::ceil((c.area2DTopLeft.y + c.area2DSize.y) * height - 0.5f)));
+		if (left >= right || top >= bottom)  return;
+
+		const CpuImage* depthMap = context.textures.depthMap;
+		DispatchVariant(c, [&](auto midLine)
+		{
+			gThreadPool.ParallelFor(top, bottom, [&](int firstRow, int lastRow)
+			{
+				for (int y = firstRow; y < lastRow; ++y)
+				{
+					CpuColour* out = dest.Row(y);
+					float v = (y + 0.5f) * context.invHeight;
+					for (int x = left; x < right; ++x)
+					{
+						// Depth test (less than) against the area depth
+						if (depthMap != nullptr && !(c.area2DDepth < depthMap->Pixel(x, y).r))  continue;
+
+						float u = (x + 0.5f) * context.invWidth;
+						PixelInput pixel = { x, y, u, v, (u - c.area2DTopLeft.x) / c.area2DSize.x, (v - c.area2DTopLeft.y) / c.area2DSize.y };
+
+						// Shader output is clamped to the render target range before blending
+						CpuColour colour = StoreColour(Saturate(ShadePixel<decltype(midLine)::value>(context, shader, pixel)));
+						float alpha = colour.a;
+						Float4 blended = LoadColour(colour) * alpha + LoadColour(out[x]) * (1.0f - alpha);
+						out[x] = StoreColour(SetAlpha(blended, alpha));
+					}
+				}
+			});
+		});
+	}
+
+
+	// A corner of a post-process polygon on screen
+	struct ScreenVertex
+	{
+		float x, y;         // Pixel coordinates
+		float depth;        // Depth buffer value
+		float invW;         // For perspective correct interpolation
+		float areaU, areaV; // Area UVs divided by w
+	};
+
+	// Get the corners on screen of the polygon in polygon2DPoints, as the 2DPolygon_pp vertex shader does. Returns false
+	// if a point is behind the camera - that would need clipping, which isn't supported here, so the polygon is skipped
+	bool PolygonScreenVertices(const PostProcessingConstants& c, int width, int height, std::array<ScreenVertex, 4>& vertices)
+	{
+		const float polygonUVs[4][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 1 } };
+		for (int i = 0; i < 4; ++i)
+		{
+			const CVector4& point = c.polygon2DPoints[i];
+			if (point.w <= 0)  return false;
+
+			float invW = 1.0f / point.w;
+			vertices[i].x = (point.x * invW + 1.0f) * 0.5f * width;
+			vertices[i].y = (1.0f - point.y * invW) * 0.5f * height;
+			vertices[i].depth = point.z * invW;
+			vertices[i].invW  = invW;
+			vertices[i].areaU = polygonUVs[i][0] * invW;
+			vertices[i].areaV = polygonUVs[i][1] * invW;
+		}
+		return true;
+	}
+
+	// Run a shader over the pixels of a polygon inside a rectangle, overwriting dest. The four points are drawn as a
+	// triangle strip, with perspective correct area UVs and linear scene UVs. Runs on the calling thread. Polygon passes
+	// aren't full screen, so they always run the NoMidLine variant
+	template <class Shader>
+	void ShadePolygon(const PassContext& context, const Shader& shader, const std::array<ScreenVertex, 4>& vertices,
+	                  CpuImage& dest, const PixelRect& clip)
+	{
+		const CpuImage* depthMap = context.textures.depthMap;
+		const int triangles[2][3] = { { 0, 1, 2 }, { 2, 1, 3 } }; // Triangle strip order
+		for (const auto& triangle : triangles)
+		{
+			const ScreenVertex& v0 = vertices[triangle[0]];
+			const ScreenVertex& v1 = vertices[triangle[1]];
+			const ScreenVertex& v2 = vertices[triangle[2]];
+
+			float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+			if (area == 0)  continue;
+			float invArea = 1.0f / area;
+
+			// Range of pixels whose centres might be in the triangle
+			int left   = std::max(clip.left,       static_cast<int>(std::ceil (std::min({ v0.x, v1.x, v2.x }) - 0.5f)));
+			int right  = std::min(clip.right - 1,  static_cast<int>(std::floor(std::max({ v0.x, v1.x, v2.x }) - 0.5f)));
+			int top    = std::max(clip.top,        static_cast<int>(std::ceil (std::min({ v0.y, v1.y, v2.y }) - 0.5f)));
+			int bottom = std::min(clip.bottom - 1, static_cast<int>(std::floor(std::max({ v0.y, v1.y, v2.y }) - 0.5f)));
+			if (left > right || top > bottom)  continue;
+
+			// The two triangles share an edge, pixels on it may be processed twice but will get the same result each time
+			for (int y = top; y <= bottom; ++y)
+			{
+				CpuColour* out = dest.Row(y);
+				float py = y + 0.5f;
+				float v = py * context.invHeight;
+				for (int x = left; x <= right; ++x)
+				{
+					float px = x + 0.5f;
+					float b0 = ((v2.x - v1.x) * (py - v1.y) - (v2.y - v1.y) * (px - v1.x)) * invArea;
+					float b1 = ((v0.x - v2.x) * (py - v2.y) - (v0.y - v2.y) * (px - v2.x)) * invArea;
+					float b2 = 1.0f - b0 - b1;
+					if (b0 < 0 || b1 < 0 || b2 < 0)  continue;
+
+					// Depth clipping and depth test (less than)
+					float depth = b0 * v0.depth + b1 * v1.depth + b2 * v2.depth;
+					if (depth < 0 || depth > 1)  continue;
+					if (depthMap != nullptr && !(depth < depthMap->Pixel(x, y).r))  continue;
+
+					float invW = b0 * v0.invW + b1 * v1.invW + b2 * v2.invW;
+					float areaU = (b0 * v0.areaU + b1 * v1.areaU + b2 * v2.areaU) / invW;
+					float areaV = (b0 * v0.areaV + b1 * v1.areaV + b2 * v2.areaV) / invW;
+
+					PixelInput pixel = { x, y, px * context.invWidth, v, areaU, areaV };
+					out[x] = StoreColour(Saturate(ShadePixel<false>(context, shader, pixel)));
+				}
+			}
+		}
+	}
+
+	// Run a shader over the polygon in polygon2DPoints, overwriting dest - the rows of the polygon are shared out
+	// between the threads
+	template <class Shader>
+	void RunPolygon(const PassContext& context, const Shader& shader, CpuImage& dest)
+	{
+		int width  = dest.Width();
+		int height = dest.Height();
+		std::array<ScreenVertex, 4> vertices;
+		if (!PolygonScreenVertices(context.constants, width, height, vertices))  return;
+
+		PixelRect bounds = PolygonPixelBounds(context.constants.polygon2DPoints, width, height);
+		gThreadPool.ParallelFor(bounds.top, bounds.bottom, [&](int firstRow, int lastRow)
+		{
+			ShadePolygon(context, shader, vertices, dest, { 0, firstRow, width, lastRow });
+		});
+	}
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Post-processing passes
+//--------------------------------------------------------------------------------------
+
+CpuBlurSettings GetCpuBlurSettings(const Constants& settings)
+{
+	CpuBlurSettings blur;
+	blur.mode = settings.blurMode;
+	blur.deviation = GetBlurKernel(settings.blurStrength, settings.blurSigma, settings.blurLinearSampling).deviation;
+	return blur;
+}
+
+
+// Process the entire image - matches FullScreenPostProcess in PostProcessPasses.h
+bool CpuFullScreenPostProcess(PostProcess postProcess, const PostProcessingConstants& constants,
+                              const CpuPostProcessTextures& textures, const CpuImage& source, CpuImage& dest,
+                              const CpuBlurSettings& blur)
+{
+	if (!HasRequiredTextures(postProcess, textures, source))  return false;
+	dest.Resize(source.Width(), source.Height());
+
+	if (postProcess == PostProcess::Copy)
+	{
+		CopyImage(source, dest);
+		return true;
+	}
+
+	// The constant-time blur modes work on whole rows rather than one pixel at a time
+	if ((postProcess == PostProcess::BlurH || postProcess == PostProcess::BlurV) && blur.mode != BlurMode::Gaussian)
+	{
+		CpuBlurPass(blur.mode, postProcess == PostProcess::BlurV, blur.deviation, source, dest);
+		ApplyMidLine(constants, source, dest);
+		return true;
+	}
+
+	PassContext context = MakePassContext(postProcess, constants, textures, source);
+	return DispatchShader(postProcess, [&](const auto& shader) { RunFullScreen(context, shader, dest); });
+}
+
+
+// Copy source to dest then alpha blend the post-process over the area given by area2DTopLeft/area2DSize - matches AreaPostProcess in PostProcessPasses.h
+// If source and dest are the same image only the area is touched
+bool CpuAreaPostProcess(PostProcess postProcess, const PostProcessingConstants& constants,
+                        const CpuPostProcessTextures& textures, const CpuImage& source, CpuImage& dest)
+{
+	if (!HasRequiredTextures(postProcess, textures, source))  return false;
+	if (postProcess == PostProcess::Copy && &source == &dest)  return true;
+
+	// In place the effect reads a copy of the pixels around the area, otherwise the whole of source
+	const CpuImage* read = &source;
+	if (&source == &dest)
+	{
+		int width = source.Width(), height = source.Height();
+		PixelRect bounds = AreaPixelBounds(constants.area2DTopLeft, constants.area2DSize, width, height);
+		if (bounds.Empty())  return true;
+		CVector2 readMargin = PostProcessReadMargin(postProcess, constants, width, height);
+		read = &CopyImageBounds(source, { ExpandPixelRect(bounds, readMargin, width, height) });
+	}
+	else
+	{
+		dest.Resize(source.Width(), source.Height());
+		CopyImage(source, dest);
+		if (postProcess == PostProcess::Copy)  return true;
+	}
+
+	PassContext context = MakePassContext(postProcess, constants, textures, *read);
+	return DispatchShader(postProcess, [&](const auto& shader) { RunArea(context, shader, dest); });
+}
+
+
+// Copy source to dest then overwrite the pixels inside the four point polygon given in polygon2DPoints - matches PolygonPostProcess in PostProcessPasses.h
+// If source and dest are the same image only the polygon is touched
+bool CpuPolygonPostProcess(PostProcess postProcess, const PostProcessingConstants& constants,
+                           const CpuPostProcessTextures& textures, const CpuImage& source, CpuImage& dest)
+{
+	if (!HasRequiredTextures(postProcess, textures, source))  return false;
+	if (postProcess == PostProcess::Copy && &source == &dest)  return true;
+
+	// In place the effect reads a copy of the pixels around the polygon, otherwise the whole of source
+	const CpuImage* read = &source;
+	if (&source == &dest)
+	{
+		int width = source.Width(), height = source.Height();
+		PixelRect bounds = PolygonPixelBounds(constants.polygon2DPoints, width, height);
+		if (bounds.Empty())  return true;
+		CVector2 readMargin = PostProcessReadMargin(postProcess, constants, width, height);
+		read = &CopyImageBounds(source, { ExpandPixelRect(bounds, readMargin, width, height) });
+	}
+	else
+	{
+		dest.Resize(source.Width(), source.Height());
+		CopyImage(source, dest);
+		if (postProcess == PostProcess::Copy)  return true;
+	}
+
+	PassContext context = MakePassContext(postProcess, constants, textures, *read);
+	return DispatchShader(postProcess, [&](const auto& shader) { RunPolygon(context, shader, dest); });
+}
+
+
+// Draw a batch of windows in one tiled sweep over the screen - matches PolygonBatchPostProcess in PostProcessPasses.h
+bool CpuPolygonBatchPostProcess(const std::vector<PostProcess>& postProcesses, const std::vector<PostProcessingConstants>& constants,
+                                const CpuPostProcessTextures& textures, const CpuImage& source, CpuImage& dest)
+{
+	int numWindows = static_cast<int>(postProcesses.size());
+	if (static_cast<int>(constants.size()) != numWindows)  return false;
+	for (auto postProcess : postProcesses)
+	{
+		if (!IsBatchablePolygonEffect(postProcess) || !HasRequiredTextures(postProcess, textures, source))  return false;
+	}
+
+	int width = source.Width(), height = source.Height();
+	bool inPlace = (&source == &dest);
+	if (!inPlace)
+	{
+		dest.Resize(width, height);
+		CopyImage(source, dest);
+	}
+
+	std::vector<PolygonWindowBounds> windows(numWindows);
+	for (int window = 0; window < numWindows; ++window)
+	{
+		windows[window] = GetPolygonWindowBounds(postProcesses[window], constants[window], width, height);
+	}
+	std::vector<int> draws = PlanPolygonBatchDraws(windows);
+
+	for (size_t draw = 0; draw + 1 < draws.size(); ++draw)
+	{
+		int firstWindow = draws[draw], endWindow = draws[draw + 1];
+
+		// A draw reads the image as the draws before it left it - the source for the first draw, otherwise a copy of
+		// the pixels its windows read
+		const CpuImage* read = &source;
+		if (inPlace || draw > 0)
+		{
+			std::vector<PixelRect> readRects;
+			for (int window = firstWindow; window < endWindow; ++window)  readRects.push_back(windows[window].read);
+			read = &CopyImageBounds(dest, readRects);
+		}
+
+		// Set up each window of the draw - its settings and its corners on screen
+		int numDrawWindows = endWindow - firstWindow;
+		std::vector<PassContext> contexts;
+		contexts.reserve(numDrawWindows);
+		std::vector<std::array<ScreenVertex, 4>> vertices(numDrawWindows);
+		std::vector<bool> visible(numDrawWindows);
+		PixelRect drawBounds;
+		for (int window = firstWindow; window < endWindow; ++window)
+		{
+			int index = window - firstWindow;
+			contexts.push_back(MakePassContext(postProcesses[window], constants[window], textures, *read));
+			visible[index] = PolygonScreenVertices(constants[window], width, height, vertices[index]);
+			if (visible[index])  drawBounds = UnionPixelRect(drawBounds, windows[window].draw);
+		}
+		if (drawBounds.Empty())  continue;
+
+		// Share out square tiles of the screen between the threads. Each tile runs the windows covering it in order, so
+		// where windows overlap the later one is on top as on the GPU
+		const int TILE_SIZE = 64;
+		int tilesX = (drawBounds.right - drawBounds.left + TILE_SIZE - 1) / TILE_SIZE;
+		int tilesY = (drawBounds.bottom - drawBounds.top + TILE_SIZE - 1) / TILE_SIZE;
+		gThreadPool.ParallelFor(0, tilesX * tilesY, [&](int firstTile, int lastTile)
+		{
+			for (int tile = firstTile; tile < lastTile; ++tile)
+			{
+				PixelRect tileRect;
+				tileRect.left   = drawBounds.left + (tile % tilesX) * TILE_SIZE;
+				tileRect.top    = drawBounds.top  + (tile / tilesX) * TILE_SIZE;
+				tileRect.right  = std::min(tileRect.left + TILE_SIZE, drawBounds.right);
+				tileRect.bottom = std::min(tileRect.top  + TILE_SIZE, drawBounds.bottom);
+				for (int window = firstWindow; window < endWindow; ++window)
+				{
+					int index = window - firstWindow;
+					if (!visible[index] || !windows[window].draw.Overlaps(tileRect))  continue;
+
+					DispatchShader(postProcesses[window], [&](const auto& shader)
+					{
+						ShadePolygon(contexts[index], shader, vertices[index], dest, tileRect);
+					});
+				}
+			}
+		}, 1);
+	}
+	return true;
+}
+
+
+// Run a list of fusable post-processes (see PostProcessFusion.h) in a single pass over the image - matches
+// FusedPostProcess in PostProcessPasses.h. The tint colours for each stage must already be in fusedTintColours
+bool CpuFusedPostProcess(const std::vector<PostProcess>& stages, const PostProcessingConstants& constants,
+                         const CpuImage& source, CpuImage& dest)
+{
+	int numStages = static_cast<int>(stages.size());
+	if (numStages == 0 || numStages > MAX_FUSED_STAGES)  return false;
+	for (int s = 0; s < numStages; ++s)
+	{
+		if (!IsFusablePostProcess(stages[s], s == 0))  return false;
+	}
+	dest.Resize(source.Width(), source.Height());
+
+	FusedShader shader;
+	shader.stages = stages.data();
+	shader.numStages = numStages;
+	for (int s = 0; s < numStages; ++s)
+	{
+		const CVector4& top    = constants.fusedTintColours[2 * s];
+		const CVector4& bottom = constants.fusedTintColours[2 * s + 1];
+		shader.topColours[s]    = Float4(top.x,    top.y,    top.z,    0);
+		shader.bottomColours[s] = Float4(bottom.x, bottom.y, bottom.z, 0);
+	}
+
+	CpuPostProcessTextures noTextures;
+	PassContext context = MakePassContext(PostProcess::Copy, constants, noTextures, source);
+	RunFullScreen(context, shader, dest);
+	return true;
+}
+
+
+// Run a fused pass with a baked colour lookup table (see ColourLut.h) - matches the colour LUT path of FusedPostProcess
+// in PostProcessPasses.h. The colour LUT part of the constants must have been set with SetColourLutConstants
+bool CpuColourLutPostProcess(const ColourLut& lut, const PostProcessingConstants& constants,
+                             const CpuImage& source, CpuImage& dest)
+{
+	if (lut.size < 2 || lut.entries.size() != static_cast<size_t>(lut.size) * lut.size * lut.size)  return false;
+	dest.Resize(source.Width(), source.Height());
+
+	auto colour = [](const CVector4& c) { return Float4(c.x, c.y, c.z, 0.0f); };
+	ColourLutShader shader = { lut, constants.lutRetroSample != 0,
+	                           colour(constants.lutPreTintColours[0]),  colour(constants.lutPreTintColours[1]),
+	                           colour(constants.lutPostTintColours[0]), colour(constants.lutPostTintColours[1]) };
+
+	CpuPostProcessTextures noTextures;
+	PassContext context = MakePassContext(PostProcess::Copy, constants, noTextures, source);
+	RunFullScreen(context, shader, dest);
+	return true;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Post-processing stack
+//--------------------------------------------------------------------------------------
+
+// Run a whole post-process list in the same order and with the same settings updates as RenderScene
+void CpuRunPostProcessStack(const std::vector<ProcessAndMode>& postProcessList, std::vector<Constants>& settingsList,
+                            const std::vector<std::array<CVector4, 4>>& polygonPoints, float frameTime,
+                            PostProcessingConstants& constants, const CpuPostProcessTextures& textures,
+                            const CpuImage& scene, CpuImage& result, int colourLutSize)
+{
+	int width  = scene.Width();
+	int height = scene.Height();
+
+	// The passes come from the same compiled graph as RenderScene runs (see PostProcessGraph.h), kept between calls so
+	// it is only rebuilt when the list changes. The images come from a render target pool in the same way as on the
+	// GPU, each slot being one CPU image
+	static thread_local PostProcessGraphCache graphs;
+	const CompiledPostProcessGraph& graph = graphs.Get(postProcessList);
+	if (graph.passes.empty())
+	{
+		result = scene;
+		return;
+	}
+
+	RenderTargetDesc sceneDesc;
+	sceneDesc.width = width;
+	sceneDesc.height = height;
+	RenderTargetPool pool;
+	std::vector<CpuImage> images;
+	auto image = [&](int slot) -> CpuImage&
+	{
+		if (slot >= static_cast<int>(images.size()))  images.resize(slot + 1);
+		return images[slot];
+	};
+	int sceneSlot = pool.Acquire(sceneDesc);
+	image(sceneSlot) = scene;
+
+	// Run one pass for list entry i - mirrors the FullScreenPostProcess, PolygonPostProcess and BloomPostProcess
+	// functions in PostProcessPasses.h. The blur settings carry over from a BlurH entry to the BlurV after it, as the taps do
+	CpuBlurSettings blur;
+	auto runPass = [&](PostProcess postProcess, PostProcessMode mode, int i, const CpuImage& source, CpuImage& dest)
+	{
+		if (postProcess != PostProcess::Copy && i < static_cast<int>(settingsList.size()))
+		{
+			UpdatePostProcessConstants(postProcess, settingsList[i], frameTime, width, height, constants);
+			if (postProcess == PostProcess::BlurH)  blur = GetCpuBlurSettings(settingsList[i]);
+		}
+		constants.area2DTopLeft = { 0, 0 };
+		constants.area2DSize = { 1, 1 };
+		constants.area2DDepth = 0;
+
+		if (mode == PostProcessMode::Polygon)
+		{
+			if (i < static_cast<int>(polygonPoints.size()))
+			{
+				for (int p = 0; p < 4; ++p)  constants.polygon2DPoints[p] = polygonPoints[i][p];
+			}
+			CpuPolygonPostProcess(postProcess, constants, textures, source, dest);
+		}
+		else if (postProcess == PostProcess::Bloom1)
+		{
+			CpuBloomPostProcess(constants, source, dest);
+		}
+		else
+		{
+			CpuFullScreenPostProcess(postProcess, constants, textures, source, dest, blur);
+		}
+	};
+
+	// Draw several polygon entries in one batch - mirrors PolygonBatchPostProcess in PostProcessPasses.h
+	auto runBatchPass = [&](const std::vector<int>& entries, const CpuImage& source, CpuImage& dest)
+	{
+		std::vector<PostProcess> postProcesses;
+		std::vector<PostProcessingConstants> windowConstants;
+		for (int i : entries)
+		{
+			postProcesses.push_back(postProcessList[i].process);
+			if (i < static_cast<int>(settingsList.size()))
+			{
+				UpdatePostProcessConstants(postProcessList[i].process, settingsList[i], frameTime, width, height, constants);
+			}
+			constants.area2DTopLeft = { 0, 0 };
+			constants.area2DSize = { 1, 1 };
+			constants.area2DDepth = 0;
+			if (i < static_cast<int>(polygonPoints.size()))
+			{
+				for (int p = 0; p < 4; ++p)  constants.polygon2DPoints[p] = polygonPoints[i][p];
+			}
+			windowConstants.push_back(constants);
+		}
+		CpuPolygonBatchPostProcess(postProcesses, windowConstants, textures, source, dest);
+	};
+
+	// Run several list entries in a single pass - mirrors FusedPostProcess in PostProcessPasses.h
+	auto runFusedPass = [&](const std::vector<int>& entries, const CpuImage& source, CpuImage& dest)
+	{
+		std::vector<PostProcess> stages;
+		for (int stage = 0; stage < static_cast<int>(entries.size()); ++stage)
+		{
+			int i = entries[stage];
+			stages.push_back(postProcessList[i].process);
+			if (i < static_cast<int>(settingsList.size()))
+			{
+				UpdatePostProcessConstants(postProcessList[i].process, settingsList[i], frameTime, width, height, constants);
+			}
+			SetFusedStageConstants(stage, postProcessList[i].process, constants);
+		}
+		constants.area2DTopLeft = { 0, 0 };
+		constants.area2DSize = { 1, 1 };
+		constants.area2DDepth = 0;
+
+		// The tables are kept between calls, one for each fused pass as on the GPU, so they are only rebaked when settings change
+		static thread_local std::map<int, ColourLutCache> colourLuts;
+		ColourLutPlan lutPlan;
+		if (colourLutSize > 0 && PlanColourLut(stages, constants, lutPlan))
+		{
+			SetColourLutConstants(lutPlan, colourLutSize, constants);
+			CpuColourLutPostProcess(colourLuts[entries[0]].Get(stages, lutPlan, constants, colourLutSize), constants, source, dest);
+		}
+		else
+		{
+			CpuFusedPostProcess(stages, constants, source, dest);
+		}
+	};
+
+	// The final pass writes straight into the result, as the GPU's final pass writes the back buffer
+	int finalSlot;
+	RunPostProcessGraph(graph, pool, sceneDesc, sceneSlot, true,
+		[&](const PostProcessPass& pass, const std::vector<int>& inputs, int output)
+		{
+			// Get the output first - a new slot can grow the image list, which would move the input
+			CpuImage&       dest   = (output == SCREEN_OUTPUT_SLOT) ? result : image(output);
+			const CpuImage& source = image(inputs[0]);
+
+			int i = pass.entries[0];
+			constants.IsFullScreen = (pass.type != PostProcessPassType::Polygon);
+			switch (pass.type)
+			{
+				case PostProcessPassType::Polygon:
+					if (IsBatchablePolygonEffect(postProcessList[i].process))
+					{
+						runBatchPass(pass.entries, source, dest);
+					}
+					else
+					{
+						runPass(postProcessList[i].process, PostProcessMode::Polygon, i, source, dest);
+					}
+					break;
+
+				case PostProcessPassType::Fused:
+					runFusedPass(pass.entries, source, dest);
+					break;
+
+				case PostProcessPassType::Bloom:
+					// The whole bloom chain counts as one pass
+					runPass(PostProcess::Bloom1, PostProcessMode::Fullscreen, i, source, dest);
+					break;
+
+				default:
+					runPass(postProcessList[i].process, PostProcessMode::Fullscreen, i, source, dest);
+					break;
+			}
+			return true;
+		}, finalSlot);
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Comparison
+//--------------------------------------------------------------------------------------
+
+// Compare two images of the same size, errors are per colour channel (alpha is ignored)
+CpuImageDifference CompareCpuImages(const CpuImage& a, const CpuImage& b, float tolerance)
+{
+	CpuImageDifference difference;
+	if (a.Width() != b.Width() || a.Height() != b.Height())
+	{
+		difference.maxError = 1.0f;
+		difference.meanError = 1.0f;
+		difference.numPixelsOverTolerance = std::max(a.Width() * a.Height(), b.Width() * b.Height());
+		return difference;
+	}
+
+	double totalError = 0;
+	for (int y = 0; y < a.Height(); ++y)
+	{
+		const CpuColour* rowA = a.Row(y);
+		const CpuColour* rowB = b.Row(y);
+		for (int x = 0; x < a.Width(); ++x)
+		{
+			float errorR = std::abs(rowA[x].r - rowB[x].r);
+			float errorG = std::abs(rowA[x].g - rowB[x].g);
+			float errorB = std::abs(rowA[x].b - rowB[x].b);
+			float pixelMax = std::max({ errorR, errorG, errorB });
+
+			difference.maxError = std::max(difference.maxError, pixelMax);
+			totalError += errorR + errorG + errorB;
+			if (pixelMax > tolerance)  ++difference.numPixelsOverTolerance;
+		}
+	}
+
+	int numPixels = a.Width() * a.Height();
+	if (numPixels > 0)  difference.meanError = static_cast<float>(totalError / (numPixels * 3.0));
+	return difference;
+}
@@ -0,0 +1,194 @@
+//--------------------------------------------------------------------------------------
+// CPU reference implementation of the post-processing effects
+//--------------------------------------------------------------------------------------
+// Runs every effect in the PostProcess enum over an image held in memory, reading the same
+// PostProcessingConstants structure that is sent to the GPU shaders. Work is split into bands of rows
+// over the worker threads (see ThreadPool.h) and the colour maths uses the Float4 SIMD type (CpuSimd.h).
+//
+// Each effect follows its _pp.hlsl shader line for line, so results match the GPU within a small tolerance
+// (the GPU stores 8-bit values between passes and uses mip-mapping on the noise/burn/distort maps). This gives
+// a headless path that runs on any platform and can be used as the golden reference for the shaders
+
+#ifndef _CPU_POST_PROCESS_H_INCLUDED_
+#define _CPU_POST_PROCESS_H_INCLUDED_
+
+#include "PostProcess.h"
+#include "ColourLut.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Images
+//--------------------------------------------------------------------------------------
+
+// One RGBA pixel, 16-byte aligned so it can be loaded straight into a SIMD register
+struct alignas(16) CpuColour
+{
+	float r, g, b, a;
+};
+
+
+// A 2D image of floating point RGBA pixels. Plays the part of a texture / render target on the CPU
+class CpuImage
+{
+public:
+	//-------------------------------------
+	// Construction and Usage
+	//-------------------------------------
+
+	// Create an image of the given size, all pixels transparent black
+	CpuImage(int width = 0, int height = 0)  { Resize(width, height); }
+
+	// Change the size of the image, contents are lost
+	void Resize(int width, int height);
+
+	// Set every pixel to the given colour
+	void Fill(CpuColour colour);
+
+	int Width()  const { return mWidth;  }
+	int Height() const { return mHeight; }
+
+	// Direct pixel access, no range checking
+	CpuColour*       Row(int y)                { return &mPixels[static_cast<size_t>(y) * mWidth]; }
+	const CpuColour* Row(int y)          const { return &mPixels[static_cast<size_t>(y) * mWidth]; }
+	CpuColour&       Pixel(int x, int y)       { return Row(y)[x]; }
+	const CpuColour& Pixel(int x, int y) const { return Row(y)[x]; }
+
+
+	//-------------------------------------
+	// 8-bit conversion
+	//-------------------------------------
+	// Convert to and from the RGBA8 (DXGI_FORMAT_R8G8B8A8_UNORM) layout used by the scene textures, e.g. to
+	// compare against a GPU read-back or to load source images. rowPitch is the number of bytes per row
+
+	void LoadRGBA8 (const uint8_t* data, int width, int height, int rowPitch);
+	void StoreRGBA8(uint8_t* data, int rowPitch) const;
+
+
+	//-------------------------------------
+	// Sampling
+	//-------------------------------------
+	// UVs are 0->1 across the image as in the shaders
+
+	// Point sampling with clamp addressing - matches gPointSampler
+	CpuColour SamplePoint(float u, float v) const;
+
+	// Bilinear sampling with wrap addressing - matches the top mip level of gTrilinearSampler
+	CpuColour SampleLinearWrap(float u, float v) const;
+
+	// Bilinear sampling with clamp addressing
+	CpuColour SampleLinearClamp(float u, float v) const;
+
+
+//-------------------------------------
+// Private members
+//-------------------------------------
+private:
+	int mWidth  = 0;
+	int mHeight = 0;
+	std::vector<CpuColour> mPixels;
+};
+
+
+// Additional textures used by some post-processes, the same textures the GPU path binds to slots t1/t2.
+// Leave a texture as nullptr if the effects that use it won't be run
+struct CpuPostProcessTextures
+{
+	const CpuImage* noiseMap   = nullptr; // GreyNoise (Noise.png)
+	const CpuImage* burnMap    = nullptr; // Burn (Burn.png)
+	const CpuImage* distortMap = nullptr; // Distort (Distort.png)
+	const CpuImage* bloomBase  = nullptr; // Bloom2 - the scene as it was before the bloom passes
+	const CpuImage* depthMap   = nullptr; // DepthOfField and depth testing of area / polygon effects - depth buffer values in the red channel
+};
+
+
+// How the full-screen BlurH / BlurV passes blur. The constant-time modes (see CpuBlur.h) only exist on the CPU, so
+// these aren't in PostProcessingConstants, which matches the GPU constant buffers. The Gaussian uses blurTaps
+struct CpuBlurSettings
+{
+	BlurMode mode      = BlurMode::Gaussian;
+	float    deviation = 0; // Standard deviation of the Gaussian the constant-time modes match, in pixels
+};
+
+// Blur settings for a BlurH list entry, the BlurV pass after it uses the same ones (as it does the same taps)
+CpuBlurSettings GetCpuBlurSettings(const Constants& settings);
+
+
+//--------------------------------------------------------------------------------------
+// Post-processing passes
+//--------------------------------------------------------------------------------------
+// Each function reads source and writes dest, which must be different images of the same size - apart from the area
+// and polygon passes, which can update an image in place (only touching the pixels they cover).
+// Returns false if the post-process is not supported (PostProcess::None)
+
+// Process the entire image - matches FullScreenPostProcess in PostProcessPasses.h. BlurH and BlurV passes blur as given by blur
+bool CpuFullScreenPostProcess(PostProcess postProcess, const PostProcessingConstants& constants,
+                              const CpuPostProcessTextures& textures, const CpuImage& source, CpuImage& dest,
+                              const CpuBlurSettings& blur = CpuBlurSettings());
+
+// Copy source to dest then alpha blend the post-process over the area given by area2DTopLeft/area2DSize, depth
+// tested against area2DDepth if a depth map is given - matches AreaPostProcess in PostProcessPasses.h
+bool CpuAreaPostProcess(PostProcess postProcess, const PostProcessingConstants& constants,
+                        const CpuPostProcessTextures& textures, const CpuImage& source, CpuImage& dest);
+
+// Copy source to dest then overwrite the pixels inside the four point polygon given in polygon2DPoints (already
+// transformed to clip space, drawn as a triangle strip) - matches PolygonPostProcess in PostProcessPasses.h
+bool CpuPolygonPostProcess(PostProcess postProcess, const PostProcessingConstants& constants,
+                           const CpuPostProcessTextures& textures, const CpuImage& source, CpuImage& dest);
+
+// Draw a batch of windows (see PolygonBatch.h) - window i runs postProcesses[i] with constants[i] inside the polygon in
+// its polygon2DPoints. The windows are drawn in one tiled sweep over the screen rather than a pass each, giving the same
+// result - matches PolygonBatchPostProcess in PostProcessPasses.h. Every post-process must be batchable (IsBatchablePolygonEffect).
+// source and dest can be the same image, then only the windows are touched
+bool CpuPolygonBatchPostProcess(const std::vector<PostProcess>& postProcesses, const std::vector<PostProcessingConstants>& constants,
+                                const CpuPostProcessTextures& textures, const CpuImage& source, CpuImage& dest);
+
+// Apply a run of fusable post-processes (see PostProcessFusion.h) in a single pass over the image - matches
+// FusedPostProcess in PostProcessPasses.h. The per-stage tint colours must already be in fusedTintColours (SetFusedStageConstants)
+bool CpuFusedPostProcess(const std::vector<PostProcess>& stages, const PostProcessingConstants& constants,
+                         const CpuImage& source, CpuImage& dest);
+
+// Apply a fused pass with a baked colour lookup table (see ColourLut.h) - matches the colour LUT path of FusedPostProcess
+// in PostProcessPasses.h. The colour LUT part of the constants must have been set with SetColourLutConstants
+bool CpuColourLutPostProcess(const ColourLut& lut, const PostProcessingConstants& constants,
+                             const CpuImage& source, CpuImage& dest);
+
+
+//--------------------------------------------------------------------------------------
+// Post-processing stack
+//--------------------------------------------------------------------------------------
+
+// Run a whole post-process list in the same order and with the same settings updates as RenderScene, using the same
+// compiled graph (see PostProcessGraph.h): polygon effects first, then full-screen effects, then bloom (see CpuBloom.h).
+// Area entries and entries that leave the image unchanged are skipped as RenderScene does.
+// polygonPoints gives the clip space corners for each list entry (only polygon entries use it).
+// The settings and constants are updated (animation etc.) exactly as the GPU path would update them.
+// Fused passes of colour-only effects use a colour lookup table of the given size as RenderScene does (0 for none)
+void CpuRunPostProcessStack(const std::vector<ProcessAndMode>& postProcessList, std::vector<Constants>& settingsList,
+                            const std::vector<std::array<CVector4, 4>>& polygonPoints, float frameTime,
+                            PostProcessingConstants& constants, const CpuPostProcessTextures& textures,
+                            const CpuImage& scene, CpuImage& result, int colourLutSize = 0);
+
+
+//--------------------------------------------------------------------------------------
+// Comparison
+//--------------------------------------------------------------------------------------
+
+// Result of comparing two images, errors are per colour channel (alpha is ignored)
+struct CpuImageDifference
+{
+	float maxError  = 0; // Largest difference found in any channel
+	float meanError = 0; // Average difference over all channels
+	int   numPixelsOverTolerance = 0;
+};
+
+// Compare two images of the same size, e.g. a CPU result against a GPU read-back. A tolerance of 2/255 is
+// a sensible choice for a single pass given the 8-bit render targets used on the GPU
+CpuImageDifference CompareCpuImages(const CpuImage& a, const CpuImage& b, float tolerance);
+
+
+#endif //_CPU_POST_PROCESS_H_INCLUDED_
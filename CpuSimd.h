@@ -0,0 +1,125 @@
+//--------------------------------------------------------------------------------------
+// Four-wide float SIMD helper for the CPU post-processing kernels
+//--------------------------------------------------------------------------------------
+// A Float4 holds one RGBA colour (or any four floats) in a single SSE register when SSE is available,
+// otherwise it falls back to plain scalar code with the same interface (e.g. on ARM or when building
+// without SSE). The kernels are written once against this type
+
+#ifndef _CPU_SIMD_H_INCLUDED_
+#define _CPU_SIMD_H_INCLUDED_
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CPU_SIMD_SSE 1
+	#include <emmintrin.h>
+#else
+	#define CPU_SIMD_SSE 0
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+
+struct Float4
+{
+#if CPU_SIMD_SSE
+	__m128 v;
+
+	Float4() = default;
+	Float4(__m128 value) : v(value) {}
+	explicit Float4(float s) : v(_mm_set1_ps(s)) {}
+	Float4(float x, float y, float z, float w) : v(_mm_setr_ps(x, y, z, w)) {}
+
+	// Load / store four floats, the pointer must be 16-byte aligned
+	static Float4 Load(const float* p)  { return _mm_load_ps(p); }
+	void Store(float* p) const           { _mm_store_ps(p, v); }
+
+	// Load / store four floats from anywhere (e.g. a row of a CMatrix4x4)
+	static Float4 LoadUnaligned(const float* p)  { return _mm_loadu_ps(p); }
+	void StoreUnaligned(float* p) const           { _mm_storeu_ps(p, v); }
+
+	float X() const  { return _mm_cvtss_f32(v); }
+#else
+	float v[4];
+
+	Float4() = default;
+	explicit Float4(float s) : v{ s, s, s, s } {}
+	Float4(float x, float y, float z, float w) : v{ x, y, z, w } {}
+
+	static Float4 Load(const float* p)  { return Float4(p[0], p[1], p[2], p[3]); }
+	void Store(float* p) const           { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+
+	static Float4 LoadUnaligned(const float* p)  { return Load(p); }
+	void StoreUnaligned(float* p) const           { Store(p); }
+
+	float X() const  { return v[0]; }
+#endif
+};
+
+
+#if CPU_SIMD_SSE
+
+inline Float4 operator+(Float4 a, Float4 b)  { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b)  { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b)  { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b)  { return _mm_div_ps(a.v, b.v); }
+inline Float4 Min(Float4 a, Float4 b)        { return _mm_min_ps(a.v, b.v); }
+inline Float4 Max(Float4 a, Float4 b)        { return _mm_max_ps(a.v, b.v); }
+
+// Round each element towards negative infinity (SSE2 has no floor instruction, so truncate and fix up negatives)
+inline Float4 Floor(Float4 a)
+{
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+	__m128 tooBig = _mm_cmpgt_ps(truncated, a.v);
+	return _mm_sub_ps(truncated, _mm_and_ps(tooBig, _mm_set1_ps(1.0f)));
+}
+
+// Compare each element, returning a bit per element (bit 0 for x) set where the comparison is true
+inline int GreaterEqualMask(Float4 a, Float4 b)  { return _mm_movemask_ps(_mm_cmpge_ps(a.v, b.v)); }
+inline int LessEqualMask(Float4 a, Float4 b)     { return _mm_movemask_ps(_mm_cmple_ps(a.v, b.v)); }
+
+// Swap the rows and columns of four Float4s treated as a 4x4 matrix
+inline void Transpose(Float4& row0, Float4& row1, Float4& row2, Float4& row3)
+{
+	_MM_TRANSPOSE4_PS(row0.v, row1.v, row2.v, row3.v);
+}
+
+#else
+
+inline Float4 operator+(Float4 a, Float4 b)  { return Float4(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]); }
+inline Float4 operator-(Float4 a, Float4 b)  { return Float4(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]); }
+inline Float4 operator*(Float4 a, Float4 b)  { return Float4(a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]); }
+inline Float4 operator/(Float4 a, Float4 b)  { return Float4(a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]); }
+inline Float4 Min(Float4 a, Float4 b)  { return Float4(std::min(a.v[0], b.v[0]), std::min(a.v[1], b.v[1]), std::min(a.v[2], b.v[2]), std::min(a.v[3], b.v[3])); }
+inline Float4 Max(Float4 a, Float4 b)  { return Float4(std::max(a.v[0], b.v[0]), std::max(a.v[1], b.v[1]), std::max(a.v[2], b.v[2]), std::max(a.v[3], b.v[3])); }
+
+inline Float4 Floor(Float4 a)
+{
+	return Float4(std::floor(a.v[0]), std::floor(a.v[1]), std::floor(a.v[2]), std::floor(a.v[3]));
+}
+
+inline int GreaterEqualMask(Float4 a, Float4 b)
+{
+	return (a.v[0] >= b.v[0]) | (a.v[1] >= b.v[1]) << 1 | (a.v[2] >= b.v[2]) << 2 | (a.v[3] >= b.v[3]) << 3;
+}
+inline int LessEqualMask(Float4 a, Float4 b)  { return GreaterEqualMask(b, a); }
+
+inline void Transpose(Float4& row0, Float4& row1, Float4& row2, Float4& row3)
+{
+	std::swap(row0.v[1], row1.v[0]);
+	std::swap(row0.v[2], row2.v[0]);
+	std::swap(row0.v[3], row3.v[0]);
+	std::swap(row1.v[2], row2.v[1]);
+	std::swap(row1.v[3], row3.v[1]);
+	std::swap(row2.v[3], row3.v[2]);
+}
+
+#endif
+
+
+// Helpers built on the operations above
+inline Float4 operator*(Float4 a, float s)          { return a * Float4(s); }
+inline Float4 Lerp(Float4 a, Float4 b, float t)     { return a + (b - a) * Float4(t); }
+inline Float4 Saturate(Float4 a)                    { return Min(Max(a, Float4(0.0f)), Float4(1.0f)); }
+
+
+#endif //_CPU_SIMD_H_INCLUDED_
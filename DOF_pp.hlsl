@@ -27,7 +27,7 @@ float4 main(PostProcessingInput input) : SV_Target
 {
     float3 finalColour = float3(1.0, 0.0, 0.0);
     
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
         finalColour = SceneTexture.Sample(PointSample, input.sceneUV); //this takes our sampler and turns the rgba into floats between 0 and 1
 
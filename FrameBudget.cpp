@@ -0,0 +1,379 @@
+//--------------------------------------------------------------------------------------
+// Checking the cost of post-processing against budgets
+//--------------------------------------------------------------------------------------
+
+#include "FrameBudget.h"
+#include "PostProcessPasses.h"
+#include "PostProcessGraph.h"
+#include "RenderTargetPool.h"
+#include "StateCache.h"
+
+#include <string>
+#include <vector>
+
+
+namespace
+{
+	// Shader used for each post-process, for the log
+	const char* POST_PROCESS_SHADER_NAMES[NUM_POST_PROCESSES] =
+	{
+		"None", "Copy_pp", "Tint_pp", "GreyNoise_pp", "Burn_pp", "Distort_pp", "Spiral_pp", "HeatHaze_pp", "HueTint_pp",
+		"BlurHorizontal_pp", "BlurVertical_pp", "Underwater_pp", "InvertColour_pp", "NightVision_pp", "Retro_pp",
+		"Bloom1_pp", "Bloom2_pp", "DOF_pp",
+	};
+
+	const float FRAME_TIME = 1.0f / 60.0f;
+
+
+	RecordedObject MakeObject(const std::string& name, RecordedObjectType type, size_t bytes = 0)
+	{
+		RecordedObject object;
+		object.name = name;
+		object.type = type;
+		object.bytes = bytes;
+		return object;
+	}
+
+
+	// An effect compiled in each shader variant, as PostProcessShader in Shader.h
+	struct RecordedPostProcessShader
+	{
+		RecordedObject variants[NUM_SHADER_VARIANTS];
+
+		RecordedObject* Get(ShaderVariant variant)  { return &variants[static_cast<int>(variant)]; }
+	};
+
+	// Passes aren't timed when recording
+	struct NoPassTiming
+	{
+		explicit NoPassTiming(const std::string&) {}
+	};
+
+
+	// Types for the post-processing passes (PostProcessPasses.h) in front of a RecordingContext. The objects the passes
+	// create are allocated here and deleted when released
+	struct RecordingPostProcessApi : RecordingApi
+	{
+		using Resource          = RecordedObject;
+		using Texture2D         = RecordedObject;
+		using Texture3D         = RecordedObject;
+		using Box               = RecordedBox;
+		using PostProcessShader = RecordedPostProcessShader;
+		using PassTiming        = NoPassTiming;
+		static constexpr RecordedTopology TRIANGLE_STRIP = RecordedTopology::TriangleStrip;
+
+		static void* Map(RecordingContext* context, RecordedObject* buffer)   { return context->Map(buffer); }
+		static void  Unmap(RecordingContext* context, RecordedObject* buffer) { context->Unmap(buffer); }
+
+		static bool CreateRenderTarget(int slot, const RenderTargetDesc& desc, PostProcessTarget<RecordingPostProcessApi>& target)
+		{
+			std::string name = "Pool target " + std::to_string(slot);
+			target.texture      = new RecordedObject(MakeObject(name, RecordedObjectType::Texture, RenderTargetBytes(desc)));
+			target.renderTarget = new RecordedObject(MakeObject(name, RecordedObjectType::View));
+			target.textureSRV   = new RecordedObject(MakeObject(name + " SRV", RecordedObjectType::View));
+			return true;
+		}
+
+		static RecordedObject* CreateFusedShader(const std::vector<PostProcess>& stages, ShaderVariant variant)
+		{
+			std::string name = "Fused";
+			for (PostProcess stage : stages)  name += std::string(" ") + POST_PROCESS_SHADER_NAMES[static_cast<int>(stage)];
+			if (variant == ShaderVariant::MidLine)  name += " (mid-line)";
+			return new RecordedObject(MakeObject(name, RecordedObjectType::Shader));
+		}
+
+		static bool CreateColourLutTexture(int size, const std::vector<uint8_t>& texels, PostProcessColourLut<RecordingPostProcessApi>& colourLut)
+		{
+			colourLut.texture    = new RecordedObject(MakeObject("Colour LUT", RecordedObjectType::Texture, texels.size()));
+			colourLut.textureSRV = new RecordedObject(MakeObject("Colour LUT " + std::to_string(size) + " SRV", RecordedObjectType::View));
+			return true;
+		}
+
+		static void Release(RecordedObject* object)  { delete object; }
+	};
+
+
+	// Runs the post-processing part of RenderScene in Scene.cpp - the scene set-up the passes rely on, then the passes
+	// themselves, through the same PostProcessPasses code as the app. The objects stand in for the DirectX ones there
+	class PostProcessRecorder
+	{
+	public:
+		PostProcessRecorder(const std::vector<ProcessAndMode>& postProcessList, int width, int height, int colourLutSize,
+		                    RecordingContext& context);
+
+		void RenderFrame(float frameTime);
+
+	private:
+		void SetViewport(int width, int height);
+
+		StateFilter<RecordingPostProcessApi> mStateFilter;
+
+		const std::vector<ProcessAndMode>& mPostProcessList;
+		std::vector<Constants>             mConstantsList;
+		PostProcessingConstants            mPostProcessingConstants = {};
+		PostProcessGraphCache              mPostProcessGraphs;
+		std::vector<CVector4>              mClipPoints; // Corners of each polygon entry in clip space, four per list index
+		int mViewportWidth;
+		int mViewportHeight;
+
+		PostProcessPasses<RecordingPostProcessApi> mPostProcessPasses;
+
+		// Objects standing in for the DirectX ones in Scene.cpp
+		RecordedObject mBackBufferTexture, mBackBufferRenderTarget, mDepthStencil, mDepthShaderView;
+		RecordedObject m2DQuadVertexShader, m2DPolygonVertexShader, m2DPolygonBatchVertexShader;
+		RecordedObject mCopyPostProcess, mPolygonBatchPostProcess;
+		RecordedObject mBloomThresholdPostProcess, mBloomDownsamplePostProcess, mBloomUpsamplePostProcess;
+		RecordedPostProcessShader mPostProcessShaders[NUM_POST_PROCESSES];
+		RecordedPostProcessShader mColourLutPostProcess, mBloomCompositePostProcess;
+		RecordedObject mNoBlendingState, mAdditiveBlendingState, mAlphaBlendingState;
+		RecordedObject mDepthReadOnlyState, mNoDepthBufferState;
+		RecordedObject mCullNoneState, mCullNoneScissorState;
+		RecordedObject mPointSampler, mBilinearClampSampler, mTrilinearSampler;
+		RecordedObject mNoiseMapSRV, mBurnMapSRV, mDistortMapSRV;
+		RecordedObject mPostProcessingConstantBuffers[NUM_POST_PROCESS_CONSTANT_BLOCKS];
+		RecordedObject mPolygonBatchConstantBuffer, mPolygonBatchBuffer, mPolygonBatchBufferSRV;
+	};
+
+
+	PostProcessRecorder::PostProcessRecorder(const std::vector<ProcessAndMode>& postProcessList, int width, int height,
+	                                         int colourLutSize, RecordingContext& context)
+		: mPostProcessList(postProcessList), mConstantsList(postProcessList.size()), mViewportWidth(width), mViewportHeight(height),
+		  mPostProcessPasses(mStateFilter, mPostProcessList, mConstantsList, mPostProcessingConstants)
+	{
+		mStateFilter.SetContext(&context);
+		mPostProcessingConstants.MidLine = 0.5f;
+		mPostProcessPasses.SetScreenSize(width, height);
+		mPostProcessPasses.colourLutSize = colourLutSize;
+
+		// The polygon windows side by side across the middle of the screen, like the windows in the scene. Corners in the
+		// same order as the scene's: top-left, bottom-left, top-right, bottom-right
+		int numWindows = 0;
+		for (auto& entry : postProcessList)  numWindows += (entry.mode == PostProcessMode::Polygon) ? 1 : 0;
+		mClipPoints.resize(postProcessList.size() * 4);
+		int window = 0;
+		for (size_t i = 0; i < postProcessList.size(); ++i)
+		{
+			if (postProcessList[i].mode != PostProcessMode::Polygon)  continue;
+			float left = -0.8f + 1.6f * window / numWindows;
+			float right = left + 1.4f / numWindows;
+			mClipPoints[i * 4 + 0] = { left,   0.5f, 0.5f, 1.0f };
+			mClipPoints[i * 4 + 1] = { left,  -0.5f, 0.5f, 1.0f };
+			mClipPoints[i * 4 + 2] = { right,  0.5f, 0.5f, 1.0f };
+			mClipPoints[i * 4 + 3] = { right, -0.5f, 0.5f, 1.0f };
+			++window;
+		}
+
+		using Type = RecordedObjectType;
+		mBackBufferTexture      = MakeObject("Back buffer", Type::Texture, RenderTargetBytes(mPostProcessPasses.SceneTargetDesc()));
+		mBackBufferRenderTarget = MakeObject("Back buffer", Type::View);
+		mDepthStencil           = MakeObject("Depth buffer", Type::View);
+		mDepthShaderView        = MakeObject("Depth buffer SRV", Type::View);
+
+		m2DQuadVertexShader         = MakeObject("2DQuad_pp", Type::Shader);
+		m2DPolygonVertexShader      = MakeObject("2DPolygon_pp", Type::Shader);
+		m2DPolygonBatchVertexShader = MakeObject("2DPolygonBatch_pp", Type::Shader);
+		mCopyPostProcess            = MakeObject("Copy_pp", Type::Shader);
+		mPolygonBatchPostProcess    = MakeObject("PolygonBatch_pp", Type::Shader);
+		mBloomThresholdPostProcess  = MakeObject("BloomThreshold_pp", Type::Shader);
+		mBloomDownsamplePostProcess = MakeObject("BloomDownsample_pp", Type::Shader);
+		mBloomUpsamplePostProcess   = MakeObject("BloomUpsample_pp", Type::Shader);
+		for (int variant = 0; variant < NUM_SHADER_VARIANTS; ++variant)
+		{
+			std::string suffix = (variant == static_cast<int>(ShaderVariant::MidLine)) ? " (mid-line)" : "";
+			for (int process = 0; process < NUM_POST_PROCESSES; ++process)
+			{
+				mPostProcessShaders[process].variants[variant] = MakeObject(POST_PROCESS_SHADER_NAMES[process] + suffix, Type::Shader);
+			}
+			mColourLutPostProcess.variants[variant]      = MakeObject("ColourLut_pp" + suffix, Type::Shader);
+			mBloomCompositePostProcess.variants[variant] = MakeObject("BloomComposite_pp" + suffix, Type::Shader);
+		}
+
+		mNoBlendingState       = MakeObject("No blending", Type::State);
+		mAdditiveBlendingState = MakeObject("Additive blending", Type::State);
+		mAlphaBlendingState    = MakeObject("Alpha blending", Type::State);
+		mDepthReadOnlyState    = MakeObject("Depth read-only", Type::State);
+		mNoDepthBufferState    = MakeObject("No depth buffer", Type::State);
+		mCullNoneState         = MakeObject("Cull none", Type::State);
+		mCullNoneScissorState  = MakeObject("Cull none scissor", Type::State);
+		mPointSampler          = MakeObject("Point sampler", Type::State);
+		mBilinearClampSampler  = MakeObject("Bilinear clamp sampler", Type::State);
+		mTrilinearSampler      = MakeObject("Trilinear sampler", Type::State);
+		mNoiseMapSRV           = MakeObject("Noise map", Type::View);
+		mBurnMapSRV            = MakeObject("Burn map", Type::View);
+		mDistortMapSRV         = MakeObject("Distort map", Type::View);
+
+		for (int block = 0; block < NUM_POST_PROCESS_CONSTANT_BLOCKS; ++block)
+		{
+			size_t offset, size;
+			PostProcessConstantBlockRange(static_cast<PostProcessConstantBlock>(block), offset, size);
+			mPostProcessingConstantBuffers[block] = MakeObject("Post-process constants b" + std::to_string(block == 0 ? 1 : block + 2),
+			                                                   Type::ConstantBuffer, size);
+		}
+		mPolygonBatchConstantBuffer = MakeObject("Polygon batch constants", Type::ConstantBuffer, sizeof(PolygonBatchConstants));
+		mPolygonBatchBuffer         = MakeObject("Polygon batch", Type::Buffer, MAX_POLYGON_BATCH * sizeof(PolygonInstance));
+		mPolygonBatchBufferSRV      = MakeObject("Polygon batch SRV", Type::View);
+
+		// Hand the objects to the passes, as SelectPostProcessObjects in Scene.cpp does each frame
+		PostProcessObjects<RecordingPostProcessApi>& objects = mPostProcessPasses.objects;
+		objects.backBuffer               = &mBackBufferRenderTarget;
+		objects.backBufferTexture        = &mBackBufferTexture;
+		objects.depthStencil             = &mDepthStencil;
+		objects.quadVertexShader         = &m2DQuadVertexShader;
+		objects.polygonVertexShader      = &m2DPolygonVertexShader;
+		objects.polygonBatchVertexShader = &m2DPolygonBatchVertexShader;
+		objects.copyShader               = &mCopyPostProcess;
+		for (int process = 0; process < NUM_POST_PROCESSES; ++process)  objects.effectShaders[process] = &mPostProcessShaders[process];
+		objects.colourLutShader          = &mColourLutPostProcess;
+		objects.bloomThresholdShader     = &mBloomThresholdPostProcess;
+		objects.bloomDownsampleShader    = &mBloomDownsamplePostProcess;
+		objects.bloomUpsampleShader      = &mBloomUpsamplePostProcess;
+		objects.bloomCompositeShader     = &mBloomCompositePostProcess;
+		objects.polygonBatchShader       = &mPolygonBatchPostProcess;
+		objects.noBlendingState          = &mNoBlendingState;
+		objects.additiveBlendingState    = &mAdditiveBlendingState;
+		objects.alphaBlendingState       = &mAlphaBlendingState;
+		objects.depthReadOnlyState       = &mDepthReadOnlyState;
+		objects.noDepthBufferState       = &mNoDepthBufferState;
+		objects.cullNoneState            = &mCullNoneState;
+		objects.cullNoneScissorState     = &mCullNoneScissorState;
+		objects.pointSampler             = &mPointSampler;
+		objects.bilinearClampSampler     = &mBilinearClampSampler;
+		objects.trilinearSampler         = &mTrilinearSampler;
+		objects.noiseMapSRV              = &mNoiseMapSRV;
+		objects.burnMapSRV               = &mBurnMapSRV;
+		objects.distortMapSRV            = &mDistortMapSRV;
+		for (int block = 0; block < NUM_POST_PROCESS_CONSTANT_BLOCKS; ++block)  objects.constantBuffers[block] = &mPostProcessingConstantBuffers[block];
+		objects.polygonBatchBuffer         = &mPolygonBatchBuffer;
+		objects.polygonBatchBufferSRV      = &mPolygonBatchBufferSRV;
+		objects.polygonBatchConstantBuffer = &mPolygonBatchConstantBuffer;
+	}
+
+
+	void PostProcessRecorder::SetViewport(int width, int height)
+	{
+		RecordedViewport vp = { 0, 0, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f };
+		mStateFilter.RSSetViewports(1, &vp);
+	}
+
+
+	// The windows are always on screen here, so none are culled
+	void PostProcessRecorder::RenderFrame(float frameTime)
+	{
+		mStateFilter.NewFrame();
+		RecordingContext& context = *mStateFilter.GetContext();
+
+		SetViewport(mViewportWidth, mViewportHeight);
+		mStateFilter.OMSetRenderTargets(0, nullptr, &mDepthStencil);
+		context.ClearDepthStencilView(&mDepthStencil, 1, 1.0f, 0);
+
+		const float backgroundColour[4] = { 0, 0, 0, 1 };
+		RenderTargetPool& renderTargetPool = mPostProcessPasses.TargetPool();
+		const CompiledPostProcessGraph& postProcessGraph = mPostProcessGraphs.Get(mPostProcessList);
+		int sceneSlot = -1;
+		if (!postProcessGraph.passes.empty())
+		{
+			sceneSlot = renderTargetPool.Acquire(mPostProcessPasses.SceneTargetDesc());
+			if (mPostProcessPasses.GetRenderTarget(sceneSlot) == nullptr)
+			{
+				renderTargetPool.Release(sceneSlot);
+				sceneSlot = -1;
+			}
+		}
+		RecordedObject* sceneTarget = (sceneSlot >= 0) ? mPostProcessPasses.GetRenderTarget(sceneSlot)->renderTarget : &mBackBufferRenderTarget;
+		mStateFilter.OMSetRenderTargets(1, &sceneTarget, &mDepthStencil);
+		context.ClearRenderTargetView(sceneTarget, backgroundColour);
+
+		RecordedObject* depthShaderView = &mDepthShaderView;
+		RecordedObject* pointSampler = &mPointSampler;
+		mStateFilter.PSSetShaderResources(2, 1, &depthShaderView);
+		mStateFilter.PSSetSamplers(2, 1, &pointSampler);
+
+		// The models are drawn here but not recorded. They leave their own shaders, states and textures bound, so forget
+		// everything but the targets and viewport
+		for (int kind = 0; kind < NUM_STATE_KINDS; ++kind)
+		{
+			if (kind == static_cast<int>(StateKind::RenderTargets) || kind == static_cast<int>(StateKind::Viewport))  continue;
+			mStateFilter.Invalidate(static_cast<StateKind>(kind));
+		}
+
+		mPostProcessPasses.NewFrame();
+		if (sceneSlot >= 0)
+		{
+			mPostProcessPasses.Render(postProcessGraph, sceneSlot, mClipPoints.data(), nullptr, frameTime);
+		}
+	}
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Recording
+//--------------------------------------------------------------------------------------
+
+RecordedFrame RecordPostProcessFrames(const std::vector<ProcessAndMode>& postProcessList, int width, int height,
+                                      int numFrames, RecordingContext& context, int colourLutSize)
+{
+	PostProcessRecorder recorder(postProcessList, width, height, colourLutSize, context);
+	for (int frame = 0; frame < numFrames; ++frame)
+	{
+		context.NewFrame();
+		recorder.RenderFrame(FRAME_TIME);
+	}
+	return context.Frame();
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Budgets
+//--------------------------------------------------------------------------------------
+
+std::vector<FrameBudget> DefaultFrameBudgets()
+{
+	using P = PostProcess;
+	const PostProcessMode fullScreen = PostProcessMode::Fullscreen;
+	const PostProcessMode polygon = PostProcessMode::Polygon;
+
+	//                name                            list                                                            draws state  KB  targets
+	return {
+		{ "4 full-screen effects (fused)", { { P::Tint, fullScreen }, { P::Inverted, fullScreen }, { P::NightVision, fullScreen },
+		                                     { P::HueTint, fullScreen } },                                           1,    24,   1,   3 },
+		{ "4 full-screen effects",         { { P::GreyNoise, fullScreen }, { P::Burn, fullScreen }, { P::Distort, fullScreen },
+		                                     { P::Spiral, fullScreen } },                                            4,    40,   2,   6 },
+		{ "Blur horizontal + vertical",    { { P::BlurH, fullScreen }, { P::BlurV, fullScreen } },                    2,    28,   1,   4 },
+		{ "Bloom",                         { { P::Bloom1, fullScreen } },                                             6,    54,   1,   8 },
+		{ "4 polygon windows",             { { P::NightVision, polygon }, { P::Underwater, polygon }, { P::Inverted, polygon },
+		                                     { P::HueTint, polygon } },                                                2,    32,   1,   3 },
+		{ "Windows, blur and bloom",       { { P::NightVision, polygon }, { P::Underwater, polygon }, { P::Inverted, polygon },
+		                                     { P::HueTint, polygon }, { P::BlurH, fullScreen }, { P::BlurV, fullScreen },
+		                                     { P::Bloom1, fullScreen } },                                            9,    76,   2,  10 },
+	};
+}
+
+
+std::vector<FrameBudgetResult> CheckFrameBudgets(const std::vector<FrameBudget>& budgets, int width, int height)
+{
+	std::vector<FrameBudgetResult> results;
+	for (auto& budget : budgets)
+	{
+		// A few frames so the constants and colour tables sent once have settled
+		RecordingContext context;
+		FrameBudgetResult result;
+		result.name = budget.name;
+		result.frame = RecordPostProcessFrames(budget.postProcessList, width, height, 3, context);
+
+		auto check = [&](const char* what, int64_t value, int64_t limit)
+		{
+			if (value <= limit)  return;
+			if (!result.overBudget.empty())  result.overBudget += ", ";
+			result.overBudget += std::string(what) + " " + std::to_string(value) + " > " + std::to_string(limit);
+		};
+		check("draws", result.frame.numDraws, budget.maxDraws);
+		check("state calls", result.frame.TotalStateCalls(), budget.maxStateCalls);
+		check("constant KB", static_cast<int64_t>((result.frame.constantBytes + 1023) / 1024), budget.maxConstantKB);
+		check("target switches", result.frame.numRenderTargetSwitches, budget.maxRenderTargetSwitches);
+		result.withinBudget = result.overBudget.empty();
+		results.push_back(result);
+	}
+	return results;
+}
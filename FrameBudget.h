@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------------
+// Checking the cost of post-processing against budgets
+//--------------------------------------------------------------------------------------
+// RecordPostProcessFrames runs the post-processing for a post-process list without a GPU. The passes of its compiled
+// graph (PostProcessGraph.h) are drawn by the same code the app uses (PostProcessPasses.h), but through a StateFilter
+// into a RecordingContext (RecordingContext.h) instead of the DirectX context. Several frames are run and
+// the last is returned - constant blocks (ConstantBlocks.h) and colour lookup tables (ColourLut.h) are only sent when
+// they change, so the first frame costs more than the ones after.
+//
+// A budget gives the most draws, state calls, constant buffer data and render target switches a list may take in a
+// frame. CheckFrameBudgets records each list and reports those over budget, so a change making post-processing more
+// expensive shows up without a GPU. Only post-processing is recorded - drawing the models needs the meshes and a device.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _FRAME_BUDGET_H_INCLUDED_
+#define _FRAME_BUDGET_H_INCLUDED_
+
+#include "PostProcess.h"
+#include "RecordingContext.h"
+
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Recording
+//--------------------------------------------------------------------------------------
+
+// Run the post-processing for a list on a screen of the given size for a number of frames, 1/60s apart, recording the
+// calls into the context. Returns the calls made in the last frame (also left in the context with its log, if logging).
+// colourLutSize is the size of the colour lookup tables used by fused passes, 0 for none (as PostProcessPasses::colourLutSize)
+RecordedFrame RecordPostProcessFrames(const std::vector<ProcessAndMode>& postProcessList, int width, int height,
+                                      int numFrames, RecordingContext& context, int colourLutSize = 64);
+
+
+
+//--------------------------------------------------------------------------------------
+// Budgets
+//--------------------------------------------------------------------------------------
+
+// Most a post-process list may cost in a frame
+struct FrameBudget
+{
+	std::string                 name;
+	std::vector<ProcessAndMode> postProcessList;
+	int maxDraws;
+	int maxStateCalls;
+	int maxConstantKB;           // Constant buffer data sent
+	int maxRenderTargetSwitches;
+};
+
+struct FrameBudgetResult
+{
+	std::string   name;
+	RecordedFrame frame;        // Calls made in a frame once running steadily
+	bool          withinBudget;
+	std::string   overBudget;   // What went over, e.g. "draws 7 > 6", empty if within budget
+};
+
+// Budgets for the kinds of list the scene uses - full-screen effects (fused and not), blurs, bloom and polygon windows
+std::vector<FrameBudget> DefaultFrameBudgets();
+
+// Record each budget's list on a screen of the given size and compare the last frame against the budget
+std::vector<FrameBudgetResult> CheckFrameBudgets(const std::vector<FrameBudget>& budgets, int width, int height);
+
+
+#endif //_FRAME_BUDGET_H_INCLUDED_
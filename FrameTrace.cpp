@@ -0,0 +1,296 @@
+//--------------------------------------------------------------------------------------
+// Capturing frames of CPU events as a Chrome trace
+//--------------------------------------------------------------------------------------
+
+#include "FrameTrace.h"
+#include "PassTiming.h" // SteadyClockNanoseconds
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char* category;
+		uint64_t    startNs;
+		uint64_t    endNs;
+		char        name[TRACE_NAME_LENGTH];
+	};
+
+	// The events recorded by one thread. Only that thread writes to it once it is in the list
+	struct ThreadTrace
+	{
+		int                           id = 0;
+		char                          name[TRACE_NAME_LENGTH] = {};
+		std::unique_ptr<TraceEvent[]> events;             // Allocated when the thread first records
+		std::atomic<int>              numEvents{ 0 };     // Events published so far
+		std::atomic<int>              numDropped{ 0 };
+		std::atomic<unsigned int>     capture{ 0 };       // Capture the events belong to
+		ThreadTrace*                  next = nullptr;
+	};
+
+	// Every thread that has recorded or been named, newest first. They are never freed, the trace of a capture can be
+	// written after its threads have finished
+	std::atomic<ThreadTrace*> gThreadTraces{ nullptr };
+	std::atomic<int>          gNumThreadTraces{ 0 };
+
+	std::atomic<bool>         gCapturing{ false };
+	std::atomic<unsigned int> gCapture{ 0 };
+
+	// Only used by the thread that starts captures and ends frames
+	uint64_t gCaptureStartNs = 0;
+	uint64_t gFrameStartNs   = 0;
+	int      gFramesLeft     = 0;
+	int      gNumFrames      = 0;
+
+	thread_local ThreadTrace* tThreadTrace = nullptr;
+
+
+	void CopyName(char (&destination)[TRACE_NAME_LENGTH], const char* name)
+	{
+		std::snprintf(destination, TRACE_NAME_LENGTH, "%s", name);
+	}
+
+
+	// The calling thread's trace, added to the list the first time
+	ThreadTrace* CurrentThreadTrace(const char* name = nullptr)
+	{
+		if (tThreadTrace != nullptr)  return tThreadTrace;
+
+		ThreadTrace* thread = new ThreadTrace;
+		thread->id = gNumThreadTraces.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (name != nullptr)  CopyName(thread->name, name);
+		thread->next = gThreadTraces.load(std::memory_order_relaxed);
+		while (!gThreadTraces.compare_exchange_weak(thread->next, thread, std::memory_order_release, std::memory_order_relaxed)) {}
+		tThreadTrace = thread;
+		return thread;
+	}
+
+
+	void RecordEvent(const char* category, const char* name, uint64_t startNs, uint64_t endNs)
+	{
+		ThreadTrace* thread = CurrentThreadTrace();
+
+		// Empty the buffer if it holds an earlier capture. The count is cleared before the capture number is changed, so
+		// a reader seeing the new number never sees the old count
+		unsigned int capture = gCapture.load(std::memory_order_acquire);
+		if (thread->capture.load(std::memory_order_relaxed) != capture)
+		{
+			thread->numEvents.store(0, std::memory_order_relaxed);
+			thread->numDropped.store(0, std::memory_order_relaxed);
+			thread->capture.store(capture, std::memory_order_release);
+		}
+		if (!thread->events)  thread->events.reset(new TraceEvent[TRACE_EVENTS_PER_THREAD]);
+
+		int numEvents = thread->numEvents.load(std::memory_order_relaxed);
+		if (numEvents >= TRACE_EVENTS_PER_THREAD)
+		{
+			thread->numDropped.store(thread->numDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return;
+		}
+		TraceEvent& event = thread->events[numEvents];
+		event.category = category;
+		event.startNs  = startNs;
+		event.endNs    = endNs;
+		CopyName(event.name, name);
+		thread->numEvents.store(numEvents + 1, std::memory_order_release);
+	}
+
+
+	// Threads with events in the current capture, in id order, and the number of events each has published
+	std::vector<std::pair<const ThreadTrace*, int>> CapturedThreads()
+	{
+		std::vector<std::pair<const ThreadTrace*, int>> threads;
+		unsigned int capture = gCapture.load(std::memory_order_acquire);
+		for (ThreadTrace* thread = gThreadTraces.load(std::memory_order_acquire); thread != nullptr; thread = thread->next)
+		{
+			if (thread->capture.load(std::memory_order_acquire) != capture)  continue;
+			int numEvents = thread->numEvents.load(std::memory_order_acquire);
+			if (numEvents > 0)  threads.emplace_back(thread, numEvents);
+		}
+		std::sort(threads.begin(), threads.end(), [](const std::pair<const ThreadTrace*, int>& a, const std::pair<const ThreadTrace*, int>& b)
+		{
+			return a.first->id < b.first->id;
+		});
+		return threads;
+	}
+
+
+	void WriteJsonString(std::ostream& json, const char* text)
+	{
+		json << '"';
+		for (const char* c = text; *c != 0; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				json << '\\' << *c;
+			}
+			else if (static_cast<unsigned char>(*c) < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(*c));
+				json << escaped;
+			}
+			else
+			{
+				json << *c;
+			}
+		}
+		json << '"';
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Capture
+//--------------------------------------------------------------------------------------
+
+void StartTraceCapture(int numFrames)
+{
+	gCaptureStartNs = SteadyClockNanoseconds();
+	gFrameStartNs = gCaptureStartNs;
+	gFramesLeft = numFrames;
+	gNumFrames = 0;
+	gCapture.fetch_add(1, std::memory_order_acq_rel);
+	gCapturing.store(numFrames > 0, std::memory_order_release);
+}
+
+
+void StopTraceCapture()
+{
+	gCapturing.store(false, std::memory_order_release);
+}
+
+
+bool TraceCapturing()
+{
+	return gCapturing.load(std::memory_order_acquire);
+}
+
+
+bool TraceFrameEnd()
+{
+	if (!TraceCapturing())  return false;
+
+	uint64_t now = SteadyClockNanoseconds();
+	RecordEvent("Frame", ("Frame " + std::to_string(gNumFrames)).c_str(), gFrameStartNs, now);
+	gFrameStartNs = now;
+	gNumFrames++;
+	if (--gFramesLeft > 0)  return false;
+
+	StopTraceCapture();
+	return true;
+}
+
+
+void SetTraceThreadName(const char* name)
+{
+	if (tThreadTrace == nullptr)  CurrentThreadTrace(name);
+}
+
+
+TraceCaptureStats GetTraceCaptureStats()
+{
+	TraceCaptureStats stats;
+	stats.capturing = TraceCapturing();
+	stats.numFrames = gNumFrames;
+	for (auto& thread : CapturedThreads())
+	{
+		stats.numThreads++;
+		stats.numEvents += thread.second;
+		stats.numDropped += thread.first->numDropped.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Events
+//--------------------------------------------------------------------------------------
+
+uint64_t TraceEventStart()
+{
+	return TraceCapturing() ? SteadyClockNanoseconds() : 0;
+}
+
+
+void AddTraceEvent(const char* category, const char* name, uint64_t startNs)
+{
+	if (startNs == 0 || !TraceCapturing())  return;
+	RecordEvent(category, name, startNs, SteadyClockNanoseconds());
+}
+
+
+ScopedTraceEvent::ScopedTraceEvent(const char* category, const char* name)
+	: mCategory(category), mStartNs(TraceEventStart())
+{
+	if (mStartNs != 0)  CopyName(mName, name);
+}
+
+
+ScopedTraceEvent::~ScopedTraceEvent()
+{
+	AddTraceEvent(mCategory, mName, mStartNs);
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Output
+//--------------------------------------------------------------------------------------
+
+std::string TraceJson()
+{
+	std::ostringstream json;
+	json.setf(std::ios::fixed);
+	json.precision(3);
+	json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	const char* separator = "\n";
+	for (auto& captured : CapturedThreads())
+	{
+		const ThreadTrace& thread = *captured.first;
+		std::string name = thread.name[0] != 0 ? thread.name : "Thread " + std::to_string(thread.id);
+		json << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id << ",\"args\":{\"name\":";
+		WriteJsonString(json, name.c_str());
+		json << "}}";
+		separator = ",\n";
+		json << separator << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id
+		     << ",\"args\":{\"sort_index\":" << thread.id << "}}";
+
+		for (int e = 0; e < captured.second; ++e)
+		{
+			// An event started in an earlier capture is cut at the start of this one
+			const TraceEvent& event = thread.events[e];
+			uint64_t startNs = std::max(event.startNs, gCaptureStartNs);
+			uint64_t endNs = std::max(event.endNs, startNs);
+			json << separator << "{\"name\":";
+			WriteJsonString(json, event.name);
+			json << ",\"cat\":";
+			WriteJsonString(json, event.category);
+			json << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.id << ",\"ts\":" << (startNs - gCaptureStartNs) / 1000.0
+			     << ",\"dur\":" << (endNs - startNs) / 1000.0 << "}";
+		}
+	}
+	json << "\n]}\n";
+	return json.str();
+}
+
+
+bool WriteTraceJson(const std::string& fileName)
+{
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file)  return false;
+	file << TraceJson();
+	file.close();
+	return !file.fail();
+}
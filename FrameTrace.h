@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------
+// Capturing frames of CPU events as a Chrome trace
+//--------------------------------------------------------------------------------------
+// A capture records what each thread was doing over a number of frames - scoped events (ScopedTraceEvent) around the
+// scene update, the scene render, each post-processing pass, ImGui and Present, and around the shader and texture loads
+// at start-up. The capture is written as Chrome trace JSON, which chrome://tracing and ui.perfetto.dev open, so the
+// same frames can be compared between two builds.
+//
+// Recording an event takes no locks. Each thread that records gets its own buffer of TRACE_EVENTS_PER_THREAD events,
+// allocated the first time it records and reached through a thread_local pointer, so only that thread ever writes to it.
+// Buffers are added to a list with a compare-and-swap and kept until the program ends. A thread publishes each event
+// by storing its new event count with release ordering, so WriteTraceJson can read the events up to that count at any
+// time. Starting a capture just moves on a capture number - each thread empties its own buffer when it next records and
+// sees the number has changed, and buffers not used since the capture started are left out of the JSON.
+// When not capturing, an event costs one atomic load at each end.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _FRAME_TRACE_H_INCLUDED_
+#define _FRAME_TRACE_H_INCLUDED_
+
+#include <cstdint>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Capture
+//--------------------------------------------------------------------------------------
+
+// Events each thread can record in a capture, later ones are dropped (and counted)
+const int TRACE_EVENTS_PER_THREAD = 8192;
+
+// Longest event or thread name kept, including the terminating 0. Longer names are cut short
+const int TRACE_NAME_LENGTH = 48;
+
+
+// Start capturing, discarding the last capture. It stops by itself after numFrames calls to TraceFrameEnd
+void StartTraceCapture(int numFrames);
+
+// Stop capturing straight away, keeping what has been recorded
+void StopTraceCapture();
+
+bool TraceCapturing();
+
+// Call once a frame, from the thread that calls StartTraceCapture. Records the frame as an event from the previous call
+// (or the start of the capture) and counts it. Returns true on the frame the capture finishes
+bool TraceFrameEnd();
+
+
+// Name the calling thread in the trace, e.g. "Main". Call once, before the thread records anything. Threads without a
+// name are shown as "Thread <id>"
+void SetTraceThreadName(const char* name);
+
+
+struct TraceCaptureStats
+{
+	bool capturing     = false;
+	int  numFrames     = 0; // Frames captured so far
+	int  numThreads    = 0; // Threads that recorded events
+	int  numEvents     = 0;
+	int  numDropped    = 0; // Events that didn't fit in their thread's buffer
+};
+
+TraceCaptureStats GetTraceCaptureStats();
+
+
+
+//--------------------------------------------------------------------------------------
+// Events
+//--------------------------------------------------------------------------------------
+
+// Time now in nanoseconds if capturing, 0 if not. The start of an event for AddTraceEvent
+uint64_t TraceEventStart();
+
+// Record an event on the calling thread from a time given by TraceEventStart until now. Nothing is recorded if the
+// start is 0 or the capture has stopped. The category must be a string that lives as long as the program (e.g. a
+// literal), the name is copied
+void AddTraceEvent(const char* category, const char* name, uint64_t startNs);
+
+
+// Records an event from its construction to the end of its scope
+class ScopedTraceEvent
+{
+public:
+	ScopedTraceEvent(const char* category, const char* name);
+	ScopedTraceEvent(const char* category, const std::string& name) : ScopedTraceEvent(category, name.c_str()) {}
+	~ScopedTraceEvent();
+
+	ScopedTraceEvent(const ScopedTraceEvent&) = delete;
+	ScopedTraceEvent& operator=(const ScopedTraceEvent&) = delete;
+
+private:
+	const char* mCategory;
+	uint64_t    mStartNs;
+	char        mName[TRACE_NAME_LENGTH]; // Only filled in when capturing
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Output
+//--------------------------------------------------------------------------------------
+
+// The last capture as Chrome trace JSON - a complete ("X") event for each recorded event with its thread id and times
+// in microseconds from the start of the capture, and the name of each thread. Thread ids are given in the order
+// threads first record or are named, so the main thread is 1 if it is named first
+std::string TraceJson();
+
+// Write TraceJson to a file, returns false if the file couldn't be written
+bool WriteTraceJson(const std::string& fileName);
+
+
+#endif //_FRAME_TRACE_H_INCLUDED_
@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------
+// Stages of the fused per-pixel post-processes
+//--------------------------------------------------------------------------------------
+// Included by the pixel shaders generated by GenerateFusedShaderSource (PostProcessFusion.cpp). Each function is the
+// colour part of one of the single effect shaders - keep them in step with those shaders if either changes
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The scene has been rendered to a texture, these variables allow access to that texture
+Texture2D SceneTexture : register(t0);
+SamplerState PointSample : register(s0); // We don't usually want to filter (bilinear, trilinear etc.) the scene texture when
+                                          // post-processing so this sampler will use "point sampling" - no filtering
+
+
+//--------------------------------------------------------------------------------------
+// Stages
+//--------------------------------------------------------------------------------------
+
+// Tint_pp.hlsl and HueTint_pp.hlsl - multiply by a colour blended from top to bottom of the screen. HueTint's hue shift is
+// applied to the colours on the C++ side
+float3 TintStage(float3 colour, int stage, float2 sceneUV)
+{
+    return colour * lerp(gFusedTintColours[2 * stage].rgb, gFusedTintColours[2 * stage + 1].rgb, sceneUV.y);
+}
+
+// InvertColour_pp.hlsl
+float3 InvertStage(float3 colour)
+{
+    return 1 - colour;
+}
+
+// NightVision_pp.hlsl - the shader adds the same sample four times, then divides by four again unless the result is bright
+float3 NightVisionStage(float3 colour)
+{
+    colour *= 4;
+    if (((colour.r + colour.g + colour.b) / 3) < 1.2)
+    {
+        colour = colour / 4;
+    }
+    return float3(0, (colour.r + colour.g + colour.b) / 3, 0);
+}
+
+// Retro_pp.hlsl - read the scene at the top-left of the large "retro" pixel containing this one. Only used as the first stage
+float3 RetroSample(float2 sceneUV)
+{
+    float pixelWidth = 15; // low res pixel width
+    float pixelHeight = 10; // low res pixel height
+    float pixelXPos = pixelWidth * (1.0f / gViewportWidth);
+    float pixelYPos = pixelHeight * (1.0f / gViewportHeight);
+    float2 coord = float2(pixelXPos * floor(sceneUV.x / pixelXPos), pixelYPos * floor(sceneUV.y / pixelYPos));
+    return SceneTexture.Sample(PointSample, coord).rgb;
+}
+
+// Retro_pp.hlsl - reduce the number of colour levels
+float3 RetroColourStage(float3 colour)
+{
+    return (floor(colour * 10) / 10) * 1.3;
+}
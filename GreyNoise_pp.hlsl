@@ -28,7 +28,7 @@ SamplerState TrilinearWrap : register(s1);
 float4 main(PostProcessingInput input) : SV_Target
 {
     float3 finalColour = float3(1.0, 0.0, 0.0);
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
         const float NoiseStrength = 0.5f; // How noticable the noise is
 
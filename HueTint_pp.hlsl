@@ -41,7 +41,7 @@ float4 main(PostProcessingInput input) : SV_Target
     
     float3 outputColour = float3(1.0, 0.0, 0.0);
     
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
     /////// top colour  /////////////  
         RGB.r = gtintTopColour.r;
@@ -26,7 +26,7 @@ float4 main(PostProcessingInput input) : SV_Target
 {
 	//// Sample a pixel from the scene texture and invert the colour colour (comes from a constant buffer defined in Common.hlsli)
     float3 finalColour = float3(1.0, 0.0, 0.0);
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
         finalColour = SceneTexture.Sample(PointSample, input.sceneUV).rgb;
     
@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------------------
+// SIMD versions of the matrix and vector operations
+//--------------------------------------------------------------------------------------
+
+#include "MatrixSimd.h"
+#include "CpuSimd.h"
+
+#if CPU_SIMD_SSE && defined(__AVX__)
+	#define MATRIX_SIMD_AVX 1
+	#include <immintrin.h>
+#else
+	#define MATRIX_SIMD_AVX 0
+#endif
+
+
+// The functions below treat a matrix as four rows of four floats and a vector as four floats
+static_assert(sizeof(CMatrix4x4) == 16 * sizeof(float), "CMatrix4x4 must be 16 floats");
+static_assert(sizeof(CVector4)   ==  4 * sizeof(float), "CVector4 must be 4 floats");
+static_assert(sizeof(CVector3)   ==  3 * sizeof(float), "CVector3 must be 3 floats");
+
+namespace
+{
+	const float* Row(const CMatrix4x4& m, int row)  { return &m.e00 + row * 4; }
+	float*       Row(CMatrix4x4& m, int row)        { return &m.e00 + row * 4; }
+
+	// Cross product of the xyz parts of two vectors, w is zero
+	Float4 Cross(Float4 a, Float4 b)
+	{
+#if CPU_SIMD_SSE
+		__m128 aYZX = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 bYZX = _mm_shuffle_ps(b.v, b.v, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 result = _mm_sub_ps(_mm_mul_ps(a.v, bYZX), _mm_mul_ps(aYZX, b.v)); // Cross product in zxy order
+		return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+#else
+		return Float4(a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2], a.v[0] * b.v[1] - a.v[1] * b.v[0], 0.0f);
+#endif
+	}
+
+	float Dot3(Float4 a, Float4 b)
+	{
+#if CPU_SIMD_SSE
+		__m128 product = _mm_mul_ps(a.v, b.v);
+		__m128 sum = _mm_add_ss(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 2, 2, 2))));
+#else
+		return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
+#endif
+	}
+
+	// One point or vector times the rows of a matrix
+	Float4 Transform(float x, float y, float z, float w, const Float4 rows[4])
+	{
+		return rows[0] * Float4(x) + rows[1] * Float4(y) + rows[2] * Float4(z) + rows[3] * Float4(w);
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Single operations
+//--------------------------------------------------------------------------------------
+
+// Matrix multiply a * b - each row of the result is the row of a used to weight the rows of b
+CMatrix4x4 MultiplySimd(const CMatrix4x4& a, const CMatrix4x4& b)
+{
+	Float4 rows[4] = { Float4::LoadUnaligned(Row(b, 0)), Float4::LoadUnaligned(Row(b, 1)),
+	                   Float4::LoadUnaligned(Row(b, 2)), Float4::LoadUnaligned(Row(b, 3)) };
+	CMatrix4x4 result;
+	for (int row = 0; row < 4; ++row)
+	{
+		const float* aRow = Row(a, row);
+		Transform(aRow[0], aRow[1], aRow[2], aRow[3], rows).StoreUnaligned(Row(result, row));
+	}
+	return result;
+}
+
+
+// Transform a vector by a matrix v * m
+CVector4 TransformSimd(const CVector4& v, const CMatrix4x4& m)
+{
+	Float4 rows[4] = { Float4::LoadUnaligned(Row(m, 0)), Float4::LoadUnaligned(Row(m, 1)),
+	                   Float4::LoadUnaligned(Row(m, 2)), Float4::LoadUnaligned(Row(m, 3)) };
+	CVector4 result;
+	Transform(v.x, v.y, v.z, v.w, rows).StoreUnaligned(&result.x);
+	return result;
+}
+
+
+// Inverse of an affine matrix. The columns of the inverse of the 3x3 part are the cross products of pairs of its rows
+// over the determinant, then the inverse translation is the negated translation put through that
+CMatrix4x4 InverseAffineSimd(const CMatrix4x4& m)
+{
+	Float4 row0 = Float4::LoadUnaligned(Row(m, 0));
+	Float4 row1 = Float4::LoadUnaligned(Row(m, 1));
+	Float4 row2 = Float4::LoadUnaligned(Row(m, 2));
+
+	Float4 column0 = Cross(row1, row2);
+	Float4 column1 = Cross(row2, row0);
+	Float4 column2 = Cross(row0, row1);
+	Float4 invDet(1.0f / Dot3(row0, column0));
+	column0 = column0 * invDet;
+	column1 = column1 * invDet;
+	column2 = column2 * invDet;
+
+	// Transpose the columns into rows, the w column of an affine matrix is 0,0,0,1
+	Float4 column3(0.0f);
+	Transpose(column0, column1, column2, column3);
+	Float4 rows[4] = { column0, column1, column2, Float4(0.0f) };
+
+	CMatrix4x4 result;
+	column0.StoreUnaligned(Row(result, 0));
+	column1.StoreUnaligned(Row(result, 1));
+	column2.StoreUnaligned(Row(result, 2));
+	Transform(-m.e30, -m.e31, -m.e32, 0.0f, rows).StoreUnaligned(Row(result, 3));
+	result.e33 = 1.0f;
+	return result;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Batches
+//--------------------------------------------------------------------------------------
+
+// Transform an array of points (w = 1) by a matrix
+void TransformPoints(const CVector3* points, int numPoints, const CMatrix4x4& m, CVector4* results)
+{
+	int p = 0;
+
+#if MATRIX_SIMD_AVX
+	// Two points at a time - each matrix row is repeated in both halves of a register and each point component fills
+	// one half, so one store writes two results
+	__m256 rows[4];
+	for (int row = 0; row < 4; ++row)  rows[row] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(Row(m, row)));
+	auto pair = [](float first, float second)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(first)), _mm_set1_ps(second), 1);
+	};
+	for (; p + 2 <= numPoints; p += 2)
+	{
+		const CVector3& a = points[p];
+		const CVector3& b = points[p + 1];
+		__m256 result = _mm256_add_ps(_mm256_mul_ps(rows[0], pair(a.x, b.x)), _mm256_mul_ps(rows[1], pair(a.y, b.y)));
+		result = _mm256_add_ps(_mm256_add_ps(result, _mm256_mul_ps(rows[2], pair(a.z, b.z))), rows[3]);
+		_mm256_storeu_ps(&results[p].x, result);
+	}
+#endif
+
+	Float4 rows4[4] = { Float4::LoadUnaligned(Row(m, 0)), Float4::LoadUnaligned(Row(m, 1)),
+	                    Float4::LoadUnaligned(Row(m, 2)), Float4::LoadUnaligned(Row(m, 3)) };
+	for (; p < numPoints; ++p)
+	{
+		const CVector3& point = points[p];
+		(rows4[0] * Float4(point.x) + rows4[1] * Float4(point.y) + rows4[2] * Float4(point.z) + rows4[3]).StoreUnaligned(&results[p].x);
+	}
+}
+
+
+// Transform an array of vectors by a matrix
+void TransformVectors(const CVector4* vectors, int numVectors, const CMatrix4x4& m, CVector4* results)
+{
+	Float4 rows[4] = { Float4::LoadUnaligned(Row(m, 0)), Float4::LoadUnaligned(Row(m, 1)),
+	                   Float4::LoadUnaligned(Row(m, 2)), Float4::LoadUnaligned(Row(m, 3)) };
+	for (int v = 0; v < numVectors; ++v)
+	{
+		CVector4 vector = vectors[v]; // Copied first as results may be the same array
+		Transform(vector.x, vector.y, vector.z, vector.w, rows).StoreUnaligned(&results[v].x);
+	}
+}
@@ -0,0 +1,49 @@
+//--------------------------------------------------------------------------------------
+// SIMD versions of the matrix and vector operations
+//--------------------------------------------------------------------------------------
+// The CMatrix4x4 / CVector4 operators work one float at a time. These functions do the same operations on the same
+// types using the Float4 SIMD type (CpuSimd.h) - a whole matrix row or vector in one register. That is SSE on x86/x64,
+// with batches of points done two at a time using AVX when the build enables it (/arch:AVX or -mavx). Elsewhere Float4
+// falls back to plain scalar code, which ARM compilers vectorise to NEON themselves.
+//
+// Results match the scalar operators to within rounding (the sums are done in a different order). Use them where the
+// work is repeated - every camera change, every point of a polygon effect - and the batch functions for arrays of
+// points. The "matrices" benchmark in Tests/Benchmarks.cpp compares the speed of the two.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _MATRIX_SIMD_H_INCLUDED_
+#define _MATRIX_SIMD_H_INCLUDED_
+
+#include "CVector3.h"
+#include "CVector4.h"
+#include "CMatrix4x4.h"
+
+
+//--------------------------------------------------------------------------------------
+// Single operations
+//--------------------------------------------------------------------------------------
+
+// Matrix multiply a * b, as the CMatrix4x4 operator*
+CMatrix4x4 MultiplySimd(const CMatrix4x4& a, const CMatrix4x4& b);
+
+// Transform a vector by a matrix v * m, as the CVector4 / CMatrix4x4 operator*
+CVector4 TransformSimd(const CVector4& v, const CMatrix4x4& m);
+
+// Inverse of an affine matrix (rotation, scale and translation only), as InverseAffine
+CMatrix4x4 InverseAffineSimd(const CMatrix4x4& m);
+
+
+
+//--------------------------------------------------------------------------------------
+// Batches
+//--------------------------------------------------------------------------------------
+
+// Transform an array of points (w = 1) by a matrix. results must have room for numPoints vectors
+void TransformPoints(const CVector3* points, int numPoints, const CMatrix4x4& m, CVector4* results);
+
+// Transform an array of vectors by a matrix. results must have room for numVectors vectors, and can be the same array
+// as vectors
+void TransformVectors(const CVector4* vectors, int numVectors, const CMatrix4x4& m, CVector4* results);
+
+
+#endif //_MATRIX_SIMD_H_INCLUDED_
@@ -0,0 +1,160 @@
+//--------------------------------------------------------------------------------------
+// Binary cache of mesh geometry
+//--------------------------------------------------------------------------------------
+
+#include "MeshCache.h"
+#include "ConstantBlocks.h" // HashBytes
+
+#include <cstring>
+#include <fstream>
+
+
+//--------------------------------------------------------------------------------------
+// Cache format
+//--------------------------------------------------------------------------------------
+
+namespace
+{
+	uint64_t AlignCacheOffset(uint64_t offset)
+	{
+		return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+	}
+}
+
+
+// Name of the cache file for a mesh file
+std::string MeshCacheFileName(const std::string& sourceFileName)
+{
+	return sourceFileName + ".cache";
+}
+
+
+// Hash the contents of a file, returns false if it can't be read
+bool HashFile(const std::string& fileName, uint64_t& hash, uint64_t& size)
+{
+	MappedFile file;
+	if (!file.Open(fileName))  return false;
+
+	hash = HashBytes(file.Data(), file.Size());
+	size = file.Size();
+	return true;
+}
+
+
+// Write a cache file for mesh data parsed from a source file with the given hash and size
+bool WriteMeshCache(const std::string& cacheFileName, uint64_t sourceHash, uint64_t sourceSize, const MeshData& mesh)
+{
+	MeshCacheHeader header = {};
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.vertexSize = sizeof(MeshVertex);
+	header.flags = (mesh.hasNormals ? MESH_CACHE_NORMALS : 0) | (mesh.hasUVs ? MESH_CACHE_UVS : 0);
+	header.numVertices = static_cast<uint32_t>(mesh.vertices.size());
+	header.numIndices = static_cast<uint32_t>(mesh.indices.size());
+	header.verticesOffset = AlignCacheOffset(sizeof(header));
+	header.indicesOffset = AlignCacheOffset(header.verticesOffset + mesh.vertices.size() * sizeof(MeshVertex));
+
+	std::ofstream cacheFile(cacheFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!cacheFile.is_open())  return false;
+
+	const char padding[MESH_CACHE_ALIGNMENT] = {};
+	cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	cacheFile.write(padding, static_cast<std::streamsize>(header.verticesOffset - sizeof(header)));
+	cacheFile.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(MeshVertex));
+	cacheFile.write(padding, static_cast<std::streamsize>(header.indicesOffset - header.verticesOffset - mesh.vertices.size() * sizeof(MeshVertex)));
+	cacheFile.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+	return !cacheFile.fail();
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Loading
+//--------------------------------------------------------------------------------------
+
+// Load a mesh, using its cache if the hash of the source matches, otherwise parsing the source and writing a new cache
+bool CachedMesh::Load(const std::string& sourceFileName, const MeshParseFunction& parse, std::string& error)
+{
+	Release();
+
+	std::string cacheFileName = MeshCacheFileName(sourceFileName);
+	uint64_t sourceHash = 0;
+	uint64_t sourceSize = 0;
+	bool haveSource = HashFile(sourceFileName, sourceHash, sourceSize);
+	if (OpenCache(cacheFileName, haveSource, sourceHash, sourceSize))  return true;
+	if (!haveSource)
+	{
+		error = "can't read " + sourceFileName;
+		return false;
+	}
+
+	// Cache miss - parse the source. The stale cache has been unmapped so it can be written over
+	if (!parse(sourceFileName, mParsed, error))  return false;
+	if (mParsed.indices.empty() || mParsed.vertices.size() > UINT32_MAX || mParsed.indices.size() > UINT32_MAX)
+	{
+		mParsed = MeshData();
+		error = "no geometry in " + sourceFileName;
+		return false;
+	}
+	WriteMeshCache(cacheFileName, sourceHash, sourceSize, mParsed);
+
+	mVertices = mParsed.vertices.data();
+	mIndices = mParsed.indices.data();
+	mNumVertices = static_cast<uint32_t>(mParsed.vertices.size());
+	mNumIndices = static_cast<uint32_t>(mParsed.indices.size());
+	mHasNormals = mParsed.hasNormals;
+	mHasUVs = mParsed.hasUVs;
+	return true;
+}
+
+
+// Map a cache file and check it is valid and (if checkSource is set) built from a source with the given hash and size
+bool CachedMesh::OpenCache(const std::string& cacheFileName, bool checkSource, uint64_t sourceHash, uint64_t sourceSize)
+{
+	if (!mFile.Open(cacheFileName))  return false;
+
+	const uint8_t* data = mFile.Data();
+	size_t size = mFile.Size();
+	MeshCacheHeader header;
+	bool valid = size >= sizeof(header);
+	if (valid)
+	{
+		std::memcpy(&header, data, sizeof(header));
+		valid = header.magic == MESH_CACHE_MAGIC && header.version == MESH_CACHE_VERSION && header.vertexSize == sizeof(MeshVertex) &&
+		        (!checkSource || (header.sourceHash == sourceHash && header.sourceSize == sourceSize)) &&
+		        header.numIndices > 0 &&
+		        header.verticesOffset % MESH_CACHE_ALIGNMENT == 0 && header.indicesOffset % MESH_CACHE_ALIGNMENT == 0 &&
+		        header.verticesOffset <= size && header.numVertices <= (size - header.verticesOffset) / sizeof(MeshVertex) &&
+		        header.indicesOffset  <= size && header.numIndices  <= (size - header.indicesOffset)  / sizeof(uint32_t);
+	}
+	if (!valid)
+	{
+		mFile.Close();
+		return false;
+	}
+
+	// The mapping starts on a page boundary, so the aligned offsets are suitably aligned for the data
+	mVertices = reinterpret_cast<const MeshVertex*>(data + header.verticesOffset);
+	mIndices = reinterpret_cast<const uint32_t*>(data + header.indicesOffset);
+	mNumVertices = header.numVertices;
+	mNumIndices = header.numIndices;
+	mHasNormals = (header.flags & MESH_CACHE_NORMALS) != 0;
+	mHasUVs = (header.flags & MESH_CACHE_UVS) != 0;
+	return true;
+}
+
+
+// Free the geometry
+void CachedMesh::Release()
+{
+	mFile.Close();
+	mParsed = MeshData();
+	mVertices = nullptr;
+	mIndices = nullptr;
+	mNumVertices = 0;
+	mNumIndices = 0;
+	mHasNormals = false;
+	mHasUVs = false;
+}
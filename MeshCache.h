@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------------------
+// Binary cache of mesh geometry
+//--------------------------------------------------------------------------------------
+// Every launch imports each .x mesh file from scratch (Stars.x, Hills.x, Cube.x etc. in InitGeometry). Through the cache
+// a mesh is imported once and its vertices and indices saved to a cache file next to it (<mesh file>.cache), already in
+// the layout the GPU buffers use. Later loads memory map the cache so the buffers can be created straight from the
+// mapped bytes, and the importer only runs when the cache is missing or out of date.
+//
+// Cache layout:
+// - MeshCacheHeader, holding a hash of the source file the cache was built from
+// - the vertices (MeshVertex), starting on a MESH_CACHE_ALIGNMENT boundary
+// - the indices (uint32_t), starting on a MESH_CACHE_ALIGNMENT boundary
+// A cache is only used if the hash of the source file still matches, so editing a mesh rebuilds its cache. If the
+// source file is missing the cache is used as it is, so the app can ship with only the caches.
+//
+// Parsing is done by a function passed in, so the cache can sit in front of whichever importer reads the meshes (the one
+// Mesh uses in the app) and be run without a GPU.
+// Portable C++ - no Windows or DirectX dependencies (memory mapping is in ShaderArchive.h)
+
+#ifndef _MESH_CACHE_H_INCLUDED_
+#define _MESH_CACHE_H_INCLUDED_
+
+#include "ShaderArchive.h" // MappedFile
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Mesh data
+//--------------------------------------------------------------------------------------
+
+// One vertex in the layout used by the GPU buffers (BasicVertex in Common.hlsli)
+struct MeshVertex
+{
+	float position[3];
+	float normal[3];
+	float uv[2];
+};
+
+// Geometry of a mesh, as an indexed triangle list
+struct MeshData
+{
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t>   indices;
+	bool hasNormals = false; // The source held normals / texture coordinates, otherwise they are zero
+	bool hasUVs     = false;
+};
+
+
+// Parse a mesh file into mesh data. Returns false with a message in error on failure
+using MeshParseFunction = std::function<bool(const std::string& fileName, MeshData& mesh, std::string& error)>;
+
+
+
+//--------------------------------------------------------------------------------------
+// Cache format
+//--------------------------------------------------------------------------------------
+
+const uint32_t MESH_CACHE_MAGIC     = 0x48534D42; // "BMSH"
+const uint32_t MESH_CACHE_VERSION   = 1;
+const size_t   MESH_CACHE_ALIGNMENT = 16;
+
+struct MeshCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;    // HashBytes of the source file
+	uint64_t sourceSize;
+	uint32_t vertexSize;    // sizeof(MeshVertex) when written, checked in case the layout changes
+	uint32_t flags;         // MESH_CACHE_NORMALS | MESH_CACHE_UVS
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint64_t verticesOffset; // From the start of the file
+	uint64_t indicesOffset;
+};
+
+const uint32_t MESH_CACHE_NORMALS = 1;
+const uint32_t MESH_CACHE_UVS     = 2;
+
+
+// Name of the cache file for a mesh file
+std::string MeshCacheFileName(const std::string& sourceFileName);
+
+// Hash the contents of a file, returns false if it can't be read
+bool HashFile(const std::string& fileName, uint64_t& hash, uint64_t& size);
+
+// Write a cache file for mesh data parsed from a source file with the given hash and size. Returns false on failure
+bool WriteMeshCache(const std::string& cacheFileName, uint64_t sourceHash, uint64_t sourceSize, const MeshData& mesh);
+
+
+
+//--------------------------------------------------------------------------------------
+// Loading
+//--------------------------------------------------------------------------------------
+
+// Vertices and indices of a mesh, read from its cache if it is up to date or else parsed from the source and cached
+class CachedMesh
+{
+public:
+	// Load a mesh, using its cache if the hash of the source matches. Otherwise parse the source and write a new cache
+	// (a cache that can't be written isn't an error). Returns false with a message in error if the mesh can't be loaded
+	bool Load(const std::string& sourceFileName, const MeshParseFunction& parse, std::string& error);
+
+	// Free the geometry - the pointers below can't be used after this
+	void Release();
+
+	const MeshVertex* Vertices() const     { return mVertices; }
+	const uint32_t*   Indices() const      { return mIndices; }
+	uint32_t          NumVertices() const  { return mNumVertices; }
+	uint32_t          NumIndices() const   { return mNumIndices; }
+	bool              HasNormals() const   { return mHasNormals; }
+	bool              HasUVs() const       { return mHasUVs; }
+	bool              FromCache() const    { return mFile.Data() != nullptr; } // False if the source was parsed
+
+private:
+	bool OpenCache(const std::string& cacheFileName, bool checkSource, uint64_t sourceHash, uint64_t sourceSize);
+
+	MappedFile        mFile;   // Holds the geometry when read from the cache...
+	MeshData          mParsed; // ...or when parsed from the source
+	const MeshVertex* mVertices    = nullptr;
+	const uint32_t*   mIndices     = nullptr;
+	uint32_t          mNumVertices = 0;
+	uint32_t          mNumIndices  = 0;
+	bool              mHasNormals  = false;
+	bool              mHasUVs      = false;
+};
+
+
+#endif //_MESH_CACHE_H_INCLUDED_
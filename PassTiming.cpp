@@ -0,0 +1,165 @@
+//--------------------------------------------------------------------------------------
+// Timing each post-processing pass
+//--------------------------------------------------------------------------------------
+
+#include "PassTiming.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+
+namespace
+{
+	// Add together the times of passes with the same name, keeping the order they first appear in
+	void AddFrameTimes(std::vector<std::pair<std::string, float>>& times, const std::string& name, float ms)
+	{
+		for (auto& time : times)
+		{
+			if (time.first == name)
+			{
+				time.second += ms;
+				return;
+			}
+		}
+		times.emplace_back(name, ms);
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// History
+//--------------------------------------------------------------------------------------
+
+TimingSummary SummariseTimings(std::vector<float> samplesMs)
+{
+	TimingSummary summary;
+	summary.numSamples = static_cast<int>(samplesMs.size());
+	if (samplesMs.empty())  return summary;
+
+	std::sort(samplesMs.begin(), samplesMs.end());
+	float total = 0;
+	for (float ms : samplesMs)  total += ms;
+	summary.minMs = samplesMs.front();
+	summary.avgMs = total / samplesMs.size();
+
+	// The sample that 99% of them are at or below
+	size_t p99 = static_cast<size_t>(std::ceil(samplesMs.size() * 0.99)) - 1;
+	summary.p99Ms = samplesMs[p99];
+	return summary;
+}
+
+
+void PassTimingHistory::RollingSamples::Add(float ms)
+{
+	if (static_cast<int>(samples.size()) < TIMING_HISTORY_FRAMES)
+	{
+		samples.push_back(ms);
+		return;
+	}
+	samples[next] = ms;
+	next = (next + 1) % TIMING_HISTORY_FRAMES;
+}
+
+
+std::vector<PassTimingStats> PassTimingHistory::Stats() const
+{
+	std::vector<PassTimingStats> stats;
+	for (auto& pass : mPasses)
+	{
+		stats.push_back({ pass.name, SummariseTimings(pass.cpu.samples), SummariseTimings(pass.gpu.samples) });
+	}
+	return stats;
+}
+
+
+PassTimingHistory::Pass& PassTimingHistory::FindPass(const std::string& name)
+{
+	for (auto& pass : mPasses)
+	{
+		if (pass.name == name)  return pass;
+	}
+	mPasses.emplace_back();
+	mPasses.back().name = name;
+	return mPasses.back();
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// CPU timing
+//--------------------------------------------------------------------------------------
+
+uint64_t SteadyClockNanoseconds()
+{
+	auto time = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+}
+
+
+int PassTimer::BeginPass(const std::string& name)
+{
+	if (mPasses.size() >= MAX_TIMED_PASSES)  return -1;
+	uint64_t now = mClock();
+	mPasses.push_back({ name, now, now });
+	return static_cast<int>(mPasses.size()) - 1;
+}
+
+
+void PassTimer::EndPass(int pass)
+{
+	if (pass < 0)  return;
+	mPasses[pass].end = mClock();
+}
+
+
+void PassTimer::EndFrame(PassTimingHistory& history)
+{
+	std::vector<std::pair<std::string, float>> times;
+	for (auto& pass : mPasses)
+	{
+		AddFrameTimes(times, pass.name, (pass.end - pass.start) / 1000000.0f);
+	}
+	for (auto& time : times)  history.AddCpuSample(time.first, time.second);
+	mPasses.clear();
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// GPU timing
+//--------------------------------------------------------------------------------------
+
+int GpuTimingRing::BeginFrame()
+{
+	mSet = NextSet();
+	mFrames[mSet].passes.clear();
+	mFrames[mSet].issued = false;
+	return mSet;
+}
+
+
+int GpuTimingRing::BeginPass(const std::string& name)
+{
+	auto& passes = mFrames[mSet].passes;
+	if (passes.size() >= MAX_TIMED_PASSES)  return -1;
+	passes.push_back(name);
+	return static_cast<int>(passes.size()) - 1;
+}
+
+
+void GpuTimingRing::Collect(int set, const uint64_t* begin, const uint64_t* end, uint64_t frequency, bool disjoint,
+                            PassTimingHistory& history)
+{
+	Frame& frame = mFrames[set];
+	frame.issued = false;
+	if (disjoint || frequency == 0)  return;
+
+	std::vector<std::pair<std::string, float>> times;
+	for (size_t pass = 0; pass < frame.passes.size(); ++pass)
+	{
+		AddFrameTimes(times, frame.passes[pass], static_cast<float>((end[pass] - begin[pass]) * 1000.0 / frequency));
+	}
+	for (auto& time : times)  history.AddGpuSample(time.first, time.second);
+}
@@ -0,0 +1,174 @@
+//--------------------------------------------------------------------------------------
+// Timing each post-processing pass
+//--------------------------------------------------------------------------------------
+// Shows which effect in the post-process list costs what. Each pass (and each step of the bloom chain) is wrapped in a
+// scoped marker (ScopedPassTiming in Scene.cpp) that times it on the CPU and on the GPU:
+// - CPU: PassTimer reads a clock at the start and end of each pass. The clock is a function (TimingClock), the steady
+//   clock unless another is given, so the timer can also run headless against a clock the caller moves on itself
+// - GPU: a timestamp query at each end of a pass, inside a disjoint query covering the frame. Each frame uses the next
+//   set of queries in a ring of NUM_GPU_TIMING_FRAMES sets and the set is only read when its turn comes round again,
+//   without flushing, so the CPU never waits for the GPU. GpuTimingRing keeps track of which pass each pair of
+//   timestamps belongs to - the queries themselves are in Scene.cpp
+// Both are added to a PassTimingHistory, which keeps the last TIMING_HISTORY_FRAMES samples of each pass and gives
+// the minimum, average and 99th percentile shown in the ImGui table.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _PASS_TIMING_H_INCLUDED_
+#define _PASS_TIMING_H_INCLUDED_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// History
+//--------------------------------------------------------------------------------------
+
+// Most passes timed in a frame, later ones aren't timed
+const int MAX_TIMED_PASSES = 32;
+
+// Samples kept for each pass
+const int TIMING_HISTORY_FRAMES = 240;
+
+
+// Minimum, average and 99th percentile of some times
+struct TimingSummary
+{
+	int   numSamples = 0;
+	float minMs = 0;
+	float avgMs = 0;
+	float p99Ms = 0;
+};
+
+TimingSummary SummariseTimings(std::vector<float> samplesMs);
+
+
+struct PassTimingStats
+{
+	std::string   name;
+	TimingSummary cpu;
+	TimingSummary gpu;
+};
+
+// The recent times of each pass on the CPU and GPU
+class PassTimingHistory
+{
+public:
+	// Add a time for a pass, dropping its oldest if it already has TIMING_HISTORY_FRAMES
+	void AddCpuSample(const std::string& pass, float ms)  { FindPass(pass).cpu.Add(ms); }
+	void AddGpuSample(const std::string& pass, float ms)  { FindPass(pass).gpu.Add(ms); }
+
+	// Summary of each pass, in the order they were first seen
+	std::vector<PassTimingStats> Stats() const;
+
+	void Clear()  { mPasses.clear(); }
+
+private:
+	struct RollingSamples
+	{
+		std::vector<float> samples;
+		int next = 0; // Where the next sample goes once full
+
+		void Add(float ms);
+	};
+	struct Pass
+	{
+		std::string    name;
+		RollingSamples cpu;
+		RollingSamples gpu;
+	};
+
+	Pass& FindPass(const std::string& name);
+
+	std::vector<Pass> mPasses;
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// CPU timing
+//--------------------------------------------------------------------------------------
+
+// Gives the current time in nanoseconds from any fixed starting point
+using TimingClock = std::function<uint64_t()>;
+
+// The steady clock (the highest resolution monotonic clock the standard library has)
+uint64_t SteadyClockNanoseconds();
+
+
+// Times the passes of a frame on the CPU. Passes may be nested (e.g. the levels of the bloom chain inside bloom)
+class PassTimer
+{
+public:
+	explicit PassTimer(TimingClock clock = SteadyClockNanoseconds) : mClock(std::move(clock)) {}
+
+	void BeginFrame()  { mPasses.clear(); }
+
+	// Start timing a pass, returns its number for EndPass. Returns -1 if MAX_TIMED_PASSES have already been timed
+	int  BeginPass(const std::string& name);
+	void EndPass(int pass);
+
+	// Add the time of each pass to the history. Passes with the same name in a frame are added together
+	void EndFrame(PassTimingHistory& history);
+
+private:
+	struct Pass
+	{
+		std::string name;
+		uint64_t    start;
+		uint64_t    end;
+	};
+
+	TimingClock       mClock;
+	std::vector<Pass> mPasses;
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// GPU timing
+//--------------------------------------------------------------------------------------
+
+// Frames of queries in the ring, so a frame's timestamps are read back this many frames after they were issued
+const int NUM_GPU_TIMING_FRAMES = 4;
+
+// Which pass each pair of timestamp queries in each set of the ring was used for. The caller has a disjoint query and
+// MAX_TIMED_PASSES pairs of timestamp queries for each set
+class GpuTimingRing
+{
+public:
+	// Start a frame, returns the set of queries to use. Any results of that set not collected by now are dropped
+	int  BeginFrame();
+
+	// Get the pair of timestamps to put around a pass in the current set, -1 if all MAX_TIMED_PASSES are in use
+	int  BeginPass(const std::string& name);
+
+	void EndFrame()  { mFrames[mSet].issued = true; }
+
+	// The set BeginFrame will use next and whether it holds timestamps not yet collected. Collect them before
+	// BeginFrame, when the GPU has had NUM_GPU_TIMING_FRAMES - 1 frames to finish them
+	int  NextSet() const  { return (mSet + 1) % NUM_GPU_TIMING_FRAMES; }
+	bool Pending(int set) const  { return mFrames[set].issued; }
+	int  NumPasses(int set) const  { return static_cast<int>(mFrames[set].passes.size()); }
+
+	// Add the times of a set's passes to the history, from their begin and end timestamps and the ticks per second.
+	// A disjoint frame (e.g. the GPU clock changed speed) is dropped
+	void Collect(int set, const uint64_t* begin, const uint64_t* end, uint64_t frequency, bool disjoint, PassTimingHistory& history);
+
+	// Forget a set's timestamps without using them, e.g. if they weren't ready
+	void Drop(int set)  { mFrames[set].issued = false; }
+
+private:
+	struct Frame
+	{
+		std::vector<std::string> passes;
+		bool issued = false;
+	};
+	Frame mFrames[NUM_GPU_TIMING_FRAMES];
+	int   mSet = NUM_GPU_TIMING_FRAMES - 1;
+};
+
+
+#endif //_PASS_TIMING_H_INCLUDED_
@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------------------
+// Batching polygon post-processes into instanced draws
+//--------------------------------------------------------------------------------------
+
+#include "PolygonBatch.h"
+
+
+//--------------------------------------------------------------------------------------
+// Planning
+//--------------------------------------------------------------------------------------
+
+// Whether a polygon post-process can be drawn in a batch
+bool IsBatchablePolygonEffect(PostProcess postProcess)
+{
+	switch (postProcess)
+	{
+		case PostProcess::Tint:
+		case PostProcess::HueTint:
+		case PostProcess::Inverted:
+		case PostProcess::NightVision:
+		case PostProcess::Retro:
+		case PostProcess::Underwater:  return true;
+		default:                       return false;
+	}
+}
+
+
+// Group the polygon entries of a post-process list into passes, in list order
+std::vector<std::vector<int>> PlanPolygonPasses(const std::vector<ProcessAndMode>& postProcessList)
+{
+	std::vector<std::vector<int>> passes;
+	bool lastPassBatchable = false; // Whether more windows can be added to the last pass in the list
+	for (int i = 0; i < static_cast<int>(postProcessList.size()); ++i)
+	{
+		const auto& entry = postProcessList[i];
+		if (entry.mode != PostProcessMode::Polygon)  continue;
+
+		bool batchable = IsBatchablePolygonEffect(entry.process);
+		if (lastPassBatchable && batchable && static_cast<int>(passes.back().size()) < MAX_POLYGON_BATCH)
+		{
+			passes.back().push_back(i);
+		}
+		else
+		{
+			passes.push_back({ i });
+			lastPassBatchable = batchable;
+		}
+	}
+	return passes;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Instances
+//--------------------------------------------------------------------------------------
+
+// Fill in the instance for a window from its constants
+void SetPolygonInstance(PostProcess postProcess, const PostProcessingConstants& constants, PolygonInstance& instance)
+{
+	instance = PolygonInstance();
+	for (int point = 0; point < 4; ++point)
+	{
+		instance.points[point] = constants.polygon2DPoints[point];
+	}
+
+	switch (postProcess)
+	{
+		case PostProcess::Tint:
+		case PostProcess::HueTint:
+		{
+			// HueTint is a tint with shifted colours, as in a fused pass (see SetFusedStageConstants)
+			CVector3 top = constants.tintTopColour;
+			CVector3 bottom = constants.tintBottomColour;
+			if (postProcess == PostProcess::HueTint)
+			{
+				top = HueShiftTintColour(top, constants.HueWiggle);
+				bottom = HueShiftTintColour(bottom, constants.HueWiggle);
+			}
+			instance.effect = static_cast<int>(PolygonBatchEffect::Tint);
+			instance.colours[0] = CVector4(top, 0);
+			instance.colours[1] = CVector4(bottom, 0);
+			break;
+		}
+
+		case PostProcess::Inverted:     instance.effect = static_cast<int>(PolygonBatchEffect::Inverted);     break;
+		case PostProcess::NightVision:  instance.effect = static_cast<int>(PolygonBatchEffect::NightVision);  break;
+		case PostProcess::Retro:        instance.effect = static_cast<int>(PolygonBatchEffect::Retro);        break;
+
+		case PostProcess::Underwater:
+			instance.effect = static_cast<int>(PolygonBatchEffect::Underwater);
+			instance.colours[0] = CVector4(constants.waterColour, constants.Wiggle);
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Drawing
+//--------------------------------------------------------------------------------------
+
+// Get the bounds of a window from its constants
+PolygonWindowBounds GetPolygonWindowBounds(PostProcess postProcess, const PostProcessingConstants& constants,
+                                           int width, int height)
+{
+	PolygonWindowBounds bounds;
+	bounds.draw = PolygonPixelBounds(constants.polygon2DPoints, width, height);
+	bounds.read = ExpandPixelRect(bounds.draw, PostProcessReadMargin(postProcess, constants, width, height), width, height);
+	return bounds;
+}
+
+
+// Split the windows of a batch into draws, in order
+std::vector<int> PlanPolygonBatchDraws(const std::vector<PolygonWindowBounds>& windows)
+{
+	std::vector<int> draws;
+	int numWindows = static_cast<int>(windows.size());
+	int drawStart = 0;
+	for (int window = 0; window < numWindows; ++window)
+	{
+		bool readsEarlierWindow = false;
+		for (int earlier = drawStart; earlier < window && !readsEarlierWindow; ++earlier)
+		{
+			readsEarlierWindow = windows[window].read.Overlaps(windows[earlier].draw);
+		}
+		if (window == 0 || readsEarlierWindow)
+		{
+			draws.push_back(window);
+			drawStart = window;
+		}
+	}
+	draws.push_back(numWindows);
+	return draws;
+}
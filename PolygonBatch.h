@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------
+// Batching polygon post-processes into instanced draws
+//--------------------------------------------------------------------------------------
+// Each polygon entry in the post-process list (a "window" in the scene) used to be its own pass - a constant buffer
+// update, a shader switch and a draw. Windows whose effect only needs a few settings (see IsBatchablePolygonEffect)
+// are drawn together instead: the corners, effect and settings of every window go into one structured buffer
+// (PolygonInstance), and a single instanced draw runs one shader that picks the effect for each instance
+// (PolygonBatch_pp.hlsl). The CPU engine runs the same batches as a single tiled sweep over the screen.
+//
+// A batch reads the image from before any of its windows were drawn, whereas one pass per window lets each window see
+// the ones before it. The two only differ where a window reads pixels an earlier window writes, so a batch is split
+// into several draws just before any such window (PlanPolygonBatchDraws). Windows that don't overlap, like the ones
+// in the scene, always take one draw however many there are.
+// Portable C++ - shared by the GPU path (Scene.cpp) and the CPU engine
+
+#ifndef _POLYGON_BATCH_H_INCLUDED_
+#define _POLYGON_BATCH_H_INCLUDED_
+
+#include "PostProcess.h"
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Planning
+//--------------------------------------------------------------------------------------
+
+// Largest number of windows drawn in one batch - the size of the structured buffer on the GPU
+const int MAX_POLYGON_BATCH = 1024;
+
+// Whether a polygon post-process can be drawn in a batch - effects that read the scene at (or near) the pixel being
+// written and only need colours for their settings: Tint, HueTint, Inverted, NightVision, Retro and Underwater
+bool IsBatchablePolygonEffect(PostProcess postProcess);
+
+// Group the polygon entries of a post-process list into passes, in list order. Each pass is a list of entry indexes -
+// runs of batchable entries become one pass (split up past MAX_POLYGON_BATCH), other entries have a pass each
+std::vector<std::vector<int>> PlanPolygonPasses(const std::vector<ProcessAndMode>& postProcessList);
+
+
+
+//--------------------------------------------------------------------------------------
+// Instances
+//--------------------------------------------------------------------------------------
+
+// Effect run by each instance - must match the POLYGON_BATCH_ constants in PolygonBatch.hlsli
+enum class PolygonBatchEffect
+{
+	Tint,        // Tint and HueTint (with its colours hue shifted on the C++ side)
+	Inverted,
+	NightVision,
+	Retro,
+	Underwater,
+};
+
+// One window in the structured buffer - must match the PolygonInstance structure in PolygonBatch.hlsli
+struct PolygonInstance
+{
+	CVector4 points[4];  // Corners in clip space, as polygon2DPoints
+	CVector4 colours[2]; // Tint: top and bottom colours. Underwater: water colour with the wiggle in w
+	int      effect;     // PolygonBatchEffect value
+	int      padding[3];
+};
+
+// Settings for each draw of a batch - must match the PolygonBatchConstants constant buffer in PolygonBatch.hlsli.
+// SV_InstanceID always starts at 0, even for a draw starting part way through the structured buffer
+struct PolygonBatchConstants
+{
+	int firstInstance; // Window drawn by instance 0
+	int padding[3];
+};
+
+// Fill in the instance for a window from its constants, prepared by UpdatePostProcessConstants with the corners in
+// polygon2DPoints
+void SetPolygonInstance(PostProcess postProcess, const PostProcessingConstants& constants, PolygonInstance& instance);
+
+
+
+//--------------------------------------------------------------------------------------
+// Drawing
+//--------------------------------------------------------------------------------------
+
+// Pixels one window writes and the pixels it reads to do so
+struct PolygonWindowBounds
+{
+	PixelRect draw;
+	PixelRect read;
+};
+
+// Get the bounds of a window from its constants (after UpdatePostProcessConstants, with the corners in polygon2DPoints)
+PolygonWindowBounds GetPolygonWindowBounds(PostProcess postProcess, const PostProcessingConstants& constants,
+                                           int width, int height);
+
+// Split the windows of a batch into draws, in order. A window starts a new draw if it reads pixels written by an
+// earlier window in the current draw, so each draw gives the same result as drawing its windows one at a time. Returns
+// the first window of each draw, followed by the number of windows (so draw d is windows [draws[d], draws[d + 1]) )
+std::vector<int> PlanPolygonBatchDraws(const std::vector<PolygonWindowBounds>& windows);
+
+
+#endif //_POLYGON_BATCH_H_INCLUDED_
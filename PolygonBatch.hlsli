@@ -0,0 +1,47 @@
+//--------------------------------------------------------------------------------------
+// Batched polygon post-processing
+//--------------------------------------------------------------------------------------
+// Included by the vertex and pixel shaders that draw a batch of polygon windows in one instanced draw (see
+// PolygonBatch.h). Each instance is one window, read from a structured buffer filled in by the C++ side
+
+
+//--------------------------------------------------------------------------------------
+// Windows
+//--------------------------------------------------------------------------------------
+
+// Effect run by each window - must match PolygonBatchEffect in PolygonBatch.h
+static const int POLYGON_BATCH_TINT         = 0; // Tint and HueTint
+static const int POLYGON_BATCH_INVERTED     = 1;
+static const int POLYGON_BATCH_NIGHT_VISION = 2;
+static const int POLYGON_BATCH_RETRO        = 3;
+static const int POLYGON_BATCH_UNDERWATER   = 4;
+
+// One window - must match PolygonInstance in PolygonBatch.h
+struct PolygonInstance
+{
+	float4 points[4];  // Corners in clip space, as gPolygon2DPoints
+	float4 colours[2]; // Tint: top and bottom colours. Underwater: water colour with the wiggle in w
+	int    effect;     // One of the POLYGON_BATCH_ values above
+	int3   padding;
+};
+
+StructuredBuffer<PolygonInstance> gPolygonInstances : register(t3);
+
+
+// SV_InstanceID always starts at 0, so when a batch is split into several draws the C++ side gives the first window of
+// each draw here - must match PolygonBatchConstants in PolygonBatch.h
+cbuffer PolygonBatchConstants : register(b2)
+{
+	int  gFirstPolygonInstance;
+	int3 paddingB;
+}
+
+
+// Vertex shader output - PostProcessingInput with the window being drawn
+struct PolygonBatchInput
+{
+	float4 projectedPosition     : SV_Position;
+	noperspective float2 sceneUV : sceneUV;
+	float2 areaUV                : areaUV;
+	nointerpolation uint window  : window;
+};
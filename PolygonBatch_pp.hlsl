@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------
+// Polygon Batch Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Runs the effect of each window in a polygon batch (see PolygonBatch.h). Each effect matches its own shader when drawn
+// on a polygon (where the mid-line split never applies) - keep them in step with those shaders if either changes
+
+#include "Common.hlsli"
+#include "PolygonBatch.hlsli"
+#include "FusedEffects.hlsli" // The scene texture and the colour parts of the per-pixel effects
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+float4 main(PolygonBatchInput input) : SV_Target
+{
+	PolygonInstance window = gPolygonInstances[input.window];
+
+	float3 finalColour;
+	if (window.effect == POLYGON_BATCH_RETRO)
+	{
+		finalColour = RetroColourStage(RetroSample(input.sceneUV));
+	}
+	else if (window.effect == POLYGON_BATCH_UNDERWATER)
+	{
+		// Underwater_pp.hlsl - wiggle the scene vertically and tint it with the water colour
+		float2 sceneUV = input.sceneUV;
+		float sinY = sin(sceneUV.y * radians(360.0f) + window.colours[0].w) * 0.012;
+		sceneUV.y += 0.314f * sinY;
+		finalColour = SceneTexture.Sample(PointSample, sceneUV).rgb * window.colours[0].rgb;
+	}
+	else
+	{
+		finalColour = SceneTexture.Sample(PointSample, input.sceneUV).rgb;
+		if (window.effect == POLYGON_BATCH_TINT)
+		{
+			finalColour *= lerp(window.colours[0].rgb, window.colours[1].rgb, input.sceneUV.y);
+		}
+		else if (window.effect == POLYGON_BATCH_INVERTED)
+		{
+			finalColour = InvertStage(finalColour);
+		}
+		else if (window.effect == POLYGON_BATCH_NIGHT_VISION)
+		{
+			finalColour = NightVisionStage(finalColour);
+		}
+	}
+
+	// Got the RGB from the scene texture, set alpha to 1 for final output
+	return float4(finalColour, 1.0f);
+}
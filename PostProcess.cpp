@@ -0,0 +1,321 @@
+//--------------------------------------------------------------------------------------
+// Post-process definitions shared by the GPU (Direct3D) and CPU reference paths
+//--------------------------------------------------------------------------------------
+
+#include "PostProcess.h"
+#include "BlurKernel.h"
+#include "MathHelpers.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+//--------------------------------------------------------------------------------------
+// Post-process selection
+//--------------------------------------------------------------------------------------
+
+const char* PostProcessName(PostProcess postProcess)
+{
+	switch (postProcess)
+	{
+		case PostProcess::None:         return "None";
+		case PostProcess::Copy:         return "Copy";
+		case PostProcess::Tint:         return "Tint";
+		case PostProcess::GreyNoise:    return "Grey noise";
+		case PostProcess::Burn:         return "Burn";
+		case PostProcess::Distort:      return "Distort";
+		case PostProcess::Spiral:       return "Spiral";
+		case PostProcess::HeatHaze:     return "Heat haze";
+		case PostProcess::HueTint:      return "Hue tint";
+		case PostProcess::BlurH:        return "Blur horizontal";
+		case PostProcess::BlurV:        return "Blur vertical";
+		case PostProcess::Underwater:   return "Underwater";
+		case PostProcess::Inverted:     return "Inverted";
+		case PostProcess::NightVision:  return "Night vision";
+		case PostProcess::Retro:        return "Retro";
+		case PostProcess::Bloom1:       return "Bloom";
+		case PostProcess::Bloom2:       return "Bloom 2";
+		case PostProcess::DepthOfField: return "Depth of field";
+		default:                        return "Unknown";
+	}
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Shader variants
+//--------------------------------------------------------------------------------------
+
+// Variant needed by a pass with the given constants - the same test the effect shaders make at run time
+ShaderVariant PostProcessShaderVariant(const PostProcessingConstants& constants)
+{
+	return (constants.MidLineEnabled && constants.IsFullScreen) ? ShaderVariant::MidLine : ShaderVariant::NoMidLine;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Bloom
+//--------------------------------------------------------------------------------------
+
+// Get the size of a level in the bloom chain given the size of the screen
+void BloomLevelSize(int level, int screenWidth, int screenHeight, int& levelWidth, int& levelHeight)
+{
+	levelWidth = screenWidth;
+	levelHeight = screenHeight;
+	for (int i = 0; i <= level; ++i)
+	{
+		levelWidth  = (levelWidth  + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+	if (levelWidth  < 1)  levelWidth  = 1;
+	if (levelHeight < 1)  levelHeight = 1;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Post-process settings update
+//--------------------------------------------------------------------------------------
+
+namespace
+{
+	// Colour space conversions from HueTint_pp.hlsl
+	const float Epsilon = 1e-10f;
+
+	CVector3 HUEtoRGB(float H)
+	{
+		float R = std::abs(H * 6 - 3) - 1;
+		float G = 2 - std::abs(H * 6 - 2);
+		float B = 2 - std::abs(H * 6 - 4);
+		return { std::min(std::max(R, 0.0f), 1.0f), std::min(std::max(G, 0.0f), 1.0f), std::min(std::max(B, 0.0f), 1.0f) };
+	}
+
+	CVector3 HSLtoRGB(CVector3 HSL)
+	{
+		CVector3 RGB = HUEtoRGB(HSL.x);
+		float C = (1 - std::abs(2 * HSL.z - 1)) * HSL.y;
+		return { (RGB.x - 0.5f) * C + HSL.z, (RGB.y - 0.5f) * C + HSL.z, (RGB.z - 0.5f) * C + HSL.z };
+	}
+
+	CVector3 RGBtoHCV(CVector3 RGB)
+	{
+		float P[4], Q[4];
+		if (RGB.y < RGB.z) { P[0] = RGB.z;  P[1] = RGB.y;  P[2] = -1.0f;  P[3] =  2.0f / 3.0f; }
+		else               { P[0] = RGB.y;  P[1] = RGB.z;  P[2] =  0.0f;  P[3] = -1.0f / 3.0f; }
+		if (RGB.x < P[0])  { Q[0] = P[0];   Q[1] = P[1];   Q[2] = P[3];   Q[3] = RGB.x; }
+		else               { Q[0] = RGB.x;  Q[1] = P[1];   Q[2] = P[2];   Q[3] = P[0];  }
+		float C = Q[0] - std::min(Q[3], Q[1]);
+		float H = std::abs((Q[3] - Q[1]) / (6 * C + Epsilon) + Q[2]);
+		return { H, C, Q[0] };
+	}
+
+	CVector3 RGBtoHSL(CVector3 RGB)
+	{
+		CVector3 HCV = RGBtoHCV(RGB);
+		float L = HCV.z - HCV.y * 0.5f;
+		float S = HCV.y / (1 - std::abs(L * 2 - 1) + Epsilon);
+		return { HCV.x, S, L };
+	}
+}
+
+
+// Shift the hue of a tint colour by the current hue wiggle, as HueTint_pp.hlsl does to its top and bottom colours
+CVector3 HueShiftTintColour(CVector3 colour, float hueWiggle)
+{
+	CVector3 HSL = RGBtoHSL(colour);
+	HSL.x += 0.314f * std::sin(hueWiggle * 0.3f);
+	if (HSL.x > 1.0f)
+	{
+		HSL.x = 0.0f;
+	}
+	return HSLtoRGB(HSL);
+}
+
+
+
+// Copy the settings for one post-process list entry into the constant buffer structure and advance any animated values
+// (burn height, spiral, wiggles etc.) by the frame time. Used by both the GPU path (PostProcessPasses.h) and the CPU engine so
+// they always see exactly the same parameters. Pass the size of the viewport being processed
+void UpdatePostProcessConstants(PostProcess postProcess, Constants& settings, float frameTime,
+                                int viewportWidth, int viewportHeight, PostProcessingConstants& constants)
+{
+	if (postProcess == PostProcess::Tint)
+	{
+		constants.tintBottomColour = settings.tintBottomColour;
+		constants.tintTopColour = settings.tintTopColour;
+	}
+
+	else if (postProcess == PostProcess::GreyNoise)
+	{
+		// Noise scaling adjusts how fine the noise is.
+		const float grainSize = 140; // Fineness of the noise grain
+		constants.noiseScale = { viewportWidth / grainSize, viewportHeight / grainSize };
+
+		// The noise offset is randomised to give a constantly changing noise effect (like tv static)
+		constants.noiseOffset = { Random(0.0f, 1.0f), Random(0.0f, 1.0f) };
+	}
+
+	else if (postProcess == PostProcess::Burn)
+	{
+		// Set and increase the burn level (cycling back to 0 when it reaches 1.0f)
+		const float burnSpeed = 0.2f;
+		constants.burnHeight = fmod(constants.burnHeight + burnSpeed * frameTime, 1.0f);
+	}
+
+	else if (postProcess == PostProcess::Spiral)
+	{
+		const float spiralSpeed = 1.0f;
+
+		// Set and increase the amount of spiral - use a tweaked cos wave to animate
+		constants.spiralLevel = ((1.0f - cos(settings.spiral)) * 4.0f);
+		settings.spiral += spiralSpeed * frameTime;
+	}
+
+	else if (postProcess == PostProcess::HeatHaze)
+	{
+		constants.heatHazeTimer += frameTime;
+	}
+
+	else if (postProcess == PostProcess::HueTint)
+	{
+		constants.HueWiggle += settings.HueWiggleSpeed * frameTime;
+	}
+
+	else if (postProcess == PostProcess::Underwater)
+	{
+		constants.waterColour = { 0.2f, 0.4f, 1.0f };
+		settings.Wiggle += settings.WiggleSpeed * frameTime;
+		constants.Wiggle = settings.Wiggle;
+	}
+
+	else if (postProcess == PostProcess::BlurH)
+	{
+		// Kernels are cached so this is only calculated when the strength or sigma changes. The BlurV pass that
+		// follows uses the same taps
+		PackBlurKernel(GetBlurKernel(settings.blurStrength, settings.blurSigma, settings.blurLinearSampling), constants);
+	}
+
+	else if (postProcess == PostProcess::Bloom1)
+	{
+		constants.bloomThreshold = settings.bloomThreshold;
+	}
+
+	else if (postProcess == PostProcess::DepthOfField)
+	{
+		constants.depthThreshold = settings.depthThreshold;
+	}
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Screen bounds
+//--------------------------------------------------------------------------------------
+
+// Smallest rectangle containing both rectangles
+PixelRect UnionPixelRect(const PixelRect& a, const PixelRect& b)
+{
+	if (a.Empty())  return b;
+	if (b.Empty())  return a;
+	return { std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right), std::max(a.bottom, b.bottom) };
+}
+
+
+// Pixels that may be covered by a polygon given in clip space on a screen of the given size
+PixelRect PolygonPixelBounds(const CVector4 (&points)[4], int width, int height)
+{
+	PixelRect screen = { 0, 0, width, height };
+	float left = static_cast<float>(width), right = 0, top = static_cast<float>(height), bottom = 0;
+	for (auto& point : points)
+	{
+		// Points behind the camera would need clipping to find the bounds
+		if (point.w <= 0)  return screen;
+
+		float x = (point.x / point.w + 1.0f) * 0.5f * width;
+		float y = (1.0f - point.y / point.w) * 0.5f * height;
+		left   = std::min(left, x);
+		right  = std::max(right, x);
+		top    = std::min(top, y);
+		bottom = std::max(bottom, y);
+	}
+
+	PixelRect bounds;
+	bounds.left   = std::max(0,      static_cast<int>(std::floor(left)));
+	bounds.top    = std::max(0,      static_cast<int>(std::floor(top)));
+	bounds.right  = std::min(width,  static_cast<int>(std::ceil(right)));
+	bounds.bottom = std::min(height, static_cast<int>(std::ceil(bottom)));
+	return bounds;
+}
+
+
+// Pixels covered by an area given in 0->1 screen coordinates
+PixelRect AreaPixelBounds(CVector2 topLeft, CVector2 size, int width, int height)
+{
+	PixelRect bounds;
+	bounds.left   = std::max(0,      static_cast<int>(std::floor(topLeft.x * width)));
+	bounds.top    = std::max(0,      static_cast<int>(std::floor(topLeft.y * height)));
+	bounds.right  = std::min(width,  static_cast<int>(std::ceil((topLeft.x + size.x) * width)));
+	bounds.bottom = std::min(height, static_cast<int>(std::ceil((topLeft.y + size.y) * height)));
+	return bounds;
+}
+
+
+// Furthest distance in pixels a post-process reads the scene from the pixel it is writing. The offsets are the ones
+// used in the _pp.hlsl files (and the matching CPU shaders)
+CVector2 PostProcessReadMargin(PostProcess postProcess, const PostProcessingConstants& constants, int width, int height)
+{
+	CVector2 screen = { static_cast<float>(width), static_cast<float>(height) };
+	switch (postProcess)
+	{
+		case PostProcess::Burn: // Crinkle at the burn edge, up to 0.15 * 0.5 either way
+			return { 0.075f * width, 0.075f * height };
+
+		case PostProcess::Distort: // Distort map vector, up to 0.5 either way, times the distort level
+			return { std::abs(constants.distortLevel) * 0.5f * width, std::abs(constants.distortLevel) * 0.5f * height };
+
+		case PostProcess::HeatHaze: // Haze offset scales with the area size
+			return { 0.01f * std::abs(constants.area2DSize.x) * width, 0.01f * std::abs(constants.area2DSize.y) * height };
+
+		case PostProcess::Underwater: // Vertical wiggle only
+			return { 0, 0.314f * 0.012f * height };
+
+		case PostProcess::Retro: // Reads the top-left of its 15x10 block
+			return { 15, 10 };
+
+		case PostProcess::BlurH:
+		case PostProcess::BlurV:
+		{
+			// Furthest tap, taps between pixels also read the next one along
+			float furthest = 0;
+			for (int i = 0; i < constants.blurTapCount; ++i)
+			{
+				const CVector4& packed = constants.blurTaps[i / 2];
+				furthest = std::max(furthest, std::abs((i % 2 == 0) ? packed.y : packed.w) + 1.0f);
+			}
+			if (postProcess == PostProcess::BlurH)  return { furthest, 0 };
+			return { 0, furthest };
+		}
+
+		case PostProcess::Spiral: // Rotates around the area centre, which can be anywhere
+			return screen;
+
+		default: // Only read the pixel being written
+			return { 0, 0 };
+	}
+}
+
+
+// Grow a rectangle by a margin in pixels, rounding out to whole pixels and clamping to the screen
+PixelRect ExpandPixelRect(const PixelRect& rect, CVector2 margin, int width, int height)
+{
+	int marginX = static_cast<int>(std::ceil(margin.x)) + 1;
+	int marginY = static_cast<int>(std::ceil(margin.y)) + 1;
+
+	PixelRect expanded;
+	expanded.left   = std::max(0,      rect.left   - marginX);
+	expanded.top    = std::max(0,      rect.top    - marginY);
+	expanded.right  = std::min(width,  rect.right  + marginX);
+	expanded.bottom = std::min(height, rect.bottom + marginY);
+	return expanded;
+}
@@ -0,0 +1,314 @@
+//--------------------------------------------------------------------------------------
+// Post-process definitions shared by the GPU (Direct3D) and CPU reference paths
+//--------------------------------------------------------------------------------------
+// Nothing in this file depends on DirectX or Windows so it can be used by headless tools
+// (e.g. the CPU post-processing engine) on any platform
+
+#ifndef _POST_PROCESS_H_INCLUDED_
+#define _POST_PROCESS_H_INCLUDED_
+
+#include "CVector2.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Post-process selection
+//--------------------------------------------------------------------------------------
+
+// Available post-processes
+enum class PostProcess
+{
+	None,
+	Copy,
+	Tint,
+	GreyNoise,
+	Burn,
+	Distort,
+	Spiral,
+	HeatHaze,
+	HueTint,
+	BlurH,
+	BlurV,
+	Underwater,
+	Inverted,
+	NightVision,
+	Retro,
+	Bloom1,
+	Bloom2,
+	DepthOfField
+};
+const int NUM_POST_PROCESSES = static_cast<int>(PostProcess::DepthOfField) + 1;
+
+enum class PostProcessMode
+{
+	Fullscreen,
+	Area,
+	Polygon,
+};
+
+// Ways of calculating the BlurH / BlurV post-processes. The constant-time modes approximate the Gaussian with the same
+// spread, but their cost doesn't depend on the blur strength. They are used by the CPU engine for full-screen passes,
+// the GPU and the CPU area/polygon passes always use the Gaussian taps
+enum class BlurMode
+{
+	Gaussian,  // One texture read per tap (see BlurKernel.h)
+	Box,       // Three box blurs using running sums
+	Recursive, // Young / van Vliet recursive Gaussian filter
+};
+
+struct ProcessAndMode
+{
+	PostProcess process;
+	PostProcessMode mode;
+};
+
+// Name of a post-process, for display
+const char* PostProcessName(PostProcess postProcess);
+
+
+// User adjustable settings for a single entry in the post-process list
+struct Constants
+{
+	// Tint post-process settings
+	CVector3 tintTopColour = { 0, 0, 1 };
+	CVector3 tintBottomColour = { 0, 1, 0 };
+
+	// HueTint post-process settings
+	float    HueWiggle = 0.0f;
+	float    HueWiggleSpeed = 0.0f;
+
+	// Spiral post-process settings
+	float    spiral = 0.0f; // Animated, the spiral level follows a cos wave of this
+
+	// Underwater post-process settiings
+	CVector3 waterColour = { 0.0f,0.0f,0.0f };
+	float    Wiggle = 0.0f;
+	float    WiggleSpeed = 0.0f;
+
+	// Bloom post processing effects
+	float bloomThreshold = 0.8f;
+
+	// DOF post processing effects
+	float depthThreshold = 0.0f;
+
+	// Blur post-process settings
+	int   blurStrength = 7;
+	float blurSigma = 40.0f;
+	bool  blurLinearSampling = true; // Use bilinear fetches to read two pixels per tap (see BlurKernel.h)
+	BlurMode blurMode = BlurMode::Gaussian;  // CPU engine only, the GPU always uses the Gaussian taps (see BlurMode)
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Constant Buffer
+//--------------------------------------------------------------------------------------
+
+// Largest number of effects that can be combined into one fused pass (see PostProcessFusion.h)
+const int MAX_FUSED_STAGES = 8;
+
+// Settings used by post-processes - must match the similar constant buffers in the Common.hlsli shader file. The GPU
+// receives the structure as several blocks, each sent only when the shaders need it and it has changed (see
+// ConstantBlocks.h), so keep each block together and a multiple of 16 bytes in size
+struct PostProcessingConstants
+{
+	//---- Area block - where the draw goes on screen
+
+	CVector2 area2DTopLeft; // Top-left of post-process area on screen, provided as coordinate from 0.0->1.0 not as a pixel coordinate
+	CVector2 area2DSize;    // Size of post-process area on screen, provided as sizes from 0.0->1.0 (1 = full screen) not as a size in pixels
+	float    area2DDepth;   // Depth buffer value for area (0.0 nearest to 1.0 furthest). Full screen post-processing uses 0.0f
+	CVector3 paddingA;      // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
+
+	CVector4 polygon2DPoints[4]; // Four points of a polygon in 2D viewport space for polygon post-processing. Matrix transformations already done on C++ side
+
+	bool	 IsFullScreen;
+	CVector3 paddingK;
+
+
+	//---- Frame block - the split screen mid-line, only changes when the user moves it
+
+	float    MidLine;
+	CVector3 paddingZ;
+
+	bool	 MidLineEnabled;
+	CVector3 paddingY;
+
+
+	//---- Effect block - settings of the single effects
+
+	// Tint post-process settings
+	CVector3 tintTopColour;
+	float    paddingB;  // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
+
+	CVector3 tintBottomColour;
+	float    paddingC;  // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
+
+	// HueTint post-process settings
+	float    HueWiggle;  // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
+	float    HueWiggleSpeed;
+	CVector2 paddingD;
+
+	// Underwater post-process settiings
+	CVector3 waterColour;
+	float    Wiggle;  // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
+
+	float    WiggleSpeed;
+	CVector3 paddingE;
+
+	//Retro post-processing settintgs
+
+	// Grey noise post-process settings
+    CVector2 noiseScale;
+	CVector2 noiseOffset;
+
+	// Burn post-process settings
+	float    burnHeight;
+	CVector3 paddingG;
+
+	// Distort post-process settings
+	float    distortLevel;
+	CVector3 paddingH;
+
+	// Spiral post-process settings
+	float    spiralLevel;
+	CVector3 paddingI;
+
+	// Heat haze post-process settings
+	float    heatHazeTimer;
+	CVector3 paddingJ;
+
+	// Bloom post processing effects
+	float bloomThreshold;
+	CVector3 paddingF;
+
+	// DOF post processing effects
+	float depthThreshold;
+	CVector3 paddingM;
+
+
+	//---- Blur block - only changes with the blur settings
+
+	// Blur post-process settings - two taps packed in each element as (weight, offset, weight, offset), see BlurKernel.h
+	CVector4 blurTaps[50];
+	int      blurTapCount;
+	CVector3 paddingL;
+
+
+	//---- Fused block - settings of fused and colour LUT passes
+
+	// Fused pass settings - the top and bottom tint colours for each stage (w unused), see PostProcessFusion.h
+	CVector4 fusedTintColours[2 * MAX_FUSED_STAGES];
+
+	// Colour LUT pass settings - top and bottom tint colours applied before and after the lookup (w unused), see ColourLut.h
+	CVector4 lutPreTintColours[2];
+	CVector4 lutPostTintColours[2];
+	float    lutSize;
+	int      lutRetroSample; // Whether to read the scene at Retro's snapped positions
+	CVector2 paddingN;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Shader variants
+//--------------------------------------------------------------------------------------
+// Every effect shader starts by checking which side of the split-screen mid-line the pixel is on, which is only ever
+// shown in full-screen passes with the mid-line switched on. Rather than checking for every pixel, each effect is
+// compiled in two variants (the MIDLINE_SPLIT define in Common.hlsli) and each pass picks the one it needs. Area and
+// polygon passes already have their own vertex shaders, and as they never show the mid-line they always take the
+// NoMidLine variant. The CPU engine does the same with a template parameter on its pixel loops
+
+enum class ShaderVariant
+{
+	NoMidLine, // No mid-line check at all - the usual case
+	MidLine,   // Effect to the left of the mid-line, the untouched scene to the right
+};
+const int NUM_SHADER_VARIANTS = 2;
+
+// Variant needed by a pass with the given constants
+ShaderVariant PostProcessShaderVariant(const PostProcessingConstants& constants);
+
+
+
+//--------------------------------------------------------------------------------------
+// Bloom
+//--------------------------------------------------------------------------------------
+// A Bloom1 entry in the post-process list runs the whole bloom effect as a chain of smaller images:
+// - threshold the scene and downsample it to half size (level 0 of the chain)
+// - downsample again to a quarter and an eighth of the screen size
+// - working back up, blur each level with a small tent filter and add it onto the level above
+// - a single composite pass adds the blurred half size level onto the scene
+// The small levels make a wide blur cheap - a 3x3 tent at 1/8 size covers as much of the screen as a 24 pixel
+// wide blur at full size, and only the final composite touches every screen pixel
+
+// Number of levels in the bloom chain (half, quarter and eighth size)
+const int NUM_BLOOM_LEVELS = 3;
+
+// Get the size of a level in the bloom chain given the size of the screen. Each level is half the size of the one
+// above, rounded up so no level is ever empty
+void BloomLevelSize(int level, int screenWidth, int screenHeight, int& levelWidth, int& levelHeight);
+
+
+
+//--------------------------------------------------------------------------------------
+// Post-process settings update
+//--------------------------------------------------------------------------------------
+
+// Copy the settings for one post-process list entry into the constant buffer structure and advance any animated values
+// (burn height, spiral, wiggles etc.) by the frame time. Used by both the GPU path (PostProcessPasses.h) and the CPU engine so
+// they always see exactly the same parameters. Pass the size of the viewport being processed
+void UpdatePostProcessConstants(PostProcess postProcess, Constants& settings, float frameTime,
+                                int viewportWidth, int viewportHeight, PostProcessingConstants& constants);
+
+// Shift the hue of a tint colour by the current hue wiggle, as HueTint_pp.hlsl does to its top and bottom colours
+CVector3 HueShiftTintColour(CVector3 colour, float hueWiggle);
+
+
+
+//--------------------------------------------------------------------------------------
+// Screen bounds
+//--------------------------------------------------------------------------------------
+// Polygon and area effects only change part of the screen. Rather than copying the whole image first, they work out
+// the rectangle of pixels they cover, grow it by however far the effect reads around each pixel, and only copy and
+// process that (see PolygonPostProcess in PostProcessPasses.h and CpuPolygonPostProcess)
+
+// A rectangle of pixels, right and bottom exclusive
+struct PixelRect
+{
+	int left   = 0;
+	int top    = 0;
+	int right  = 0;
+	int bottom = 0;
+
+	bool     Empty() const   { return right <= left || bottom <= top; }
+	uint64_t Pixels() const  { return Empty() ? 0 : static_cast<uint64_t>(right - left) * (bottom - top); }
+
+	// Whether the two rectangles share any pixels
+	bool Overlaps(const PixelRect& other) const
+	{
+		return !Empty() && !other.Empty() && left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+	}
+};
+
+// Smallest rectangle containing both rectangles (an empty rectangle adds nothing)
+PixelRect UnionPixelRect(const PixelRect& a, const PixelRect& b);
+
+// Pixels that may be covered by a polygon given in clip space (polygon2DPoints) on a screen of the given size. A polygon
+// with a point behind the camera covers the whole screen
+PixelRect PolygonPixelBounds(const CVector4 (&points)[4], int width, int height);
+
+// Pixels covered by an area given in 0->1 screen coordinates (area2DTopLeft / area2DSize)
+PixelRect AreaPixelBounds(CVector2 topLeft, CVector2 size, int width, int height);
+
+// Furthest distance in pixels a post-process reads the scene from the pixel it is writing, given the settings in the
+// constants (so call after UpdatePostProcessConstants). Effects that can read anywhere return the screen size
+CVector2 PostProcessReadMargin(PostProcess postProcess, const PostProcessingConstants& constants, int width, int height);
+
+// Grow a rectangle by a margin in pixels, rounding out to whole pixels (plus one for sampling between pixels) and
+// clamping to the screen
+PixelRect ExpandPixelRect(const PixelRect& rect, CVector2 margin, int width, int height);
+
+
+#endif //_POST_PROCESS_H_INCLUDED_
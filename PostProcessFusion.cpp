@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// Fusing per-pixel post-processes into single passes
+//--------------------------------------------------------------------------------------
+
+#include "PostProcessFusion.h"
+
+
+// Whether a post-process can be a stage in a fused pass
+bool IsFusablePostProcess(PostProcess postProcess, bool firstStage)
+{
+	switch (postProcess)
+	{
+		case PostProcess::Tint:
+		case PostProcess::HueTint:
+		case PostProcess::Inverted:
+		case PostProcess::NightVision:  return true;
+		case PostProcess::Retro:        return firstStage;
+		default:                        return false;
+	}
+}
+
+
+// Group the full-screen entries of a post-process list into passes, in the order RenderScene runs them
+std::vector<std::vector<int>> PlanFullScreenPasses(const std::vector<ProcessAndMode>& postProcessList)
+{
+	std::vector<std::vector<int>> passes;
+	bool lastPassFusable = false; // Whether more stages can be added to the last pass in the list
+	for (int i = 0; i < static_cast<int>(postProcessList.size()); ++i)
+	{
+		const auto& entry = postProcessList[i];
+		if (entry.mode != PostProcessMode::Fullscreen || entry.process == PostProcess::Bloom1)  continue;
+
+		if (lastPassFusable && IsFusablePostProcess(entry.process, false) &&
+			static_cast<int>(passes.back().size()) < MAX_FUSED_STAGES)
+		{
+			passes.back().push_back(i);
+		}
+		else
+		{
+			passes.push_back({ i });
+			lastPassFusable = IsFusablePostProcess(entry.process, true);
+		}
+	}
+	return passes;
+}
+
+
+// Copy the settings for one stage of a fused pass into the fused part of the constants
+void SetFusedStageConstants(int stage, PostProcess postProcess, PostProcessingConstants& constants)
+{
+	// Tint and HueTint become the same stage - HueTint just shifts its colours first, which only depends on the constants
+	CVector3 top = constants.tintTopColour;
+	CVector3 bottom = constants.tintBottomColour;
+	if (postProcess == PostProcess::HueTint)
+	{
+		top = HueShiftTintColour(top, constants.HueWiggle);
+		bottom = HueShiftTintColour(bottom, constants.HueWiggle);
+	}
+	constants.fusedTintColours[2 * stage]     = CVector4(top, 0);
+	constants.fusedTintColours[2 * stage + 1] = CVector4(bottom, 0);
+}
+
+
+// Generate the HLSL source for a pixel shader running the given stages in order, in the given variant
+std::string GenerateFusedShaderSource(const std::vector<PostProcess>& stages, ShaderVariant variant)
+{
+	std::string source = "// Fused post-process generated by GenerateFusedShaderSource (PostProcessFusion.cpp)\n";
+	source += (variant == ShaderVariant::MidLine) ? "#define MIDLINE_SPLIT 1\n" : "#define MIDLINE_SPLIT 0\n";
+	source += "#include \"Common.hlsli\"\n"
+	          "#include \"FusedEffects.hlsli\"\n\n"
+	          "float4 main(PostProcessingInput input) : SV_Target\n"
+	          "{\n"
+	          "    float3 colour = float3(1.0, 0.0, 0.0);\n"
+	          "    if (EffectSideOfMidLine(input.sceneUV))\n"
+	          "    {\n";
+
+	for (int stage = 0; stage < static_cast<int>(stages.size()); ++stage)
+	{
+		if (stage == 0)
+		{
+			source += (stages[0] == PostProcess::Retro) ? "        colour = RetroSample(input.sceneUV);\n"
+			                                            : "        colour = SceneTexture.Sample(PointSample, input.sceneUV).rgb;\n";
+		}
+
+		std::string stageNumber = std::to_string(stage);
+		switch (stages[stage])
+		{
+			case PostProcess::Tint:
+			case PostProcess::HueTint:      source += "        colour = saturate(TintStage(colour, " + stageNumber + ", input.sceneUV));\n";  break;
+			case PostProcess::Inverted:     source += "        colour = saturate(InvertStage(colour));\n";                                    break;
+			case PostProcess::NightVision:  source += "        colour = saturate(NightVisionStage(colour));\n";                               break;
+			case PostProcess::Retro:        source += "        colour = saturate(RetroColourStage(colour));\n";                               break;
+			default:                        break;
+		}
+	}
+
+	source += "    }\n"
+	          "    else if (input.sceneUV.x >= (gMidLine + 0.002))\n"
+	          "    {\n"
+	          "        colour = SceneTexture.Sample(PointSample, input.sceneUV).rgb;\n"
+	          "    }\n"
+	          "    return float4(colour, 1.0f);\n"
+	          "}\n";
+	return source;
+}
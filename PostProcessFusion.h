@@ -0,0 +1,41 @@
+//--------------------------------------------------------------------------------------
+// Fusing per-pixel post-processes into single passes
+//--------------------------------------------------------------------------------------
+// Tint, HueTint, Inverted and NightVision only change the colour of each pixel, and Retro only reads one (snapped)
+// pixel before changing its colour. A run of these effects next to each other in the post-process list doesn't need
+// a full-screen pass each - a single pass can read the scene once and apply every effect in turn. This file finds
+// those runs and generates the HLSL for the combined pixel shader. Each stage's settings go in the fusedTintColours
+// array of the constant buffer, so a fused pass needs only one constant buffer update.
+//
+// The results match running the effects one at a time, apart from the rounding to 8 bits between passes that the
+// separate passes had (values are still clamped to 0->1 between stages as the render targets did).
+// Portable C++ - shared by the GPU path (Scene.cpp generates and compiles the shader) and the CPU engine
+
+#ifndef _POST_PROCESS_FUSION_H_INCLUDED_
+#define _POST_PROCESS_FUSION_H_INCLUDED_
+
+#include "PostProcess.h"
+
+#include <string>
+#include <vector>
+
+
+// Whether a post-process can be a stage in a fused pass. Retro reads the scene away from the pixel being processed
+// so it can only be the first stage (reading the scene rather than the result of an earlier stage)
+bool IsFusablePostProcess(PostProcess postProcess, bool firstStage);
+
+// Group the full-screen entries of a post-process list into passes, in the order RenderScene runs them (Bloom1 entries
+// are left out, they run after everything else). Each pass is a list of entry indexes - a single entry is an ordinary
+// pass, several are fused. Runs of fusable effects are split up if they have more than MAX_FUSED_STAGES entries
+std::vector<std::vector<int>> PlanFullScreenPasses(const std::vector<ProcessAndMode>& postProcessList);
+
+// Copy the settings for one stage of a fused pass into the fused part of the constants. Call after UpdatePostProcessConstants
+// has prepared the constants for the stage's list entry
+void SetFusedStageConstants(int stage, PostProcess postProcess, PostProcessingConstants& constants);
+
+// Generate the HLSL source for a pixel shader running the given stages in order (see FusedEffects.hlsli), in the given
+// variant (see ShaderVariant in PostProcess.h)
+std::string GenerateFusedShaderSource(const std::vector<PostProcess>& stages, ShaderVariant variant);
+
+
+#endif //_POST_PROCESS_FUSION_H_INCLUDED_
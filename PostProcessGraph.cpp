@@ -0,0 +1,314 @@
+//--------------------------------------------------------------------------------------
+// Post-processing render graph
+//--------------------------------------------------------------------------------------
+
+#include "PostProcessGraph.h"
+#include "PostProcessFusion.h"
+#include "PolygonBatch.h"
+
+
+//--------------------------------------------------------------------------------------
+// Graph declaration
+//--------------------------------------------------------------------------------------
+
+// Declare a pass, returns its number
+int PostProcessGraph::AddPass(const PostProcessPass& pass)
+{
+	mPasses.push_back(pass);
+	return static_cast<int>(mPasses.size()) - 1;
+}
+
+
+// Declare the passes for a post-process list in the order RenderScene has always run them
+PostProcessGraph BuildPostProcessGraph(const std::vector<ProcessAndMode>& postProcessList)
+{
+	PostProcessGraph graph;
+	int latest = PostProcessGraph::SceneResource;
+
+	// Each pass reads the image written by the one before and writes a new image
+	auto addPass = [&](PostProcessPassType type, const std::vector<int>& entries)
+	{
+		PostProcessPass pass;
+		pass.type = type;
+		pass.entries = entries;
+		pass.reads = { latest };
+		pass.write = graph.AddResource();
+
+		PostProcess postProcess = postProcessList[entries[0]].process;
+		pass.identity = (type == PostProcessPassType::Polygon || type == PostProcessPassType::FullScreen) &&
+		                (postProcess == PostProcess::Copy || postProcess == PostProcess::None);
+		pass.inPlace = (type == PostProcessPassType::Polygon);
+
+		graph.AddPass(pass);
+		latest = pass.write;
+	};
+
+	for (auto& entries : PlanPolygonPasses(postProcessList))
+	{
+		addPass(PostProcessPassType::Polygon, entries);
+	}
+	for (auto& entries : PlanFullScreenPasses(postProcessList))
+	{
+		addPass(entries.size() == 1 ? PostProcessPassType::FullScreen : PostProcessPassType::Fused, entries);
+	}
+	int listSize = static_cast<int>(postProcessList.size());
+	for (int i = 0; i < listSize; ++i)
+	{
+		if (postProcessList[i].process == PostProcess::Bloom1)  addPass(PostProcessPassType::Bloom, { i });
+	}
+
+	graph.SetOutput(latest);
+	return graph;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Compiling
+//--------------------------------------------------------------------------------------
+
+// Compile a graph ready to run
+bool CompilePostProcessGraph(const PostProcessGraph& graph, CompiledPostProcessGraph& compiled)
+{
+	compiled = CompiledPostProcessGraph();
+	const std::vector<PostProcessPass>& passes = graph.Passes();
+	int numPasses = static_cast<int>(passes.size());
+	int numResources = graph.NumResources();
+	compiled.numResources = numResources;
+	compiled.numDeclared = numPasses;
+
+	// Find the pass writing each image. Each image is written once, and the scene before the graph starts
+	std::vector<int> writer(numResources, -1);
+	for (int p = 0; p < numPasses; ++p)
+	{
+		int write = passes[p].write;
+		if (write <= PostProcessGraph::SceneResource || write >= numResources || writer[write] >= 0)  return false;
+		writer[write] = p;
+	}
+	auto isWritten = [&](int resource)
+	{
+		return resource >= 0 && resource < numResources && (resource == PostProcessGraph::SceneResource || writer[resource] >= 0);
+	};
+	for (auto& pass : passes)
+	{
+		if (pass.reads.empty())  return false;
+		for (int read : pass.reads)
+		{
+			if (!isWritten(read))  return false;
+		}
+	}
+	if (!isWritten(graph.Output()))  return false;
+
+
+	// Order the passes so each one runs after the passes writing the images it reads. When several passes are ready the
+	// one declared first goes next, so a graph declared in a valid order keeps that order
+	std::vector<int> order;
+	std::vector<int> numWaiting(numPasses, 0); // Images each pass reads that haven't been written yet
+	for (int p = 0; p < numPasses; ++p)
+	{
+		for (int read : passes[p].reads)
+		{
+			if (read != PostProcessGraph::SceneResource)  ++numWaiting[p];
+		}
+	}
+	std::vector<bool> done(numPasses, false);
+	while (static_cast<int>(order.size()) < numPasses)
+	{
+		int next = 0;
+		while (next < numPasses && (done[next] || numWaiting[next] > 0))  ++next;
+		if (next == numPasses)  return false; // Cycle
+
+		done[next] = true;
+		order.push_back(next);
+		for (int p = 0; p < numPasses; ++p)
+		{
+			for (int read : passes[p].reads)
+			{
+				if (read == passes[next].write)  --numWaiting[p];
+			}
+		}
+	}
+
+
+	// Passes that leave the image unchanged are dropped - their readers read the pass's input instead. Chains of them
+	// are followed back to the first real image (there are no cycles by now)
+	auto resolve = [&](int resource)
+	{
+		while (resource != PostProcessGraph::SceneResource && passes[writer[resource]].identity)
+		{
+			resource = passes[writer[resource]].reads[0];
+		}
+		return resource;
+	};
+	compiled.output = resolve(graph.Output());
+
+
+	// Work back from the output, keeping only the passes that write an image something later needs
+	std::vector<bool> needed(numResources, false);
+	std::vector<bool> keep(numPasses, false);
+	needed[compiled.output] = true;
+	for (int o = numPasses - 1; o >= 0; --o)
+	{
+		int p = order[o];
+		if (passes[p].identity || !needed[passes[p].write])  continue;
+
+		keep[p] = true;
+		for (int read : passes[p].reads)  needed[resolve(read)] = true;
+	}
+
+	for (int p : order)
+	{
+		if (!keep[p])  continue;
+
+		PostProcessPass pass = passes[p];
+		for (int& read : pass.reads)  read = resolve(read);
+		compiled.passes.push_back(pass);
+	}
+	compiled.numRemoved = numPasses - static_cast<int>(compiled.passes.size());
+
+
+	// Each image is finished with after the last pass reading it, apart from the output which is shown on screen
+	int numCompiled = static_cast<int>(compiled.passes.size());
+	std::vector<int> lastRead(numResources, -1);
+	for (int p = 0; p < numCompiled; ++p)
+	{
+		for (int read : compiled.passes[p].reads)  lastRead[read] = p;
+	}
+	compiled.releaseAfter.resize(numCompiled);
+	for (int resource = 0; resource < numResources; ++resource)
+	{
+		if (lastRead[resource] >= 0 && resource != compiled.output)
+		{
+			compiled.releaseAfter[lastRead[resource]].push_back(resource);
+		}
+	}
+
+	// A pass can only update its input in place if nothing after it reads the input too
+	for (int p = 0; p < numCompiled; ++p)
+	{
+		PostProcessPass& pass = compiled.passes[p];
+		pass.inPlace = pass.inPlace && lastRead[pass.reads[0]] == p && pass.reads[0] != compiled.output;
+		if (pass.type == PostProcessPassType::Polygon && !pass.inPlace)  ++compiled.numCopies;
+	}
+	return true;
+}
+
+
+// Get the compiled graph for a post-process list, compiling it first if the list has changed since the last call
+const CompiledPostProcessGraph& PostProcessGraphCache::Get(const std::vector<ProcessAndMode>& postProcessList)
+{
+	bool listMatches = mValid && postProcessList.size() == mPostProcessList.size();
+	for (size_t i = 0; listMatches && i < postProcessList.size(); ++i)
+	{
+		listMatches = postProcessList[i].process == mPostProcessList[i].process &&
+		              postProcessList[i].mode    == mPostProcessList[i].mode;
+	}
+	if (listMatches)  return mGraph;
+
+	// A graph built from a list is always valid, but if it ever wasn't show the scene untouched rather than a broken graph
+	if (!CompilePostProcessGraph(BuildPostProcessGraph(postProcessList), mGraph))
+	{
+		mGraph = CompiledPostProcessGraph();
+	}
+	mPostProcessList = postProcessList;
+	mValid = true;
+	++mNumCompiles;
+	return mGraph;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Running
+//--------------------------------------------------------------------------------------
+
+// Run a compiled graph, taking targets from the pool as they are written and handing them back after their last read
+bool RunPostProcessGraph(const CompiledPostProcessGraph& graph, RenderTargetPool& pool, const RenderTargetDesc& sceneDesc,
+                         int sceneSlot, bool finalToScreen, const RunPostProcessPass& runPass, int& finalSlot)
+{
+	std::vector<int> slots(graph.numResources, -1);
+	slots[PostProcessGraph::SceneResource] = sceneSlot;
+
+	// Everything left in the graph feeds the output, so the pass writing it is always the last
+	std::vector<int> inputs;
+	for (size_t p = 0; p < graph.passes.size(); ++p)
+	{
+		const PostProcessPass& pass = graph.passes[p];
+		inputs.clear();
+		for (int read : pass.reads)  inputs.push_back(slots[read]);
+
+		// An in-place pass writes over its input's target, which then holds the new image
+		bool toScreen = finalToScreen && pass.write == graph.output;
+		if (toScreen)
+		{
+			slots[pass.write] = SCREEN_OUTPUT_SLOT;
+		}
+		else if (pass.inPlace)
+		{
+			slots[pass.write] = slots[pass.reads[0]];
+			slots[pass.reads[0]] = -1;
+		}
+		else
+		{
+			slots[pass.write] = pool.Acquire(sceneDesc);
+		}
+		if (!runPass(pass, inputs, slots[pass.write]))
+		{
+			for (int slot : slots)  pool.Release(slot);
+			finalSlot = -1;
+			return false;
+		}
+
+		for (int resource : graph.releaseAfter[p])
+		{
+			pool.Release(slots[resource]);
+			slots[resource] = -1;
+		}
+	}
+	finalSlot = slots[graph.output];
+	return true;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Counting
+//--------------------------------------------------------------------------------------
+
+// Work out the draws needed to run a compiled graph on a screen of the given size, without a GPU
+PostProcessDrawStats EstimatePostProcessDraws(const CompiledPostProcessGraph& graph, int width, int height, bool finalToScreen)
+{
+	PostProcessDrawStats stats;
+	uint64_t screenPixels = static_cast<uint64_t>(width) * height;
+	for (auto& pass : graph.passes)
+	{
+		stats.numPasses++;
+
+		// Screen sized draws writing the pass output - a polygon pass copies its input first unless it runs in place
+		bool toScreen = finalToScreen && pass.write == graph.output;
+		bool copies = pass.type == PostProcessPassType::Polygon && (!pass.inPlace || toScreen);
+		int numOutputDraws = copies ? 2 : 1;
+
+		// Without finalToScreen each of them is repeated to the back buffer, with it only the final pass writes there
+		int numDraws = finalToScreen ? numOutputDraws : 2 * numOutputDraws;
+		int numScreenDraws = (!finalToScreen || pass.write == graph.output) ? numOutputDraws : 0;
+
+		stats.numDraws += numDraws;
+		stats.numScreenDraws += numScreenDraws;
+		stats.pixelsFilled += numDraws * screenPixels;
+
+		// The bloom chain - threshold into the top level, down to the smallest and back up again
+		if (pass.type == PostProcessPassType::Bloom)
+		{
+			for (int level = 0; level < NUM_BLOOM_LEVELS; ++level)
+			{
+				int levelWidth, levelHeight;
+				BloomLevelSize(level, width, height, levelWidth, levelHeight);
+				int numLevelDraws = (level < NUM_BLOOM_LEVELS - 1) ? 2 : 1;
+				stats.numDraws += numLevelDraws;
+				stats.pixelsFilled += numLevelDraws * static_cast<uint64_t>(levelWidth) * levelHeight;
+			}
+		}
+	}
+	return stats;
+}
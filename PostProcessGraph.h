@@ -0,0 +1,174 @@
+//--------------------------------------------------------------------------------------
+// Post-processing render graph
+//--------------------------------------------------------------------------------------
+// The post-process list is turned into a small graph before it is run. Each pass declares the images it reads and the
+// image it writes, and each image is written by exactly one pass (resource 0 is the rendered scene). Compiling the graph:
+// - removes passes that leave the image unchanged (Copy or None entries), pointing their readers at the original
+// - culls passes whose results never reach the final image
+// - orders the remaining passes so every image is written before it is read
+// - works out when each image is finished with, so its render target can go back to the pool (see RenderTargetPool.h)
+// Polygon passes only cover part of the screen, so where nothing else reads their input they update it in place - only
+// the pixels inside the polygon's screen bounds are touched (see PixelRect in PostProcess.h). The only copies left are
+// for polygon passes whose input is still needed later, or that draw the final image. The final pass draws straight to
+// the screen, so no other pass touches the back buffer (PostProcessDrawStats counts the draws to check this).
+//
+// The compiled graph depends only on the post-process list, so it is cached until the list changes
+// (PostProcessGraphCache). Used by RenderScene and the CPU engine, so both run exactly the same passes.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _POST_PROCESS_GRAPH_H_INCLUDED_
+#define _POST_PROCESS_GRAPH_H_INCLUDED_
+
+#include "PostProcess.h"
+#include "RenderTargetPool.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Graph declaration
+//--------------------------------------------------------------------------------------
+
+// How a pass is run
+enum class PostProcessPassType
+{
+	Polygon,    // One or more polygon entries (a batch, see PolygonBatch.h) - draws each effect inside its polygon over
+	            // the input (or a copy of it)
+	FullScreen, // One full-screen entry
+	Fused,      // Several full-screen entries in one pass (see PostProcessFusion.h)
+	Bloom,      // One Bloom1 entry, running the whole bloom chain
+};
+
+struct PostProcessPass
+{
+	PostProcessPassType type;
+	std::vector<int>    entries;  // Indexes of the post-process list entries run by the pass
+	std::vector<int>    reads;    // Images read by the pass, the first is the one being processed
+	int                 write;    // Image written by the pass
+	bool                identity; // The pass leaves the image unchanged (a Copy or None entry)
+	bool                inPlace = false; // The pass only changes part of the image, so it can update its input's target
+	                                     // rather than copying it - cleared when compiling if the input is read again later
+};
+
+
+class PostProcessGraph
+{
+public:
+	// The rendered scene, always image 0
+	static const int SceneResource = 0;
+
+	// Add an image to the graph, returns its number. All images are screen sized
+	int AddResource()  { return mNumResources++; }
+
+	// Declare a pass, returns its number
+	int AddPass(const PostProcessPass& pass);
+
+	// Choose the image shown on screen, the scene if not set
+	void SetOutput(int resource)  { mOutput = resource; }
+
+	int NumResources() const  { return mNumResources; }
+	const std::vector<PostProcessPass>& Passes() const  { return mPasses; }
+	int Output() const  { return mOutput; }
+
+private:
+	int mNumResources = 1;
+	std::vector<PostProcessPass> mPasses;
+	int mOutput = SceneResource;
+};
+
+
+// Declare the passes for a post-process list in the order RenderScene has always run them: polygon entries first (with
+// runs of batchable windows drawn together), then the full-screen entries (with runs of per-pixel effects fused), then
+// bloom. Area entries are left out
+PostProcessGraph BuildPostProcessGraph(const std::vector<ProcessAndMode>& postProcessList);
+
+
+
+//--------------------------------------------------------------------------------------
+// Compiling
+//--------------------------------------------------------------------------------------
+
+struct CompiledPostProcessGraph
+{
+	std::vector<PostProcessPass>  passes;       // Passes to run, in order
+	std::vector<std::vector<int>> releaseAfter; // For each pass, the images that are finished with once it has run
+	int numResources = 1;
+	int output = PostProcessGraph::SceneResource; // Image holding the final result
+
+	int numDeclared = 0; // Passes declared in the graph
+	int numRemoved  = 0; // Passes removed because they left the image unchanged or their result was never used
+	int numCopies   = 0; // Passes that have to copy their input first (polygon passes that can't run in place)
+};
+
+// Compile a graph ready to run. Returns false if the graph can't be run - an image written twice, an image read that
+// is never written, or a cycle
+bool CompilePostProcessGraph(const PostProcessGraph& graph, CompiledPostProcessGraph& compiled);
+
+
+// Keeps the compiled graph for the last post-process list seen, so the graph is only built and compiled again when the
+// list changes
+class PostProcessGraphCache
+{
+public:
+	// Get the compiled graph for a post-process list, compiling it first if the list has changed since the last call
+	const CompiledPostProcessGraph& Get(const std::vector<ProcessAndMode>& postProcessList);
+
+	// Number of times a graph has been compiled
+	int NumCompiles() const  { return mNumCompiles; }
+
+private:
+	std::vector<ProcessAndMode> mPostProcessList;
+	CompiledPostProcessGraph    mGraph;
+	bool mValid = false;
+	int  mNumCompiles = 0;
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Running
+//--------------------------------------------------------------------------------------
+
+// Output slot given to the final pass when it writes straight to the screen rather than a target from the pool
+const int SCREEN_OUTPUT_SLOT = -1;
+
+// Function running one pass - given the pass, the pool slots of the images it reads and the slot to write. Return false
+// to stop the graph (e.g. a render target couldn't be created)
+using RunPostProcessPass = std::function<bool(const PostProcessPass& pass, const std::vector<int>& inputs, int output)>;
+
+// Run a compiled graph. Each image is given a screen sized target from the pool just before the pass writing it runs,
+// and the target goes back to the pool after the last pass reading it. sceneSlot is the pool slot holding the scene.
+// If finalToScreen is true the final pass is given SCREEN_OUTPUT_SLOT to write to instead of a target, otherwise
+// finalSlot is set to the slot holding the final image, which the caller hands back to the pool once it has been used.
+// An in-place pass (other than one drawing to the screen) is given its input's slot as its output, and the image it
+// writes takes over that target.
+// Returns false if a pass failed (all the graph's targets are handed back)
+bool RunPostProcessGraph(const CompiledPostProcessGraph& graph, RenderTargetPool& pool, const RenderTargetDesc& sceneDesc,
+                         int sceneSlot, bool finalToScreen, const RunPostProcessPass& runPass, int& finalSlot);
+
+
+
+//--------------------------------------------------------------------------------------
+// Counting
+//--------------------------------------------------------------------------------------
+
+// Draw calls made by post-processing in a frame and the pixels they write
+struct PostProcessDrawStats
+{
+	int      numPasses       = 0; // Graph passes run
+	int      numDraws        = 0; // Draw calls, including those inside a pass (the bloom chain, a polygon's copy)
+	int      numScreenDraws  = 0; // Draw calls writing to the back buffer
+	uint64_t pixelsFilled    = 0; // Pixels covered by all the draws
+};
+
+// Work out the draws needed to run a compiled graph on a screen of the given size, without a GPU. With finalToScreen
+// only the final pass writes to the screen, otherwise every pass is drawn a second time to the back buffer as the
+// passes used to be. Polygon draws are counted as covering the whole screen, as their size depends on the camera, so
+// the pixel count is an upper bound when there are polygon passes. A polygon pass running in place is one draw, other
+// polygon passes copy their input with a second (a polygon batch split into several draws still counts as one)
+PostProcessDrawStats EstimatePostProcessDraws(const CompiledPostProcessGraph& graph, int width, int height, bool finalToScreen);
+
+
+#endif //_POST_PROCESS_GRAPH_H_INCLUDED_
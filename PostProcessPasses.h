@@ -0,0 +1,1064 @@
+//--------------------------------------------------------------------------------------
+// Post-processing passes
+//--------------------------------------------------------------------------------------
+// The post-processing part of RenderScene - the functions drawing each kind of pass of the compiled graph
+// (PostProcessGraph.h): full-screen effects, fused runs of effects and their colour lookup tables, the bloom chain, area
+// effects and polygon windows, singly or in batches. They own what post-processing keeps between frames - the render
+// target pool and its textures, the constant block tracker, the fused shaders and the colour lookup tables - and set
+// every state they need through a StateFilter (StateCache.h).
+//
+// Like the filter, the passes are a template on an "API" struct, so the same code drives the DirectX context in the
+// app (D3D11PostProcessApi in Scene.cpp) and a RecordingContext when the calls are counted against budgets without a
+// GPU (FrameBudget.cpp). As well as the filter's types the struct gives:
+//   Resource, Texture2D, Texture3D, Box           - resource types and the box used by CopySubresourceRegion
+//   PostProcessShader                             - an effect compiled in each ShaderVariant, PixelShader* Get(variant)
+//   PassTiming                                    - times a pass from construction to the end of its scope, given its name
+//   TRIANGLE_STRIP                                - the PrimitiveTopology of the post-process quads and polygons
+//   void* Map(Context*, Buffer*), Unmap(Context*, Buffer*)
+//                                                 - map a dynamic buffer for writing (discarding its contents), nullptr
+//                                                   on failure
+//   bool CreateRenderTarget(slot, desc, PostProcessTarget<Api>&)
+//                                                 - create the texture and views of a pool slot, false on failure
+//   PixelShader* CreateFusedShader(stages, variant)
+//                                                 - generate and compile a fused pass shader, nullptr on failure
+//   bool CreateColourLutTexture(size, texels, PostProcessColourLut<Api>&)
+//                                                 - create a 3D lookup table texture and its view holding the texels
+//   Release(object)                               - release an object created above, ignoring nullptr
+// Draws, copies and texture updates are made directly on the filter's context.
+//
+// The caller owns the post-process list, its settings and the constants structure, and fills in the objects the passes
+// draw with (PostProcessObjects) before each frame.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _POST_PROCESS_PASSES_H_INCLUDED_
+#define _POST_PROCESS_PASSES_H_INCLUDED_
+
+#include "PostProcess.h"
+#include "PostProcessGraph.h"
+#include "PostProcessFusion.h"
+#include "RenderTargetPool.h"
+#include "ConstantBlocks.h"
+#include "ColourLut.h"
+#include "PolygonBatch.h"
+#include "ScreenProjection.h"
+#include "StateCache.h"
+
+#include "CVector2.h"
+#include "CVector4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Objects
+//--------------------------------------------------------------------------------------
+
+// A render target from the pool. The slot numbers given out by the pool index the list of these
+template <typename Api>
+struct PostProcessTarget
+{
+	typename Api::Texture2D*          texture      = nullptr; // The memory used by the texture on the GPU
+	typename Api::RenderTargetView*   renderTarget = nullptr; // Used when rendering to the texture
+	typename Api::ShaderResourceView* textureSRV   = nullptr; // Gives shaders access to the texture
+};
+
+// The colour lookup table of a fused pass (see ColourLut.h). The 3D texture is only refilled when the cache rebakes
+// the table
+template <typename Api>
+struct PostProcessColourLut
+{
+	ColourLutCache                    cache;
+	int                               size = 0;
+	typename Api::Texture3D*          texture = nullptr;
+	typename Api::ShaderResourceView* textureSRV = nullptr;
+};
+
+// The shaders, states, textures and buffers the passes draw with. They belong to the caller, which fills them in before
+// each frame - shaders and textures can be swapped while running (hot reload, textures finishing loading)
+template <typename Api>
+struct PostProcessObjects
+{
+	typename Api::RenderTargetView* backBuffer        = nullptr;
+	typename Api::Resource*         backBufferTexture = nullptr; // Read by the scratch copies of passes drawing to the screen
+	typename Api::DepthStencilView* depthStencil      = nullptr;
+
+	typename Api::VertexShader* quadVertexShader         = nullptr; // 2DQuad_pp
+	typename Api::VertexShader* polygonVertexShader      = nullptr; // 2DPolygon_pp
+	typename Api::VertexShader* polygonBatchVertexShader = nullptr; // 2DPolygonBatch_pp
+
+	typename Api::PixelShader*       copyShader = nullptr;
+	typename Api::PostProcessShader* effectShaders[NUM_POST_PROCESSES] = {}; // Indexed by PostProcess, None and Copy unused
+	typename Api::PostProcessShader* colourLutShader = nullptr;
+	typename Api::PixelShader*       bloomThresholdShader = nullptr;
+	typename Api::PixelShader*       bloomDownsampleShader = nullptr;
+	typename Api::PixelShader*       bloomUpsampleShader = nullptr;
+	typename Api::PostProcessShader* bloomCompositeShader = nullptr;
+	typename Api::PixelShader*       polygonBatchShader = nullptr;
+
+	typename Api::BlendState*        noBlendingState       = nullptr;
+	typename Api::BlendState*        additiveBlendingState = nullptr;
+	typename Api::BlendState*        alphaBlendingState    = nullptr;
+	typename Api::DepthStencilState* depthReadOnlyState    = nullptr;
+	typename Api::DepthStencilState* noDepthBufferState    = nullptr;
+	typename Api::RasterizerState*   cullNoneState         = nullptr;
+	typename Api::RasterizerState*   cullNoneScissorState  = nullptr;
+	typename Api::SamplerState*      pointSampler          = nullptr;
+	typename Api::SamplerState*      bilinearClampSampler  = nullptr;
+	typename Api::SamplerState*      trilinearSampler      = nullptr;
+
+	// Additional textures used for specific post-processes
+	typename Api::ShaderResourceView* noiseMapSRV   = nullptr;
+	typename Api::ShaderResourceView* burnMapSRV    = nullptr;
+	typename Api::ShaderResourceView* distortMapSRV = nullptr;
+
+	// One buffer for each block of the constants (see ConstantBlocks.h), the windows of a polygon batch and the constant
+	// buffer giving each draw of a batch its first window (see PolygonBatch.h)
+	typename Api::Buffer*             constantBuffers[NUM_POST_PROCESS_CONSTANT_BLOCKS] = {};
+	typename Api::Buffer*             polygonBatchBuffer         = nullptr;
+	typename Api::ShaderResourceView* polygonBatchBufferSRV      = nullptr;
+	typename Api::Buffer*             polygonBatchConstantBuffer = nullptr;
+};
+
+// Work done by the passes in a frame
+struct PostProcessPassStats
+{
+	PostProcessDrawStats draws;                   // Only the final pass should write the back buffer
+	int numColourLutPasses      = 0;              // Fused passes that used a colour lookup table
+	int numPolygonWindows       = 0;              // Polygon windows drawn and the draws used for them
+	int numPolygonDraws         = 0;
+	int numPolygonWindowsCulled = 0;              // Batched windows left out as they were off screen
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Passes
+//--------------------------------------------------------------------------------------
+
+template <typename Api>
+class PostProcessPasses
+{
+public:
+	using Target = PostProcessTarget<Api>;
+
+	// The state filter must have its context set. The list, settings and constants stay owned by the caller
+	PostProcessPasses(StateFilter<Api>& stateFilter, const std::vector<ProcessAndMode>& postProcessList,
+	                  std::vector<Constants>& constantsList, PostProcessingConstants& constants)
+		: mStateFilter(stateFilter), mPostProcessList(postProcessList), mConstantsList(constantsList), mConstants(constants)
+	{
+	}
+
+	~PostProcessPasses()  { Release(); }
+
+	PostProcessPasses(const PostProcessPasses&) = delete;
+	PostProcessPasses& operator=(const PostProcessPasses&) = delete;
+
+
+	//-------------------------------------
+	// Set-up
+	//-------------------------------------
+
+	PostProcessObjects<Api> objects;
+
+	// Size of the colour lookup tables used by fused passes, 0 to use the fused shaders instead
+	int colourLutSize = 64;
+
+	// Size of the screen. Screen sized textures hold the scene and the result of each post-process pass
+	void SetScreenSize(int width, int height)
+	{
+		mWidth = width;
+		mHeight = height;
+		mSceneTargetDesc.width = width;
+		mSceneTargetDesc.height = height;
+		mSceneTargetDesc.format = RenderTargetFormat::RGBA8;
+	}
+	const RenderTargetDesc& SceneTargetDesc() const  { return mSceneTargetDesc; }
+
+	// Textures come from a pool (see RenderTargetPool.h) - each pass takes a texture to render to and hands back the one
+	// it read when it has finished, so images that aren't needed at the same time share the same memory
+	RenderTargetPool& TargetPool()  { return mRenderTargetPool; }
+
+	// Get the render target for a slot given out by the pool, creating it the first time the slot is used. Returns
+	// nullptr if the render target can't be created
+	Target* GetRenderTarget(int slot)
+	{
+		if (slot < 0)  return nullptr;
+		if (slot >= static_cast<int>(mRenderTargets.size()))
+		{
+			mRenderTargets.resize(slot + 1);
+		}
+
+		Target& target = mRenderTargets[slot];
+		if (target.texture == nullptr && !Api::CreateRenderTarget(slot, mRenderTargetPool.Desc(slot), target))
+		{
+			Api::Release(target.textureSRV);
+			Api::Release(target.renderTarget);
+			Api::Release(target.texture);
+			target = Target();
+			return nullptr;
+		}
+		return &target;
+	}
+
+	// Release the fused pass shaders, they are generated again when next needed
+	void ReleaseFusedShaders()
+	{
+		for (auto& fusedShaders : mFusedShaders)
+		{
+			for (auto& fusedShader : fusedShaders)  Api::Release(fusedShader.second);
+			fusedShaders.clear();
+		}
+	}
+
+	// Release everything created by the passes
+	void Release()
+	{
+		for (auto& target : mRenderTargets)
+		{
+			Api::Release(target.textureSRV);
+			Api::Release(target.renderTarget);
+			Api::Release(target.texture);
+		}
+		mRenderTargets.clear();
+		mRenderTargetPool.Clear();
+
+		ReleaseFusedShaders();
+
+		for (auto& colourLut : mColourLuts)
+		{
+			Api::Release(colourLut.second.textureSRV);
+			Api::Release(colourLut.second.texture);
+		}
+		mColourLuts.clear();
+		mConstantBlocks.Reset();
+	}
+
+
+	//-------------------------------------
+	// Frame
+	//-------------------------------------
+
+	// Start a frame, clearing the counts
+	void NewFrame()
+	{
+		mStats = PostProcessPassStats();
+		mConstantBlocks.NewFrame();
+	}
+
+	// Run the passes of a compiled graph on the scene held in the given pool slot, the final pass drawing to the back
+	// buffer. clipPoints are the corners of the polygon entries in clip space (from Camera::ProjectToScreen), four per
+	// post-process index. screenPoints are the same corners on the screen, batched windows entirely off screen are left
+	// out - pass nullptr to draw every window. Returns false if a pass failed
+	bool Render(const CompiledPostProcessGraph& graph, int sceneSlot, const CVector4* clipPoints,
+	            const ScreenPoints* screenPoints, float frameTime)
+	{
+		int finalSlot;
+		return RunPostProcessGraph(graph, mRenderTargetPool, mSceneTargetDesc, sceneSlot, true,
+			[&](const PostProcessPass& pass, const std::vector<int>& inputs, int output)
+			{
+				if (output != SCREEN_OUTPUT_SLOT && GetRenderTarget(output) == nullptr)  return false;
+
+				mStats.draws.numPasses++;
+				int i = pass.entries[0];
+				mConstants.IsFullScreen = (pass.type != PostProcessPassType::Polygon);
+				switch (pass.type)
+				{
+					case PostProcessPassType::Polygon:
+						if (IsBatchablePolygonEffect(mPostProcessList[i].process))
+						{
+							return PolygonBatchPostProcess(pass.entries, clipPoints, screenPoints, frameTime, inputs[0], output);
+						}
+						mStats.numPolygonWindows++;
+						mStats.numPolygonDraws++;
+						return PolygonPostProcess(mPostProcessList[i].process, clipPoints + i * 4, frameTime, i, inputs[0], output);
+
+					case PostProcessPassType::Fused:
+						return FusedPostProcess(pass.entries, frameTime, inputs[0], output);
+
+					case PostProcessPassType::Bloom:
+						return BloomPostProcess(frameTime, i, inputs[0], output);
+
+					default:
+						FullScreenPostProcess(mPostProcessList[i].process, frameTime, i, inputs[0], output);
+						return true;
+				}
+			}, finalSlot);
+	}
+
+
+	//-------------------------------------
+	// Counting
+	//-------------------------------------
+
+	const PostProcessPassStats& FrameStats() const  { return mStats; }
+
+	// Constant blocks sent this frame (see ConstantBlocks.h)
+	const ConstantBlockTracker& ConstantBlocks() const  { return mConstantBlocks; }
+
+	// Times the colour lookup tables have been baked
+	int NumColourLutBakes() const
+	{
+		int numBakes = 0;
+		for (auto& colourLut : mColourLuts)  numBakes += colourLut.second.cache.NumBakes();
+		return numBakes;
+	}
+
+
+	//-------------------------------------
+	// Passes
+	//-------------------------------------
+
+	// Send the blocks of the constants read by the next draw's shaders to the GPU (see ConstantBlocks.h), skipping any
+	// that haven't changed since they were last sent, then select the buffers for the shaders. blocks is a set of
+	// ConstantBlockBit values
+	void SendPostProcessConstants(unsigned int blocks)
+	{
+		mConstantBlocks.CountRequest();
+		for (int b = 0; b < NUM_POST_PROCESS_CONSTANT_BLOCKS; ++b)
+		{
+			auto block = static_cast<PostProcessConstantBlock>(b);
+			if ((blocks & ConstantBlockBit(block)) == 0 || !mConstantBlocks.NeedsUpload(block, mConstants))  continue;
+
+			size_t offset, size;
+			PostProcessConstantBlockRange(block, offset, size);
+			void* mappedBuffer = Api::Map(Context(), objects.constantBuffers[b]);
+			if (mappedBuffer == nullptr)
+			{
+				mConstantBlocks.Invalidate(block);
+				continue;
+			}
+			std::memcpy(mappedBuffer, reinterpret_cast<const char*>(&mConstants) + offset, size);
+			Api::Unmap(Context(), objects.constantBuffers[b]);
+		}
+
+		// The area block is register b1 (the vertex shaders read it too), the rest follow on from b3
+		mStateFilter.VSSetConstantBuffers(1, 1, &objects.constantBuffers[0]);
+		mStateFilter.PSSetConstantBuffers(1, 1, &objects.constantBuffers[0]);
+		mStateFilter.PSSetConstantBuffers(3, NUM_POST_PROCESS_CONSTANT_BLOCKS - 1, &objects.constantBuffers[1]);
+	}
+
+
+	// Perform a full-screen post process from the input texture to the output texture (or the back buffer)
+	void FullScreenPostProcess(PostProcess postProcess, float frameTime, int i, int input, int output)
+	{
+		typename Api::PassTiming timing(PostProcessName(postProcess));
+
+		// Not going to clear the target because we're going to overwrite it all
+		SelectPostProcessTargets(input, output);
+		DrawFullScreenPostProcess(postProcess, frameTime, i);
+	}
+
+
+	// Perform a full-screen pass that runs several per-pixel post-processes one after another (see PostProcessFusion.h).
+	// entries are the indexes of the post-processes in the list. If every effect only depends on the pixel colour (apart
+	// from tints at either end) the pass uses a baked colour lookup table instead (see ColourLut.h). Falls back to one
+	// pass per entry if the fused shader can't be compiled, with the images in between taken from the pool. Returns
+	// false if one of those couldn't be created
+	bool FusedPostProcess(const std::vector<int>& entries, float frameTime, int input, int output)
+	{
+		std::vector<PostProcess> stages;
+		std::string passName = "Fused:";
+		for (int i : entries)
+		{
+			stages.push_back(mPostProcessList[i].process);
+			passName += std::string(" ") + PostProcessName(mPostProcessList[i].process);
+		}
+		typename Api::PassTiming timing(passName);
+
+		ShaderVariant variant = PostProcessShaderVariant(mConstants);
+		typename Api::PixelShader* fusedShader = GetFusedPostProcessShader(stages, variant);
+		if (fusedShader == nullptr)
+		{
+			int source = input;
+			for (size_t stage = 0; stage < entries.size(); ++stage)
+			{
+				int target = (stage + 1 == entries.size()) ? output : mRenderTargetPool.Acquire(mSceneTargetDesc);
+				bool targetReady = target == SCREEN_OUTPUT_SLOT || GetRenderTarget(target) != nullptr;
+				if (targetReady)
+				{
+					FullScreenPostProcess(mPostProcessList[entries[stage]].process, frameTime, entries[stage], source, target);
+				}
+				if (source != input)  mRenderTargetPool.Release(source);
+				if (!targetReady)
+				{
+					if (target != output)  mRenderTargetPool.Release(target);
+					return false;
+				}
+				source = target;
+			}
+			return true;
+		}
+
+		PreparePostProcessDraw();
+		SelectPostProcessTargets(input, output);
+
+		// Prepare the settings of every stage, then send them all over in one go
+		for (int stage = 0; stage < static_cast<int>(entries.size()); ++stage)
+		{
+			int i = entries[stage];
+			UpdatePostProcessConstants(mPostProcessList[i].process, mConstantsList[i], frameTime, mWidth, mHeight, mConstants);
+			SetFusedStageConstants(stage, mPostProcessList[i].process, mConstants);
+		}
+
+		// Use a colour lookup table if the stages allow it
+		ColourLutPlan lutPlan;
+		typename Api::ShaderResourceView* lutSRV = nullptr;
+		if (colourLutSize > 0 && PlanColourLut(stages, mConstants, lutPlan))
+		{
+			lutSRV = GetColourLutTexture(entries[0], stages, lutPlan);
+		}
+		if (lutSRV != nullptr)
+		{
+			SetColourLutConstants(lutPlan, colourLutSize, mConstants);
+			mStateFilter.PSSetShader(objects.colourLutShader->Get(variant), nullptr, 0);
+			mStateFilter.PSSetShaderResources(1, 1, &lutSRV);
+			mStateFilter.PSSetSamplers(1, 1, &objects.bilinearClampSampler);
+			mStats.numColourLutPasses++;
+		}
+		else
+		{
+			mStateFilter.PSSetShader(fusedShader, nullptr, 0);
+		}
+
+		SendPostProcessConstants(FusedPassConstantBlocks());
+
+		// Draw a quad
+		DrawPostProcess(ScreenPixels());
+		return true;
+	}
+
+
+	// Perform the bloom effect for post-process list entry i using the bloom chain (see PostProcess.h). Reads the input
+	// texture and writes the output as a single full-screen post-process would. The chain textures come from the pool
+	// and are handed back as soon as each level has been added onto the one above. Returns false if they couldn't be
+	// created
+	bool BloomPostProcess(float frameTime, int i, int input, int output)
+	{
+		typename Api::PassTiming timing("Bloom");
+
+		int levels[NUM_BLOOM_LEVELS];
+		for (int level = 0; level < NUM_BLOOM_LEVELS; ++level)
+		{
+			levels[level] = mRenderTargetPool.Acquire(BloomLevelDesc(level, mSceneTargetDesc));
+			if (GetRenderTarget(levels[level]) == nullptr)
+			{
+				for (int acquired = 0; acquired <= level; ++acquired)  mRenderTargetPool.Release(levels[acquired]);
+				return false;
+			}
+		}
+
+		mStateFilter.VSSetShader(objects.quadVertexShader, nullptr, 0);
+		mStateFilter.GSSetShader(nullptr, nullptr, 0);
+
+		// States - no blending and ignore back-face culling. The smaller levels can't use the depth buffer (it is screen sized)
+		mStateFilter.OMSetBlendState(objects.noBlendingState, nullptr, 0xffffff);
+		mStateFilter.OMSetDepthStencilState(objects.noDepthBufferState, 0);
+		mStateFilter.RSSetState(objects.cullNoneState);
+		mStateFilter.IASetInputLayout(nullptr);
+		mStateFilter.IASetPrimitiveTopology(Api::TRIANGLE_STRIP);
+
+		mStateFilter.PSSetSamplers(0, 1, &objects.pointSampler);
+		mStateFilter.PSSetSamplers(1, 1, &objects.bilinearClampSampler);
+
+		// Every pass covers the whole of its target
+		UpdatePostProcessConstants(PostProcess::Bloom1, mConstantsList[i], frameTime, mWidth, mHeight, mConstants);
+		mConstants.area2DTopLeft = { 0, 0 };
+		mConstants.area2DSize = { 1, 1 };
+		mConstants.area2DDepth = 0;
+		SendPostProcessConstants(PostProcessConstantBlocks(PostProcess::Bloom1));
+		ShaderVariant variant = PostProcessShaderVariant(mConstants);
+
+		typename Api::ShaderResourceView* sceneSRV = mRenderTargets[input].textureSRV;
+		typename Api::ShaderResourceView* nullSRV = nullptr;
+
+		// Draw a quad into one level of the chain reading the given texture. step names the draw for the pass timings
+		auto drawLevel = [&](int level, typename Api::ShaderResourceView* source, typename Api::PixelShader* shader, const char* step)
+		{
+			typename Api::PassTiming levelTiming(std::string("Bloom ") + step + " (level " + std::to_string(level) + ")");
+
+			int levelWidth, levelHeight;
+			BloomLevelSize(level, mWidth, mHeight, levelWidth, levelHeight);
+			SetViewport(levelWidth, levelHeight);
+
+			mStateFilter.PSSetShaderResources(0, 1, &nullSRV);
+			mStateFilter.OMSetRenderTargets(1, &mRenderTargets[levels[level]].renderTarget, nullptr);
+			mOutput = levels[level];
+			mStateFilter.PSSetShaderResources(0, 1, &source);
+			mStateFilter.PSSetShader(shader, nullptr, 0);
+			DrawPostProcess(static_cast<uint64_t>(levelWidth) * levelHeight);
+		};
+
+		// Threshold the scene into the half size level, then downsample to the smaller levels
+		drawLevel(0, sceneSRV, objects.bloomThresholdShader, "threshold");
+		for (int level = 1; level < NUM_BLOOM_LEVELS; ++level)
+		{
+			drawLevel(level, mRenderTargets[levels[level - 1]].textureSRV, objects.bloomDownsampleShader, "downsample");
+		}
+
+		// Back up the chain, blurring each level and adding it onto the level above
+		mStateFilter.OMSetBlendState(objects.additiveBlendingState, nullptr, 0xffffff);
+		for (int level = NUM_BLOOM_LEVELS - 1; level > 0; --level)
+		{
+			drawLevel(level - 1, mRenderTargets[levels[level]].textureSRV, objects.bloomUpsampleShader, "upsample");
+			mRenderTargetPool.Release(levels[level]);
+		}
+
+		// Add the blurred bright pixels onto the scene
+		{
+			typename Api::PassTiming compositeTiming("Bloom composite");
+			SetViewport(mWidth, mHeight);
+			mStateFilter.OMSetBlendState(objects.noBlendingState, nullptr, 0xffffff);
+			mStateFilter.OMSetDepthStencilState(objects.depthReadOnlyState, 0);
+			SelectPostProcessTargets(input, output);
+			mStateFilter.PSSetShaderResources(1, 1, &mRenderTargets[levels[0]].textureSRV);
+			mStateFilter.PSSetShader(objects.bloomCompositeShader->Get(variant), nullptr, 0);
+			DrawPostProcess(ScreenPixels());
+		}
+
+		// Unbind the top level so it can be rendered to again without DirectX warnings
+		mStateFilter.PSSetShaderResources(1, 1, &nullSRV);
+		mRenderTargetPool.Release(levels[0]);
+		return true;
+	}
+
+
+	// Perform an area post process from the input texture to the output at a given point in the world, with a given
+	// size (world units). The point is one of a batch already projected to the screen with Camera::ProjectToScreen, so
+	// placing many areas doesn't redo the camera work for each. If input and output are the same target only the area is
+	// updated, otherwise the input is copied to the output first. Returns false if a scratch target couldn't be created
+	bool AreaPostProcess(PostProcess postProcess, const ScreenPoints& screenPoints, int point, CVector2 areaSize,
+	                     float frameTime, int i, int input, int output)
+	{
+		typename Api::PassTiming timing(std::string("Area: ") + PostProcessName(postProcess));
+
+		// First perform a full-screen copy of the input to the output - unless drawing over the input itself, when the
+		// effect reads a scratch copy of the pixels around the area instead
+		int scratch = -1;
+		if (input == output)
+		{
+			scratch = SelectPostProcessScratchInput(output);
+			if (scratch < 0)  return false;
+			PreparePostProcessDraw();
+		}
+		else
+		{
+			FullScreenPostProcess(PostProcess::Copy, frameTime, i, input, output);
+		}
+
+		// Now draw the effect over a portion of the output, relying on the states the copy above set up
+		SelectPostProcessShaderAndTextures(postProcess, frameTime, i);
+
+		// Enable alpha blending - area effects need to fade out at the edges or the hard edge of the area is visible
+		// A couple of the shaders have been updated to put the effect into a soft circle
+		// Alpha blending isn't enabled for fullscreen and polygon effects so it doesn't affect those (except heat-haze, which works a bit differently)
+		mStateFilter.OMSetBlendState(objects.alphaBlendingState, nullptr, 0xffffff);
+
+		// Nothing to do if given 3D point is behind the camera
+		if (!screenPoints.InFront(point))
+		{
+			mRenderTargetPool.Release(scratch);
+			return true;
+		}
+
+		// The 2D position of the 3D point at the centre of the area effect, converted from pixel coordinates to 0->1
+		// coordinates as used by the shader
+		CVector2 area2DCentre = { screenPoints.x[point] / mWidth, screenPoints.y[point] / mHeight };
+
+		// The size of the 2D area we need to cover the world space size requested at the distance of the point, again
+		// converted from pixels to 0->1 coordinates
+		CVector2 area2DSize = screenPoints.PixelSize(point, areaSize);
+		area2DSize.x /= mWidth;
+		area2DSize.y /= mHeight;
+
+		// Send the area top-left and size into the constant buffer - the 2DQuad vertex shader will use this to create a quad in the right place
+		mConstants.area2DTopLeft = area2DCentre - 0.5f * area2DSize; // Top-left of area is centre - half the size
+		mConstants.area2DSize = area2DSize;
+
+		// Depth buffer value of the 3D point, 0->1. This is the projection's z / w - the same as the full calculation from
+		// the Z distance and the camera near/far clip values derived in the Picking lecture. Having the depth allows us to
+		// have area effects behind normal objects
+		mConstants.area2DDepth = screenPoints.depth[point];
+
+		// Drawing in place, copy the pixels around the area for the effect to read. Nothing is drawn if the area is
+		// entirely off screen
+		PixelRect bounds = AreaPixelBounds(mConstants.area2DTopLeft, area2DSize, mWidth, mHeight);
+		if (scratch >= 0)
+		{
+			if (bounds.Empty())
+			{
+				mRenderTargetPool.Release(scratch);
+				return true;
+			}
+			CVector2 readMargin = PostProcessReadMargin(postProcess, mConstants, mWidth, mHeight);
+			CopyPostProcessPixels(mRenderTargets[input].texture, scratch, ExpandPixelRect(bounds, readMargin, mWidth, mHeight));
+			SetPostProcessScissor(bounds);
+		}
+
+		SendPostProcessConstants(PostProcessConstantBlocks(postProcess));
+
+		// Draw a quad
+		DrawPostProcess(bounds.Pixels());
+
+		if (scratch >= 0)
+		{
+			mStateFilter.RSSetState(objects.cullNoneState);
+			mRenderTargetPool.Release(scratch);
+		}
+		return true;
+	}
+
+
+	// Perform a post process from the input texture to the output within the given four-point polygon, its corners
+	// already in clip space (from Camera::ProjectToScreen). If input and output are the same target only the pixels
+	// inside the polygon are updated, otherwise the input is copied to the output first. Returns false if a scratch
+	// target couldn't be created
+	bool PolygonPostProcess(PostProcess postProcess, const CVector4* clipPoints, float frameTime, int i, int input, int output)
+	{
+		typename Api::PassTiming timing(std::string("Window: ") + PostProcessName(postProcess));
+
+		// First perform a full-screen copy of the input to the output texture (or the back buffer) - unless drawing over
+		// the input itself, when the effect reads a scratch copy of the pixels around the polygon instead
+		int scratch = -1;
+		if (input == output)
+		{
+			scratch = SelectPostProcessScratchInput(output);
+			if (scratch < 0)  return false;
+			PreparePostProcessDraw();
+		}
+		else
+		{
+			SelectPostProcessTargets(input, output);
+			DrawFullScreenPostProcess(PostProcess::Copy, frameTime, i);
+		}
+
+		// Now draw the effect over a portion of the output, relying on the states the copy above set up
+		SelectPostProcessShaderAndTextures(postProcess, frameTime, i);
+
+		// The polygon's points in 2D (this is what the vertex shader normally does in most labs)
+		std::copy(clipPoints, clipPoints + 4, mConstants.polygon2DPoints);
+
+		// Drawing in place, copy the pixels around the polygon for the effect to read and scissor to its bounds. Nothing
+		// is drawn if the polygon is entirely off screen
+		if (scratch >= 0)
+		{
+			PixelRect bounds = PolygonPixelBounds(mConstants.polygon2DPoints, mWidth, mHeight);
+			if (bounds.Empty())
+			{
+				mRenderTargetPool.Release(scratch);
+				return true;
+			}
+			CVector2 readMargin = PostProcessReadMargin(postProcess, mConstants, mWidth, mHeight);
+			CopyPostProcessPixels(mRenderTargets[input].texture, scratch, ExpandPixelRect(bounds, readMargin, mWidth, mHeight));
+			SetPostProcessScissor(bounds);
+		}
+
+		// Pass over the polygon points to the shaders (also sends the per-process settings)
+		SendPostProcessConstants(PostProcessConstantBlocks(postProcess));
+
+		// Select the special 2D polygon post-processing vertex shader and draw the polygon
+		mStateFilter.VSSetShader(objects.polygonVertexShader, nullptr, 0);
+		DrawPostProcess(PolygonPixels(mConstants.polygon2DPoints));
+
+		if (scratch >= 0)
+		{
+			mStateFilter.RSSetState(objects.cullNoneState);
+			mRenderTargetPool.Release(scratch);
+		}
+		return true;
+	}
+
+
+	// Perform a batch of polygon post-processes (see PolygonBatch.h) from the input texture to the output texture (or
+	// the back buffer). entries are the indexes of the windows in the post-process list. Every window goes into one
+	// structured buffer and is drawn by a single instanced draw, unless a window reads pixels an earlier one writes, when
+	// the batch is split into a few draws. If input and output are the same target only the pixels inside the windows
+	// are updated, otherwise the input is copied to the output first. clipPoints holds the corners of all the windows,
+	// four per post-process index. Windows entirely off screen in screenPoints are left out, unless it is nullptr.
+	// Returns false if a scratch target couldn't be created
+	bool PolygonBatchPostProcess(const std::vector<int>& entries, const CVector4* clipPoints, const ScreenPoints* screenPoints,
+	                             float frameTime, int input, int output)
+	{
+		typename Api::PassTiming timing("Window batch");
+
+		// Prepare every window that can be seen - its settings, its corners in 2D and the pixels it reads and writes
+		std::vector<PolygonInstance> instances;
+		std::vector<PolygonWindowBounds> windows;
+		for (int i : entries)
+		{
+			if (screenPoints != nullptr && screenPoints->AllOffScreen(i * 4, 4))
+			{
+				mStats.numPolygonWindowsCulled++;
+				continue;
+			}
+			PostProcess postProcess = mPostProcessList[i].process;
+			UpdatePostProcessConstants(postProcess, mConstantsList[i], frameTime, mWidth, mHeight, mConstants);
+			std::copy(clipPoints + i * 4, clipPoints + i * 4 + 4, mConstants.polygon2DPoints);
+			instances.emplace_back();
+			SetPolygonInstance(postProcess, mConstants, instances.back());
+			windows.push_back(GetPolygonWindowBounds(postProcess, mConstants, mWidth, mHeight));
+		}
+		int numWindows = static_cast<int>(instances.size());
+
+		// Send all the windows over in one go
+		void* mappedBuffer = Api::Map(Context(), objects.polygonBatchBuffer);
+		if (mappedBuffer == nullptr)  return false;
+		std::copy(instances.begin(), instances.end(), static_cast<PolygonInstance*>(mappedBuffer));
+		Api::Unmap(Context(), objects.polygonBatchBuffer);
+
+		// First perform a full-screen copy of the input to the output - the first draw can then read the input itself.
+		// Drawing over the input, every draw reads a scratch copy of the pixels around its windows instead
+		if (input != output)
+		{
+			SelectPostProcessTargets(input, output);
+			DrawFullScreenPostProcess(PostProcess::Copy, frameTime, entries[0]);
+		}
+		else
+		{
+			PreparePostProcessDraw();
+		}
+
+		bool succeeded = true;
+		int scratch = -1;
+		typename Api::Resource* outputTexture = (output == SCREEN_OUTPUT_SLOT) ? objects.backBufferTexture
+		                                                                       : mRenderTargets[output].texture;
+		std::vector<int> draws = PlanPolygonBatchDraws(windows);
+		for (size_t draw = 0; draw + 1 < draws.size(); ++draw)
+		{
+			int firstWindow = draws[draw];
+			int endWindow = draws[draw + 1];
+
+			// Later draws (or all of them when in place) read the image left by the draws before
+			if (draw > 0 || input == output)
+			{
+				if (scratch < 0)
+				{
+					scratch = SelectPostProcessScratchInput(output);
+					if (scratch < 0)
+					{
+						succeeded = false;
+						break;
+					}
+				}
+				for (int window = firstWindow; window < endWindow; ++window)
+				{
+					CopyPostProcessPixels(outputTexture, scratch, windows[window].read);
+				}
+			}
+
+			// Only touch the pixels inside the windows of this draw
+			PixelRect drawBounds = windows[firstWindow].draw;
+			uint64_t pixels = 0;
+			for (int window = firstWindow; window < endWindow; ++window)
+			{
+				drawBounds = UnionPixelRect(drawBounds, windows[window].draw);
+				pixels += PolygonPixels(instances[window].points);
+			}
+			SetPostProcessScissor(drawBounds);
+
+			mStateFilter.VSSetShader(objects.polygonBatchVertexShader, nullptr, 0);
+			mStateFilter.PSSetShader(objects.polygonBatchShader, nullptr, 0);
+			mStateFilter.VSSetShaderResources(3, 1, &objects.polygonBatchBufferSRV);
+			mStateFilter.PSSetShaderResources(3, 1, &objects.polygonBatchBufferSRV);
+
+			mPolygonBatchConstants.firstInstance = firstWindow;
+			void* mappedConstants = Api::Map(Context(), objects.polygonBatchConstantBuffer);
+			if (mappedConstants != nullptr)
+			{
+				std::memcpy(mappedConstants, &mPolygonBatchConstants, sizeof(mPolygonBatchConstants));
+				Api::Unmap(Context(), objects.polygonBatchConstantBuffer);
+			}
+			mStateFilter.VSSetConstantBuffers(2, 1, &objects.polygonBatchConstantBuffer);
+
+			DrawPostProcess(pixels, endWindow - firstWindow);
+			mStats.numPolygonDraws++;
+		}
+		mStats.numPolygonWindows += numWindows;
+
+		mStateFilter.RSSetState(objects.cullNoneState);
+		mRenderTargetPool.Release(scratch);
+		return succeeded;
+	}
+
+
+private:
+	typename Api::Context* Context()  { return mStateFilter.GetContext(); }
+
+	// Select the appropriate shader plus any additional textures required for a given post-process
+	// Helper function shared by full-screen, area and polygon post-processing functions above
+	void SelectPostProcessShaderAndTextures(PostProcess postProcess, float frameTime, int i)
+	{
+		// Copy this entry's settings into the constant buffer structure and advance any animation (shared with the CPU engine)
+		if (postProcess != PostProcess::Copy)
+		{
+			UpdatePostProcessConstants(postProcess, mConstantsList[i], frameTime, mWidth, mHeight, mConstants);
+		}
+		ShaderVariant variant = PostProcessShaderVariant(mConstants);
+
+		typename Api::PostProcessShader* effectShader = objects.effectShaders[static_cast<int>(postProcess)];
+		if (postProcess == PostProcess::Copy)  mStateFilter.PSSetShader(objects.copyShader, nullptr, 0);
+		else if (effectShader != nullptr)      mStateFilter.PSSetShader(effectShader->Get(variant), nullptr, 0);
+
+		switch (postProcess)
+		{
+			// Give pixel shader access to the noise texture
+			case PostProcess::GreyNoise:
+				mStateFilter.PSSetShaderResources(1, 1, &objects.noiseMapSRV);
+				mStateFilter.PSSetSamplers(1, 1, &objects.trilinearSampler);
+				break;
+
+			// Give pixel shader access to the burn texture (basically a height map that the burn level ascends)
+			case PostProcess::Burn:
+				mStateFilter.PSSetShaderResources(1, 1, &objects.burnMapSRV);
+				mStateFilter.PSSetSamplers(1, 1, &objects.trilinearSampler);
+				break;
+
+			// Give pixel shader access to the distortion texture (containts 2D vectors (in R & G) to shift the texture UVs to give a cut-glass impression)
+			case PostProcess::Distort:
+				mStateFilter.PSSetShaderResources(1, 1, &objects.distortMapSRV);
+				mStateFilter.PSSetSamplers(1, 1, &objects.trilinearSampler);
+				break;
+
+			// Blur taps can fall between pixels (linear sampling mode), so read the scene with bilinear filtering
+			case PostProcess::BlurH:
+			case PostProcess::BlurV:
+				mStateFilter.PSSetSamplers(1, 1, &objects.bilinearClampSampler);
+				break;
+
+			// The separate copy of the scene Bloom2 used to add onto went with the old bloom passes, use the pass's input
+			case PostProcess::Bloom2:
+				mStateFilter.PSSetShaderResources(1, 1, &mRenderTargets[mInput].textureSRV);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+
+	// Give the pixel shader (slot 0) the texture holding the input image and select the given output as render target.
+	// Both are render target pool slots, the output can also be SCREEN_OUTPUT_SLOT to draw to the back buffer
+	void SelectPostProcessTargets(int input, int output)
+	{
+		typename Api::ShaderResourceView* nullSRV = nullptr;
+		mStateFilter.PSSetShaderResources(0, 1, &nullSRV);
+		if (output == SCREEN_OUTPUT_SLOT)
+		{
+			mStateFilter.OMSetRenderTargets(1, &objects.backBuffer, objects.depthStencil);
+		}
+		else
+		{
+			mStateFilter.OMSetRenderTargets(1, &mRenderTargets[output].renderTarget, objects.depthStencil);
+		}
+		mStateFilter.PSSetShaderResources(0, 1, &mRenderTargets[input].textureSRV);
+		mStateFilter.PSSetSamplers(0, 1, &objects.pointSampler);
+		mInput = input;
+		mOutput = output;
+	}
+
+
+	// Set up the states and geometry for a 2D post-process quad or polygon covering the whole target, without drawing
+	// anything - no blending, don't write to depth buffer and ignore back-face culling
+	void PreparePostProcessDraw()
+	{
+		mStateFilter.VSSetShader(objects.quadVertexShader, nullptr, 0);
+		mStateFilter.GSSetShader(nullptr, nullptr, 0);  // Switch off geometry shader when not using it
+		mStateFilter.OMSetBlendState(objects.noBlendingState, nullptr, 0xffffff);
+		mStateFilter.OMSetDepthStencilState(objects.depthReadOnlyState, 0);
+		mStateFilter.RSSetState(objects.cullNoneState);
+
+		// No need to set vertex/index buffer (see 2D quad vertex shader), just indicate that the quad will be created as a triangle strip
+		mStateFilter.IASetInputLayout(nullptr);
+		mStateFilter.IASetPrimitiveTopology(Api::TRIANGLE_STRIP);
+
+		// Set 2D area for full-screen post-processing (coordinates in 0->1 range)
+		mConstants.area2DTopLeft = { 0, 0 }; // Top-left of entire screen
+		mConstants.area2DSize = { 1, 1 };    // Full size of screen
+		mConstants.area2DDepth = 0;          // Depth buffer value for full screen is as close as possible
+	}
+
+
+	// Draw a full-screen post process into the selected render target
+	void DrawFullScreenPostProcess(PostProcess postProcess, float frameTime, int i)
+	{
+		PreparePostProcessDraw();
+
+		// Select shader and textures needed for the required post-processes (helper function above)
+		SelectPostProcessShaderAndTextures(postProcess, frameTime, i);
+
+		// Pass over the above post-processing settings (also the per-process settings)
+		SendPostProcessConstants(PostProcessConstantBlocks(postProcess));
+
+		// Draw a quad
+		DrawPostProcess(ScreenPixels());
+	}
+
+
+	// Draw the post-processing quad or polygon already set up into the selected target and count it. pixels is the
+	// number of pixels it covers. Several instances can be drawn by the one call (a polygon batch)
+	void DrawPostProcess(uint64_t pixels, int numInstances = 1)
+	{
+		if (numInstances == 1)  Context()->Draw(4, 0);
+		else                    Context()->DrawInstanced(4, numInstances, 0, 0);
+
+		mStats.draws.numDraws++;
+		if (mOutput == SCREEN_OUTPUT_SLOT)  mStats.draws.numScreenDraws++;
+		mStats.draws.pixelsFilled += pixels;
+	}
+
+
+	// Get the pixel shader for a fused pass with the given stages and variant, generating and compiling it the first
+	// time it is needed. Returns nullptr if the shader fails to compile
+	typename Api::PixelShader* GetFusedPostProcessShader(const std::vector<PostProcess>& stages, ShaderVariant variant)
+	{
+		auto& fusedShaders = mFusedShaders[static_cast<int>(variant)];
+		auto shader = fusedShaders.find(stages);
+		if (shader == fusedShaders.end())
+		{
+			shader = fusedShaders.emplace(stages, Api::CreateFusedShader(stages, variant)).first;
+		}
+		return shader->second;
+	}
+
+
+	// Get the colour lookup table texture for a fused pass whose first entry is at the given list index, rebaking the
+	// table and refilling the texture if the settings of the baked stages have changed. Returns nullptr on failure
+	typename Api::ShaderResourceView* GetColourLutTexture(int firstEntry, const std::vector<PostProcess>& stages, const ColourLutPlan& plan)
+	{
+		PostProcessColourLut<Api>& colourLut = mColourLuts[firstEntry];
+		const ColourLut& lut = colourLut.cache.Get(stages, plan, mConstants, colourLutSize);
+		if (!colourLut.cache.Rebaked() && colourLut.textureSRV != nullptr)  return colourLut.textureSRV;
+
+		// 8-bit entries, the same precision the separate passes had between each effect
+		std::vector<uint8_t> texels(lut.entries.size() * 4);
+		for (size_t entry = 0; entry < lut.entries.size(); ++entry)
+		{
+			const CVector4& colour = lut.entries[entry];
+			texels[entry * 4 + 0] = static_cast<uint8_t>(colour.x * 255.0f + 0.5f);
+			texels[entry * 4 + 1] = static_cast<uint8_t>(colour.y * 255.0f + 0.5f);
+			texels[entry * 4 + 2] = static_cast<uint8_t>(colour.z * 255.0f + 0.5f);
+			texels[entry * 4 + 3] = 255;
+		}
+
+		if (colourLut.texture != nullptr && colourLut.size == lut.size)
+		{
+			Context()->UpdateSubresource(colourLut.texture, 0, nullptr, texels.data(), lut.size * 4, lut.size * lut.size * 4);
+			return colourLut.textureSRV;
+		}
+
+		// New table size - recreate the texture
+		Api::Release(colourLut.textureSRV);
+		Api::Release(colourLut.texture);
+		colourLut.textureSRV = nullptr;
+		colourLut.texture = nullptr;
+		colourLut.size = lut.size;
+		if (!Api::CreateColourLutTexture(lut.size, texels, colourLut))  return nullptr;
+		return colourLut.textureSRV;
+	}
+
+
+	// Set the viewport to cover a render target of the given size
+	void SetViewport(int width, int height)
+	{
+		typename Api::Viewport vp = { 0, 0, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f };
+		mStateFilter.RSSetViewports(1, &vp);
+	}
+
+
+	// Polygon and area effects that update their input in place (see PostProcessGraph.h) can't read the target they are
+	// drawing to. Get a screen sized scratch target from the pool for them to read instead and select it as the input.
+	// Returns the scratch slot, or -1 if it couldn't be created
+	int SelectPostProcessScratchInput(int output)
+	{
+		int scratch = mRenderTargetPool.Acquire(mSceneTargetDesc);
+		if (GetRenderTarget(scratch) == nullptr)
+		{
+			mRenderTargetPool.Release(scratch);
+			return -1;
+		}
+		SelectPostProcessTargets(scratch, output);
+		return scratch;
+	}
+
+
+	// Copy the pixels an in-place effect reads from the texture it is drawing over into the scratch target. Only these
+	// pixels are touched, so the cost scales with the area covered rather than the screen
+	void CopyPostProcessPixels(typename Api::Resource* source, int scratch, const PixelRect& readBounds)
+	{
+		typename Api::Box box = { static_cast<uint32_t>(readBounds.left),  static_cast<uint32_t>(readBounds.top),    0,
+		                          static_cast<uint32_t>(readBounds.right), static_cast<uint32_t>(readBounds.bottom), 1 };
+		Context()->CopySubresourceRegion(mRenderTargets[scratch].texture, 0, readBounds.left, readBounds.top, 0, source, 0, &box);
+		mStats.draws.pixelsFilled += readBounds.Pixels();
+	}
+
+
+	// Limit drawing to the given pixels with a scissor rectangle. Call RSSetState afterwards to switch the scissor test off again
+	void SetPostProcessScissor(const PixelRect& drawBounds)
+	{
+		typename Api::Rect scissor = { drawBounds.left, drawBounds.top, drawBounds.right, drawBounds.bottom };
+		mStateFilter.RSSetScissorRects(1, &scissor);
+		mStateFilter.RSSetState(objects.cullNoneScissorState);
+	}
+
+
+	// Number of pixels in the full-screen post-processing targets
+	uint64_t ScreenPixels() const
+	{
+		return static_cast<uint64_t>(mWidth) * mHeight;
+	}
+
+	// Number of pixels covered by a post-process polygon with the given corners in clip space (drawn as a triangle
+	// strip). Only used for counting, so a polygon with a corner behind the camera just counts as the whole screen
+	uint64_t PolygonPixels(const CVector4 (&points)[4]) const
+	{
+		CVector2 pixels[4];
+		for (int p = 0; p < 4; ++p)
+		{
+			if (points[p].w <= 0)  return ScreenPixels();
+			pixels[p] = { (points[p].x / points[p].w * 0.5f + 0.5f) * mWidth,
+			              (points[p].y / points[p].w * 0.5f + 0.5f) * mHeight };
+		}
+		auto triangleArea = [&](int a, int b, int c)
+		{
+			return std::abs((pixels[b].x - pixels[a].x) * (pixels[c].y - pixels[a].y) -
+			                (pixels[c].x - pixels[a].x) * (pixels[b].y - pixels[a].y)) * 0.5f;
+		};
+		float area = triangleArea(0, 1, 2) + triangleArea(1, 2, 3);
+		return std::min(static_cast<uint64_t>(area), ScreenPixels());
+	}
+
+
+	StateFilter<Api>&                  mStateFilter;
+	const std::vector<ProcessAndMode>& mPostProcessList;
+	std::vector<Constants>&            mConstantsList;
+	PostProcessingConstants&           mConstants;
+
+	int mWidth = 0;
+	int mHeight = 0;
+	RenderTargetDesc    mSceneTargetDesc;
+	RenderTargetPool    mRenderTargetPool;
+	std::vector<Target> mRenderTargets; // Indexed by pool slot
+
+	// Slots of the image read by the pass in progress and the target being drawn to (SCREEN_OUTPUT_SLOT for the back buffer)
+	int mInput = -1;
+	int mOutput = SCREEN_OUTPUT_SLOT;
+
+	ConstantBlockTracker  mConstantBlocks;        // What each constant buffer holds, so unchanged blocks aren't sent again
+	PolygonBatchConstants mPolygonBatchConstants = {};
+
+	// Pixel shaders for fused passes for each shader variant, generated when first needed (see PostProcessFusion.h)
+	std::map<std::vector<PostProcess>, typename Api::PixelShader*> mFusedShaders[NUM_SHADER_VARIANTS];
+
+	// Colour lookup tables for fused passes of colour-only effects, keyed by the list index of the first entry in the pass
+	std::map<int, PostProcessColourLut<Api>> mColourLuts;
+
+	PostProcessPassStats mStats;
+};
+
+
+#endif //_POST_PROCESS_PASSES_H_INCLUDED_
@@ -0,0 +1,204 @@
+//--------------------------------------------------------------------------------------
+// Recording the calls made to a device context
+//--------------------------------------------------------------------------------------
+
+#include "RecordingContext.h"
+
+
+int RecordedFrame::TotalStateCalls() const
+{
+	int total = 0;
+	for (int count : stateCalls)  total += count;
+	return total;
+}
+
+
+const char* RecordedObjectName(const RecordedObject* object)
+{
+	return object ? object->name.c_str() : "null";
+}
+
+
+void RecordingContext::NewFrame()
+{
+	mFrame = RecordedFrame();
+	mLog.clear();
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------------------------
+
+void RecordingContext::SetObject(StateKind kind, const char* call, const RecordedObject* object)
+{
+	mFrame.stateCalls[static_cast<int>(kind)]++;
+	if (mLogging)  AddToLog(std::string(call) + " " + RecordedObjectName(object));
+}
+
+
+void RecordingContext::SetRange(StateKind kind, const char* call, unsigned int startSlot, unsigned int numSlots,
+                                RecordedObject* const* objects)
+{
+	mFrame.stateCalls[static_cast<int>(kind)]++;
+	if (!mLogging)  return;
+
+	std::string line = std::string(call) + " " + std::to_string(startSlot) + ":";
+	for (unsigned int i = 0; i < numSlots; ++i)
+	{
+		line += " ";
+		line += RecordedObjectName(objects[i]);
+	}
+	AddToLog(line);
+}
+
+
+void RecordingContext::IASetPrimitiveTopology(RecordedTopology topology)
+{
+	mFrame.stateCalls[static_cast<int>(StateKind::PrimitiveTopology)]++;
+	if (mLogging)  AddToLog(topology == RecordedTopology::TriangleStrip ? "IASetPrimitiveTopology strip" : "IASetPrimitiveTopology list");
+}
+
+
+void RecordingContext::RSSetViewports(unsigned int numViewports, const RecordedViewport* viewports)
+{
+	mFrame.stateCalls[static_cast<int>(StateKind::Viewport)]++;
+	if (mLogging && numViewports > 0)
+	{
+		AddToLog("RSSetViewports " + std::to_string(static_cast<int>(viewports[0].width)) + "x" +
+		                        std::to_string(static_cast<int>(viewports[0].height)));
+	}
+}
+
+
+void RecordingContext::RSSetScissorRects(unsigned int numRects, const RecordedRect* rects)
+{
+	mFrame.stateCalls[static_cast<int>(StateKind::ScissorRect)]++;
+	if (mLogging && numRects > 0)
+	{
+		AddToLog("RSSetScissorRects " + std::to_string(rects[0].left)  + "," + std::to_string(rects[0].top) + " - " +
+		                           std::to_string(rects[0].right) + "," + std::to_string(rects[0].bottom));
+	}
+}
+
+
+void RecordingContext::OMSetBlendState(RecordedObject* state, const float[4], unsigned int)
+{
+	SetObject(StateKind::BlendState, "OMSetBlendState", state);
+}
+
+
+void RecordingContext::OMSetDepthStencilState(RecordedObject* state, unsigned int)
+{
+	SetObject(StateKind::DepthStencilState, "OMSetDepthStencilState", state);
+}
+
+
+void RecordingContext::OMSetRenderTargets(unsigned int numViews, RecordedObject* const* renderTargets, RecordedObject* depthStencil)
+{
+	mFrame.stateCalls[static_cast<int>(StateKind::RenderTargets)]++;
+	mFrame.numRenderTargetSwitches++;
+	if (!mLogging)  return;
+
+	std::string line = "OMSetRenderTargets";
+	for (unsigned int i = 0; i < numViews; ++i)
+	{
+		line += " ";
+		line += RecordedObjectName(renderTargets[i]);
+	}
+	AddToLog(line + " depth " + RecordedObjectName(depthStencil));
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Drawing and resources
+//--------------------------------------------------------------------------------------
+
+void RecordingContext::Draw(unsigned int vertexCount, unsigned int)
+{
+	mFrame.numDraws++;
+	mFrame.numInstances++;
+	if (mLogging)  AddToLog("Draw " + std::to_string(vertexCount));
+}
+
+
+void RecordingContext::DrawInstanced(unsigned int vertexCount, unsigned int instanceCount, unsigned int, unsigned int)
+{
+	mFrame.numDraws++;
+	mFrame.numInstances += instanceCount;
+	if (mLogging)  AddToLog("DrawInstanced " + std::to_string(vertexCount) + " x " + std::to_string(instanceCount));
+}
+
+
+void RecordingContext::ClearRenderTargetView(RecordedObject* renderTarget, const float[4])
+{
+	mFrame.numClears++;
+	if (mLogging)  AddToLog(std::string("ClearRenderTargetView ") + RecordedObjectName(renderTarget));
+}
+
+
+void RecordingContext::ClearDepthStencilView(RecordedObject* depthStencil, unsigned int, float, uint8_t)
+{
+	mFrame.numClears++;
+	if (mLogging)  AddToLog(std::string("ClearDepthStencilView ") + RecordedObjectName(depthStencil));
+}
+
+
+void* RecordingContext::Map(RecordedObject* resource)
+{
+	mMappedData.resize(resource->bytes);
+	return mMappedData.data();
+}
+
+
+void RecordingContext::Unmap(RecordedObject* resource)
+{
+	CountUpload(resource, resource->bytes);
+	if (mLogging)  AddToLog("Map " + resource->name + " " + std::to_string(resource->bytes) + " bytes");
+}
+
+
+void RecordingContext::UpdateSubresource(RecordedObject* resource, unsigned int, const RecordedBox* box, const void*,
+                                         unsigned int rowPitch, unsigned int depthPitch)
+{
+	uint64_t bytes = resource->bytes;
+	if (box)
+	{
+		uint32_t slices = box->back - box->front;
+		bytes = (slices > 1) ? static_cast<uint64_t>(slices) * depthPitch : static_cast<uint64_t>(box->bottom - box->top) * rowPitch;
+	}
+	CountUpload(resource, bytes);
+	if (mLogging)  AddToLog("UpdateSubresource " + resource->name + " " + std::to_string(bytes) + " bytes");
+}
+
+
+void RecordingContext::CopySubresourceRegion(RecordedObject* destination, unsigned int, unsigned int, unsigned int,
+                                             unsigned int, RecordedObject* source, unsigned int, const RecordedBox* box)
+{
+	mFrame.numCopies++;
+	if (box)  mFrame.pixelsCopied += static_cast<uint64_t>(box->right - box->left) * (box->bottom - box->top);
+	if (mLogging)  AddToLog("CopySubresourceRegion " + source->name + " -> " + destination->name);
+}
+
+
+void RecordingContext::CountUpload(const RecordedObject* resource, uint64_t bytes)
+{
+	if (resource->type == RecordedObjectType::ConstantBuffer)
+	{
+		mFrame.numConstantUploads++;
+		mFrame.constantBytes += bytes;
+	}
+	else
+	{
+		mFrame.numResourceUploads++;
+		mFrame.resourceBytes += bytes;
+	}
+}
+
+
+void RecordingContext::AddToLog(const std::string& line)
+{
+	mLog.push_back(line);
+}
@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------------------
+// Recording the calls made to a device context
+//--------------------------------------------------------------------------------------
+// The CPU cost of a frame is mostly in the calls made to the device context - draws, state changes, constant buffer
+// uploads and render target switches. RecordingContext takes the same calls as the DirectX context (the ones this
+// project uses) but only counts them, and can keep a log of them in order. Frames can then be measured without a GPU
+// or a window, e.g. to check the post-processing hasn't become more expensive (see FrameBudget.h).
+//
+// The objects passed to it are RecordedObjects - just a name and, for buffers and textures, a size. RecordingApi gives
+// the types for a StateFilter (StateCache.h), so the calls that reach the context are the ones left after redundant
+// state changes are filtered out, as with the real context.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _RECORDING_CONTEXT_H_INCLUDED_
+#define _RECORDING_CONTEXT_H_INCLUDED_
+
+#include "StateCache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Recorded objects
+//--------------------------------------------------------------------------------------
+
+// What a recorded object stands for - decides how uploads to it are counted
+enum class RecordedObjectType
+{
+	Shader,
+	State,
+	ConstantBuffer,
+	Buffer,
+	Texture,
+	View,
+};
+
+// Stands in for a shader, state, buffer, texture or view. Objects are told apart by their address, as with DirectX
+struct RecordedObject
+{
+	std::string        name;
+	RecordedObjectType type  = RecordedObjectType::State;
+	size_t             bytes = 0; // Size of a buffer or texture
+};
+
+enum class RecordedTopology
+{
+	Undefined,
+	TriangleList,
+	TriangleStrip,
+};
+
+// Same layout as D3D11_VIEWPORT, D3D11_RECT and D3D11_BOX
+struct RecordedViewport
+{
+	float topLeftX, topLeftY;
+	float width, height;
+	float minDepth, maxDepth;
+};
+
+struct RecordedRect
+{
+	int32_t left, top, right, bottom;
+};
+
+struct RecordedBox
+{
+	uint32_t left, top, front;
+	uint32_t right, bottom, back;
+};
+
+
+class RecordingContext;
+
+// Types for a StateFilter in front of a RecordingContext
+struct RecordingApi
+{
+	using Context            = RecordingContext;
+	using VertexShader       = RecordedObject;
+	using GeometryShader     = RecordedObject;
+	using PixelShader        = RecordedObject;
+	using InputLayout        = RecordedObject;
+	using PrimitiveTopology  = RecordedTopology;
+	using Buffer             = RecordedObject;
+	using ShaderResourceView = RecordedObject;
+	using SamplerState       = RecordedObject;
+	using RasterizerState    = RecordedObject;
+	using Viewport           = RecordedViewport;
+	using Rect               = RecordedRect;
+	using BlendState         = RecordedObject;
+	using DepthStencilState  = RecordedObject;
+	using RenderTargetView   = RecordedObject;
+	using DepthStencilView   = RecordedObject;
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Recorded frame
+//--------------------------------------------------------------------------------------
+
+// Calls that reached the context in a frame
+struct RecordedFrame
+{
+	int numDraws     = 0; // Draw calls, an instanced draw counts once
+	int numInstances = 0; // Instances drawn by all the draws
+
+	int stateCalls[NUM_STATE_KINDS] = {}; // State-setting calls of each kind
+	int numRenderTargetSwitches     = 0;  // OMSetRenderTargets calls (also counted in stateCalls)
+
+	int      numConstantUploads = 0; // Constant buffers mapped or updated, and the bytes sent to them
+	uint64_t constantBytes      = 0;
+	int      numResourceUploads = 0; // Other buffers and textures mapped or updated, and the bytes sent to them
+	uint64_t resourceBytes      = 0;
+
+	int      numCopies    = 0; // CopySubresourceRegion calls and the pixels they copy (assuming 2D textures)
+	uint64_t pixelsCopied = 0;
+	int      numClears    = 0; // Render target and depth buffer clears
+
+	int TotalStateCalls() const;
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Context
+//--------------------------------------------------------------------------------------
+
+// Takes the device context calls this project makes and records them. The signatures match ID3D11DeviceContext, with
+// RecordedObjects in place of the DirectX interfaces
+class RecordingContext
+{
+public:
+	// Start recording a new frame, clearing the counts and the log
+	void NewFrame();
+
+	const RecordedFrame& Frame() const  { return mFrame; }
+
+	// Keep a line of text for each call made, off by default
+	void SetLogging(bool logging)  { mLogging = logging; }
+	const std::vector<std::string>& Log() const  { return mLog; }
+
+
+	//-------------------------------------
+	// State
+	//-------------------------------------
+
+	void VSSetShader(RecordedObject* shader, std::nullptr_t, unsigned int)  { SetObject(StateKind::VertexShader, "VSSetShader", shader); }
+	void GSSetShader(RecordedObject* shader, std::nullptr_t, unsigned int)  { SetObject(StateKind::GeometryShader, "GSSetShader", shader); }
+	void PSSetShader(RecordedObject* shader, std::nullptr_t, unsigned int)  { SetObject(StateKind::PixelShader, "PSSetShader", shader); }
+
+	void IASetInputLayout(RecordedObject* layout)  { SetObject(StateKind::InputLayout, "IASetInputLayout", layout); }
+	void IASetPrimitiveTopology(RecordedTopology topology);
+
+	void VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, RecordedObject* const* buffers)
+	{
+		SetRange(StateKind::VSConstantBuffer, "VSSetConstantBuffers", startSlot, numBuffers, buffers);
+	}
+	void GSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, RecordedObject* const* buffers)
+	{
+		SetRange(StateKind::GSConstantBuffer, "GSSetConstantBuffers", startSlot, numBuffers, buffers);
+	}
+	void PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, RecordedObject* const* buffers)
+	{
+		SetRange(StateKind::PSConstantBuffer, "PSSetConstantBuffers", startSlot, numBuffers, buffers);
+	}
+	void VSSetShaderResources(unsigned int startSlot, unsigned int numViews, RecordedObject* const* views)
+	{
+		SetRange(StateKind::VSResource, "VSSetShaderResources", startSlot, numViews, views);
+	}
+	void PSSetShaderResources(unsigned int startSlot, unsigned int numViews, RecordedObject* const* views)
+	{
+		SetRange(StateKind::PSResource, "PSSetShaderResources", startSlot, numViews, views);
+	}
+	void PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, RecordedObject* const* samplers)
+	{
+		SetRange(StateKind::PSSampler, "PSSetSamplers", startSlot, numSamplers, samplers);
+	}
+
+	void RSSetState(RecordedObject* state)  { SetObject(StateKind::RasterizerState, "RSSetState", state); }
+	void RSSetViewports(unsigned int numViewports, const RecordedViewport* viewports);
+	void RSSetScissorRects(unsigned int numRects, const RecordedRect* rects);
+
+	void OMSetBlendState(RecordedObject* state, const float blendFactor[4], unsigned int sampleMask);
+	void OMSetDepthStencilState(RecordedObject* state, unsigned int stencilRef);
+	void OMSetRenderTargets(unsigned int numViews, RecordedObject* const* renderTargets, RecordedObject* depthStencil);
+
+
+	//-------------------------------------
+	// Drawing and resources
+	//-------------------------------------
+
+	void Draw(unsigned int vertexCount, unsigned int startVertex);
+	void DrawInstanced(unsigned int vertexCount, unsigned int instanceCount, unsigned int startVertex, unsigned int startInstance);
+
+	void ClearRenderTargetView(RecordedObject* renderTarget, const float colour[4]);
+	void ClearDepthStencilView(RecordedObject* depthStencil, unsigned int clearFlags, float depth, uint8_t stencil);
+
+	// Map a buffer or texture for writing, the whole resource is counted as sent (as with D3D11_MAP_WRITE_DISCARD).
+	// Returns memory the size of the resource, valid until Unmap
+	void* Map(RecordedObject* resource);
+	void  Unmap(RecordedObject* resource);
+
+	// Send data to a resource, all of it if box is null. rowPitch and depthPitch give the bytes in a box
+	void UpdateSubresource(RecordedObject* resource, unsigned int subresource, const RecordedBox* box, const void* data,
+	                       unsigned int rowPitch, unsigned int depthPitch);
+
+	void CopySubresourceRegion(RecordedObject* destination, unsigned int destinationSubresource, unsigned int x, unsigned int y,
+	                           unsigned int z, RecordedObject* source, unsigned int sourceSubresource, const RecordedBox* box);
+
+private:
+	void SetObject(StateKind kind, const char* call, const RecordedObject* object);
+	void SetRange(StateKind kind, const char* call, unsigned int startSlot, unsigned int numSlots, RecordedObject* const* objects);
+
+	// Count bytes sent to a resource
+	void CountUpload(const RecordedObject* resource, uint64_t bytes);
+
+	// Add a line to the log if logging
+	void AddToLog(const std::string& line);
+
+	RecordedFrame mFrame;
+	std::vector<char> mMappedData;
+
+	bool mLogging = false;
+	std::vector<std::string> mLog;
+};
+
+// Name of an object for the log, "null" for a null pointer
+const char* RecordedObjectName(const RecordedObject* object);
+
+
+#endif //_RECORDING_CONTEXT_H_INCLUDED_
@@ -0,0 +1,189 @@
+//--------------------------------------------------------------------------------------
+// Pool of render targets for post-processing
+//--------------------------------------------------------------------------------------
+
+#include "RenderTargetPool.h"
+#include "PostProcessGraph.h"
+
+
+//--------------------------------------------------------------------------------------
+// Render target descriptions
+//--------------------------------------------------------------------------------------
+
+// Size in bytes of one pixel in the given format
+int RenderTargetFormatBytes(RenderTargetFormat format)
+{
+	switch (format)
+	{
+		case RenderTargetFormat::RGBA16F:  return 8;
+		default:                           return 4;
+	}
+}
+
+
+bool operator==(const RenderTargetDesc& a, const RenderTargetDesc& b)
+{
+	return a.width == b.width && a.height == b.height && a.format == b.format;
+}
+
+bool operator!=(const RenderTargetDesc& a, const RenderTargetDesc& b)
+{
+	return !(a == b);
+}
+
+
+// Memory used by a render target with the given description
+size_t RenderTargetBytes(const RenderTargetDesc& desc)
+{
+	return static_cast<size_t>(desc.width) * desc.height * RenderTargetFormatBytes(desc.format);
+}
+
+
+// Description of a target the same format as the given one but 1/divisor of its size, rounded up
+RenderTargetDesc ScaledRenderTargetDesc(const RenderTargetDesc& desc, int divisor)
+{
+	RenderTargetDesc scaled = desc;
+	if (divisor > 1)
+	{
+		scaled.width  = (desc.width  + divisor - 1) / divisor;
+		scaled.height = (desc.height + divisor - 1) / divisor;
+	}
+	if (scaled.width  < 1)  scaled.width  = 1;
+	if (scaled.height < 1)  scaled.height = 1;
+	return scaled;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Pool
+//--------------------------------------------------------------------------------------
+
+// Get a free slot with the given description, adding a new slot if there isn't one
+int RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+{
+	int slot = 0;
+	while (slot < NumSlots() && (mSlots[slot].inUse || mSlots[slot].desc != desc))
+	{
+		++slot;
+	}
+
+	if (slot == NumSlots())
+	{
+		mSlots.push_back({ desc, false });
+	}
+
+	mSlots[slot].inUse = true;
+	mBytesInUse += RenderTargetBytes(desc);
+	if (mBytesInUse > mPeakBytesInUse)  mPeakBytesInUse = mBytesInUse;
+	return slot;
+}
+
+
+// Hand a slot back to the pool when its image is no longer needed
+void RenderTargetPool::Release(int slot)
+{
+	if (slot < 0 || slot >= NumSlots() || !mSlots[slot].inUse)  return;
+
+	mSlots[slot].inUse = false;
+	mBytesInUse -= RenderTargetBytes(mSlots[slot].desc);
+}
+
+
+// Hand back every slot still in use
+void RenderTargetPool::ReleaseAll()
+{
+	for (int slot = 0; slot < NumSlots(); ++slot)
+	{
+		Release(slot);
+	}
+}
+
+
+// Forget all the slots
+void RenderTargetPool::Clear()
+{
+	mSlots.clear();
+	mBytesInUse = 0;
+}
+
+
+// Memory used by all the slots created
+size_t RenderTargetPool::AllocatedBytes() const
+{
+	size_t bytes = 0;
+	for (auto& slot : mSlots)
+	{
+		bytes += RenderTargetBytes(slot.desc);
+	}
+	return bytes;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Post-processing targets
+//--------------------------------------------------------------------------------------
+
+// Description of each level of the bloom chain for the given scene target
+RenderTargetDesc BloomLevelDesc(int level, const RenderTargetDesc& sceneDesc)
+{
+	RenderTargetDesc desc;
+	BloomLevelSize(level, sceneDesc.width, sceneDesc.height, desc.width, desc.height);
+	desc.format = RenderTargetFormat::RGBA16F;
+	return desc;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Measuring
+//--------------------------------------------------------------------------------------
+
+// Run through the target lifetimes of a post-process list as RenderScene would, without a GPU
+RenderTargetReport SimulatePostProcessTargets(const std::vector<ProcessAndMode>& postProcessList, int width, int height)
+{
+	RenderTargetDesc sceneDesc;
+	sceneDesc.width = width;
+	sceneDesc.height = height;
+	sceneDesc.format = RenderTargetFormat::RGBA8;
+
+	RenderTargetPool pool;
+	CompiledPostProcessGraph graph;
+	CompilePostProcessGraph(BuildPostProcessGraph(postProcessList), graph);
+
+	// With no passes to run the scene goes straight to the back buffer, otherwise the final pass writes it
+	if (!graph.passes.empty())
+	{
+		int finalSlot;
+		RunPostProcessGraph(graph, pool, sceneDesc, pool.Acquire(sceneDesc), true,
+			[&](const PostProcessPass& pass, const std::vector<int>&, int)
+			{
+				if (pass.type != PostProcessPassType::Bloom)  return true;
+
+				// The chain is built down to the smallest level, then each level is handed back once added onto the
+				// one above, the top level after the composite into the output
+				int levels[NUM_BLOOM_LEVELS];
+				for (int level = 0; level < NUM_BLOOM_LEVELS; ++level)
+				{
+					levels[level] = pool.Acquire(BloomLevelDesc(level, sceneDesc));
+				}
+				for (int level = 0; level < NUM_BLOOM_LEVELS; ++level)
+				{
+					pool.Release(levels[level]);
+				}
+				return true;
+			}, finalSlot);
+	}
+
+	RenderTargetReport report;
+	report.numTargets = pool.NumSlots();
+	report.allocatedBytes = pool.AllocatedBytes();
+	report.peakBytesInUse = pool.PeakBytesInUse();
+	report.fixedBytes = 3 * RenderTargetBytes(sceneDesc);
+	for (int level = 0; level < NUM_BLOOM_LEVELS; ++level)
+	{
+		report.fixedBytes += RenderTargetBytes(BloomLevelDesc(level, sceneDesc));
+	}
+	return report;
+}
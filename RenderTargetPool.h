@@ -0,0 +1,139 @@
+//--------------------------------------------------------------------------------------
+// Pool of render targets for post-processing
+//--------------------------------------------------------------------------------------
+// Post-processing needs somewhere to render each pass, but most of those images are only needed for a moment - a pass
+// reads the latest image, writes a new one, and the old one is finished with. Rather than creating a fixed set of
+// targets up front, passes ask the pool for a target of a given size and format when they start writing it, and hand
+// it back after the last pass that reads it. A target handed back can be given out again to any later pass asking for
+// the same size and format, so images whose lifetimes don't overlap share the same memory.
+//
+// The pool only does the bookkeeping - each slot number stands for one real render target, which the user creates the
+// first time the slot is given out (see PostProcessPasses.h). That keeps it portable, so the memory used by a post-process list
+// can be measured without a GPU (SimulatePostProcessTargets).
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _RENDER_TARGET_POOL_H_INCLUDED_
+#define _RENDER_TARGET_POOL_H_INCLUDED_
+
+#include "PostProcess.h"
+
+#include <cstddef>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Render target descriptions
+//--------------------------------------------------------------------------------------
+
+// Pixel formats used by the post-processing targets
+enum class RenderTargetFormat
+{
+	RGBA8,   // 8-bit unsigned normalised per channel - the scene and most post-processes
+	RGBA16F, // 16-bit float per channel - the bloom chain, where values can add up past 1
+};
+
+// Size in bytes of one pixel in the given format
+int RenderTargetFormatBytes(RenderTargetFormat format);
+
+
+// Size and format of a render target - the key used to find a matching target in the pool
+struct RenderTargetDesc
+{
+	int width  = 0;
+	int height = 0;
+	RenderTargetFormat format = RenderTargetFormat::RGBA8;
+};
+
+bool operator==(const RenderTargetDesc& a, const RenderTargetDesc& b);
+bool operator!=(const RenderTargetDesc& a, const RenderTargetDesc& b);
+
+// Memory used by a render target with the given description
+size_t RenderTargetBytes(const RenderTargetDesc& desc);
+
+// Description of a target the same format as the given one but 1/divisor of its size, rounded up so it is never empty.
+// Used for half resolution and smaller intermediates
+RenderTargetDesc ScaledRenderTargetDesc(const RenderTargetDesc& desc, int divisor);
+
+
+
+//--------------------------------------------------------------------------------------
+// Pool
+//--------------------------------------------------------------------------------------
+
+class RenderTargetPool
+{
+public:
+	// Get a free slot with the given description, adding a new slot if there isn't one. The caller creates the real
+	// render target the first time it sees a slot number
+	int Acquire(const RenderTargetDesc& desc);
+
+	// Hand a slot back to the pool when its image is no longer needed, so later passes can use its memory
+	void Release(int slot);
+
+	// Hand back every slot still in use, e.g. at the end of a frame
+	void ReleaseAll();
+
+	// Forget all the slots, call after destroying the real render targets. Keeps the peak usage
+	void Clear();
+
+
+	// Number of slots created so far, each one a real render target
+	int NumSlots() const  { return static_cast<int>(mSlots.size()); }
+
+	const RenderTargetDesc& Desc(int slot) const  { return mSlots[slot].desc; }
+	bool InUse(int slot) const  { return mSlots[slot].inUse; }
+
+
+	// Memory used by all the slots created, i.e. the real memory cost of the pool
+	size_t AllocatedBytes() const;
+
+	// Memory used by the slots currently given out, and the most that has been given out at once since the last reset
+	size_t BytesInUse() const      { return mBytesInUse; }
+	size_t PeakBytesInUse() const  { return mPeakBytesInUse; }
+	void   ResetPeak()             { mPeakBytesInUse = mBytesInUse; }
+
+private:
+	struct Slot
+	{
+		RenderTargetDesc desc;
+		bool inUse;
+	};
+	std::vector<Slot> mSlots;
+
+	size_t mBytesInUse = 0;
+	size_t mPeakBytesInUse = 0;
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Post-processing targets
+//--------------------------------------------------------------------------------------
+// The screen sized targets are taken and handed back by the post-processing graph as each image is written and
+// finished with (see PostProcessGraph.h). Bloom takes its smaller levels itself while it runs
+
+// Description of each level of the bloom chain for the given scene target (see the bloom section of PostProcess.h)
+RenderTargetDesc BloomLevelDesc(int level, const RenderTargetDesc& sceneDesc);
+
+
+
+//--------------------------------------------------------------------------------------
+// Measuring
+//--------------------------------------------------------------------------------------
+
+// Memory needed for the render targets of a post-process list
+struct RenderTargetReport
+{
+	int    numTargets;     // Real render targets created by the pool
+	size_t allocatedBytes; // Memory of those targets
+	size_t peakBytesInUse; // Most memory given out at once (less than allocatedBytes if formats or sizes don't match up)
+	size_t fixedBytes;     // Memory used by the fixed set of targets this replaced - three screen sized RGBA8 targets
+	                       // and every level of the bloom chain
+};
+
+// Run through the target lifetimes of a post-process list as RenderScene would (running its compiled graph), without
+// a GPU, and report the memory needed for a screen of the given size
+RenderTargetReport SimulatePostProcessTargets(const std::vector<ProcessAndMode>& postProcessList, int width, int height);
+
+
+#endif //_RENDER_TARGET_POOL_H_INCLUDED_
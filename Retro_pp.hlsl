@@ -26,7 +26,7 @@ float4 main(PostProcessingInput input) : SV_Target
     
     float3 finalColour = float3(1.0, 0.0, 0.0);
        
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
         // Perform Post Process
         float pixelXPos = pixelWidth * (1.0f / gViewportWidth);
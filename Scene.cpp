@@ -9,8 +9,20 @@
 #include "Camera.h"
 #include "State.h"
 #include "Shader.h"
+#include "Texture.h"
 #include "Input.h"
 #include "Common.h"
+#include "PostProcessPasses.h"
+#include "PostProcessFusion.h"
+#include "ColourLut.h"
+#include "RenderTargetPool.h"
+#include "PostProcessGraph.h"
+#include "PolygonBatch.h"
+#include "ConstantBlocks.h"
+#include "MatrixSimd.h"
+#include "StateCache.h"
+#include "PassTiming.h"
+#include "FrameTrace.h"
 
 #include "CVector2.h" 
 #include "CVector3.h" 
@@ -23,9 +35,14 @@
 #include "imgui_impl_win32.h"
 #include "imgui_impl_dx11.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
+#include <map>
 #include <sstream>
 #include <memory>
+#include <vector>
 
 
 //--------------------------------------------------------------------------------------
@@ -33,66 +50,7 @@
 //--------------------------------------------------------------------------------------
 
 //********************
-// Available post-processes 
-enum class PostProcess
-{
-	None,
-	Copy,
-	Tint,
-	GreyNoise,
-	Burn,
-	Distort,
-	Spiral,
-	HeatHaze,
-	HueTint,
-	BlurH,
-	BlurV,
-	Underwater,
-	Inverted,
-	NightVision,
-	Retro,
-	Bloom1,
-	Bloom2,
-	DepthOfField
-};
-
-enum class PostProcessMode
-{
-	Fullscreen,
-	Area,
-	Polygon,
-};
-
-struct ProcessAndMode
-{
-	PostProcess process;
-	PostProcessMode mode;
-};
-
-struct Constants
-{
-	// Tint post-process settings
-	CVector3 tintTopColour = { 0, 0, 1 };
-	CVector3 tintBottomColour = { 0, 1, 0 };
-
-	// HueTint post-process settings
-	float    HueWiggle = 0.0f;
-	float    HueWiggleSpeed = 0.0f;
-
-	// Underwater post-process settiings
-	CVector3 waterColour = { 0.0f,0.0f,0.0f };
-	float    Wiggle = 0.0f;
-	float    WiggleSpeed = 0.0f;
-
-	// Bloom post processing effects
-	float bloomThreshold = 0.8f;
-
-	// DOF post processing effects
-	float depthThreshold = 0.0f;
-
-	// Blur post-process settings
-	int blurStrength = 7;
-};
+// Post-process list - the PostProcess enum and the Constants settings structure are in PostProcess.h
 
 std::vector<Constants> gConstantsList;
 
@@ -169,7 +127,7 @@ ID3D11Buffer* gPerModelConstantBuffer; // --"--
 
 //**************************
 PostProcessingConstants gPostProcessingConstants;       // As above, but constants (settings) for each post-process
-ID3D11Buffer* gPostProcessingConstantBuffer; // --"--
+ID3D11Buffer* gPostProcessingConstantBuffers[NUM_POST_PROCESS_CONSTANT_BLOCKS] = {}; // --"-- one for each block (see ConstantBlocks.h)
 //**************************
 
 
@@ -197,21 +155,73 @@ ID3D11ShaderResourceView* gLightDiffuseMapSRV = nullptr;
 //****************************
 // Post processing textures
 
-// This texture will have the scene renderered on it. Then the texture is then used for post-processing
-ID3D11Texture2D* gSceneTexture = nullptr; // This object represents the memory used by the texture on the GPU
-ID3D11RenderTargetView* gSceneRenderTarget = nullptr; // This object is used when we want to render to the texture above
-ID3D11ShaderResourceView* gSceneTextureSRV = nullptr; // This object is used to give shaders access to the texture above (SRV = shader resource view)
+// The scene is rendered to a texture, then post-processed from texture to texture. The textures come from a pool
+// owned by the passes (gPostProcessPasses below) - each pass takes a texture to render to and hands back the one it
+// read when it has finished, so images that aren't needed at the same time share the same memory. The bloom chain
+// takes its smaller floating point textures from the same pool
 
-// This texture will have the scene renderered on it. Then the texture is then used for post-processing
-ID3D11Texture2D* gSceneTextureOne = nullptr; // This object represents the memory used by the texture on the GPU
-ID3D11RenderTargetView* gSceneRenderTargetCopy = nullptr; // This object is used when we want to render to the texture above
-ID3D11ShaderResourceView* gSceneTextureOneSRV = nullptr; // This object is used to give shaders access to the texture above (SRV = shader resource view)
+// Compiled post-processing graph for the current list, only rebuilt when the list changes (see PostProcessGraph.h)
+PostProcessGraphCache gPostProcessGraphs;
 
-// This texture will have the scene renderered on it. Then the texture is then used for post-processing
-ID3D11Texture2D* gSceneTextureTwo = nullptr; // This object represents the memory used by the texture on the GPU
-ID3D11RenderTargetView* gSceneRenderTargetTwo = nullptr; // This object is used when we want to render to the texture above
-ID3D11ShaderResourceView* gSceneTextureTwoSRV = nullptr; // This object is used to give shaders access to the texture above (SRV = shader resource view)
+// Windows of the polygon batch being drawn, all sent to the GPU in one go (see PolygonBatch.h), and the constant buffer
+// giving each draw of the batch its first window
+ID3D11Buffer*             gPolygonBatchBuffer         = nullptr;
+ID3D11ShaderResourceView* gPolygonBatchBufferSRV      = nullptr;
+ID3D11Buffer*             gPolygonBatchConstantBuffer = nullptr;
+
+// The types of the DirectX objects set through gStateFilter (see StateCache.h), extended for the post-processing
+// passes by D3D11PostProcessApi below
+struct D3D11StateApi
+{
+	using Context            = ID3D11DeviceContext;
+	using VertexShader       = ID3D11VertexShader;
+	using GeometryShader     = ID3D11GeometryShader;
+	using PixelShader        = ID3D11PixelShader;
+	using InputLayout        = ID3D11InputLayout;
+	using PrimitiveTopology  = D3D11_PRIMITIVE_TOPOLOGY;
+	using Buffer             = ID3D11Buffer;
+	using ShaderResourceView = ID3D11ShaderResourceView;
+	using SamplerState       = ID3D11SamplerState;
+	using RasterizerState    = ID3D11RasterizerState;
+	using Viewport           = D3D11_VIEWPORT;
+	using Rect               = D3D11_RECT;
+	using BlendState         = ID3D11BlendState;
+	using DepthStencilState  = ID3D11DepthStencilState;
+	using RenderTargetView   = ID3D11RenderTargetView;
+	using DepthStencilView   = ID3D11DepthStencilView;
+};
 
+// Depth pre-pass - when on, the depths written by RenderDepthBufferFromCamera are kept and the opaque models of the main
+// pass are drawn over them with gDepthPrePassState, so PixelLighting_ps runs once per visible pixel. When off the main
+// pass fills the depth buffer itself. The pixel shader invocations of the opaque models are counted to compare the two,
+// using a ring of pipeline statistics queries read back a few frames later so the CPU never waits for the GPU
+bool         gUseDepthPrePass = true;
+const int    NUM_OVERDRAW_QUERIES = 4;
+ID3D11Query* gOverdrawQueries[NUM_OVERDRAW_QUERIES] = {};
+int          gOverdrawFrame = 0;
+UINT64       gOpaquePixelShaderInvocations = 0; // From the latest query read back
+
+// Time taken by each post-processing pass on the CPU and GPU (see PassTiming.h). Each set of GPU queries in the ring is
+// a disjoint query for the frame and a pair of timestamps for each pass
+struct GpuTimingQueries
+{
+	ID3D11Query* disjoint;
+	ID3D11Query* begin[MAX_TIMED_PASSES];
+	ID3D11Query* end[MAX_TIMED_PASSES];
+};
+GpuTimingQueries  gGpuTimingQueries[NUM_GPU_TIMING_FRAMES] = {};
+int               gGpuTimingSet = 0; // Set used this frame
+GpuTimingRing     gGpuTiming;
+PassTimer         gPassTimer;
+PassTimingHistory gPassTimings;
+
+// Capturing frames of CPU events as a Chrome trace (see FrameTrace.h). Start-up - loading the shaders and textures and
+// the first frames after - is always captured, and kept until a capture is started from ImGui
+const int   STARTUP_TRACE_FRAMES = 60;
+const char* TRACE_FILE = "FrameTrace.json";
+int         gTraceFrames = 10;            // Frames captured by the ImGui button
+bool        gSaveTraceWhenDone = false;  // Write the capture to TRACE_FILE when it finishes
+std::string gTraceSaveResult;            // Where the last capture was written, or that it couldn't be
 
 // Additional textures used for specific post-processes
 ID3D11Resource* gNoiseMap = nullptr;
@@ -226,6 +236,161 @@ ID3D11ShaderResourceView* gDistortMapSRV = nullptr;
 
 
 
+//--------------------------------------------------------------------------------------
+// Post-processing passes
+//--------------------------------------------------------------------------------------
+
+// Read back the GPU pass timings in the set of queries about to be used again, issued NUM_GPU_TIMING_FRAMES frames ago.
+// Never waits for the GPU - if they still aren't ready they are dropped
+void CollectGpuPassTimings()
+{
+	int set = gGpuTiming.NextSet();
+	if (!gGpuTiming.Pending(set))  return;
+
+	GpuTimingQueries& queries = gGpuTimingQueries[set];
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	uint64_t begin[MAX_TIMED_PASSES], end[MAX_TIMED_PASSES];
+	bool ready = gD3DContext->GetData(queries.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+	for (int pass = 0; pass < gGpuTiming.NumPasses(set) && ready; ++pass)
+	{
+		ready = gD3DContext->GetData(queries.begin[pass], &begin[pass], sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
+		        gD3DContext->GetData(queries.end[pass],   &end[pass],   sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+	}
+	if (ready)  gGpuTiming.Collect(set, begin, end, disjoint.Frequency, disjoint.Disjoint != FALSE, gPassTimings);
+	else        gGpuTiming.Drop(set);
+}
+
+
+// Start timing the post-processing passes of a frame, collecting the GPU times of an earlier frame
+void BeginPassTimings()
+{
+	CollectGpuPassTimings();
+	gGpuTimingSet = gGpuTiming.BeginFrame();
+	gD3DContext->Begin(gGpuTimingQueries[gGpuTimingSet].disjoint);
+	gPassTimer.BeginFrame();
+}
+
+// Finish timing the passes of a frame, the CPU times go straight into the history
+void EndPassTimings()
+{
+	gD3DContext->End(gGpuTimingQueries[gGpuTimingSet].disjoint);
+	gGpuTiming.EndFrame();
+	gPassTimer.EndFrame(gPassTimings);
+}
+
+
+// Times a post-processing pass on the CPU and GPU from its construction to the end of its scope, and records it in any
+// trace capture. Only use between BeginPassTimings and EndPassTimings
+class ScopedPassTiming
+{
+public:
+	explicit ScopedPassTiming(const std::string& name) : mTrace("Post-process", name)
+	{
+		mCpuPass = gPassTimer.BeginPass(name);
+		mGpuPass = gGpuTiming.BeginPass(name);
+		if (mGpuPass >= 0)  gD3DContext->End(gGpuTimingQueries[gGpuTimingSet].begin[mGpuPass]);
+	}
+
+	~ScopedPassTiming()
+	{
+		if (mGpuPass >= 0)  gD3DContext->End(gGpuTimingQueries[gGpuTimingSet].end[mGpuPass]);
+		gPassTimer.EndPass(mCpuPass);
+	}
+
+private:
+	ScopedTraceEvent mTrace;
+	int mCpuPass;
+	int mGpuPass;
+};
+
+
+
+// The post-processing passes (see PostProcessPasses.h) draw with DirectX. The state filter takes the same types, so
+// the passes can set their states through it
+struct D3D11PostProcessApi : D3D11StateApi
+{
+	using Resource          = ID3D11Resource;
+	using Texture2D         = ID3D11Texture2D;
+	using Texture3D         = ID3D11Texture3D;
+	using Box               = D3D11_BOX;
+	using PostProcessShader = ::PostProcessShader;
+	using PassTiming        = ScopedPassTiming;
+	static constexpr D3D11_PRIMITIVE_TOPOLOGY TRIANGLE_STRIP = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+
+	static void* Map(ID3D11DeviceContext* context, ID3D11Buffer* buffer)
+	{
+		D3D11_MAPPED_SUBRESOURCE mappedBuffer;
+		if (FAILED(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer)))  return nullptr;
+		return mappedBuffer.pData;
+	}
+	static void Unmap(ID3D11DeviceContext* context, ID3D11Buffer* buffer)  { context->Unmap(buffer, 0); }
+
+	// Create the texture and views for a render target from the pool. Returns false on failure
+	static bool CreateRenderTarget(int /*slot*/, const RenderTargetDesc& desc, PostProcessTarget<D3D11PostProcessApi>& target)
+	{
+		// We will render to these textures instead of the back-buffer (screen). This is exactly the same code we used in the
+		// graphics module when we were rendering the scene onto a cube using a texture
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = desc.width;
+		textureDesc.Height = desc.height;
+		textureDesc.MipLevels = 1; // No mip-maps when rendering to textures (or we would have to render every level)
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = (desc.format == RenderTargetFormat::RGBA16F) ? DXGI_FORMAT_R16G16B16A16_FLOAT  // Bloom chain - values can add up past 1
+		                                                                  : DXGI_FORMAT_R8G8B8A8_UNORM;     // RGBA texture (8-bits each)
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.SampleDesc.Quality = 0;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+		textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE; // IMPORTANT: Indicate we will use texture as render target, and pass it to shaders
+		textureDesc.CPUAccessFlags = 0;
+		textureDesc.MiscFlags = 0;
+
+		// Also need a "view" of the texture as a render target, and a shader-resource "view" to send it to the shaders
+		if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, NULL, &target.texture)) ||
+			FAILED(gD3DDevice->CreateRenderTargetView(target.texture, NULL, &target.renderTarget)) ||
+			FAILED(gD3DDevice->CreateShaderResourceView(target.texture, NULL, &target.textureSRV)))
+		{
+			gLastError = "Error creating post-processing render target";
+			return false;
+		}
+		return true;
+	}
+
+	static ID3D11PixelShader* CreateFusedShader(const std::vector<PostProcess>& stages, ShaderVariant variant)
+	{
+		return CompilePixelShader(GenerateFusedShaderSource(stages, variant));
+	}
+
+	// Create the 3D texture holding a colour lookup table, filled with the baked table
+	static bool CreateColourLutTexture(int size, const std::vector<uint8_t>& texels, PostProcessColourLut<D3D11PostProcessApi>& colourLut)
+	{
+		D3D11_TEXTURE3D_DESC lutDesc = {};
+		lutDesc.Width = size;
+		lutDesc.Height = size;
+		lutDesc.Depth = size;
+		lutDesc.MipLevels = 1;
+		lutDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		lutDesc.Usage = D3D11_USAGE_DEFAULT;
+		lutDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		D3D11_SUBRESOURCE_DATA initialData = { texels.data(), static_cast<UINT>(size * 4), static_cast<UINT>(size * size * 4) };
+		return SUCCEEDED(gD3DDevice->CreateTexture3D(&lutDesc, &initialData, &colourLut.texture)) &&
+		       SUCCEEDED(gD3DDevice->CreateShaderResourceView(colourLut.texture, nullptr, &colourLut.textureSRV));
+	}
+
+	template <typename Object>
+	static void Release(Object* object)  { if (object)  object->Release(); }
+};
+
+// All the pipeline state set here goes through this filter, which drops calls that wouldn't change anything (see
+// StateCache.h). Other work on the context (draws, copies, clears, buffer updates) goes straight to gD3DContext
+StateFilter<D3D11PostProcessApi> gStateFilter;
+
+// The passes run on the scene texture after it has been rendered, for the post-process list above. They own the
+// render target pool and its textures, the fused shaders and the colour lookup tables
+PostProcessPasses<D3D11PostProcessApi> gPostProcessPasses(gStateFilter, gPostProcessList, gConstantsList, gPostProcessingConstants);
+
+
+
+
 //--------------------------------------------------------------------------------------
 // Initialise scene geometry, constant buffers and states
 //--------------------------------------------------------------------------------------
@@ -234,9 +399,17 @@ ID3D11ShaderResourceView* gDistortMapSRV = nullptr;
 // Returns true on success
 bool InitGeometry()
 {
+	SetTraceThreadName("Main");
+	StartTraceCapture(STARTUP_TRACE_FRAMES);
+	ScopedTraceEvent trace("Start-up", "InitGeometry");
+
+	gStateFilter.SetContext(gD3DContext);
+
 	////--------------- Load meshes ---------------////
 
 	// Load mesh geometry data, just like TL-Engine this doesn't create anything in the scene. Create a Model for that.
+	// Mesh runs its importer on the file every time - it has no way to be built from the geometry of a CachedMesh
+	// (MeshCache.h), so the meshes can't be loaded through the cache yet
 	try
 	{
 		gStarsMesh = new Mesh("Stars.x");
@@ -256,18 +429,20 @@ bool InitGeometry()
 	////--------------- Load / prepare textures & GPU states ---------------////
 
 	// Load textures and create DirectX objects for them
-	// The LoadTexture function requires you to pass a ID3D11Resource* (e.g. &gCubeDiffuseMap), which manages the GPU memory for the
+	// The LoadTextureAsync function requires you to pass a ID3D11Resource* (e.g. &gCubeDiffuseMap), which manages the GPU memory for the
 	// texture and also a ID3D11ShaderResourceView* (e.g. &gCubeDiffuseMapSRV), which allows us to use the texture in shaders
-	// The function will fill in these pointers with usable data. The variables used here are globals found near the top of the file.
-	if (!LoadTexture("Stars.jpg", &gStarsDiffuseSpecularMap, &gStarsDiffuseSpecularMapSRV) ||
-		!LoadTexture("GrassDiffuseSpecular.dds", &gGroundDiffuseSpecularMap, &gGroundDiffuseSpecularMapSRV) ||
-		!LoadTexture("StoneDiffuseSpecular.dds", &gCubeDiffuseSpecularMap, &gCubeDiffuseSpecularMapSRV) ||
-		!LoadTexture("CargoA.dds", &gCrateDiffuseSpecularMap, &gCrateDiffuseSpecularMapSRV) ||
-		!LoadTexture("brick_35.jpg", &gWallDiffuseSpecularMap, &gWallDiffuseSpecularMapSRV) ||
-		!LoadTexture("Flare.jpg", &gLightDiffuseMap, &gLightDiffuseMapSRV) ||
-		!LoadTexture("Noise.png", &gNoiseMap, &gNoiseMapSRV) ||
-		!LoadTexture("Burn.png", &gBurnMap, &gBurnMapSRV) ||
-		!LoadTexture("Distort.png", &gDistortMap, &gDistortMapSRV))
+	// The function will fill in these pointers with a placeholder straight away, and the files are decoded in the background.
+	// The real textures replace the placeholder as they arrive, in UploadLoadedTextures at the start of each frame (see Texture.h).
+	// The variables used here are globals found near the top of the file.
+	if (!LoadTextureAsync("Stars.jpg", &gStarsDiffuseSpecularMap, &gStarsDiffuseSpecularMapSRV) ||
+		!LoadTextureAsync("GrassDiffuseSpecular.dds", &gGroundDiffuseSpecularMap, &gGroundDiffuseSpecularMapSRV) ||
+		!LoadTextureAsync("StoneDiffuseSpecular.dds", &gCubeDiffuseSpecularMap, &gCubeDiffuseSpecularMapSRV) ||
+		!LoadTextureAsync("CargoA.dds", &gCrateDiffuseSpecularMap, &gCrateDiffuseSpecularMapSRV) ||
+		!LoadTextureAsync("brick_35.jpg", &gWallDiffuseSpecularMap, &gWallDiffuseSpecularMapSRV) ||
+		!LoadTextureAsync("Flare.jpg", &gLightDiffuseMap, &gLightDiffuseMapSRV) ||
+		!LoadTextureAsync("Noise.png", &gNoiseMap, &gNoiseMapSRV) ||
+		!LoadTextureAsync("Burn.png", &gBurnMap, &gBurnMapSRV) ||
+		!LoadTextureAsync("Distort.png", &gDistortMap, &gDistortMapSRV))
 	{
 		gLastError = "Error loading textures";
 		return false;
@@ -296,91 +471,98 @@ bool InitGeometry()
 	// See the comments above where these variable are declared and also the UpdateScene function
 	gPerFrameConstantBuffer = CreateConstantBuffer(sizeof(gPerFrameConstants));
 	gPerModelConstantBuffer = CreateConstantBuffer(sizeof(gPerModelConstants));
-	gPostProcessingConstantBuffer = CreateConstantBuffer(sizeof(gPostProcessingConstants));
-	if (gPerFrameConstantBuffer == nullptr || gPerModelConstantBuffer == nullptr || gPostProcessingConstantBuffer == nullptr)
+	if (gPerFrameConstantBuffer == nullptr || gPerModelConstantBuffer == nullptr)
 	{
 		gLastError = "Error creating constant buffers";
 		return false;
 	}
-
-
-
-	//********************************************
-	//**** Create Scene Texture
-
-	// We will render the scene to this texture instead of the back-buffer (screen), then we post-process the texture onto the screen
-	// This is exactly the same code we used in the graphics module when we were rendering the scene onto a cube using a texture
-
-	// Using a helper function to load textures from files above. Here we create the scene texture manually
-	// as we are creating a special kind of texture (one that we can render to). Many settings to prepare:
-	D3D11_TEXTURE2D_DESC sceneTextureDesc = {};
-	sceneTextureDesc.Width = gViewportWidth;  // Full-screen post-processing - use full screen size for texture
-	sceneTextureDesc.Height = gViewportHeight;
-	sceneTextureDesc.MipLevels = 1; // No mip-maps when rendering to textures (or we would have to render every level)
-	sceneTextureDesc.ArraySize = 1;
-	sceneTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // RGBA texture (8-bits each)
-	sceneTextureDesc.SampleDesc.Count = 1;
-	sceneTextureDesc.SampleDesc.Quality = 0;
-	sceneTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-	sceneTextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE; // IMPORTANT: Indicate we will use texture as render target, and pass it to shaders
-	sceneTextureDesc.CPUAccessFlags = 0;
-	sceneTextureDesc.MiscFlags = 0;
-	if (FAILED(gD3DDevice->CreateTexture2D(&sceneTextureDesc, NULL, &gSceneTexture)))
-	{
-		gLastError = "Error creating scene texture";
-		return false;
-	}
-	if (FAILED(gD3DDevice->CreateTexture2D(&sceneTextureDesc, NULL, &gSceneTextureOne)))
+	for (int block = 0; block < NUM_POST_PROCESS_CONSTANT_BLOCKS; ++block)
 	{
-		gLastError = "Error creating scene texture";
-		return false;
-	}
-	if (FAILED(gD3DDevice->CreateTexture2D(&sceneTextureDesc, NULL, &gSceneTextureTwo)))
-	{
-		gLastError = "Error creating scene texture";
-		return false;
+		size_t offset, size;
+		PostProcessConstantBlockRange(static_cast<PostProcessConstantBlock>(block), offset, size);
+		gPostProcessingConstantBuffers[block] = CreateConstantBuffer(static_cast<int>(size));
+		if (gPostProcessingConstantBuffers[block] == nullptr)
+		{
+			gLastError = "Error creating constant buffers";
+			return false;
+		}
 	}
 
-	// We created the scene texture above, now we get a "view" of it as a render target, i.e. get a special pointer to the texture that
-	// we use when rendering to it (see RenderScene function below)
-	if (FAILED(gD3DDevice->CreateRenderTargetView(gSceneTexture, NULL, &
-		gSceneRenderTarget)))
+	// Structured buffer holding the windows of a polygon batch, rewritten each time a batch is drawn
+	D3D11_BUFFER_DESC batchDesc = {};
+	batchDesc.ByteWidth = MAX_POLYGON_BATCH * sizeof(PolygonInstance);
+	batchDesc.Usage = D3D11_USAGE_DYNAMIC;
+	batchDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	batchDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	batchDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	batchDesc.StructureByteStride = sizeof(PolygonInstance);
+	D3D11_SHADER_RESOURCE_VIEW_DESC batchSRVDesc = {};
+	batchSRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+	batchSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	batchSRVDesc.Buffer.FirstElement = 0;
+	batchSRVDesc.Buffer.NumElements = MAX_POLYGON_BATCH;
+	gPolygonBatchConstantBuffer = CreateConstantBuffer(sizeof(PolygonBatchConstants));
+	if (FAILED(gD3DDevice->CreateBuffer(&batchDesc, nullptr, &gPolygonBatchBuffer)) ||
+		FAILED(gD3DDevice->CreateShaderResourceView(gPolygonBatchBuffer, &batchSRVDesc, &gPolygonBatchBufferSRV)) ||
+		gPolygonBatchConstantBuffer == nullptr)
 	{
-		gLastError = "Error creating scene render target view";
+		gLastError = "Error creating polygon batch buffers";
 		return false;
 	}
-	if (FAILED(gD3DDevice->CreateRenderTargetView(gSceneTextureOne, NULL, &gSceneRenderTargetCopy)))
-	{
-		gLastError = "Error creating scene render target view";
-		return false;
-	}
-	if (FAILED(gD3DDevice->CreateRenderTargetView(gSceneTextureTwo, NULL, &gSceneRenderTargetTwo)))
+
+	// Queries counting the pixel shader invocations of the opaque models, to measure overdraw
+	D3D11_QUERY_DESC overdrawQueryDesc = { D3D11_QUERY_PIPELINE_STATISTICS, 0 };
+	for (auto& query : gOverdrawQueries)
 	{
-		gLastError = "Error creating scene render target Two view";
-		return false;
+		if (FAILED(gD3DDevice->CreateQuery(&overdrawQueryDesc, &query)))
+		{
+			gLastError = "Error creating overdraw queries";
+			return false;
+		}
 	}
 
-	// We also need to send this texture (resource) to the shaders. To do that we must create a shader-resource "view"
-	D3D11_SHADER_RESOURCE_VIEW_DESC srDesc = {};
-	srDesc.Format = sceneTextureDesc.Format;
-	srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srDesc.Texture2D.MostDetailedMip = 0;
-	srDesc.Texture2D.MipLevels = 1;
-	if (FAILED(gD3DDevice->CreateShaderResourceView(gSceneTexture, &srDesc, &gSceneTextureSRV)))
+	// Queries timing the post-processing passes on the GPU
+	D3D11_QUERY_DESC disjointQueryDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+	D3D11_QUERY_DESC timestampQueryDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+	for (auto& queries : gGpuTimingQueries)
 	{
-		gLastError = "Error creating scene shader resource view";
-		return false;
+		bool created = SUCCEEDED(gD3DDevice->CreateQuery(&disjointQueryDesc, &queries.disjoint));
+		for (int pass = 0; pass < MAX_TIMED_PASSES && created; ++pass)
+		{
+			created = SUCCEEDED(gD3DDevice->CreateQuery(&timestampQueryDesc, &queries.begin[pass])) &&
+			          SUCCEEDED(gD3DDevice->CreateQuery(&timestampQueryDesc, &queries.end[pass]));
+		}
+		if (!created)
+		{
+			gLastError = "Error creating timing queries";
+			return false;
+		}
 	}
-	if (FAILED(gD3DDevice->CreateShaderResourceView(gSceneTextureOne, &srDesc, &gSceneTextureOneSRV)))
+
+
+
+	//********************************************
+	//**** Post-processing render targets
+
+	// The scene and post-processing textures come from a pool and are created the first time they are needed (see
+	// PostProcessPasses::GetRenderTarget). Screen sized textures hold the scene and the result of each post-process
+	gPostProcessPasses.SetScreenSize(gViewportWidth, gViewportHeight); // Full-screen post-processing - use full screen size for texture
+	const RenderTargetDesc& sceneTargetDesc = gPostProcessPasses.SceneTargetDesc();
+	RenderTargetPool& renderTargetPool = gPostProcessPasses.TargetPool();
+
+	// Create the textures most frames need now so any failure is reported at startup - two screen sized textures to
+	// ping-pong between and the bloom chain. They go straight back into the pool ready for the first frame
+	std::vector<RenderTargetDesc> startupTargets = { sceneTargetDesc, sceneTargetDesc };
+	for (int level = 0; level < NUM_BLOOM_LEVELS; ++level)
 	{
-		gLastError = "Error creating scene shader resource view";
-		return false;
+		startupTargets.push_back(BloomLevelDesc(level, sceneTargetDesc));
 	}
-	if (FAILED(gD3DDevice->CreateShaderResourceView(gSceneTextureTwo, &srDesc, &gSceneTextureTwoSRV)))
+	for (auto& desc : startupTargets)
 	{
-		gLastError = "Error creating scene shader resource view";
-		return false;
+		if (gPostProcessPasses.GetRenderTarget(renderTargetPool.Acquire(desc)) == nullptr)  return false;
 	}
+	renderTargetPool.ReleaseAll();
+	renderTargetPool.ResetPeak();
 
 
 	return true;
@@ -391,6 +573,8 @@ bool InitGeometry()
 // Returns true on success
 bool InitScene()
 {
+	ScopedTraceEvent trace("Start-up", "InitScene");
+
 	////--------------- Set up scene ---------------////
 
 	gStars = new Model(gStarsMesh);
@@ -453,7 +637,6 @@ bool InitScene()
 
 	gPostProcessingConstants.tintTopColour = { 0, 0, 1 };
 	gPostProcessingConstants.tintBottomColour = { 0, 1, 0 };
-	gPostProcessingConstants.blurStrength = 13;
 	gPostProcessingConstants.MidLine = 0.5f;
 	//gPostProcessingConstants.MidLineEnabled = true;
 	//gPostProcessingConstants.IsFullScreen = true;
@@ -472,17 +655,11 @@ void ReleaseResources()
 {
 	ReleaseStates();
 
-	if (gSceneTextureSRV)              gSceneTextureSRV->Release();
-	if (gSceneRenderTarget)            gSceneRenderTarget->Release();
-	if (gSceneTexture)                 gSceneTexture->Release();
-
-	if (gSceneTextureOneSRV)              gSceneTextureOneSRV->Release();
-	if (gSceneRenderTargetCopy)            gSceneRenderTargetCopy->Release();
-	if (gSceneTextureOne)                 gSceneTextureOne->Release();
+	// Textures still loading are discarded, leaving the placeholder in their slots to be released below
+	ReleaseTextureLoader();
 
-	if (gSceneTextureTwoSRV)              gSceneTextureTwoSRV->Release();
-	if (gSceneRenderTargetTwo)            gSceneRenderTargetTwo->Release();
-	if (gSceneTextureTwo)                 gSceneTextureTwo->Release();
+	// Render targets, fused pass shaders and colour lookup tables
+	gPostProcessPasses.Release();
 
 	if (gDistortMapSRV)                gDistortMapSRV->Release();
 	if (gDistortMap)                   gDistortMap->Release();
@@ -504,7 +681,29 @@ void ReleaseResources()
 	if (gStarsDiffuseSpecularMapSRV)   gStarsDiffuseSpecularMapSRV->Release();
 	if (gStarsDiffuseSpecularMap)      gStarsDiffuseSpecularMap->Release();
 
-	if (gPostProcessingConstantBuffer)  gPostProcessingConstantBuffer->Release();
+	for (auto& query : gOverdrawQueries)
+	{
+		if (query)  query->Release();
+		query = nullptr;
+	}
+	for (auto& queries : gGpuTimingQueries)
+	{
+		if (queries.disjoint)  queries.disjoint->Release();
+		for (int pass = 0; pass < MAX_TIMED_PASSES; ++pass)
+		{
+			if (queries.begin[pass])  queries.begin[pass]->Release();
+			if (queries.end[pass])    queries.end[pass]->Release();
+		}
+		queries = GpuTimingQueries();
+	}
+	if (gPolygonBatchConstantBuffer)    gPolygonBatchConstantBuffer->Release();
+	if (gPolygonBatchBufferSRV)         gPolygonBatchBufferSRV->Release();
+	if (gPolygonBatchBuffer)            gPolygonBatchBuffer->Release();
+	for (auto& constantBuffer : gPostProcessingConstantBuffers)
+	{
+		if (constantBuffer)  constantBuffer->Release();
+		constantBuffer = nullptr;
+	}
 	if (gPerModelConstantBuffer)        gPerModelConstantBuffer->Release();
 	if (gPerFrameConstantBuffer)        gPerFrameConstantBuffer->Release();
 
@@ -536,6 +735,17 @@ void ReleaseResources()
 // Scene Rendering
 //--------------------------------------------------------------------------------------
 
+// Model::Render binds its geometry, input layout and per-model constant buffer straight on the context, so after drawing
+// models the state filter can't know what those are
+void ModelsRendered()
+{
+	gStateFilter.Invalidate(StateKind::InputLayout);
+	gStateFilter.Invalidate(StateKind::PrimitiveTopology);
+	gStateFilter.Invalidate(StateKind::VSConstantBuffer);
+	gStateFilter.Invalidate(StateKind::GSConstantBuffer);
+	gStateFilter.Invalidate(StateKind::PSConstantBuffer);
+}
+
 void RenderDepthBufferFromCamera(Camera* camera)
 {
 
@@ -546,23 +756,25 @@ void RenderDepthBufferFromCamera(Camera* camera)
 	UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
 
 	// Indicate that the constant buffer we just updated is for use in the vertex shader (VS) and pixel shader (PS)
-	gD3DContext->VSSetConstantBuffers(1, 1, &gPerFrameConstantBuffer); // First parameter must match constant buffer number in the shader 
-	gD3DContext->PSSetConstantBuffers(1, 1, &gPerFrameConstantBuffer);
+	gStateFilter.VSSetConstantBuffers(1, 1, &gPerFrameConstantBuffer); // First parameter must match constant buffer number in the shader 
+	gStateFilter.PSSetConstantBuffers(1, 1, &gPerFrameConstantBuffer);
 
-	// Use special depth-only rendering shaders
-	gD3DContext->VSSetShader(gBasicTransformVertexShader, nullptr, 0);
-	gD3DContext->PSSetShader(gDepthOnlyPixelShader, nullptr, 0);
+	// Use special depth-only rendering shaders. No render target is bound so no pixel shader is needed, the depths are
+	// written without one (see the note in DepthOnly_ps.hlsl)
+	gStateFilter.VSSetShader(gBasicTransformVertexShader, nullptr, 0);
+	gStateFilter.PSSetShader(nullptr, nullptr, 0);
 
 	// States - no blending, normal depth buffer and culling
-	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
-	gD3DContext->OMSetDepthStencilState(gUseDepthBufferState, 0);
-	gD3DContext->RSSetState(gCullBackState);
+	gStateFilter.OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
+	gStateFilter.OMSetDepthStencilState(gUseDepthBufferState, 0);
+	gStateFilter.RSSetState(gCullBackState);
 
 	// Render models - no state changes required between each object in this situation (no textures used in this step)
 	gGround->Render();
 	gCrate->Render();
 	gCube->Render();
 	gWall->Render();
+	ModelsRendered();
 }
 
 // Render everything in the scene from the given camera
@@ -585,73 +797,91 @@ void RenderSceneFromCamera(Camera* camera)
 	UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
 
 	// Indicate that the constant buffer we just updated is for use in the vertex shader (VS), geometry shader (GS) and pixel shader (PS)
-	gD3DContext->VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer); // First parameter must match constant buffer number in the shader 
-	gD3DContext->GSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
-	gD3DContext->PSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
+	gStateFilter.VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer); // First parameter must match constant buffer number in the shader 
+	gStateFilter.GSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
+	gStateFilter.PSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
 
-	gD3DContext->PSSetShader(gPixelLightingPixelShader, nullptr, 0);
+	gStateFilter.PSSetShader(gPixelLightingPixelShader, nullptr, 0);
 
 
 	////--------------- Render ordinary models ---------------///
 
 	// Select which shaders to use next
-	gD3DContext->VSSetShader(gPixelLightingVertexShader, nullptr, 0);
-	gD3DContext->PSSetShader(gPixelLightingPixelShader, nullptr, 0);
-	gD3DContext->GSSetShader(nullptr, nullptr, 0);  // Switch off geometry shader when not using it (pass nullptr for first parameter)
-
-	// States - no blending, normal depth buffer and back-face culling (standard set-up for opaque models)
-	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
-	gD3DContext->OMSetDepthStencilState(gUseDepthBufferState, 0);
-	gD3DContext->RSSetState(gCullBackState);
+	gStateFilter.VSSetShader(gPixelLightingVertexShader, nullptr, 0);
+	gStateFilter.PSSetShader(gPixelLightingPixelShader, nullptr, 0);
+	gStateFilter.GSSetShader(nullptr, nullptr, 0);  // Switch off geometry shader when not using it (pass nullptr for first parameter)
+
+	// States - no blending, normal depth buffer and back-face culling (standard set-up for opaque models). After a depth
+	// pre-pass the depths are already in place, so the depth buffer is only read and just the matching pixels are drawn
+	gStateFilter.OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
+	gStateFilter.OMSetDepthStencilState(gUseDepthPrePass ? gDepthPrePassState : gUseDepthBufferState, 0);
+	gStateFilter.RSSetState(gCullBackState);
+
+	// Count the pixel shader invocations of the opaque models. The query in this slot was issued NUM_OVERDRAW_QUERIES
+	// frames ago, collect its result first if the GPU has finished with it
+	ID3D11Query* overdrawQuery = gOverdrawQueries[gOverdrawFrame % NUM_OVERDRAW_QUERIES];
+	D3D11_QUERY_DATA_PIPELINE_STATISTICS statistics;
+	if (gOverdrawFrame >= NUM_OVERDRAW_QUERIES &&
+	    gD3DContext->GetData(overdrawQuery, &statistics, sizeof(statistics), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+	{
+		gOpaquePixelShaderInvocations = statistics.PSInvocations;
+	}
+	gD3DContext->Begin(overdrawQuery);
 
 	// Render lit models, only change textures for each onee
-	gD3DContext->PSSetSamplers(0, 1, &gAnisotropic4xSampler);
+	gStateFilter.PSSetSamplers(0, 1, &gAnisotropic4xSampler);
 
-	gD3DContext->PSSetShaderResources(0, 1, &gGroundDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
+	gStateFilter.PSSetShaderResources(0, 1, &gGroundDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
 	gGround->Render();
 
-	gD3DContext->PSSetShaderResources(0, 1, &gCrateDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
+	gStateFilter.PSSetShaderResources(0, 1, &gCrateDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
 	gCrate->Render();
 
-	gD3DContext->PSSetShaderResources(0, 1, &gCubeDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
+	gStateFilter.PSSetShaderResources(0, 1, &gCubeDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
 	gCube->Render();
 
-	gD3DContext->PSSetShaderResources(0, 1, &gWallDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
+	gStateFilter.PSSetShaderResources(0, 1, &gWallDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
 	gWall->Render();
+	ModelsRendered();
+
+	gD3DContext->End(overdrawQuery);
+	++gOverdrawFrame;
 
 
 
 	////--------------- Render sky ---------------////
 
 	// Select which shaders to use next
-	gD3DContext->VSSetShader(gBasicTransformVertexShader, nullptr, 0);
-	gD3DContext->PSSetShader(gTintedTexturePixelShader, nullptr, 0);
+	gStateFilter.VSSetShader(gBasicTransformVertexShader, nullptr, 0);
+	gStateFilter.PSSetShader(gTintedTexturePixelShader, nullptr, 0);
 
 	// Using a pixel shader that tints the texture - don't need a tint on the sky so set it to white
 	gPerModelConstants.objectColour = { 1, 1, 1 };
 
-	// Stars point inwards
-	gD3DContext->RSSetState(gCullNoneState);
+	// Stars point inwards. The sky isn't in the depth pre-pass, so it needs the normal depth buffer state to write its depths
+	gStateFilter.OMSetDepthStencilState(gUseDepthBufferState, 0);
+	gStateFilter.RSSetState(gCullNoneState);
 
 	// Render sky
-	gD3DContext->PSSetShaderResources(0, 1, &gStarsDiffuseSpecularMapSRV);
+	gStateFilter.PSSetShaderResources(0, 1, &gStarsDiffuseSpecularMapSRV);
 	gStars->Render();
+	ModelsRendered();
 
 
 
 	////--------------- Render lights ---------------////
 
 	// Select which shaders to use next (actually same as before, so we could skip this)
-	gD3DContext->VSSetShader(gBasicTransformVertexShader, nullptr, 0);
-	gD3DContext->PSSetShader(gTintedTexturePixelShader, nullptr, 0);
+	gStateFilter.VSSetShader(gBasicTransformVertexShader, nullptr, 0);
+	gStateFilter.PSSetShader(gTintedTexturePixelShader, nullptr, 0);
 
 	// Select the texture and sampler to use in the pixel shader
-	gD3DContext->PSSetShaderResources(0, 1, &gLightDiffuseMapSRV); // First parameter must match texture slot number in the shaer
+	gStateFilter.PSSetShaderResources(0, 1, &gLightDiffuseMapSRV); // First parameter must match texture slot number in the shaer
 
 	// States - additive blending, read-only depth buffer and no culling (standard set-up for blending)
-	gD3DContext->OMSetBlendState(gAdditiveBlendingState, nullptr, 0xffffff);
-	gD3DContext->OMSetDepthStencilState(gDepthReadOnlyState, 0);
-	gD3DContext->RSSetState(gCullNoneState);
+	gStateFilter.OMSetBlendState(gAdditiveBlendingState, nullptr, 0xffffff);
+	gStateFilter.OMSetDepthStencilState(gDepthReadOnlyState, 0);
+	gStateFilter.RSSetState(gCullNoneState);
 
 	// Render all the lights in the array
 	for (int i = 0; i < NUM_LIGHTS; ++i)
@@ -659,6 +889,7 @@ void RenderSceneFromCamera(Camera* camera)
 		gPerModelConstants.objectColour = gLights[i].colour; // Set any per-model constants apart from the world matrix just before calling render (light colour here)
 		gLights[i].model->Render();
 	}
+	ModelsRendered();
 
 
 }
@@ -667,457 +898,131 @@ void RenderSceneFromCamera(Camera* camera)
 
 //**************************
 
-// Select the appropriate shader plus any additional textures required for a given post-process
-// Helper function shared by full-screen, area and polygon post-processing functions below
-void SelectPostProcessShaderAndTextures(PostProcess postProcess, float frameTime, int i)
+// Write the last trace capture to TRACE_FILE, keeping the result to show in ImGui
+void SaveTraceCapture()
 {
-	if (postProcess == PostProcess::Copy)
-	{
-		gD3DContext->PSSetShader(gCopyPostProcess, nullptr, 0);
-	}
-
-	else if (postProcess == PostProcess::Tint)
-	{
-		gPostProcessingConstants.tintBottomColour = gConstantsList[i].tintBottomColour;
-		gPostProcessingConstants.tintTopColour = gConstantsList[i].tintTopColour;
-		gD3DContext->PSSetShader(gTintPostProcess, nullptr, 0);
-	}
-
-	else if (postProcess == PostProcess::GreyNoise)
-	{
-		gD3DContext->PSSetShader(gGreyNoisePostProcess, nullptr, 0);
-
-		// Noise scaling adjusts how fine the noise is.
-		const float grainSize = 140; // Fineness of the noise grain
-		gPostProcessingConstants.noiseScale = { gViewportWidth / grainSize, gViewportHeight / grainSize };
-
-		// The noise offset is randomised to give a constantly changing noise effect (like tv static)
-		gPostProcessingConstants.noiseOffset = { Random(0.0f, 1.0f), Random(0.0f, 1.0f) };
-
-		// Give pixel shader access to the noise texture
-		gD3DContext->PSSetShaderResources(1, 1, &gNoiseMapSRV);
-		gD3DContext->PSSetSamplers(1, 1, &gTrilinearSampler);
-	}
-
-	else if (postProcess == PostProcess::Burn)
-	{
-		gD3DContext->PSSetShader(gBurnPostProcess, nullptr, 0);
-
-		// Set and increase the burn level (cycling back to 0 when it reaches 1.0f)
-		const float burnSpeed = 0.2f;
-		gPostProcessingConstants.burnHeight = fmod(gPostProcessingConstants.burnHeight + burnSpeed * frameTime, 1.0f);
-
-		// Give pixel shader access to the burn texture (basically a height map that the burn level ascends)
-		gD3DContext->PSSetShaderResources(1, 1, &gBurnMapSRV);
-		gD3DContext->PSSetSamplers(1, 1, &gTrilinearSampler);
-	}
-
-	else if (postProcess == PostProcess::Distort)
-	{
-		gD3DContext->PSSetShader(gDistortPostProcess, nullptr, 0);
-
-		// Give pixel shader access to the distortion texture (containts 2D vectors (in R & G) to shift the texture UVs to give a cut-glass impression)
-		gD3DContext->PSSetShaderResources(1, 1, &gDistortMapSRV);
-		gD3DContext->PSSetSamplers(1, 1, &gTrilinearSampler);
-	}
-
-	else if (postProcess == PostProcess::Spiral)
-	{
-		gD3DContext->PSSetShader(gSpiralPostProcess, nullptr, 0);
-
-		static float spiral = 0.0f;
-		const float spiralSpeed = 1.0f;
-
-		// Set and increase the amount of spiral - use a tweaked cos wave to animate
-		gPostProcessingConstants.spiralLevel = ((1.0f - cos(spiral)) * 4.0f);
-		spiral += spiralSpeed * frameTime;
-
-		gD3DContext->PSSetShader(gSpiralPostProcess, nullptr, 0);
-	}
-
-	else if (postProcess == PostProcess::HeatHaze)
-	{
-		gD3DContext->PSSetShader(gHeatHazePostProcess, nullptr, 0);
-
-		gPostProcessingConstants.heatHazeTimer += frameTime;
-	}
-
-	else if (postProcess == PostProcess::HueTint)
-	{
-		gD3DContext->PSSetShader(gHueTintPostProcess, nullptr, 0);
-
-		gPostProcessingConstants.HueWiggle += gConstantsList[i].HueWiggleSpeed * frameTime;
-	}
-
-	else if (postProcess == PostProcess::Underwater)
-	{
-		gD3DContext->PSSetShader(gUnderwaterPostProcess, nullptr, 0);
-		gPostProcessingConstants.waterColour = { 0.2, 0.4, 1 };
-		gConstantsList[i].Wiggle += gConstantsList[i].WiggleSpeed * frameTime;
-		gPostProcessingConstants.Wiggle = gConstantsList[i].Wiggle;
-
-	}
-
-	else if (postProcess == PostProcess::Inverted)
-	{
-		gD3DContext->PSSetShader(gInvertedColourPostProcess, nullptr, 0);
-	}
-
-	else if (postProcess == PostProcess::NightVision)
-	{
-		gD3DContext->PSSetShader(gNightVisionPostProcess, nullptr, 0);
-	}
-
-	else if (postProcess == PostProcess::BlurH)
-	{
-		gD3DContext->PSSetShader(gBlurHPostProcess, nullptr, 0);
-
-		/*int blurStrength = 5;
-
-		std::array<float,300> kernels;
-		std::array<float, 300> weights;*/
-		//const int arraySize = 100;
-
-		gPostProcessingConstants.blurStrength = gConstantsList[i].blurStrength;
-
-		if (gPostProcessingConstants.blurStrength % 2 == 0)
-		{
-			gPostProcessingConstants.blurStrength -= 1;
-		}
-
-		double sigma = 40;
-
-		double mean = (gPostProcessingConstants.blurStrength - 1) / 2;
-		double sum = 0.0; // For accumulating the kernel values
-
-		for (int x = 0; x < gPostProcessingConstants.blurStrength; ++x)
-		{
-			gPostProcessingConstants.weight[x].x = exp(-0.5 * (pow((x - mean) / sigma, 2.0) + pow((x - mean) / sigma, 2.0))) / (2 * PI * sigma * sigma);
-
-			// Accumulate the kernel values
-			sum += gPostProcessingConstants.weight[x].x;
-		}
-
-		// Normalize the kernel
-		for (int x = 0; x < gPostProcessingConstants.blurStrength; ++x)
-		{
-			gPostProcessingConstants.weight[x].x /= sum;
-		}
-
-		//int kernel[arraySize];
-		int midpoint = (gPostProcessingConstants.blurStrength - 1) / 2;
-
-		gPostProcessingConstants.kernel[midpoint].x = 0;
-		for (int x = 1; x <= midpoint; x++)
-		{
-			gPostProcessingConstants.kernel[midpoint + x].x = x;
-			gPostProcessingConstants.kernel[midpoint - x].x = -x;
-		}
-	}
-	else if (postProcess == PostProcess::BlurV)
-	{
-		gD3DContext->PSSetShader(gBlurVPostProcess, nullptr, 0);
-	}
-	else if (postProcess == PostProcess::Retro)
-	{
-		gD3DContext->PSSetShader(gRetroPostProcess, nullptr, 0);
-	}
-	else if (postProcess == PostProcess::Bloom1)
-	{
-		gPostProcessingConstants.bloomThreshold = gConstantsList[i].bloomThreshold;
-		gD3DContext->PSSetShader(gBloom1PostProcess, nullptr, 0);
-	}
-	else if (postProcess == PostProcess::Bloom2)
-	{
-		gD3DContext->PSSetShader(gBloom2PostProcess, nullptr, 0);
-		gD3DContext->PSSetShaderResources(1, 1, &gSceneTextureOneSRV);
-	}
-	else if (postProcess == PostProcess::DepthOfField)
-	{
-		gPostProcessingConstants.depthThreshold = gConstantsList[i].depthThreshold;
-		gD3DContext->PSSetShader(gDepthOfFieldPostProcess, nullptr, 0);
-		// gD3DContext->PSSetShaderResources(2, 1, &gDepthShaderView);
-		// gD3DContext->PSSetSamplers(2, 1, &gPointSampler);
-	}
-
+	gTraceSaveResult = WriteTraceJson(TRACE_FILE) ? std::string("Written to ") + TRACE_FILE : std::string("Couldn't write ") + TRACE_FILE;
 }
 
 
-
-// Perform a full-screen post process from "scene texture" to back buffer
-void FullScreenPostProcess(PostProcess postProcess, float frameTime, int i)
+// Set the viewport to cover a render target of the given size
+void SetViewport(int width, int height)
 {
-
-	gD3DContext->VSSetShader(g2DQuadVertexShader, nullptr, 0);
-	gD3DContext->GSSetShader(nullptr, nullptr, 0);  // Switch off geometry shader when not using it (pass nullptr for first parameter)
-
-
-	// States - no blending, don't write to depth buffer and ignore back-face culling
-	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
-	gD3DContext->OMSetDepthStencilState(gDepthReadOnlyState, 0);
-	gD3DContext->RSSetState(gCullNoneState);
-
-
-	// No need to set vertex/index buffer (see 2D quad vertex shader), just indicate that the quad will be created as a triangle strip
-	gD3DContext->IASetInputLayout(NULL); // No vertex data
-	gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-
-	ID3D11ShaderResourceView* nullSRV = nullptr;
-	gD3DContext->PSSetShaderResources(0, 1, &nullSRV);
-	// Select the back buffer to use for rendering. Not going to clear the back-buffer because we're going to overwrite it all
-	if (i % 2 == 0)
-	{
-		gD3DContext->OMSetRenderTargets(1, &gSceneRenderTargetTwo, gDepthStencil);
-		gD3DContext->PSSetShaderResources(0, 1, &gSceneTextureSRV);
-		gD3DContext->PSSetSamplers(0, 1, &gPointSampler);
-	}
-	else
-	{
-		gD3DContext->OMSetRenderTargets(1, &gSceneRenderTarget, gDepthStencil);
-		gD3DContext->PSSetShaderResources(0, 1, &gSceneTextureTwoSRV);
-		gD3DContext->PSSetSamplers(0, 1, &gPointSampler);
-	}
-
-
-	// Select shader and textures needed for the required post-processes (helper function above)
-	SelectPostProcessShaderAndTextures(postProcess, frameTime, i);
-
-
-	// Set 2D area for full-screen post-processing (coordinates in 0->1 range)
-	gPostProcessingConstants.area2DTopLeft = { 0, 0 }; // Top-left of entire screen
-	gPostProcessingConstants.area2DSize = { 1, 1 }; // Full size of screen
-	gPostProcessingConstants.area2DDepth = 0;        // Depth buffer value for full screen is as close as possible
-
-
-	// Pass over the above post-processing settings (also the per-process settings prepared in UpdateScene function below)
-	UpdateConstantBuffer(gPostProcessingConstantBuffer, gPostProcessingConstants);
-	gD3DContext->VSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
-	gD3DContext->PSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
-
-
-	// Draw a quad
-	gD3DContext->Draw(4, 0);
-
-	gD3DContext->OMSetRenderTargets(1, &gBackBufferRenderTarget, gDepthStencil);
-
-	gD3DContext->Draw(4, 0);
+	D3D11_VIEWPORT vp;
+	vp.Width = static_cast<FLOAT>(width);
+	vp.Height = static_cast<FLOAT>(height);
+	vp.MinDepth = 0.0f;
+	vp.MaxDepth = 1.0f;
+	vp.TopLeftX = 0;
+	vp.TopLeftY = 0;
+	gStateFilter.RSSetViewports(1, &vp);
 }
 
 
-void SaveBaseSceneTexture(int i)
+// Select the objects the post-processing passes draw with (see PostProcessPasses.h). Done each frame, as shaders can be
+// reloaded and textures swapped in while running
+void SelectPostProcessObjects()
 {
-	gD3DContext->VSSetShader(g2DQuadVertexShader, nullptr, 0);
-	gD3DContext->GSSetShader(nullptr, nullptr, 0);  // Switch off geometry shader when not using it (pass nullptr for first parameter)
-
-
-	// States - no blending, don't write to depth buffer and ignore back-face culling
-	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
-	gD3DContext->OMSetDepthStencilState(gDepthReadOnlyState, 0);
-	gD3DContext->RSSetState(gCullNoneState);
-
-
-	// No need to set vertex/index buffer (see 2D quad vertex shader), just indicate that the quad will be created as a triangle strip
-	gD3DContext->IASetInputLayout(NULL); // No vertex data
-	gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-
-	ID3D11ShaderResourceView* nullSRV = nullptr;
-	gD3DContext->PSSetShaderResources(0, 1, &nullSRV);
-	// Select the back buffer to use for rendering. Not going to clear the back-buffer because we're going to overwrite it all
-
-	gD3DContext->OMSetRenderTargets(1, &gSceneRenderTargetCopy, gDepthStencil);
-	gD3DContext->PSSetSamplers(0, 1, &gPointSampler);
-
-	if (i % 2 == 0)
-	{
-		gD3DContext->PSSetShaderResources(0, 1, &gSceneTextureSRV);
-	}
-	else
-	{
-		gD3DContext->PSSetShaderResources(0, 1, &gSceneTextureTwoSRV);
-	}
-
-
-	gD3DContext->PSSetShader(gCopyPostProcess, nullptr, 0);
-
-	// Set 2D area for full-screen post-processing (coordinates in 0->1 range)
-	gPostProcessingConstants.area2DTopLeft = { 0, 0 }; // Top-left of entire screen
-	gPostProcessingConstants.area2DSize = { 1, 1 }; // Full size of screen
-	gPostProcessingConstants.area2DDepth = 0;        // Depth buffer value for full screen is as close as possible
-
-
-	// Pass over the above post-processing settings (also the per-process settings prepared in UpdateScene function below)
-	UpdateConstantBuffer(gPostProcessingConstantBuffer, gPostProcessingConstants);
-	gD3DContext->VSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
-	gD3DContext->PSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
-
-	// Draw a quad
-	gD3DContext->Draw(4, 0);
-
-	gD3DContext->OMSetRenderTargets(1, &gBackBufferRenderTarget, gDepthStencil);
-
-	gD3DContext->Draw(4, 0);
-}
-
-// Perform an area post process from "scene texture" to back buffer at a given point in the world, with a given size (world units)
-void AreaPostProcess(PostProcess postProcess, CVector3 worldPoint, CVector2 areaSize, float frameTime, int i)
-{
-	// First perform a full-screen copy of the scene to back-buffer
-	FullScreenPostProcess(PostProcess::Copy, frameTime, i);
-
-
-	// Now perform a post-process of a portion of the scene to the back-buffer (overwriting some of the copy above)
-	// Note: The following code relies on many of the settings that were prepared in the FullScreenPostProcess call above, it only
-	//       updates a few things that need to be changed for an area process. If you tinker with the code structure you need to be
-	//       aware of all the work that the above function did that was also preparation for this post-process area step
-
-	// Select shader/textures needed for required post-process
-	SelectPostProcessShaderAndTextures(postProcess, frameTime, i);
-
-	// Enable alpha blending - area effects need to fade out at the edges or the hard edge of the area is visible
-	// A couple of the shaders have been updated to put the effect into a soft circle
-	// Alpha blending isn't enabled for fullscreen and polygon effects so it doesn't affect those (except heat-haze, which works a bit differently)
-	gD3DContext->OMSetBlendState(gAlphaBlendingState, nullptr, 0xffffff);
-
-
-	// Use picking methods to find the 2D position of the 3D point at the centre of the area effect
-	auto worldPointTo2D = gCamera->PixelFromWorldPt(worldPoint, gViewportWidth, gViewportHeight);
-	CVector2 area2DCentre = { worldPointTo2D.x, worldPointTo2D.y };
-	float areaDistance = worldPointTo2D.z;
-
-	// Nothing to do if given 3D point is behind the camera
-	if (areaDistance < gCamera->NearClip())  return;
-
-	// Convert pixel coordinates to 0->1 coordinates as used by the shader
-	area2DCentre.x /= gViewportWidth;
-	area2DCentre.y /= gViewportHeight;
-
-
-
-	// Using new helper function here - it calculates the world space units covered by a pixel at a certain distance from the camera.
-	// Use this to find the size of the 2D area we need to cover the world space size requested
-	CVector2 pixelSizeAtPoint = gCamera->PixelSizeInWorldSpace(areaDistance, gViewportWidth, gViewportHeight);
-	CVector2 area2DSize = { areaSize.x / pixelSizeAtPoint.x, areaSize.y / pixelSizeAtPoint.y };
-
-	// Again convert the result in pixels to a result to 0->1 coordinates
-	area2DSize.x /= gViewportWidth;
-	area2DSize.y /= gViewportHeight;
-
-
-
-	// Send the area top-left and size into the constant buffer - the 2DQuad vertex shader will use this to create a quad in the right place
-	gPostProcessingConstants.area2DTopLeft = area2DCentre - 0.5f * area2DSize; // Top-left of area is centre - half the size
-	gPostProcessingConstants.area2DSize = area2DSize;
-
-	// Manually calculate depth buffer value from Z distance to the 3D point and camera near/far clip values. Result is 0->1 depth value
-	// We've never seen this full calculation before, it's occasionally useful. It is derived from the material in the Picking lecture
-	// Having the depth allows us to have area effects behind normal objects
-	gPostProcessingConstants.area2DDepth = gCamera->FarClip() * (areaDistance - gCamera->NearClip()) / (gCamera->FarClip() - gCamera->NearClip());
-	gPostProcessingConstants.area2DDepth /= areaDistance;
-
-	// Pass over this post-processing area to shaders (also sends the per-process settings prepared in UpdateScene function below)
-	UpdateConstantBuffer(gPostProcessingConstantBuffer, gPostProcessingConstants);
-	gD3DContext->VSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
-	gD3DContext->PSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
-
-
-	// Draw a quad
-	gD3DContext->Draw(4, 0);
+	PostProcessObjects<D3D11PostProcessApi>& objects = gPostProcessPasses.objects;
+
+	// The swap chain holds on to the back buffer texture, so the reference taken here can be released straight away
+	ID3D11Resource* backBufferTexture = nullptr;
+	gBackBufferRenderTarget->GetResource(&backBufferTexture);
+	if (backBufferTexture)  backBufferTexture->Release();
+	objects.backBuffer        = gBackBufferRenderTarget;
+	objects.backBufferTexture = backBufferTexture;
+	objects.depthStencil      = gDepthStencil;
+
+	objects.quadVertexShader         = g2DQuadVertexShader;
+	objects.polygonVertexShader      = g2DPolygonVertexShader;
+	objects.polygonBatchVertexShader = g2DPolygonBatchVertexShader;
+
+	auto effectShader = [&](PostProcess postProcess) -> PostProcessShader*& { return objects.effectShaders[static_cast<int>(postProcess)]; };
+	effectShader(PostProcess::Tint)         = &gTintPostProcess;
+	effectShader(PostProcess::GreyNoise)    = &gGreyNoisePostProcess;
+	effectShader(PostProcess::Burn)         = &gBurnPostProcess;
+	effectShader(PostProcess::Distort)      = &gDistortPostProcess;
+	effectShader(PostProcess::Spiral)       = &gSpiralPostProcess;
+	effectShader(PostProcess::HeatHaze)     = &gHeatHazePostProcess;
+	effectShader(PostProcess::HueTint)      = &gHueTintPostProcess;
+	effectShader(PostProcess::BlurH)        = &gBlurHPostProcess;
+	effectShader(PostProcess::BlurV)        = &gBlurVPostProcess;
+	effectShader(PostProcess::Underwater)   = &gUnderwaterPostProcess;
+	effectShader(PostProcess::Inverted)     = &gInvertedColourPostProcess;
+	effectShader(PostProcess::NightVision)  = &gNightVisionPostProcess;
+	effectShader(PostProcess::Retro)        = &gRetroPostProcess;
+	effectShader(PostProcess::Bloom1)       = &gBloom1PostProcess;
+	effectShader(PostProcess::Bloom2)       = &gBloom2PostProcess;
+	effectShader(PostProcess::DepthOfField) = &gDepthOfFieldPostProcess;
+	objects.copyShader            = gCopyPostProcess;
+	objects.colourLutShader       = &gColourLutPostProcess;
+	objects.bloomThresholdShader  = gBloomThresholdPostProcess;
+	objects.bloomDownsampleShader = gBloomDownsamplePostProcess;
+	objects.bloomUpsampleShader   = gBloomUpsamplePostProcess;
+	objects.bloomCompositeShader  = &gBloomCompositePostProcess;
+	objects.polygonBatchShader    = gPolygonBatchPostProcess;
+
+	objects.noBlendingState       = gNoBlendingState;
+	objects.additiveBlendingState = gAdditiveBlendingState;
+	objects.alphaBlendingState    = gAlphaBlendingState;
+	objects.depthReadOnlyState    = gDepthReadOnlyState;
+	objects.noDepthBufferState    = gNoDepthBufferState;
+	objects.cullNoneState         = gCullNoneState;
+	objects.cullNoneScissorState  = gCullNoneScissorState;
+	objects.pointSampler          = gPointSampler;
+	objects.bilinearClampSampler  = gBilinearClampSampler;
+	objects.trilinearSampler      = gTrilinearSampler;
+
+	objects.noiseMapSRV   = gNoiseMapSRV;
+	objects.burnMapSRV    = gBurnMapSRV;
+	objects.distortMapSRV = gDistortMapSRV;
+
+	std::copy(std::begin(gPostProcessingConstantBuffers), std::end(gPostProcessingConstantBuffers), objects.constantBuffers);
+	objects.polygonBatchBuffer         = gPolygonBatchBuffer;
+	objects.polygonBatchBufferSRV      = gPolygonBatchBufferSRV;
+	objects.polygonBatchConstantBuffer = gPolygonBatchConstantBuffer;
 }
 
 
-// Perform an post process from "scene texture" to back buffer within the given four-point polygon and a world matrix to position/rotate/scale the polygon
-void PolygonPostProcess(PostProcess postProcess, const std::array<CVector3, 4>& points, const CMatrix4x4& worldMatrix, float frameTime, int i)
-{
-	// First perform a full-screen copy of the scene to back-buffer
-	FullScreenPostProcess(PostProcess::Copy, frameTime, i);
-
-
-	ID3D11ShaderResourceView* nullSRV = nullptr;
-	gD3DContext->PSSetShaderResources(0, 1, &nullSRV);
-	if (i % 2 == 0)
-	{
-		gD3DContext->OMSetRenderTargets(1, &gSceneRenderTargetTwo, gDepthStencil);
-		gD3DContext->PSSetShaderResources(0, 1, &gSceneTextureSRV);
-		gD3DContext->PSSetSamplers(0, 1, &gPointSampler);
-	}
-	else
-	{
-		gD3DContext->OMSetRenderTargets(1, &gSceneRenderTarget, gDepthStencil);
-		gD3DContext->PSSetShaderResources(0, 1, &gSceneTextureTwoSRV);
-		gD3DContext->PSSetSamplers(0, 1, &gPointSampler);
-	}
-
-	// Now perform a post-process of a portion of the scene to the back-buffer (overwriting some of the copy above)
-	// Note: The following code relies on many of the settings that were prepared in the FullScreenPostProcess call above, it only
-	//       updates a few things that need to be changed for an area process. If you tinker with the code structure you need to be
-	//       aware of all the work that the above function did that was also preparation for this post-process area step
-
-	// Select shader/textures needed for required post-process
-	SelectPostProcessShaderAndTextures(postProcess, frameTime, i);
-
-	// Loop through the given points, transform each to 2D (this is what the vertex shader normally does in most labs)
-	for (unsigned int i = 0; i < points.size(); ++i)
-	{
-		CVector4 modelPosition = CVector4(points[i], 1);
-		CVector4 worldPosition = modelPosition * worldMatrix;
-		CVector4 viewportPosition = worldPosition * gCamera->ViewProjectionMatrix();
-
-		gPostProcessingConstants.polygon2DPoints[i] = viewportPosition;
-	}
-
-	// Pass over the polygon points to the shaders (also sends the per-process settings prepared in UpdateScene function below)
-	UpdateConstantBuffer(gPostProcessingConstantBuffer, gPostProcessingConstants);
-	gD3DContext->VSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
-	gD3DContext->PSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
-
-	// Select the special 2D polygon post-processing vertex shader and draw the polygon
-	gD3DContext->VSSetShader(g2DPolygonVertexShader, nullptr, 0);
-	gD3DContext->Draw(4, 0);
-	gD3DContext->OMSetRenderTargets(1, &gBackBufferRenderTarget, gDepthStencil);
-
-	gD3DContext->Draw(4, 0);
-}
-
-void MergeTextures(float frameTime)
+void MergeTextures(ID3D11ShaderResourceView* firstTextureSRV, ID3D11ShaderResourceView* secondTextureSRV, float frameTime)
 {
 
 	// Select the back buffer to use for rendering. Not going to clear the back-buffer because we're going to overwrite it all
-	gD3DContext->OMSetRenderTargets(1, /*MISSING, 2nd pass specify back buffer as render target (note: needs an &)*/&gBackBufferRenderTarget, gDepthStencil);
+	gStateFilter.OMSetRenderTargets(1, /*MISSING, 2nd pass specify back buffer as render target (note: needs an &)*/&gBackBufferRenderTarget, gDepthStencil);
 
 
 	// Give the pixel shader (post-processing shader) access to the scene texture 
-	gD3DContext->PSSetShaderResources(0, 1, /* MISSING select the scene texture shader resource view (note: needs an &)*/&gSceneTextureOneSRV);
-	gD3DContext->PSSetShaderResources(1, 1, /* MISSING select the scene texture shader resource view (note: needs an &)*/&gSceneTextureTwoSRV);
-	gD3DContext->PSSetSamplers(0, 1, &gPointSampler); // Use point sampling (no bilinear, trilinear, mip-mapping etc. for most post-processes)
+	gStateFilter.PSSetShaderResources(0, 1, /* MISSING select the scene texture shader resource view (note: needs an &)*/&firstTextureSRV);
+	gStateFilter.PSSetShaderResources(1, 1, /* MISSING select the scene texture shader resource view (note: needs an &)*/&secondTextureSRV);
+	gStateFilter.PSSetSamplers(0, 1, &gPointSampler); // Use point sampling (no bilinear, trilinear, mip-mapping etc. for most post-processes)
 
 
 	// Using special vertex shader than creates its own data for a full screen quad
-	gD3DContext->VSSetShader(g2DQuadVertexShader, nullptr, 0);
-	gD3DContext->GSSetShader(nullptr, nullptr, 0);  // Switch off geometry shader when not using it (pass nullptr for first parameter)
+	gStateFilter.VSSetShader(g2DQuadVertexShader, nullptr, 0);
+	gStateFilter.GSSetShader(nullptr, nullptr, 0);  // Switch off geometry shader when not using it (pass nullptr for first parameter)
 
 
 	// States - no blending, ignore depth buffer and culling
-	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
-	gD3DContext->OMSetDepthStencilState(gNoDepthBufferState, 0);
-	gD3DContext->RSSetState(gCullNoneState);
+	gStateFilter.OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
+	gStateFilter.OMSetDepthStencilState(gNoDepthBufferState, 0);
+	gStateFilter.RSSetState(gCullNoneState);
 
 
 	// No need to set vertex/index buffer (see fullscreen quad vertex shader), just indicate that the quad will be created as a triangle strip
-	gD3DContext->IASetInputLayout(NULL); // No vertex data
-	gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	gStateFilter.IASetInputLayout(NULL); // No vertex data
+	gStateFilter.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 	// Prepare custom settings for current post-process
 
-	gD3DContext->PSSetShader(gMergeTextures, nullptr, 0);
+	gStateFilter.PSSetShader(gMergeTextures, nullptr, 0);
 
-	UpdateConstantBuffer(gPostProcessingConstantBuffer, gPostProcessingConstants);
-	gD3DContext->PSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
+	gPostProcessPasses.SendPostProcessConstants(PostProcessConstantBlocks(PostProcess::Copy));
 
 	// Draw a quad
 	gD3DContext->Draw( /*MISSING - Post-process pass renderes a quad*/ 4, 0);
 
 	// These lines unbind the scene texture from the pixel shader to stop DirectX issuing a warning when we try to render to it again next frame
 	ID3D11ShaderResourceView* nullSRV = nullptr;
-	gD3DContext->PSSetShaderResources(0, 1, &nullSRV);
+	gStateFilter.PSSetShaderResources(0, 1, &nullSRV);
 }
 //**************************
 
@@ -1125,6 +1030,20 @@ void MergeTextures(float frameTime)
 // Rendering the scene
 void RenderScene(float frameTime)
 {
+	uint64_t renderStart = TraceEventStart();
+
+	// Forget the state bound last frame, things outside this file (e.g. ImGui) may have changed it since
+	gStateFilter.NewFrame();
+
+	// Swap in any shaders whose source has been saved (see ShaderHotReload.h). The fused pass shaders are generated
+	// from the includes, so they are generated again if an include has changed
+	if (ReloadChangedShaders().includesChanged)  gPostProcessPasses.ReleaseFusedShaders();
+
+	// Swap in textures that have finished loading in the background since the last frame
+	UploadLoadedTextures();
+	SelectPostProcessObjects();
+
+
 	//// Common settings ////
 
 	// Set up the light information in the constant buffer
@@ -1150,35 +1069,44 @@ void RenderScene(float frameTime)
 	// Also clear the render target to a fixed colour and the depth buffer to the far distance
 	// Setup the viewport to the size of the main window
 
-	D3D11_VIEWPORT vp;
-	vp.Width = static_cast<FLOAT>(gViewportWidth);
-	vp.Height = static_cast<FLOAT>(gViewportHeight);
-	vp.MinDepth = 0.0f;
-	vp.MaxDepth = 1.0f;
-	vp.TopLeftX = 0;
-	vp.TopLeftY = 0;
-	gD3DContext->RSSetViewports(1, &vp);
+	SetViewport(gViewportWidth, gViewportHeight);
 
-	gD3DContext->OMSetRenderTargets(0, nullptr, gDepthStencil);
+	gStateFilter.OMSetRenderTargets(0, nullptr, gDepthStencil);
 	gD3DContext->ClearDepthStencilView(gDepthStencil, D3D11_CLEAR_DEPTH, 1.0f, 0);
 
-	RenderDepthBufferFromCamera(gCamera);
-
-	if (gPostProcessList.size() != 0)
+	// Fill the depth buffer first, the main pass then only lights the nearest surface of each pixel
+	if (gUseDepthPrePass)  RenderDepthBufferFromCamera(gCamera);
+
+	// When post-processing, render the scene to a texture from the pool (see RenderTargetPool.h). The passes come from
+	// the compiled graph for the list (see PostProcessGraph.h) - if it has none left the scene goes straight to the
+	// back buffer
+	RenderTargetPool& renderTargetPool = gPostProcessPasses.TargetPool();
+	renderTargetPool.ResetPeak();
+	const CompiledPostProcessGraph& postProcessGraph = gPostProcessGraphs.Get(gPostProcessList);
+	int sceneSlot = -1;
+	if (!postProcessGraph.passes.empty())
+	{
+		sceneSlot = renderTargetPool.Acquire(gPostProcessPasses.SceneTargetDesc());
+		if (gPostProcessPasses.GetRenderTarget(sceneSlot) == nullptr)
+		{
+			renderTargetPool.Release(sceneSlot);
+			sceneSlot = -1;
+		}
+	}
+	if (sceneSlot >= 0)
 	{
-		gD3DContext->OMSetRenderTargets(1, &gSceneRenderTarget, gDepthStencil);
-		gD3DContext->ClearRenderTargetView(gSceneRenderTarget, &gBackgroundColor.r);
+		ID3D11RenderTargetView* sceneTarget = gPostProcessPasses.GetRenderTarget(sceneSlot)->renderTarget;
+		gStateFilter.OMSetRenderTargets(1, &sceneTarget, gDepthStencil);
+		gD3DContext->ClearRenderTargetView(sceneTarget, &gBackgroundColor.r);
 	}
 	else
 	{
-		gD3DContext->OMSetRenderTargets(1, &gBackBufferRenderTarget, gDepthStencil);
+		gStateFilter.OMSetRenderTargets(1, &gBackBufferRenderTarget, gDepthStencil);
 		gD3DContext->ClearRenderTargetView(gBackBufferRenderTarget, &gBackgroundColor.r);
 	}
 
-	gD3DContext->ClearDepthStencilView(gDepthStencil, D3D11_CLEAR_DEPTH, 1.0f, 0);
-
-	gD3DContext->PSSetShaderResources(2, 1, &gDepthShaderView);
-	gD3DContext->PSSetSamplers(2, 1, &gPointSampler);
+	gStateFilter.PSSetShaderResources(2, 1, &gDepthShaderView);
+	gStateFilter.PSSetSamplers(2, 1, &gPointSampler);
 	// Render the scene from the main camera
 	RenderSceneFromCamera(gCamera);
 
@@ -1190,7 +1118,6 @@ void RenderScene(float frameTime)
 
 
 	//polyMatrix = MatrixRotationY(ToRadians(1)) * polyMatrix;
-	//SaveBaseSceneTexture();
 	// Pass an array of 4 points and a matrix. Only supports 4 points.
 
 	std::array<std::array<CVector3, 4>, 4> points;
@@ -1202,111 +1129,27 @@ void RenderScene(float frameTime)
 	// A rotating matrix placing the model above in the scene
 	static CMatrix4x4 polyMatrix = MatrixTranslation({ 0, 0, 0 });
 
-	// Run any full screen post-processing steps
-	///////////////////////////////////////////////////////////
-
-	// Perform the polygon post processing first so the base scene can be saved in a texture
-	gPostProcessingConstants.IsFullScreen = false;
-	if (gPostProcessList.size() != 0)
-	{
-		for (int i = 0; i < gPostProcessList.size(); i++)
-		{
-			if (gPostProcessList[i].mode == PostProcessMode::Polygon)
-			{
-				PolygonPostProcess(gPostProcessList[i].process, points[i], polyMatrix, frameTime, i);
-			}
-		}
-	}
-
-	// Save the scene in a texture so it can be referenced for bloom effects
-	/*SaveBaseSceneTexture();*/
-
-	//Perform full screen post processing effects
-	gPostProcessingConstants.IsFullScreen = true;
-	if (gPostProcessList.size() != 0)
-	{
-		for (int i = 0; i < gPostProcessList.size(); i++)
-		{
-			if (gPostProcessList[i].mode == PostProcessMode::Fullscreen && gPostProcessList[i].process != PostProcess::Bloom1)
-			{
-				gCurrentPostProcess = gPostProcessList[i].process;
+	// Project every polygon corner to the screen in one go, the polygon passes below take their corners from here
+	static_assert(sizeof(points) == 16 * sizeof(CVector3), "polygon points must be contiguous");
+	static ScreenPoints polygonScreenPoints;
+	std::array<CVector4, 16> polygonClipPoints;
+	gCamera->ProjectToScreen(points[0].data(), 16, polyMatrix, gViewportWidth, gViewportHeight, polygonScreenPoints, polygonClipPoints.data());
 
-				FullScreenPostProcess(gPostProcessList[i].process, frameTime, i);
-			}
-		}
-	}
+	// Run the post-processing graph
+	///////////////////////////////////////////////////////////
 
-	if (gPostProcessList.size() != 0)
+	// Polygon passes come first so the base scene can be saved in a texture, then the full screen passes (runs of
+	// per-pixel effects fused into a single pass) and bloom last. Each pass reads and writes the textures the graph
+	// gives it, apart from the final pass which draws straight to the back buffer
+	gPostProcessPasses.NewFrame();
+	uint64_t postProcessStart = TraceEventStart();
+	BeginPassTimings();
+	if (sceneSlot >= 0)
 	{
-		for (int i = 0; i < gPostProcessList.size(); i++)
-		{
-			if (gPostProcessList[i].process == PostProcess::Bloom1)
-			{
-
-				int j = i;
-				SaveBaseSceneTexture(i);
-
-				gCurrentPostProcess = gPostProcessList[i].process;
-				FullScreenPostProcess(gPostProcessList[i].process, frameTime, j);
-				j++;
-
-				//int temp = gPostProcessingConstants.blurStrength;
-				gConstantsList[i].blurStrength = 90;
-
-				/////////////////
-
-				//double sigma = 40;
-				//const int arraySize = 100;
-				//// double weight[arraySize];
-				////double mean = arraySize / 2;
-				//double mean = (gConstantsList[i].blurStrength - 1) / 2;
-				//double sum = 0.0; // For accumulating the kernel values
-
-				//for (int x = 0; x < gConstantsList[i].blurStrength; ++x)
-				//{
-				//	gPostProcessingConstants.weight[x].x = exp(-0.5 * (pow((x - mean) / sigma, 2.0) + pow((x - mean) / sigma, 2.0))) / (2 * PI * sigma * sigma);
-
-				//	// Accumulate the kernel values
-				//	sum += gPostProcessingConstants.weight[x].x;
-				//}
-
-				//// Normalize the kernel
-				//for (int x = 0; x < gConstantsList[i].blurStrength; ++x)
-				//{
-				//	gPostProcessingConstants.weight[x].x /= sum;
-				//}
-
-				////int kernel[arraySize];
-				//int midpoint = (gConstantsList[i].blurStrength - 1) / 2;
-
-				//gPostProcessingConstants.kernel[midpoint].x = 0;
-				//for (int x = 1; x <= midpoint; x++)
-				//{
-				//	gPostProcessingConstants.kernel[midpoint + x].x = x;
-				//	gPostProcessingConstants.kernel[midpoint - x].x = -x;
-				//}
-
-				//gPostProcessingConstants.blurStrength = gConstantsList[i].blurStrength;
-				/////////////
-
-				gCurrentPostProcess = PostProcess::BlurH;
-				FullScreenPostProcess(PostProcess::BlurH, frameTime, j);
-				j++;
-
-				gCurrentPostProcess = PostProcess::BlurV;
-				FullScreenPostProcess(PostProcess::BlurV, frameTime, j);
-				j++;
-
-				/*gPostProcessingConstants.blurStrength = temp;*/
-
-				gCurrentPostProcess = PostProcess::Bloom2;
-				FullScreenPostProcess(PostProcess::Bloom2, frameTime, j);
-				j++;
-
-			    FullScreenPostProcess(PostProcess::Copy, frameTime, i); // this copy is used to make the number of calls Odd so that bouncing between the two textures lines up again
-			}
-		}
+		gPostProcessPasses.Render(postProcessGraph, sceneSlot, polygonClipPoints.data(), &polygonScreenPoints, frameTime);
 	}
+	EndPassTimings();
+	AddTraceEvent("Post-process", "Post-processing", postProcessStart);
 
 
 
@@ -1320,6 +1163,7 @@ void RenderScene(float frameTime)
 
 	//ImGui::ShowDemoWindow();
 
+	uint64_t imguiStart = TraceEventStart();
 	int windowNumber = 0;
 	std::string str;
 
@@ -1418,6 +1262,137 @@ void RenderScene(float frameTime)
 
 	ImGui::BeginGroup();
 	ImGui::Text("Screen effect controls:");
+	int numFullScreenPasses = 0;
+	int numFullScreenEffects = 0;
+	for (auto& pass : postProcessGraph.passes)
+	{
+		if (pass.type != PostProcessPassType::FullScreen && pass.type != PostProcessPassType::Fused)  continue;
+		numFullScreenPasses++;
+		numFullScreenEffects += static_cast<int>(pass.entries.size());
+	}
+	ImGui::Text("Full screen passes: %d for %d effects", numFullScreenPasses, numFullScreenEffects);
+	ImGui::Text("Post-process graph: %d passes, %d removed, %d copies (compiled %d times)",
+	            static_cast<int>(postProcessGraph.passes.size()), postProcessGraph.numRemoved, postProcessGraph.numCopies,
+	            gPostProcessGraphs.NumCompiles());
+
+	// Draws made this frame against drawing every pass a second time to the back buffer, as the passes used to
+	PostProcessDrawStats everyPassDraws = EstimatePostProcessDraws(postProcessGraph, gViewportWidth, gViewportHeight, false);
+	const PostProcessPassStats& postProcessStats = gPostProcessPasses.FrameStats();
+	ImGui::Text("Post-process draws: %d (%d to back buffer), %.1fM pixels", postProcessStats.draws.numDraws,
+	            postProcessStats.draws.numScreenDraws, postProcessStats.draws.pixelsFilled / 1000000.0f);
+	ImGui::Text("Drawing every pass to back buffer: %d (%d to back buffer), %.1fM pixels", everyPassDraws.numDraws,
+	            everyPassDraws.numScreenDraws, everyPassDraws.pixelsFilled / 1000000.0f);
+	ImGui::Text("Polygon windows: %d in %d draws, %d off screen", postProcessStats.numPolygonWindows,
+	            postProcessStats.numPolygonDraws, postProcessStats.numPolygonWindowsCulled);
+	const ConstantUploadStats& constantUploads = gPostProcessPasses.ConstantBlocks().FrameStats();
+	ImGui::Text("Constants sent: %.1fKB in %d blocks (%d unchanged), whole buffer per draw: %.1fKB",
+	            constantUploads.bytesUploaded / 1024.0f, constantUploads.numUploads, constantUploads.numSkipped,
+	            constantUploads.numRequests * sizeof(PostProcessingConstants) / 1024.0f);
+
+	// Colour-only fused passes can use a lookup table, larger tables are closer to the separate effects (see ColourLut.h)
+	const char* lutSizes[] = { "Off", "32", "64" };
+	int& colourLutSize = gPostProcessPasses.colourLutSize;
+	int lutSizeIndex = (colourLutSize == 0) ? 0 : (colourLutSize == 32) ? 1 : 2;
+	if (ImGui::Combo("Colour LUT", &lutSizeIndex, lutSizes, 3))
+	{
+		colourLutSize = (lutSizeIndex == 0) ? 0 : (lutSizeIndex == 1) ? 32 : 64;
+	}
+	ImGui::Text("Colour LUT passes: %d (tables baked: %d)", postProcessStats.numColourLutPasses, gPostProcessPasses.NumColourLutBakes());
+
+	// Memory used by the render target pool against the fixed set of textures it replaced (see RenderTargetPool.h)
+	// The fixed set doesn't depend on the list, so this only needs measuring once
+	static RenderTargetReport fixedTargets = SimulatePostProcessTargets({}, gViewportWidth, gViewportHeight);
+	ImGui::Text("Render targets: %d, %.1fMB (peak in use %.1fMB, fixed set %.1fMB)", renderTargetPool.NumSlots(),
+	            renderTargetPool.AllocatedBytes() / 1048576.0f, renderTargetPool.PeakBytesInUse() / 1048576.0f,
+	            fixedTargets.fixedBytes / 1048576.0f);
+
+	// Time taken by each post-processing pass over the last few seconds (see PassTiming.h). The GPU times arrive a few
+	// frames after the CPU times
+	if (ImGui::TreeNode("Pass timings"))
+	{
+		if (ImGui::BeginTable("Pass timings", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Pass");
+			ImGui::TableSetupColumn("CPU min");
+			ImGui::TableSetupColumn("CPU avg");
+			ImGui::TableSetupColumn("CPU p99");
+			ImGui::TableSetupColumn("GPU min");
+			ImGui::TableSetupColumn("GPU avg");
+			ImGui::TableSetupColumn("GPU p99");
+			ImGui::TableHeadersRow();
+			for (auto& pass : gPassTimings.Stats())
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", pass.name.c_str());
+				for (const TimingSummary* summary : { &pass.cpu, &pass.gpu })
+				{
+					for (float ms : { summary->minMs, summary->avgMs, summary->p99Ms })
+					{
+						ImGui::TableNextColumn();
+						if (summary->numSamples > 0)  ImGui::Text("%.3fms", ms);
+						else                          ImGui::Text("-");
+					}
+				}
+			}
+			ImGui::EndTable();
+		}
+		// Passes stay in the table after they leave the list, until reset
+		if (ImGui::Button("Reset Pass Timings"))  gPassTimings.Clear();
+		ImGui::TreePop();
+	}
+
+	// Start-up cost of the shader stage (see LoadShaders in Shader.cpp)
+	ImGui::Text("Shaders: %d created, %d unchanged in %.1fms (archive %.1fms%s, %.1fKB%s)", gShaderLoadStats.numCreated,
+	            gShaderLoadStats.numUnchanged, gShaderLoadStats.totalMs, gShaderLoadStats.archiveMs,
+	            gShaderLoadStats.archiveRebuilt ? " rebuilt" : "", gShaderLoadStats.archiveBytes / 1024.0f,
+	            gShaderLoadStats.fromArchive ? "" : ", read from .cso files");
+	const HotReloadStats& reloadStats = gShaderHotReload.Stats();
+	if (reloadStats.numReloads > 0 || reloadStats.numFailures > 0)
+	{
+		ImGui::Text("Shader reloads: %d (%d failed), last %d shaders: %.0fms to notice, %.0fms to compile, %.0fms to screen",
+		            reloadStats.numReloads, reloadStats.numFailures, static_cast<int>(reloadStats.lastShaders.size()),
+		            reloadStats.lastDetectMs, reloadStats.lastCompileMs, reloadStats.lastLatencyMs);
+		if (!reloadStats.lastError.empty())  ImGui::TextWrapped("%s", reloadStats.lastError.c_str());
+	}
+
+	// Pixel shader work for the opaque models, with and without the depth pre-pass. Once per pixel is no overdraw
+	ImGui::Checkbox("Depth pre-pass", &gUseDepthPrePass);
+	ImGui::Text("Opaque pixel shader invocations: %.2fM (%.2f per pixel)", gOpaquePixelShaderInvocations / 1000000.0f,
+	            static_cast<float>(gOpaquePixelShaderInvocations) / (gViewportWidth * gViewportHeight));
+
+	// State-setting calls passed on to DirectX last frame and those dropped as nothing would change (see StateCache.h)
+	const StateFilterStats& stateCalls = gStateFilter.Cache().LastFrameStats();
+	ImGui::Text("State calls: %d issued, %d skipped", stateCalls.TotalIssued(), stateCalls.TotalSkipped());
+	if (ImGui::TreeNode("State calls by kind"))
+	{
+		for (int kind = 0; kind < NUM_STATE_KINDS; ++kind)
+		{
+			if (stateCalls.issued[kind] + stateCalls.skipped[kind] == 0)  continue;
+			ImGui::Text("%s: %d issued, %d skipped", StateKindName(static_cast<StateKind>(kind)), stateCalls.issued[kind], stateCalls.skipped[kind]);
+		}
+		ImGui::TreePop();
+	}
+
+	// Camera matrix rebuilds in the last frame - once per change to the camera rather than once per matrix fetched
+	static int lastMatrixUpdates = 0;
+	ImGui::Text("Camera matrix rebuilds: %d this frame", gCamera->NumMatrixUpdates() - lastMatrixUpdates);
+	lastMatrixUpdates = gCamera->NumMatrixUpdates();
+
+	// Start-up trace of the textures loaded in the background (see TextureLoader.h), times from the first being queued
+	if (ImGui::TreeNode("Textures"))
+	{
+		if (gTextureLoader.NumPending() > 0)  ImGui::Text("Loading %d textures...", gTextureLoader.NumPending());
+		else                                  ImGui::Text("%d textures loaded in %.1fms", static_cast<int>(gTextureLoader.Trace().size()), gTextureLoader.TotalMs());
+		for (auto& event : gTextureLoader.Trace())
+		{
+			if (!event.done)  continue;
+			ImGui::Text("%-26s thread %d: decode %6.1f - %6.1fms, uploaded %6.1fms, %.1fMB%s", event.fileName.c_str(), event.thread,
+			            event.decodeStartMs, event.decodeEndMs, event.uploadedMs, event.decodedBytes / 1048576.0f, event.failed ? " FAILED" : "");
+		}
+		for (auto& error : gTextureLoadErrors)  ImGui::TextWrapped("%s", error.c_str());
+		ImGui::TreePop();
+	}
 	ImGui::Checkbox("Enable Midline", &gPostProcessingConstants.MidLineEnabled);
 	if (gPostProcessingConstants.MidLineEnabled)
 	{
@@ -1469,6 +1444,11 @@ void RenderScene(float frameTime)
 				str += std::to_string(blurNumber);
 				const char* name = str.c_str();
 				ImGui::SliderInt(name, &gConstantsList[i].blurStrength, 7, 21);
+
+				str = "Blur Linear Sampling ";
+				str += std::to_string(blurNumber);
+				name = str.c_str();
+				ImGui::Checkbox(name, &gConstantsList[i].blurLinearSampling);
 				blurNumber++;
 			}
 				break;
@@ -1521,6 +1501,24 @@ void RenderScene(float frameTime)
 		}
 	}
 	ImGui::EndGroup();
+
+	// Frames of CPU events from every thread, saved as Chrome trace JSON for chrome://tracing or ui.perfetto.dev (see
+	// FrameTrace.h). The capture is saved when it finishes, the start-up capture only if asked
+	ImGui::BeginGroup();
+	ImGui::Text("Trace capture:");
+	ImGui::SliderInt("Frames to capture", &gTraceFrames, 1, 120);
+	if (ImGui::Button("Capture Trace"))
+	{
+		StartTraceCapture(gTraceFrames);
+		gSaveTraceWhenDone = true;
+		gTraceSaveResult.clear();
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Save Last Capture"))  SaveTraceCapture();
+	TraceCaptureStats traceStats = GetTraceCaptureStats();
+	ImGui::Text("%s: %d frames, %d events from %d threads (%d dropped) %s", traceStats.capturing ? "Capturing" : "Last capture",
+	            traceStats.numFrames, traceStats.numEvents, traceStats.numThreads, traceStats.numDropped, gTraceSaveResult.c_str());
+	ImGui::EndGroup();
 	ImGui::End();
 
 
@@ -1536,18 +1534,30 @@ void RenderScene(float frameTime)
 	// Finalise ImGUI for this frame
 	//*******************************
 	ImGui::Render();
-	gD3DContext->OMSetRenderTargets(1, &gBackBufferRenderTarget, nullptr);
+	gStateFilter.OMSetRenderTargets(1, &gBackBufferRenderTarget, nullptr);
 	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+	AddTraceEvent("Frame", "ImGui", imguiStart);
 
 
 	// These lines unbind the scene texture from the pixel shader to stop DirectX issuing a warning when we try to render to it again next frame
 	ID3D11ShaderResourceView* nullSRV = nullptr;
-	gD3DContext->PSSetShaderResources(0, 1, &nullSRV);
+	gStateFilter.PSSetShaderResources(0, 1, &nullSRV);
 
 
 	// When drawing to the off-screen back buffer is complete, we "present" the image to the front buffer (the screen)
 	// Set first parameter to 1 to lock to vsync
+	uint64_t presentStart = TraceEventStart();
 	gSwapChain->Present(lockFPS ? 1 : 0, 0);
+	AddTraceEvent("Frame", "Present", presentStart);
+	gShaderHotReload.FramePresented();
+
+	// The frame ends here in a trace capture, so save the capture if this was its last frame
+	AddTraceEvent("Frame", "RenderScene", renderStart);
+	if (TraceFrameEnd() && gSaveTraceWhenDone)
+	{
+		gSaveTraceWhenDone = false;
+		SaveTraceCapture();
+	}
 }
 
 
@@ -1559,6 +1569,8 @@ void RenderScene(float frameTime)
 // Update models and camera. frameTime is the time passed since the last frame
 void UpdateScene(float frameTime)
 {
+	ScopedTraceEvent trace("Frame", "UpdateScene");
+
 	//***********
 
 	/*if (KeyHit(Key_F1))  gCurrentPostProcessMode = PostProcessMode::Fullscreen;
@@ -1586,7 +1598,7 @@ void UpdateScene(float frameTime)
 	else if (KeyHit(Key_T)) { ProcessAndMode process = { PostProcess::Tint, PostProcessMode::Fullscreen }; gPostProcessList.push_back(process); Constants constants = Constants(); gConstantsList.push_back(constants); }
 	else if (KeyHit(Key_R)) { ProcessAndMode process = { PostProcess::Retro, PostProcessMode::Fullscreen }; gPostProcessList.push_back(process); Constants constants = Constants(); gConstantsList.push_back(constants);}
 	else if (KeyHit(Key_G)) { ProcessAndMode process = { PostProcess::GreyNoise, PostProcessMode::Fullscreen }; gPostProcessList.push_back(process); Constants constants = Constants(); gConstantsList.push_back(constants);}
-	else if (KeyHit(Key_B)) { ProcessAndMode process = { PostProcess::Bloom1, PostProcessMode::Fullscreen }; gPostProcessList.push_back(process); Constants constants = Constants(); constants.blurStrength = 90; gConstantsList.push_back(constants); gConstantsList.push_back(constants); gConstantsList.push_back(constants); gConstantsList.push_back(constants); }
+	else if (KeyHit(Key_B)) { ProcessAndMode process = { PostProcess::Bloom1, PostProcessMode::Fullscreen }; gPostProcessList.push_back(process); Constants constants = Constants(); gConstantsList.push_back(constants); }
 	else if (KeyHit(Key_0))
 	{
 		gConstantsList.clear();
@@ -1594,7 +1606,6 @@ void UpdateScene(float frameTime)
 		gCurrentPostProcess = PostProcess::None;
 		gCurrentSecondPostProcess = PostProcess::None;
 		gPostProcessingConstants.bloomThreshold = 1.3f;
-		gPostProcessingConstants.blurStrength = 13;
 		gPostProcessingConstants.MidLine = 0.5f;
 
 		ProcessAndMode window1 = { PostProcess::NightVision, PostProcessMode::Polygon };
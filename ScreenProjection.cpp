@@ -0,0 +1,120 @@
+//--------------------------------------------------------------------------------------
+// Projecting batches of points onto the screen
+//--------------------------------------------------------------------------------------
+
+#include "ScreenProjection.h"
+#include "CpuSimd.h"
+
+#include <algorithm>
+
+
+void ProjectToScreen(const CVector3* points, int numPoints, const CMatrix4x4& worldViewProjection, const CMatrix4x4& projection,
+                     float nearClip, unsigned int viewportWidth, unsigned int viewportHeight, ScreenPoints& results,
+                     CVector4* clipPoints)
+{
+	int numMasks = (numPoints + 31) / 32;
+	results.x.resize(numPoints);
+	results.y.resize(numPoints);
+	results.z.resize(numPoints);
+	results.depth.resize(numPoints);
+	results.inFront.assign(numMasks, 0);
+	results.onScreen.assign(numMasks, 0);
+
+	float halfWidth  = viewportWidth  * 0.5f;
+	float halfHeight = viewportHeight * 0.5f;
+	results.pixelsPerUnit = { projection.e00 * halfWidth, projection.e11 * halfHeight };
+	results.viewportSize = { static_cast<float>(viewportWidth), static_cast<float>(viewportHeight) };
+
+	// Each element of the matrix in all four lanes - the points are worked on four at a time with one point per lane,
+	// so every multiply does the same matrix element for four points
+	const CMatrix4x4& m = worldViewProjection;
+	const Float4 m00(m.e00), m01(m.e01), m02(m.e02), m03(m.e03);
+	const Float4 m10(m.e10), m11(m.e11), m12(m.e12), m13(m.e13);
+	const Float4 m20(m.e20), m21(m.e21), m22(m.e22), m23(m.e23);
+	const Float4 m30(m.e30), m31(m.e31), m32(m.e32), m33(m.e33);
+	const Float4 nearClip4(nearClip);
+	const Float4 zero(0.0f);
+	const Float4 one(1.0f);
+	const Float4 halfWidth4(halfWidth);
+	const Float4 halfHeight4(halfHeight);
+	const Float4 width4(static_cast<float>(viewportWidth));
+	const Float4 height4(static_cast<float>(viewportHeight));
+
+	for (int first = 0; first < numPoints; first += 4)
+	{
+		// The last group repeats its final point to fill the lanes, those results aren't kept
+		int count = std::min(numPoints - first, 4);
+		const CVector3& p0 = points[first];
+		const CVector3& p1 = points[first + std::min(1, count - 1)];
+		const CVector3& p2 = points[first + std::min(2, count - 1)];
+		const CVector3& p3 = points[first + std::min(3, count - 1)];
+		Float4 x(p0.x, p1.x, p2.x, p3.x);
+		Float4 y(p0.y, p1.y, p2.y, p3.y);
+		Float4 z(p0.z, p1.z, p2.z, p3.z);
+
+		Float4 clipX = x * m00 + y * m10 + z * m20 + m30;
+		Float4 clipY = x * m01 + y * m11 + z * m21 + m31;
+		Float4 clipZ = x * m02 + y * m12 + z * m22 + m32;
+		Float4 clipW = x * m03 + y * m13 + z * m23 + m33;
+
+		// Perspective divide then viewport transform, as PixelFromWorldPt. Points behind the camera give meaningless
+		// values here, they are left out of the masks
+		Float4 invW = one / clipW;
+		Float4 pixelX = (clipX * invW + one) * halfWidth4;
+		Float4 pixelY = (one - clipY * invW) * halfHeight4;
+		Float4 depth = clipZ * invW;
+
+		int inFront = GreaterEqualMask(clipW, nearClip4);
+		int onScreen = inFront & GreaterEqualMask(pixelX, zero) & LessEqualMask(pixelX, width4) &
+		                         GreaterEqualMask(pixelY, zero) & LessEqualMask(pixelY, height4);
+		uint32_t laneMask = (1u << count) - 1;
+		results.inFront[first / 32]  |= (inFront  & laneMask) << (first % 32);
+		results.onScreen[first / 32] |= (onScreen & laneMask) << (first % 32);
+
+		if (count == 4)
+		{
+			pixelX.StoreUnaligned(&results.x[first]);
+			pixelY.StoreUnaligned(&results.y[first]);
+			clipW.StoreUnaligned(&results.z[first]);
+			depth.StoreUnaligned(&results.depth[first]);
+		}
+		else
+		{
+			float lanes[4][4];
+			pixelX.StoreUnaligned(lanes[0]);
+			pixelY.StoreUnaligned(lanes[1]);
+			clipW.StoreUnaligned(lanes[2]);
+			depth.StoreUnaligned(lanes[3]);
+			std::copy(lanes[0], lanes[0] + count, &results.x[first]);
+			std::copy(lanes[1], lanes[1] + count, &results.y[first]);
+			std::copy(lanes[2], lanes[2] + count, &results.z[first]);
+			std::copy(lanes[3], lanes[3] + count, &results.depth[first]);
+		}
+
+		if (clipPoints)
+		{
+			// Lanes are points, turn them back into one vector per point
+			Transpose(clipX, clipY, clipZ, clipW);
+			Float4 clip[4] = { clipX, clipY, clipZ, clipW };
+			for (int point = 0; point < count; ++point)  clip[point].StoreUnaligned(&clipPoints[first + point].x);
+		}
+	}
+}
+
+
+bool ScreenPoints::AllOffScreen(int firstPoint, int numPoints) const
+{
+	int numInFront = 0;
+	bool allLeft = true, allRight = true, allAbove = true, allBelow = true;
+	for (int point = firstPoint; point < firstPoint + numPoints; ++point)
+	{
+		if (!InFront(point))  continue;
+		++numInFront;
+		allLeft  = allLeft  && x[point] < 0;
+		allRight = allRight && x[point] > viewportSize.x;
+		allAbove = allAbove && y[point] < 0;
+		allBelow = allBelow && y[point] > viewportSize.y;
+	}
+	if (numInFront == 0)  return true;
+	return numInFront == numPoints && (allLeft || allRight || allAbove || allBelow);
+}
@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------------
+// Projecting batches of points onto the screen
+//--------------------------------------------------------------------------------------
+// Camera::PixelFromWorldPt finds the pixel under one world point, and the area and polygon post-processes used to call
+// it (and PixelSizeInWorldSpace) once per point. ProjectToScreen does the same for a whole array of points in one sweep,
+// four points at a time using Float4 (CpuSimd.h), so effects can be placed at hundreds of points a frame. The results
+// are kept as separate arrays of x, y, distance and depth, with bit masks saying which points are in front of the
+// camera and which are on screen, so callers can skip points that can't be seen without looking at each one.
+//
+// Usually called through the Camera (Camera::ProjectToScreen), which supplies its matrices and near clip.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _SCREEN_PROJECTION_H_INCLUDED_
+#define _SCREEN_PROJECTION_H_INCLUDED_
+
+#include "CVector2.h"
+#include "CVector3.h"
+#include "CVector4.h"
+#include "CMatrix4x4.h"
+
+#include <cstdint>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Projected points
+//--------------------------------------------------------------------------------------
+
+struct ScreenPoints
+{
+	std::vector<float>    x, y;     // Pixel coordinates, as PixelFromWorldPt. Only meaningful for points in front of the camera
+	std::vector<float>    z;        // Distance in front of the camera (camera space z), as PixelFromWorldPt
+	std::vector<float>    depth;    // 0->1 depth buffer value at the point, as compared against by the area effects
+	std::vector<uint32_t> inFront;  // One bit per point (point i is bit i % 32 of element i / 32), set if the point is
+	                                // beyond the near clip so its x and y can be used
+	std::vector<uint32_t> onScreen; // One bit per point, set if the point is in front and inside the viewport
+	CVector2 pixelsPerUnit;         // Pixels covered by one world unit at distance 1 from the camera
+	CVector2 viewportSize;          // Width and height the points were projected to
+
+	int  NumPoints() const         { return static_cast<int>(z.size()); }
+	bool InFront(int point) const  { return (inFront[point / 32] >> (point % 32)) & 1; }
+	bool OnScreen(int point) const { return (onScreen[point / 32] >> (point % 32)) & 1; }
+
+	// Size in pixels of something of the given size in the world, at the distance of a point. The same as dividing by
+	// PixelSizeInWorldSpace
+	CVector2 PixelSize(int point, CVector2 worldSize) const
+	{
+		return { worldSize.x * pixelsPerUnit.x / z[point], worldSize.y * pixelsPerUnit.y / z[point] };
+	}
+
+	// Whether a shape with the given run of points as its corners certainly can't be seen - all of them are behind the
+	// camera, or all are in front and past the same edge of the viewport. Shapes crossing the near clip count as visible
+	bool AllOffScreen(int firstPoint, int numPoints) const;
+};
+
+
+// Project an array of points to the screen. worldViewProjection takes the points to clip space (for world points it is
+// the camera's view-projection matrix, or put a world matrix in front for model points). projection is the camera's
+// projection matrix alone, used for the pixel sizes, and must be a perspective projection as built by the Camera (clip
+// space w is the distance from the camera). If clipPoints is given it must have room for numPoints vectors and receives
+// the clip space positions, as used for polygon2DPoints
+void ProjectToScreen(const CVector3* points, int numPoints, const CMatrix4x4& worldViewProjection, const CMatrix4x4& projection,
+                     float nearClip, unsigned int viewportWidth, unsigned int viewportHeight, ScreenPoints& results,
+                     CVector4* clipPoints = nullptr);
+
+
+#endif //_SCREEN_PROJECTION_H_INCLUDED_
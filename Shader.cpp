@@ -5,8 +5,15 @@
 
 #include "Shader.h"
 #include "Common.h"
+#include "FrameTrace.h"
+#include "ThreadPool.h"
 #include <d3dcompiler.h>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
 #include <vector>
 
 //--------------------------------------------------------------------------------------
@@ -28,82 +35,253 @@ ID3D11PixelShader* gDepthOnlyPixelShader = nullptr;
 // These are also added to Shader.h
 ID3D11VertexShader* g2DQuadVertexShader    = nullptr;
 ID3D11VertexShader* g2DPolygonVertexShader = nullptr;
+ID3D11VertexShader* g2DPolygonBatchVertexShader = nullptr;
 ID3D11PixelShader*  gCopyPostProcess       = nullptr;
-ID3D11PixelShader*  gTintPostProcess       = nullptr;
-ID3D11PixelShader*  gGreyNoisePostProcess  = nullptr;
-ID3D11PixelShader*  gBurnPostProcess       = nullptr;
-ID3D11PixelShader*  gDistortPostProcess    = nullptr;
-ID3D11PixelShader*  gSpiralPostProcess     = nullptr;
-ID3D11PixelShader*  gHeatHazePostProcess   = nullptr;
-ID3D11PixelShader*  gHueTintPostProcess = nullptr;
-ID3D11PixelShader*  gBlurVPostProcess = nullptr;
-ID3D11PixelShader*  gBlurHPostProcess = nullptr;
-ID3D11PixelShader*  gUnderwaterPostProcess = nullptr;
-ID3D11PixelShader*  gInvertedColourPostProcess = nullptr;
-ID3D11PixelShader*  gNightVisionPostProcess = nullptr;
-ID3D11PixelShader*  gRetroPostProcess = nullptr;
-ID3D11PixelShader*  gBloom1PostProcess = nullptr;
-ID3D11PixelShader*  gBloom2PostProcess = nullptr;
-ID3D11PixelShader*  gDepthOfFieldPostProcess = nullptr;
+PostProcessShader   gTintPostProcess;
+PostProcessShader   gGreyNoisePostProcess;
+PostProcessShader   gBurnPostProcess;
+PostProcessShader   gDistortPostProcess;
+PostProcessShader   gSpiralPostProcess;
+PostProcessShader   gHeatHazePostProcess;
+PostProcessShader   gHueTintPostProcess;
+PostProcessShader   gBlurVPostProcess;
+PostProcessShader   gBlurHPostProcess;
+PostProcessShader   gUnderwaterPostProcess;
+PostProcessShader   gInvertedColourPostProcess;
+PostProcessShader   gNightVisionPostProcess;
+PostProcessShader   gRetroPostProcess;
+PostProcessShader   gBloom1PostProcess;
+PostProcessShader   gBloom2PostProcess;
+ID3D11PixelShader*  gBloomThresholdPostProcess = nullptr;
+ID3D11PixelShader*  gBloomDownsamplePostProcess = nullptr;
+ID3D11PixelShader*  gBloomUpsamplePostProcess = nullptr;
+PostProcessShader   gBloomCompositePostProcess;
+PostProcessShader   gColourLutPostProcess;
+ID3D11PixelShader*  gPolygonBatchPostProcess = nullptr;
+PostProcessShader   gDepthOfFieldPostProcess;
 ID3D11PixelShader*  gMergeTextures = nullptr;
 
 
 
 
+// Archive holding the bytecode of all the shaders loaded by LoadShaders (see ShaderArchive.h)
+const char* SHADER_ARCHIVE_FILE = "Shaders.pak";
+ShaderArchive gShaderArchive;
+
+// Hash of the bytecode each shader was last created from, by shader name, so LoadShaders can keep shaders that haven't
+// changed when it is called again
+std::map<std::string, uint64_t> gLoadedShaderHashes;
+
+ShaderLoadStats gShaderLoadStats;
+
+// Watches the shader sources for changes (see ShaderHotReload.h)
+ShaderHotReload gShaderHotReload;
+
+
 //--------------------------------------------------------------------------------------
 // Shader creation / destruction
 //--------------------------------------------------------------------------------------
 
-// Load shaders required for this app, returns true on success
-bool LoadShaders()
+namespace
+{
+	// Create a shader object from bytecode. Returns nullptr on failure
+	ID3D11VertexShader* CreateVertexShader(const ShaderBytecode& bytecode)
+	{
+		ID3D11VertexShader* shader;
+		HRESULT hr = gD3DDevice->CreateVertexShader(bytecode.data, bytecode.size, nullptr, &shader);
+		return SUCCEEDED(hr) ? shader : nullptr;
+	}
+
+	ID3D11PixelShader* CreatePixelShader(const ShaderBytecode& bytecode)
+	{
+		ID3D11PixelShader* shader;
+		HRESULT hr = gD3DDevice->CreatePixelShader(bytecode.data, bytecode.size, nullptr, &shader);
+		return SUCCEEDED(hr) ? shader : nullptr;
+	}
+
+
+	// Replace a shader object with a new one, releasing the old one. If the new one is nullptr the old one is kept and
+	// false is returned
+	template <class Shader>
+	bool ReplaceShader(Shader*& shader, Shader* newShader)
+	{
+		if (newShader == nullptr)  return false;
+
+		if (shader)  shader->Release();
+		shader = newShader;
+		return true;
+	}
+
+	template <class Shader>
+	void ReleaseShader(Shader*& shader)
+	{
+		if (shader)  shader->Release();
+		shader = nullptr;
+	}
+
+
+	// Get the bytecode for a shader from the archive, or read it from the shader's .cso file into the buffer if the
+	// archive doesn't hold it
+	bool GetShaderBytecode(const std::string& shaderName, std::vector<char>& buffer, ShaderBytecode& bytecode)
+	{
+		return gShaderArchive.Find(shaderName, bytecode) || ReadShaderFile(shaderName, buffer, bytecode);
+	}
+
+
+	// A shader loaded by LoadShaders - its name (without extension), the profile to compile its source with (for hot
+	// reload) and a function creating its object from bytecode, replacing the existing object. The function returns
+	// false on failure
+	struct ShaderLoad
+	{
+		std::string name;
+		const char* profile;
+		std::function<bool(const ShaderBytecode&)> create;
+	};
+
+	ShaderLoad VertexShader(ID3D11VertexShader*& shader, const char* name)
+	{
+		return { name, "vs_5_0", [&shader](const ShaderBytecode& bytecode) { return ReplaceShader(shader, CreateVertexShader(bytecode)); } };
+	}
+
+	ShaderLoad PixelShader(ID3D11PixelShader*& shader, const char* name)
+	{
+		return { name, "ps_5_0", [&shader](const ShaderBytecode& bytecode) { return ReplaceShader(shader, CreatePixelShader(bytecode)); } };
+	}
+
+	ShaderLoad PixelShader(PostProcessShader& shader, const char* name)
+	{
+		return { name, "ps_5_0", [&shader, name](const ShaderBytecode& bytecode) { return shader.Load(name, bytecode); } };
+	}
+
+	float MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+
+// The shaders used by the app, as loaded by LoadShaders
+const std::vector<ShaderLoad>& AppShaders()
 {
 	// Shaders must be added to the Visual Studio project to be compiled, they use the extension ".hlsl".
 	// To load them for use, include them here without the extension. Use the correct function for each.
-	// Ensure you release the shaders in the ShutdownDirect3D function below
-	gBasicTransformVertexShader   = LoadVertexShader  ("BasicTransform_vs"  );
-	gPixelLightingVertexShader    = LoadVertexShader  ("PixelLighting_vs"   );
-	gTintedTexturePixelShader     = LoadPixelShader   ("TintedTexture_ps"   );
-	gPixelLightingPixelShader     = LoadPixelShader   ("PixelLighting_ps"   );
-	gDepthOnlyPixelShader		  = LoadPixelShader   ("DepthOnly_ps"       );
-
-	//***************************************
-	//**** Post processing shaders
-	g2DPolygonVertexShader	   = LoadVertexShader("2DPolygon_pp");
-	g2DQuadVertexShader		   = LoadVertexShader("2DQuad_pp");
-	gCopyPostProcess		   = LoadPixelShader ("Copy_pp");
-	gTintPostProcess		   = LoadPixelShader ("Tint_pp");
-	gGreyNoisePostProcess	   = LoadPixelShader ("GreyNoise_pp");
-	gBurnPostProcess		   = LoadPixelShader ("Burn_pp");
-	gDistortPostProcess		   = LoadPixelShader ("Distort_pp");
-	gSpiralPostProcess		   = LoadPixelShader ("Spiral_pp");
-	gHeatHazePostProcess	   = LoadPixelShader ("HeatHaze_pp");
-	gHueTintPostProcess		   = LoadPixelShader("HueTint_pp");
-	gBlurVPostProcess		   = LoadPixelShader("BlurVertical_pp");
-	gBlurHPostProcess		   = LoadPixelShader("BlurHorizontal_pp");
-	gUnderwaterPostProcess	   = LoadPixelShader("Underwater_pp");
-	gInvertedColourPostProcess = LoadPixelShader("InvertColour_pp");
-	gNightVisionPostProcess    = LoadPixelShader("NightVision_pp");
-	gRetroPostProcess		   = LoadPixelShader("Retro_pp");
-	gBloom1PostProcess		   = LoadPixelShader("Bloom1_pp");
-	gBloom2PostProcess		   = LoadPixelShader("Bloom2_pp");
-	gDepthOfFieldPostProcess   = LoadPixelShader("DOF_pp");
-	gMergeTextures             = LoadPixelShader("Merging_pp");
-	
-
-
-	if (gBasicTransformVertexShader == nullptr || gPixelLightingVertexShader == nullptr ||
-		gTintedTexturePixelShader   == nullptr || gPixelLightingPixelShader  == nullptr ||
-		g2DQuadVertexShader         == nullptr || gCopyPostProcess           == nullptr ||
-		gTintPostProcess            == nullptr || gHeatHazePostProcess       == nullptr ||
-		gGreyNoisePostProcess       == nullptr || gBurnPostProcess           == nullptr ||
-		gDistortPostProcess         == nullptr || gSpiralPostProcess         == nullptr ||
-		g2DPolygonVertexShader      == nullptr || gHueTintPostProcess        == nullptr ||
-		gBlurVPostProcess           == nullptr || gBlurHPostProcess          == nullptr ||
-		gUnderwaterPostProcess      == nullptr || gMergeTextures	         == nullptr ||
-		gInvertedColourPostProcess  == nullptr || gNightVisionPostProcess    == nullptr ||
-		gBloom1PostProcess			== nullptr || gBloom2PostProcess		 == nullptr ||
-		gDepthOfFieldPostProcess    == nullptr || gRetroPostProcess			 == nullptr ||
-		gDepthOnlyPixelShader       == nullptr)
+	// Ensure you release the shaders in the ReleaseShaders function below
+	static const std::vector<ShaderLoad> shaders =
+	{
+		VertexShader(gBasicTransformVertexShader, "BasicTransform_vs"),
+		VertexShader(gPixelLightingVertexShader,  "PixelLighting_vs" ),
+		PixelShader (gTintedTexturePixelShader,   "TintedTexture_ps" ),
+		PixelShader (gPixelLightingPixelShader,   "PixelLighting_ps" ),
+		PixelShader (gDepthOnlyPixelShader,       "DepthOnly_ps"     ),
+
+		//***************************************
+		//**** Post processing shaders
+		VertexShader(g2DPolygonVertexShader,      "2DPolygon_pp"      ),
+		VertexShader(g2DPolygonBatchVertexShader, "2DPolygonBatch_pp" ),
+		VertexShader(g2DQuadVertexShader,         "2DQuad_pp"         ),
+		PixelShader (gCopyPostProcess,            "Copy_pp"           ),
+		PixelShader (gBloomThresholdPostProcess,  "BloomThreshold_pp" ),
+		PixelShader (gBloomDownsamplePostProcess, "BloomDownsample_pp"),
+		PixelShader (gBloomUpsamplePostProcess,   "BloomUpsample_pp"  ),
+		PixelShader (gPolygonBatchPostProcess,    "PolygonBatch_pp"   ),
+		PixelShader (gMergeTextures,              "Merging_pp"        ),
+
+		// Shaders with a mid-line variant (see PostProcessShader in Shader.h)
+		PixelShader(gTintPostProcess,           "Tint_pp"          ),
+		PixelShader(gGreyNoisePostProcess,      "GreyNoise_pp"     ),
+		PixelShader(gBurnPostProcess,           "Burn_pp"          ),
+		PixelShader(gDistortPostProcess,        "Distort_pp"       ),
+		PixelShader(gSpiralPostProcess,         "Spiral_pp"        ),
+		PixelShader(gHeatHazePostProcess,       "HeatHaze_pp"      ),
+		PixelShader(gHueTintPostProcess,        "HueTint_pp"       ),
+		PixelShader(gBlurVPostProcess,          "BlurVertical_pp"  ),
+		PixelShader(gBlurHPostProcess,          "BlurHorizontal_pp"),
+		PixelShader(gUnderwaterPostProcess,     "Underwater_pp"    ),
+		PixelShader(gInvertedColourPostProcess, "InvertColour_pp"  ),
+		PixelShader(gNightVisionPostProcess,    "NightVision_pp"   ),
+		PixelShader(gRetroPostProcess,          "Retro_pp"         ),
+		PixelShader(gBloom1PostProcess,         "Bloom1_pp"        ),
+		PixelShader(gBloom2PostProcess,         "Bloom2_pp"        ),
+		PixelShader(gBloomCompositePostProcess, "BloomComposite_pp"),
+		PixelShader(gColourLutPostProcess,      "ColourLut_pp"     ),
+		PixelShader(gDepthOfFieldPostProcess,   "DOF_pp"           ),
+	};
+	return shaders;
+}
+
+
+// Load shaders required for this app, returns true on success
+bool LoadShaders()
+{
+	ScopedTraceEvent trace("Shaders", "LoadShaders");
+	auto startTime = std::chrono::steady_clock::now();
+	const std::vector<ShaderLoad>& shaders = AppShaders();
+	int numShaders = static_cast<int>(shaders.size());
+
+	ShaderLoadStats stats;
+	stats.numShaders = numShaders;
+
+	// Bring the archive up to date with the .cso files. It is unmapped first as Windows won't write over a mapped file.
+	// If it can't be built or opened the shaders are read from their .cso files instead
+	uint64_t archiveStart = TraceEventStart();
+	std::vector<std::string> shaderNames;
+	for (auto& shader : shaders)  shaderNames.push_back(shader.name);
+	gShaderArchive.Close();
+	if (!IsShaderArchiveCurrent(SHADER_ARCHIVE_FILE, shaderNames))
+	{
+		stats.archiveRebuilt = BuildShaderArchive(SHADER_ARCHIVE_FILE, shaderNames);
+	}
+	stats.fromArchive = gShaderArchive.Open(SHADER_ARCHIVE_FILE);
+	stats.archiveBytes = gShaderArchive.SizeBytes();
+	stats.archiveMs = MillisecondsSince(startTime);
+	AddTraceEvent("Shaders", "Shader archive", archiveStart);
+
+
+	// Create the shader objects on the thread pool (the device can be used from several threads at once). Shaders
+	// whose bytecode is the same as when they were last loaded keep the object they have
+	auto createTime = std::chrono::steady_clock::now();
+	enum LoadResult { Failed, Created, Unchanged };
+	std::vector<int> results(numShaders, Failed);
+	std::vector<uint64_t> hashes(numShaders, 0);
+	gThreadPool.ParallelFor(0, numShaders, [&](int first, int last)
+	{
+		std::vector<char> buffer;
+		for (int s = first; s < last; ++s)
+		{
+			ScopedTraceEvent shaderTrace("Shaders", shaders[s].name);
+			ShaderBytecode bytecode;
+			if (!GetShaderBytecode(shaders[s].name, buffer, bytecode))  continue;
+
+			hashes[s] = bytecode.hash;
+			auto loaded = gLoadedShaderHashes.find(shaders[s].name);
+			if (loaded != gLoadedShaderHashes.end() && loaded->second == bytecode.hash)  results[s] = Unchanged;
+			else if (shaders[s].create(bytecode))                                         results[s] = Created;
+		}
+	}, 1);
+	stats.createMs = MillisecondsSince(createTime);
+
+
+	// A shader that failed is loaded again next time even if its bytecode is the same
+	bool allLoaded = true;
+	for (int s = 0; s < numShaders; ++s)
+	{
+		if (results[s] == Failed)
+		{
+			gLoadedShaderHashes.erase(shaders[s].name);
+			allLoaded = false;
+			continue;
+		}
+		gLoadedShaderHashes[shaders[s].name] = hashes[s];
+		if (results[s] == Created)  stats.numCreated++;
+		else                        stats.numUnchanged++;
+	}
+	stats.totalMs = MillisecondsSince(startTime);
+	gShaderLoadStats = stats;
+
+	// Watch the sources so changes are picked up while the app runs
+	for (auto& shader : shaders)  gShaderHotReload.Watch(shader.name);
+
+	if (!allLoaded)
 	{
 		gLastError = "Error loading shaders";
 		return false;
@@ -115,94 +293,145 @@ bool LoadShaders()
 
 void ReleaseShaders()
 {
-	if (gHeatHazePostProcess)         gHeatHazePostProcess       ->Release();
-	if (gSpiralPostProcess)           gSpiralPostProcess         ->Release();
-	if (gDistortPostProcess)          gDistortPostProcess        ->Release();
-	if (gBurnPostProcess)             gBurnPostProcess           ->Release();
-	if (gGreyNoisePostProcess)        gGreyNoisePostProcess      ->Release();
-	if (gTintPostProcess)             gTintPostProcess           ->Release();
-	if (gCopyPostProcess)             gCopyPostProcess           ->Release();
-	if (g2DPolygonVertexShader)       g2DPolygonVertexShader     ->Release();
-	if (g2DQuadVertexShader)          g2DQuadVertexShader        ->Release();
-	if (gPixelLightingPixelShader)    gPixelLightingPixelShader  ->Release();
-	if (gDepthOnlyPixelShader)        gDepthOnlyPixelShader      ->Release();
-	if (gTintedTexturePixelShader)    gTintedTexturePixelShader  ->Release();
-	if (gPixelLightingVertexShader)   gPixelLightingVertexShader ->Release();
-	if (gBasicTransformVertexShader)  gBasicTransformVertexShader->Release();
-	if (gHueTintPostProcess)          gHueTintPostProcess		 ->Release();
-	if (gBlurVPostProcess)            gBlurVPostProcess			 ->Release();
-	if (gBlurHPostProcess)            gBlurHPostProcess			 ->Release();
-	if (gUnderwaterPostProcess)       gUnderwaterPostProcess	 ->Release();
-	if (gInvertedColourPostProcess)   gInvertedColourPostProcess ->Release();
-	if (gNightVisionPostProcess)      gNightVisionPostProcess	 ->Release();
-	if (gRetroPostProcess)			  gRetroPostProcess			 ->Release();
-	if (gBloom1PostProcess)			  gBloom1PostProcess		 ->Release();
-	if (gBloom2PostProcess)			  gBloom2PostProcess		 ->Release();
-	if (gDepthOfFieldPostProcess)	  gDepthOfFieldPostProcess   ->Release();
-	if (gMergeTextures)               gMergeTextures			 ->Release();
-
+	gHeatHazePostProcess      .Release();
+	gSpiralPostProcess        .Release();
+	gDistortPostProcess       .Release();
+	gBurnPostProcess          .Release();
+	gGreyNoisePostProcess     .Release();
+	gTintPostProcess          .Release();
+	ReleaseShader(gCopyPostProcess);
+	ReleaseShader(g2DPolygonVertexShader);
+	ReleaseShader(g2DQuadVertexShader);
+	ReleaseShader(gPixelLightingPixelShader);
+	ReleaseShader(gDepthOnlyPixelShader);
+	ReleaseShader(gTintedTexturePixelShader);
+	ReleaseShader(gPixelLightingVertexShader);
+	ReleaseShader(gBasicTransformVertexShader);
+	gHueTintPostProcess       .Release();
+	gBlurVPostProcess         .Release();
+	gBlurHPostProcess         .Release();
+	gUnderwaterPostProcess    .Release();
+	gInvertedColourPostProcess.Release();
+	gNightVisionPostProcess   .Release();
+	gRetroPostProcess         .Release();
+	gBloom1PostProcess        .Release();
+	gBloom2PostProcess        .Release();
+	ReleaseShader(gBloomThresholdPostProcess);
+	ReleaseShader(gBloomDownsamplePostProcess);
+	ReleaseShader(gBloomUpsamplePostProcess);
+	gBloomCompositePostProcess.Release();
+	gColourLutPostProcess     .Release();
+	ReleaseShader(gPolygonBatchPostProcess);
+	ReleaseShader(g2DPolygonBatchVertexShader);
+	gDepthOfFieldPostProcess  .Release();
+	ReleaseShader(gMergeTextures);
+
+	// Everything is created again by the next LoadShaders
+	gLoadedShaderHashes.clear();
+	gShaderArchive.Close();
 }
 
 
 
-// Load a vertex shader, include the file in the project and pass the name (without the .hlsl extension)
-// to this function. The returned pointer needs to be released before quitting. Returns nullptr on failure. 
-ID3D11VertexShader* LoadVertexShader(std::string shaderName)
+//--------------------------------------------------------------------------------------
+// Hot reload
+//--------------------------------------------------------------------------------------
+
+// Compile one of the app's shaders from its .hlsl file and swap it in for the current one. Returns false with the
+// compiler's message in error on failure, leaving the current shader in place
+bool ReloadShader(const std::string& shaderName, std::string& error)
 {
-	// Open compiled shader object file
-	std::ifstream shaderFile(shaderName + ".cso", std::ios::in | std::ios::binary | std::ios::ate);
-	if (!shaderFile.is_open())
+	auto& shaders = AppShaders();
+	auto shader = std::find_if(shaders.begin(), shaders.end(), [&](const ShaderLoad& s) { return s.name == shaderName; });
+	if (shader == shaders.end())
 	{
-		return nullptr;
+		error = "not a shader loaded by LoadShaders";
+		return false;
 	}
 
-	// Read file into vector of chars
-	std::streamoff fileSize = shaderFile.tellg();
-	shaderFile.seekg(0, std::ios::beg);
-	std::vector<char> byteCode(fileSize);
-	shaderFile.read(&byteCode[0], fileSize);
-	if (shaderFile.fail())
+	std::string fileName = shaderName + ".hlsl";
+	std::ifstream sourceFile(fileName);
+	if (!sourceFile.is_open())
 	{
-		return nullptr;
+		error = "can't open " + fileName;
+		return false;
+	}
+	std::string source((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+
+	// Compiled as Visual Studio compiles the .cso files. Naming the file lets the compiler report errors against it
+	ID3DBlob* compiledShader = nullptr;
+	ID3DBlob* errors = nullptr;
+	HRESULT hr = D3DCompile(source.c_str(), source.length(), fileName.c_str(), NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main",
+	                        shader->profile, D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &compiledShader, &errors);
+	if (errors)
+	{
+		error.assign(static_cast<const char*>(errors->GetBufferPointer()), errors->GetBufferSize());
+		errors->Release();
 	}
-
-	// Create shader object from loaded file (we will use the object later when rendering)
-	ID3D11VertexShader* shader;
-	HRESULT hr = gD3DDevice->CreateVertexShader(byteCode.data(), byteCode.size(), nullptr, &shader);
 	if (FAILED(hr))
 	{
-		return nullptr;
+		if (error.empty())  error = "compile failed";
+		return false;
 	}
 
-	return shader;
+	ShaderBytecode bytecode;
+	bytecode.data = compiledShader->GetBufferPointer();
+	bytecode.size = compiledShader->GetBufferSize();
+	bytecode.hash = HashBytes(bytecode.data, bytecode.size);
+	bool created = shader->create(bytecode);
+	compiledShader->Release();
+	if (!created)
+	{
+		error = "can't create shader object";
+		return false;
+	}
+
+	// LoadShaders compares against this, so a later load from the archive replaces the compiled shader
+	gLoadedShaderHashes[shaderName] = bytecode.hash;
+	return true;
 }
 
 
-// Load a geometry shader, include the file in the project and pass the name (without the .hlsl extension)
-// to this function. The returned pointer needs to be released before quitting. Returns nullptr on failure. 
-// Basically the same code as above but for pixel shaders
-ID3D11GeometryShader* LoadGeometryShader(std::string shaderName)
+// Check the shader sources for changes and swap in any shader whose source has changed
+ShaderSourceChanges ReloadChangedShaders()
 {
-	// Open compiled shader object file
-	std::ifstream shaderFile(shaderName + ".cso", std::ios::in | std::ios::binary | std::ios::ate);
-	if (!shaderFile.is_open())
+	return gShaderHotReload.Update(ReloadShader);
+}
+
+
+
+// Load a vertex shader, include the file in the project and pass the name (without the .hlsl extension)
+// to this function. The compiled code comes from the shader archive if it holds the shader, otherwise the .cso file.
+// The returned pointer needs to be released before quitting. Returns nullptr on failure. 
+ID3D11VertexShader* LoadVertexShader(std::string shaderName)
+{
+	std::vector<char> buffer;
+	ShaderBytecode bytecode;
+	if (!GetShaderBytecode(shaderName, buffer, bytecode))
 	{
 		return nullptr;
 	}
 
-	// Read file into vector of chars
-	std::streamoff fileSize = shaderFile.tellg();
-	shaderFile.seekg(0, std::ios::beg);
-	std::vector<char>byteCode(fileSize);
-	shaderFile.read(&byteCode[0], fileSize);
-	if (shaderFile.fail())
+	// Create shader object from the compiled code (we will use the object later when rendering)
+	return CreateVertexShader(bytecode);
+}
+
+
+// Load a geometry shader, include the file in the project and pass the name (without the .hlsl extension)
+// to this function. The returned pointer needs to be released before quitting. Returns nullptr on failure. 
+// Basically the same code as above but for geometry shaders
+ID3D11GeometryShader* LoadGeometryShader(std::string shaderName)
+{
+	std::vector<char> buffer;
+	ShaderBytecode bytecode;
+	if (!GetShaderBytecode(shaderName, buffer, bytecode))
 	{
 		return nullptr;
 	}
 
-	// Create shader object from loaded file (we will use the object later when rendering)
+	// Create shader object from the compiled code (we will use the object later when rendering)
 	ID3D11GeometryShader* shader;
-	HRESULT hr = gD3DDevice->CreateGeometryShader(byteCode.data(), byteCode.size(), nullptr, &shader);
+	HRESULT hr = gD3DDevice->CreateGeometryShader(bytecode.data, bytecode.size, nullptr, &shader);
 	if (FAILED(hr))
 	{
 		return nullptr;
@@ -217,26 +446,16 @@ ID3D11GeometryShader* LoadGeometryShader(std::string shaderName)
 // The returned pointer needs to be released before quitting. Returns nullptr on failure. 
 ID3D11GeometryShader* LoadStreamOutGeometryShader(std::string shaderName, D3D11_SO_DECLARATION_ENTRY* soDecl, unsigned int soNumEntries, unsigned int soStride)
 {
-	// Open compiled shader object file
-	std::ifstream shaderFile(shaderName + ".cso", std::ios::in | std::ios::binary | std::ios::ate);
-	if (!shaderFile.is_open())
-	{
-		return nullptr;
-	}
-
-	// Read file into vector of chars
-	std::streamoff fileSize = shaderFile.tellg();
-	shaderFile.seekg(0, std::ios::beg);
-	std::vector<char>byteCode(fileSize);
-	shaderFile.read(&byteCode[0], fileSize);
-	if (shaderFile.fail())
+	std::vector<char> buffer;
+	ShaderBytecode bytecode;
+	if (!GetShaderBytecode(shaderName, buffer, bytecode))
 	{
 		return nullptr;
 	}
 
-	// Create shader object from loaded file (we will use the object later when rendering)
+	// Create shader object from the compiled code (we will use the object later when rendering)
 	ID3D11GeometryShader* shader;
-	HRESULT hr = gD3DDevice->CreateGeometryShaderWithStreamOutput(byteCode.data(), byteCode.size(),
+	HRESULT hr = gD3DDevice->CreateGeometryShaderWithStreamOutput(bytecode.data, bytecode.size,
 		                                                          soDecl, soNumEntries, &soStride, 1, D3D11_SO_NO_RASTERIZED_STREAM, nullptr, &shader);
 	if(FAILED(hr))
 	{
@@ -254,26 +473,34 @@ ID3D11GeometryShader* LoadStreamOutGeometryShader(std::string shaderName, D3D11_
 // Basically the same code as above but for pixel shaders
 ID3D11PixelShader* LoadPixelShader(std::string shaderName)
 {
-	// Open compiled shader object file
-	std::ifstream shaderFile(shaderName + ".cso", std::ios::in | std::ios::binary | std::ios::ate);
-	if (!shaderFile.is_open())
+	std::vector<char> buffer;
+	ShaderBytecode bytecode;
+	if (!GetShaderBytecode(shaderName, buffer, bytecode))
 	{
 		return nullptr;
 	}
 
-	// Read file into vector of chars
-	std::streamoff fileSize = shaderFile.tellg();
-	shaderFile.seekg(0, std::ios::beg);
-	std::vector<char>byteCode(fileSize);
-	shaderFile.read(&byteCode[0], fileSize);
-	if (shaderFile.fail())
+	// Create shader object from the compiled code (we will use the object later when rendering)
+	return CreatePixelShader(bytecode);
+}
+
+
+// Compile a pixel shader from HLSL source held in a string (entry point "main"). #include files are looked for in the
+// current directory. The returned pointer needs to be released before quitting. Returns nullptr on failure
+ID3D11PixelShader* CompilePixelShader(const std::string& shaderSource)
+{
+	ID3DBlob* compiledShader;
+	HRESULT hr = D3DCompile(shaderSource.c_str(), shaderSource.length(), NULL, NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main",
+	                        "ps_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &compiledShader, NULL);
+	if (FAILED(hr))
 	{
 		return nullptr;
 	}
 
-	// Create shader object from loaded file (we will use the object later when rendering)
+	// Create shader object from the compiled code
 	ID3D11PixelShader* shader;
-	HRESULT hr = gD3DDevice->CreatePixelShader(byteCode.data(), byteCode.size(), nullptr, &shader);
+	hr = gD3DDevice->CreatePixelShader(compiledShader->GetBufferPointer(), compiledShader->GetBufferSize(), nullptr, &shader);
+	compiledShader->Release();
 	if (FAILED(hr))
 	{
 		return nullptr;
@@ -284,6 +511,62 @@ ID3D11PixelShader* LoadPixelShader(std::string shaderName)
 
 
 
+//--------------------------------------------------------------------------------------
+// Post-processing shader variants
+//--------------------------------------------------------------------------------------
+
+// Create the NoMidLine variant from the precompiled bytecode of the shader with the given name, replacing any variants
+// already created. Returns false on failure, keeping the existing variants
+bool PostProcessShader::Load(const std::string& shaderName, const ShaderBytecode& bytecode)
+{
+	ID3D11PixelShader* noMidLine = CreatePixelShader(bytecode);
+	if (noMidLine == nullptr)  return false;
+
+	// The mid-line variant is compiled again from the (possibly changed) source when next needed
+	Release();
+	mName = shaderName;
+	mVariants[static_cast<int>(ShaderVariant::NoMidLine)] = noMidLine;
+	return true;
+}
+
+
+// Get the shader for the given variant, compiling it on first use
+ID3D11PixelShader* PostProcessShader::Get(ShaderVariant variant)
+{
+	int v = static_cast<int>(variant);
+	ID3D11PixelShader* noMidLine = mVariants[static_cast<int>(ShaderVariant::NoMidLine)];
+	if (mVariants[v] != nullptr)  return mVariants[v];
+	if (mCompileFailed[v] || noMidLine == nullptr)  return noMidLine;
+
+	// Only the mid-line variant is ever compiled here - the source is the .hlsl file with the split switched on
+	std::ifstream sourceFile(mName + ".hlsl");
+	if (sourceFile.is_open())
+	{
+		std::string source((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+		mVariants[v] = CompilePixelShader("#define MIDLINE_SPLIT 1\n" + source);
+	}
+	if (mVariants[v] == nullptr)
+	{
+		mCompileFailed[v] = true;
+		return noMidLine;
+	}
+	return mVariants[v];
+}
+
+
+// Release all variants
+void PostProcessShader::Release()
+{
+	for (int v = 0; v < NUM_SHADER_VARIANTS; ++v)
+	{
+		if (mVariants[v])  mVariants[v]->Release();
+		mVariants[v] = nullptr;
+		mCompileFailed[v] = false;
+	}
+}
+
+
+
 // Very advanced topic: When creating a vertex layout for geometry (see Scene.cpp), you need the signature
 // (bytecode) of a shader that uses that vertex layout. This is an annoying requirement and tends to create
 // unnecessary coupling between shaders and vertex buffers.
@@ -5,9 +5,40 @@
 #ifndef _SHADER_H_INCLUDED_
 #define _SHADER_H_INCLUDED_
 
+#include "PostProcess.h"
+#include "ShaderArchive.h"
+#include "ShaderHotReload.h"
 #include <d3d11.h>
 #include <string>
 
+
+//--------------------------------------------------------------------------------------
+// Post-processing shader variants
+//--------------------------------------------------------------------------------------
+// A post-processing pixel shader with a version for each ShaderVariant (see PostProcess.h). The NoMidLine variant is
+// the precompiled .cso, used for almost every pass. The MidLine variant is only needed while the mid-line split is
+// shown, so it is compiled from the .hlsl source the first time it is asked for (with MIDLINE_SPLIT defined). If that
+// compile fails the NoMidLine variant is used instead, so the effect still shows but without the split
+class PostProcessShader
+{
+public:
+	// Create the NoMidLine variant from the precompiled bytecode of the shader with the given name (without extension),
+	// replacing any variants already created. Returns false on failure
+	bool Load(const std::string& shaderName, const ShaderBytecode& bytecode);
+
+	// Get the shader for the given variant, compiling it on first use. Returns nullptr if the shader isn't loaded
+	ID3D11PixelShader* Get(ShaderVariant variant);
+
+	// Release all variants
+	void Release();
+
+private:
+	std::string        mName;
+	ID3D11PixelShader* mVariants[NUM_SHADER_VARIANTS] = {};
+	bool               mCompileFailed[NUM_SHADER_VARIANTS] = {};
+};
+
+
 //--------------------------------------------------------------------------------------
 // Global Variables
 //--------------------------------------------------------------------------------------
@@ -26,23 +57,30 @@ extern ID3D11PixelShader*    gDepthOnlyPixelShader;
 //**** Post-processing shader DirectX objects
 extern ID3D11VertexShader* g2DQuadVertexShader;
 extern ID3D11VertexShader* g2DPolygonVertexShader;
+extern ID3D11VertexShader* g2DPolygonBatchVertexShader;
 extern ID3D11PixelShader*  gCopyPostProcess;
-extern ID3D11PixelShader*  gTintPostProcess;
-extern ID3D11PixelShader*  gGreyNoisePostProcess;
-extern ID3D11PixelShader*  gBurnPostProcess;
-extern ID3D11PixelShader*  gDistortPostProcess;
-extern ID3D11PixelShader*  gSpiralPostProcess;
-extern ID3D11PixelShader*  gHeatHazePostProcess;
-extern ID3D11PixelShader* gHueTintPostProcess;
-extern ID3D11PixelShader* gBlurVPostProcess;
-extern ID3D11PixelShader* gBlurHPostProcess;
-extern ID3D11PixelShader* gUnderwaterPostProcess;
-extern ID3D11PixelShader* gInvertedColourPostProcess;
-extern ID3D11PixelShader* gNightVisionPostProcess;
-extern ID3D11PixelShader* gRetroPostProcess;
-extern ID3D11PixelShader* gBloom1PostProcess;
-extern ID3D11PixelShader* gBloom2PostProcess;
-extern ID3D11PixelShader* gDepthOfFieldPostProcess;
+extern PostProcessShader   gTintPostProcess;
+extern PostProcessShader   gGreyNoisePostProcess;
+extern PostProcessShader   gBurnPostProcess;
+extern PostProcessShader   gDistortPostProcess;
+extern PostProcessShader   gSpiralPostProcess;
+extern PostProcessShader   gHeatHazePostProcess;
+extern PostProcessShader  gHueTintPostProcess;
+extern PostProcessShader  gBlurVPostProcess;
+extern PostProcessShader  gBlurHPostProcess;
+extern PostProcessShader  gUnderwaterPostProcess;
+extern PostProcessShader  gInvertedColourPostProcess;
+extern PostProcessShader  gNightVisionPostProcess;
+extern PostProcessShader  gRetroPostProcess;
+extern PostProcessShader  gBloom1PostProcess;
+extern PostProcessShader  gBloom2PostProcess;
+extern ID3D11PixelShader* gBloomThresholdPostProcess;
+extern ID3D11PixelShader* gBloomDownsamplePostProcess;
+extern ID3D11PixelShader* gBloomUpsamplePostProcess;
+extern PostProcessShader  gBloomCompositePostProcess;
+extern PostProcessShader  gColourLutPostProcess;
+extern ID3D11PixelShader* gPolygonBatchPostProcess;
+extern PostProcessShader  gDepthOfFieldPostProcess;
 extern ID3D11PixelShader* gMergeTextures;
 
 
@@ -52,13 +90,46 @@ extern ID3D11PixelShader* gMergeTextures;
 // Shader creation / destruction
 //--------------------------------------------------------------------------------------
 
-// Load shaders required for this app, returns true on success
+// Load shaders required for this app, returns true on success. The bytecode comes from the shader archive (see
+// ShaderArchive.h), which is rebuilt first if any .cso file is newer, and the shader objects are created in parallel
+// on the thread pool. Can be called again to reload the shaders - those whose bytecode hasn't changed are kept
 bool LoadShaders();
 
 // Release shaders used by the app
 void ReleaseShaders();
 
 
+// Timings and counts from the last call to LoadShaders
+struct ShaderLoadStats
+{
+	int    numShaders     = 0;     // Shaders loaded by LoadShaders
+	int    numCreated     = 0;     // Shader objects created
+	int    numUnchanged   = 0;     // Shaders kept because their bytecode was the same as when they were last loaded
+	bool   archiveRebuilt = false; // The archive was (re)built from the .cso files
+	bool   fromArchive    = false; // The bytecode came from the archive rather than the separate .cso files
+	size_t archiveBytes   = 0;
+	float  archiveMs      = 0;     // Time checking, building and mapping the archive
+	float  createMs       = 0;     // Time creating shader objects
+	float  totalMs        = 0;
+};
+
+extern ShaderLoadStats gShaderLoadStats;
+
+
+//--------------------------------------------------------------------------------------
+// Hot reload
+//--------------------------------------------------------------------------------------
+
+// Watches the sources of the shaders loaded by LoadShaders. Call FramePresented on it after each Present to measure
+// reload latency, and see Stats for the results
+extern ShaderHotReload gShaderHotReload;
+
+// Check the shader sources for changes (at most every ShaderHotReload::POLL_INTERVAL seconds), compiling any shader whose
+// .hlsl file or includes have been saved and swapping it in. Shaders that fail to compile are kept as they were.
+// Shaders generated at run time aren't reloaded here - regenerate them if the result says an include changed
+ShaderSourceChanges ReloadChangedShaders();
+
+
 //--------------------------------------------------------------------------------------
 // Constant buffer creation / destruction
 //--------------------------------------------------------------------------------------
@@ -78,6 +149,10 @@ ID3D11VertexShader*   LoadVertexShader  (std::string shaderName);
 ID3D11GeometryShader* LoadGeometryShader(std::string shaderName);
 ID3D11PixelShader*    LoadPixelShader   (std::string shaderName);
 
+// Compile a pixel shader from HLSL source held in a string (entry point "main"). #include files are looked for in the
+// current directory. The returned pointer needs to be released before quitting. Returns nullptr on failure
+ID3D11PixelShader*    CompilePixelShader(const std::string& shaderSource);
+
 // Special method to load a geometry shader that can use the stream-out stage, Use like the other functions in this file except
 // also pass the stream out declaration, number of entries in the declaration and the size of each output element. 
 // The returned pointer needs to be released before quitting. Returns nullptr on failure. 
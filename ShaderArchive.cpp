@@ -0,0 +1,253 @@
+//--------------------------------------------------------------------------------------
+// Packed archive of compiled shaders
+//--------------------------------------------------------------------------------------
+
+#include "ShaderArchive.h"
+#include "ConstantBlocks.h" // HashBytes
+#include "ThreadPool.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Memory mapped files
+//--------------------------------------------------------------------------------------
+
+// Map the given file, returns false if it can't be opened or is empty
+bool MappedFile::Open(const std::string& fileName)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)  return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* data = (mapping != nullptr) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (data == nullptr)
+	{
+		if (mapping)  CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFile = file;
+	mMapping = mapping;
+	mData = static_cast<const uint8_t*>(data);
+	mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0)  return false;
+
+	struct stat fileInfo;
+	if (fstat(file, &fileInfo) != 0 || fileInfo.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+
+	// The mapping stays valid after the file is closed
+	void* data = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED)  return false;
+
+	mData = static_cast<const uint8_t*>(data);
+	mSize = static_cast<size_t>(fileInfo.st_size);
+#endif
+	return true;
+}
+
+
+// Unmap the file
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (mData)     UnmapViewOfFile(mData);
+	if (mMapping)  CloseHandle(mMapping);
+	if (mFile)     CloseHandle(mFile);
+	mFile = nullptr;
+	mMapping = nullptr;
+#else
+	if (mData)  munmap(const_cast<uint8_t*>(mData), mSize);
+#endif
+	mData = nullptr;
+	mSize = 0;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Archive
+//--------------------------------------------------------------------------------------
+
+// Map an archive file and read its index, returns false if it is missing or not a valid archive
+bool ShaderArchive::Open(const std::string& fileName)
+{
+	Close();
+	if (!mFile.Open(fileName))  return false;
+
+	const uint8_t* data = mFile.Data();
+	size_t size = mFile.Size();
+	ShaderArchiveHeader header;
+	if (size < sizeof(header))
+	{
+		Close();
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic != SHADER_ARCHIVE_MAGIC || header.version != SHADER_ARCHIVE_VERSION ||
+	    header.numShaders > (size - sizeof(header)) / sizeof(ShaderArchiveEntry))
+	{
+		Close();
+		return false;
+	}
+
+	// Check every entry lies inside the file before trusting any of them
+	for (uint32_t e = 0; e < header.numShaders; ++e)
+	{
+		ShaderArchiveEntry entry;
+		std::memcpy(&entry, data + sizeof(header) + e * sizeof(entry), sizeof(entry));
+		if (entry.name[MAX_SHADER_NAME - 1] != 0 || entry.offset > size || entry.size > size - entry.offset)
+		{
+			Close();
+			return false;
+		}
+
+		ShaderBytecode& bytecode = mIndex[entry.name];
+		bytecode.data = data + entry.offset;
+		bytecode.size = static_cast<size_t>(entry.size);
+		bytecode.hash = entry.hash;
+	}
+	return true;
+}
+
+
+// Unmap the archive
+void ShaderArchive::Close()
+{
+	mIndex.clear();
+	mFile.Close();
+}
+
+
+// Find the bytecode of a shader by name (without extension), returns false if the archive doesn't hold it
+bool ShaderArchive::Find(const std::string& shaderName, ShaderBytecode& bytecode) const
+{
+	auto entry = mIndex.find(shaderName);
+	if (entry == mIndex.end())  return false;
+
+	bytecode = entry->second;
+	return true;
+}
+
+
+// Whether the archive file exists and no .cso file for the given shaders is newer than it
+bool IsShaderArchiveCurrent(const std::string& fileName, const std::vector<std::string>& shaderNames)
+{
+	std::error_code error;
+	auto archiveTime = std::filesystem::last_write_time(fileName, error);
+	if (error)  return false;
+
+	for (auto& shaderName : shaderNames)
+	{
+		auto shaderTime = std::filesystem::last_write_time(shaderName + ".cso", error);
+		if (!error && shaderTime > archiveTime)  return false;
+	}
+	return true;
+}
+
+
+// Read the .cso files for the given shaders on the thread pool and pack them into an archive file
+bool BuildShaderArchive(const std::string& fileName, const std::vector<std::string>& shaderNames)
+{
+	int numShaders = static_cast<int>(shaderNames.size());
+	for (auto& shaderName : shaderNames)
+	{
+		if (shaderName.length() >= MAX_SHADER_NAME)  return false;
+	}
+
+	// Read and hash the files in parallel, each is small so one file is one job
+	std::vector<std::vector<char>> buffers(numShaders);
+	std::vector<ShaderBytecode> bytecodes(numShaders);
+	std::vector<int> read(numShaders, 0);
+	gThreadPool.ParallelFor(0, numShaders, [&](int first, int last)
+	{
+		for (int s = first; s < last; ++s)
+		{
+			read[s] = ReadShaderFile(shaderNames[s], buffers[s], bytecodes[s]);
+		}
+	}, 1);
+	for (int s = 0; s < numShaders; ++s)
+	{
+		if (!read[s])  return false;
+	}
+
+	// Lay out the index then the bytecode
+	ShaderArchiveHeader header = { SHADER_ARCHIVE_MAGIC, SHADER_ARCHIVE_VERSION, static_cast<uint32_t>(numShaders), 0 };
+	std::vector<ShaderArchiveEntry> entries(numShaders);
+	uint64_t offset = sizeof(header) + numShaders * sizeof(ShaderArchiveEntry);
+	for (int s = 0; s < numShaders; ++s)
+	{
+		offset = (offset + SHADER_ARCHIVE_ALIGNMENT - 1) / SHADER_ARCHIVE_ALIGNMENT * SHADER_ARCHIVE_ALIGNMENT;
+		std::memset(&entries[s], 0, sizeof(ShaderArchiveEntry));
+		std::memcpy(entries[s].name, shaderNames[s].c_str(), shaderNames[s].length());
+		entries[s].hash = bytecodes[s].hash;
+		entries[s].offset = offset;
+		entries[s].size = bytecodes[s].size;
+		offset += bytecodes[s].size;
+	}
+
+	std::ofstream archiveFile(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!archiveFile.is_open())  return false;
+
+	archiveFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	archiveFile.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ShaderArchiveEntry));
+	const char padding[SHADER_ARCHIVE_ALIGNMENT] = {};
+	for (int s = 0; s < numShaders; ++s)
+	{
+		std::streamoff position = archiveFile.tellp();
+		archiveFile.write(padding, static_cast<std::streamsize>(entries[s].offset - position));
+		archiveFile.write(buffers[s].data(), buffers[s].size());
+	}
+	return !archiveFile.fail();
+}
+
+
+// Read the .cso file for a shader into a buffer and hash it
+bool ReadShaderFile(const std::string& shaderName, std::vector<char>& buffer, ShaderBytecode& bytecode)
+{
+	std::ifstream shaderFile(shaderName + ".cso", std::ios::in | std::ios::binary | std::ios::ate);
+	if (!shaderFile.is_open())  return false;
+
+	std::streamoff fileSize = shaderFile.tellg();
+	if (fileSize <= 0)  return false;
+	shaderFile.seekg(0, std::ios::beg);
+	buffer.resize(static_cast<size_t>(fileSize));
+	shaderFile.read(buffer.data(), fileSize);
+	if (shaderFile.fail())  return false;
+
+	bytecode.data = buffer.data();
+	bytecode.size = buffer.size();
+	bytecode.hash = HashBytes(buffer.data(), buffer.size());
+	return true;
+}
@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------------------
+// Packed archive of compiled shaders
+//--------------------------------------------------------------------------------------
+// LoadShaders used to open each compiled shader (.cso) in turn, copying it into a fresh buffer before creating the
+// shader object. The bytecode for every shader is now packed into one archive file, which is memory mapped so the
+// shader objects are created straight from the mapped bytes. The archive is built from the .cso files the first time
+// the app runs, and built again whenever one of them is newer than the archive (e.g. after a shader is rebuilt).
+//
+// Archive layout:
+// - ShaderArchiveHeader
+// - a ShaderArchiveEntry for each shader: its name, where its bytecode is and a hash of the bytecode
+// - the bytecode of each shader, each starting on a SHADER_ARCHIVE_ALIGNMENT boundary
+// The hashes let LoadShaders skip shaders whose bytecode hasn't changed when it is called again (see Shader.cpp).
+// Portable C++ - memory mapping uses the Windows file mapping functions on Windows and mmap elsewhere
+
+#ifndef _SHADER_ARCHIVE_H_INCLUDED_
+#define _SHADER_ARCHIVE_H_INCLUDED_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Archive format
+//--------------------------------------------------------------------------------------
+
+const uint32_t SHADER_ARCHIVE_MAGIC     = 0x4B415053; // "SPAK"
+const uint32_t SHADER_ARCHIVE_VERSION   = 1;
+const int      MAX_SHADER_NAME          = 64; // Including the terminating 0
+const size_t   SHADER_ARCHIVE_ALIGNMENT = 16;
+
+struct ShaderArchiveHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numShaders;
+	uint32_t padding;
+};
+
+struct ShaderArchiveEntry
+{
+	char     name[MAX_SHADER_NAME]; // Shader name without extension
+	uint64_t hash;                  // HashBytes of the bytecode
+	uint64_t offset;                // Start of the bytecode from the start of the file
+	uint64_t size;                  // Size of the bytecode in bytes
+};
+
+
+// Compiled code of one shader, held by an archive (or some other buffer that must outlive it)
+struct ShaderBytecode
+{
+	const void* data = nullptr;
+	size_t      size = 0;
+	uint64_t    hash = 0;
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Memory mapped files
+//--------------------------------------------------------------------------------------
+
+// A file mapped read-only into memory. The contents are read from disk as they are touched
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile()  { Close(); }
+
+	// Prevent copying, the object owns the mapping
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Map the given file, returns false if it can't be opened or is empty
+	bool Open(const std::string& fileName);
+
+	// Unmap the file
+	void Close();
+
+	const uint8_t* Data() const  { return mData; }
+	size_t         Size() const  { return mSize; }
+
+private:
+	const uint8_t* mData = nullptr;
+	size_t         mSize = 0;
+#ifdef _WIN32
+	void* mFile    = nullptr; // Windows HANDLEs, held as void* so this header doesn't need windows.h
+	void* mMapping = nullptr;
+#endif
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Archive
+//--------------------------------------------------------------------------------------
+
+class ShaderArchive
+{
+public:
+	// Map an archive file and read its index, returns false if it is missing or not a valid archive
+	bool Open(const std::string& fileName);
+
+	// Unmap the archive - bytecode found earlier can't be used after this
+	void Close();
+
+	bool IsOpen() const  { return mFile.Data() != nullptr; }
+
+	// Find the bytecode of a shader by name (without extension), returns false if the archive doesn't hold it
+	bool Find(const std::string& shaderName, ShaderBytecode& bytecode) const;
+
+	int    NumShaders() const  { return static_cast<int>(mIndex.size()); }
+	size_t SizeBytes() const   { return mFile.Size(); }
+
+private:
+	MappedFile mFile;
+	std::unordered_map<std::string, ShaderBytecode> mIndex;
+};
+
+
+// Whether the archive file exists and no .cso file for the given shaders (names without extension) is newer than it.
+// A missing .cso file doesn't count, so the app can ship with only the archive
+bool IsShaderArchiveCurrent(const std::string& fileName, const std::vector<std::string>& shaderNames);
+
+// Read the .cso files for the given shaders (names without extension) on the thread pool and pack them into an archive
+// file, replacing any existing one. Returns false if a file couldn't be read or the archive couldn't be written
+bool BuildShaderArchive(const std::string& fileName, const std::vector<std::string>& shaderNames);
+
+
+// Read the .cso file for a shader into a buffer and hash it, for shaders the archive doesn't hold. The bytecode points
+// into the buffer. Returns false if the file can't be read
+bool ReadShaderFile(const std::string& shaderName, std::vector<char>& buffer, ShaderBytecode& bytecode);
+
+
+#endif //_SHADER_ARCHIVE_H_INCLUDED_
@@ -0,0 +1,162 @@
+//--------------------------------------------------------------------------------------
+// Reloading shaders when their source changes
+//--------------------------------------------------------------------------------------
+
+#include "ShaderHotReload.h"
+
+#include <algorithm>
+#include <fstream>
+
+
+//--------------------------------------------------------------------------------------
+// Source files
+//--------------------------------------------------------------------------------------
+
+// Files included by a shader source file with #include "...", following includes of includes
+std::vector<std::string> ShaderSourceIncludes(const std::string& fileName)
+{
+	std::vector<std::string> includes;
+	std::vector<std::string> toScan = { fileName };
+	while (!toScan.empty())
+	{
+		std::ifstream sourceFile(toScan.back());
+		toScan.pop_back();
+
+		std::string line;
+		while (std::getline(sourceFile, line))
+		{
+			size_t start = line.find_first_not_of(" \t");
+			if (start == std::string::npos || line.compare(start, 8, "#include") != 0)  continue;
+
+			size_t open = line.find('"', start + 8);
+			size_t close = (open != std::string::npos) ? line.find('"', open + 1) : std::string::npos;
+			if (close == std::string::npos)  continue;
+
+			std::string include = line.substr(open + 1, close - open - 1);
+			if (include == fileName || std::find(includes.begin(), includes.end(), include) != includes.end())  continue;
+
+			std::error_code error;
+			if (!std::filesystem::exists(include, error))  continue;
+			includes.push_back(include);
+			toScan.push_back(include);
+		}
+	}
+	return includes;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Hot reload
+//--------------------------------------------------------------------------------------
+
+// Watch the source of a shader (name without extension) - its .hlsl file and the files it includes
+void ShaderHotReload::Watch(const std::string& shaderName)
+{
+	std::string sourceName = shaderName + ".hlsl";
+	std::error_code error;
+	if (!std::filesystem::exists(sourceName, error))  return;
+
+	std::vector<std::string> files = ShaderSourceIncludes(sourceName);
+	files.push_back(sourceName);
+	for (auto& file : files)
+	{
+		auto watched = mFiles.find(file);
+		if (watched == mFiles.end())
+		{
+			watched = mFiles.emplace(file, WatchedFile()).first;
+			watched->second.writeTime = std::filesystem::last_write_time(file, error);
+		}
+		auto& shaders = watched->second.shaders;
+		if (std::find(shaders.begin(), shaders.end(), shaderName) == shaders.end())  shaders.push_back(shaderName);
+	}
+}
+
+
+// Check the watched files if POLL_INTERVAL has passed since the last check
+ShaderSourceChanges ShaderHotReload::Update(const ReloadShaderFunction& reload)
+{
+	if (Clock::now() - mLastCheck < std::chrono::duration<float>(POLL_INTERVAL))  return ShaderSourceChanges();
+	return CheckNow(reload);
+}
+
+
+// Check the watched files for changes, and reload each shader using a changed file once
+ShaderSourceChanges ShaderHotReload::CheckNow(const ReloadShaderFunction& reload)
+{
+	mLastCheck = Clock::now();
+
+	// A file being written may briefly fail to give a time, it will be picked up on a later check. The save time is
+	// found from the age of the file, as the file clock can't be converted to the steady clock directly
+	ShaderSourceChanges changes;
+	std::vector<std::string> shadersToReload;
+	Clock::time_point saveTime = mLastCheck;
+	for (auto& file : mFiles)
+	{
+		std::error_code error;
+		auto writeTime = std::filesystem::last_write_time(file.first, error);
+		if (error || writeTime == file.second.writeTime)  continue;
+
+		file.second.writeTime = writeTime;
+		changes.files.push_back(file.first);
+		if (file.first.size() >= 6 && file.first.compare(file.first.size() - 6, 6, ".hlsli") == 0)  changes.includesChanged = true;
+
+		auto age = std::filesystem::file_time_type::clock::now() - writeTime;
+		if (age.count() > 0)  saveTime = std::min(saveTime, mLastCheck - std::chrono::duration_cast<Clock::duration>(age));
+
+		for (auto& shader : file.second.shaders)
+		{
+			if (std::find(shadersToReload.begin(), shadersToReload.end(), shader) == shadersToReload.end())
+			{
+				shadersToReload.push_back(shader);
+			}
+		}
+	}
+	if (changes.files.empty())  return changes;
+
+
+	// Compile the shaders, keeping the first error to show. A shader that fails keeps its old version and is tried
+	// again when one of its files is next saved
+	mStats.lastDetectMs = std::chrono::duration<float, std::milli>(mLastCheck - saveTime).count();
+	mStats.lastShaders.clear();
+	mStats.lastError.clear();
+	auto compileStart = Clock::now();
+	for (auto& shader : shadersToReload)
+	{
+		std::string error;
+		if (reload(shader, error))
+		{
+			changes.shaders.push_back(shader);
+			mStats.lastShaders.push_back(shader);
+			mStats.numReloads++;
+		}
+		else
+		{
+			if (mStats.lastError.empty())  mStats.lastError = shader + ": " + error;
+			mStats.numFailures++;
+		}
+
+		// The shader may have gained includes
+		Watch(shader);
+	}
+	mStats.lastCompileMs = std::chrono::duration<float, std::milli>(Clock::now() - compileStart).count();
+
+	// The latency is measured to the next frame presented, which is the first to use the new shaders (including
+	// generated shaders, rebuilt as the frame is drawn)
+	if (!changes.shaders.empty() || changes.includesChanged)
+	{
+		mSaveTime = saveTime;
+		mAwaitingFrame = true;
+	}
+	return changes;
+}
+
+
+// Call after each frame is presented, to finish measuring the latency of a reload
+void ShaderHotReload::FramePresented()
+{
+	if (!mAwaitingFrame)  return;
+
+	mStats.lastLatencyMs = std::chrono::duration<float, std::milli>(Clock::now() - mSaveTime).count();
+	mAwaitingFrame = false;
+}
@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// Reloading shaders when their source changes
+//--------------------------------------------------------------------------------------
+// Changing a shader used to mean rebuilding and restarting the app, which loads every mesh and texture again. The
+// shader sources (the .hlsl files and the .hlsli files they include) are now watched while the app runs. When one is
+// saved only the shaders using it are compiled again and swapped in - render targets, meshes and everything else are
+// left alone. If a shader fails to compile the old one is kept, and the error is shown until the file is fixed.
+//
+// The files are polled for their modification times a few times a second rather than using operating system change
+// notifications, which keeps this portable and needs no extra thread. The time from a file being saved to the first
+// frame presented with the new shader is measured (HotReloadStats).
+//
+// Compiling is done by a function passed in (ReloadShader in Shader.cpp on the GPU), so the watching and the tracking
+// of includes can be run without a GPU by passing a stub compiler.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _SHADER_HOT_RELOAD_H_INCLUDED_
+#define _SHADER_HOT_RELOAD_H_INCLUDED_
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Source files
+//--------------------------------------------------------------------------------------
+
+// Files included by a shader source file with #include "...", following includes of includes. Only files found relative
+// to the current directory are returned (as D3D_COMPILE_STANDARD_FILE_INCLUDE finds them), each once
+std::vector<std::string> ShaderSourceIncludes(const std::string& fileName);
+
+
+
+//--------------------------------------------------------------------------------------
+// Hot reload
+//--------------------------------------------------------------------------------------
+
+// Compile the shader with the given name (without extension) from its source and swap it in. Returns false if it
+// fails to compile, with the compiler's message in error - the existing shader must be kept
+using ReloadShaderFunction = std::function<bool(const std::string& shaderName, std::string& error)>;
+
+// What changed in one check of the watched files
+struct ShaderSourceChanges
+{
+	std::vector<std::string> files;   // Watched files that have been saved since the last check
+	std::vector<std::string> shaders; // Shaders compiled and swapped in
+	bool includesChanged = false;     // An include file (.hlsli) changed - shaders generated from the includes at run
+	                                  // time (fused passes, see PostProcessFusion.h) need generating again
+};
+
+struct HotReloadStats
+{
+	int   numReloads    = 0; // Shaders swapped in since the app started
+	int   numFailures   = 0; // Shader compiles that failed
+	float lastDetectMs  = 0; // From the last change being saved to it being seen
+	float lastCompileMs = 0; // Compiling the shaders for the last change
+	float lastLatencyMs = 0; // From the last change being saved to the first frame presented with the new shaders
+	std::vector<std::string> lastShaders; // Shaders reloaded for the last change
+	std::string lastError;                // Compiler message from the last change, empty if all the shaders compiled
+};
+
+
+class ShaderHotReload
+{
+public:
+	// Seconds between checks of the watched files
+	static constexpr float POLL_INTERVAL = 0.25f;
+
+	// Watch the source of a shader (name without extension) - its .hlsl file and the files it includes. Does nothing
+	// for a shader without a source file. Can be called again, e.g. to pick up an include added to the shader
+	void Watch(const std::string& shaderName);
+
+	// Check the watched files if POLL_INTERVAL has passed since the last check (see CheckNow)
+	ShaderSourceChanges Update(const ReloadShaderFunction& reload);
+
+	// Check the watched files for changes, and reload each shader using a changed file once. Returns what changed
+	ShaderSourceChanges CheckNow(const ReloadShaderFunction& reload);
+
+	// Call after each frame is presented, to finish measuring the latency of a reload
+	void FramePresented();
+
+	const HotReloadStats& Stats() const  { return mStats; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct WatchedFile
+	{
+		std::filesystem::file_time_type writeTime;
+		std::vector<std::string>        shaders; // Shaders using the file
+	};
+	std::map<std::string, WatchedFile> mFiles;
+
+	Clock::time_point mLastCheck;
+	Clock::time_point mSaveTime;             // When the change being reloaded was saved
+	bool              mAwaitingFrame = false; // A reload has happened and the frame showing it hasn't been presented
+	HotReloadStats    mStats;
+};
+
+
+#endif //_SHADER_HOT_RELOAD_H_INCLUDED_
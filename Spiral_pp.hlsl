@@ -26,7 +26,7 @@ float4 main(PostProcessingInput input) : SV_Target
     float3 finalColour = float3(1.0, 0.0, 0.0);
     float alpha = 1.0f;
 	
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
 	// Get vector from post-processing area centre to pixel UV
         const float2 centreUV = gArea2DTopLeft + gArea2DSize * 0.5f;
@@ -21,6 +21,7 @@
 // A sampler state object represents a way to filter textures, such as bilinear or trilinear. We have one object for each method we want to use
 ID3D11SamplerState* gPointSampler         = nullptr;
 ID3D11SamplerState* gTrilinearSampler     = nullptr;
+ID3D11SamplerState* gBilinearClampSampler = nullptr;
 ID3D11SamplerState* gAnisotropic4xSampler = nullptr;
 
 // Blend states allow us to switch between blending modes (none, additive, multiplicative etc.)
@@ -33,10 +34,12 @@ ID3D11BlendState* gAlphaBlendingState    = nullptr;
 ID3D11RasterizerState* gCullBackState  = nullptr;
 ID3D11RasterizerState* gCullFrontState = nullptr;
 ID3D11RasterizerState* gCullNoneState  = nullptr;
+ID3D11RasterizerState* gCullNoneScissorState = nullptr;
 
 // Depth-stencil states allow us change how the depth buffer is used
 ID3D11DepthStencilState* gUseDepthBufferState = nullptr;
 ID3D11DepthStencilState* gDepthReadOnlyState  = nullptr;
+ID3D11DepthStencilState* gDepthPrePassState   = nullptr;
 ID3D11DepthStencilState* gNoDepthBufferState  = nullptr;
 
 
@@ -90,6 +93,25 @@ bool CreateStates()
 	}
 
 
+	////-------- Bilinear Sampling with clamping --------////
+	// Used by the blur post-processes, which read between pixels and must not wrap around at the screen edges
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT; // Bilinear filtering
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;         // Clamp addressing mode for texture coordinates outside 0->1
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;         // --"--
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;         // --"--
+	samplerDesc.MaxAnisotropy = 1;                              // Number of samples used if using anisotropic filtering, more is better but max value depends on GPU
+
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX; // Controls how much mip-mapping can be used. These settings are full mip-mapping, the usual values
+	samplerDesc.MinLOD = 0;                 // --"--
+
+	// Then create a DirectX object for your description that can be used by a shader
+	if (FAILED(gD3DDevice->CreateSamplerState(&samplerDesc, &gBilinearClampSampler)))
+	{
+		gLastError = "Error creating bilinear clamp sampler";
+		return false;
+	}
+
+
 	////-------- Anisotropic filtering --------////
 	samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC; // Trilinear filtering
 	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;    // Wrap addressing mode for texture coordinates outside 0->1
@@ -156,6 +178,21 @@ bool CreateStates()
         gLastError = "Error creating cull-none state";
         return false;
     }
+
+
+    ////-------- No culling, scissor test --------////
+    // Used by post-processes that only change part of the screen - pixels outside the rectangle set with
+    // RSSetScissorRects are left alone
+    rasterizerDesc.FillMode              = D3D11_FILL_SOLID;
+    rasterizerDesc.CullMode              = D3D11_CULL_NONE;
+    rasterizerDesc.DepthClipEnable       = TRUE;
+    rasterizerDesc.ScissorEnable         = TRUE;
+
+    if (FAILED(gD3DDevice->CreateRasterizerState(&rasterizerDesc, &gCullNoneScissorState)))
+    {
+        gLastError = "Error creating cull-none scissor state";
+        return false;
+    }
 	
 	
     //--------------------------------------------------------------------------------------
@@ -264,6 +301,24 @@ bool CreateStates()
     }
 
 
+    ////-------- Depth buffer filled by a pre-pass --------////
+    // Read only, passing pixels at the same depth - used to draw the opaque models over the depths a depth pre-pass has
+    // already written, so the pixel shader only runs for the nearest surface of each pixel. The pre-pass must compute the
+    // same positions as the shaders drawn over it (BasicTransform_vs and PixelLighting_vs do identical maths), otherwise
+    // EQUAL could lose pixels that LESS_EQUAL keeps
+    depthStencilDesc.DepthEnable      = TRUE;
+    depthStencilDesc.DepthWriteMask   = D3D11_DEPTH_WRITE_MASK_ZERO;
+    depthStencilDesc.DepthFunc        = D3D11_COMPARISON_LESS_EQUAL;
+    depthStencilDesc.StencilEnable    = FALSE;
+
+    // Create a DirectX object for the description above that can be used by a shader
+    if (FAILED(gD3DDevice->CreateDepthStencilState(&depthStencilDesc, &gDepthPrePassState)))
+    {
+        gLastError = "Error creating depth-pre-pass state";
+        return false;
+    }
+
+
 	////-------- Disable depth buffer --------////
     depthStencilDesc.DepthEnable      = FALSE;
     depthStencilDesc.DepthWriteMask   = D3D11_DEPTH_WRITE_MASK_ALL;
@@ -286,14 +341,17 @@ void ReleaseStates()
 {
     if (gUseDepthBufferState)    gUseDepthBufferState->Release();
     if (gDepthReadOnlyState)     gDepthReadOnlyState->Release();
+    if (gDepthPrePassState)      gDepthPrePassState->Release();
     if (gNoDepthBufferState)     gNoDepthBufferState->Release();
     if (gCullBackState)          gCullBackState->Release();
     if (gCullFrontState)         gCullFrontState->Release();
     if (gCullNoneState)          gCullNoneState->Release();
+    if (gCullNoneScissorState)   gCullNoneScissorState->Release();
     if (gNoBlendingState)        gNoBlendingState->Release();
     if (gAlphaBlendingState)     gAlphaBlendingState->Release();
     if (gAdditiveBlendingState)  gAdditiveBlendingState->Release();
     if (gAnisotropic4xSampler)   gAnisotropic4xSampler->Release();
+    if (gBilinearClampSampler)   gBilinearClampSampler->Release();
     if (gTrilinearSampler)       gTrilinearSampler->Release();
     if (gPointSampler)           gPointSampler->Release();
 }
@@ -0,0 +1,107 @@
+//--------------------------------------------------------------------------------------
+// Filtering out redundant pipeline state changes
+//--------------------------------------------------------------------------------------
+
+#include "StateCache.h"
+#include "ConstantBlocks.h" // HashBytes
+
+
+const char* StateKindName(StateKind kind)
+{
+	switch (kind)
+	{
+		case StateKind::VertexShader:      return "Vertex shader";
+		case StateKind::GeometryShader:    return "Geometry shader";
+		case StateKind::PixelShader:       return "Pixel shader";
+		case StateKind::InputLayout:       return "Input layout";
+		case StateKind::PrimitiveTopology: return "Topology";
+		case StateKind::VSConstantBuffer:  return "VS constant buffers";
+		case StateKind::GSConstantBuffer:  return "GS constant buffers";
+		case StateKind::PSConstantBuffer:  return "PS constant buffers";
+		case StateKind::VSResource:        return "VS textures";
+		case StateKind::PSResource:        return "PS textures";
+		case StateKind::PSSampler:         return "PS samplers";
+		case StateKind::RasterizerState:   return "Rasterizer state";
+		case StateKind::Viewport:          return "Viewport";
+		case StateKind::ScissorRect:       return "Scissor";
+		case StateKind::BlendState:        return "Blend state";
+		case StateKind::DepthStencilState: return "Depth-stencil state";
+		case StateKind::RenderTargets:     return "Render targets";
+		default:                           return "Unknown";
+	}
+}
+
+
+int StateFilterStats::TotalIssued() const
+{
+	int total = 0;
+	for (int count : issued)  total += count;
+	return total;
+}
+
+int StateFilterStats::TotalSkipped() const
+{
+	int total = 0;
+	for (int count : skipped)  total += count;
+	return total;
+}
+
+
+//--------------------------------------------------------------------------------------
+// State tracking
+//--------------------------------------------------------------------------------------
+
+bool StateCache::Matches(StateKind kind, unsigned int slot, const void* object, uint64_t settings) const
+{
+	if (slot >= MAX_STATE_SLOTS)  return false;
+	const Binding& binding = mBindings[static_cast<int>(kind)][slot];
+	return binding.known && binding.object == object && binding.settings == settings;
+}
+
+
+void StateCache::Record(StateKind kind, unsigned int slot, const void* object, uint64_t settings)
+{
+	if (slot >= MAX_STATE_SLOTS)  return;
+	mBindings[static_cast<int>(kind)][slot] = { true, object, settings };
+}
+
+
+bool StateCache::Set(StateKind kind, unsigned int slot, const void* object, uint64_t settings)
+{
+	bool changed = !Matches(kind, slot, object, settings);
+	if (changed)  Record(kind, slot, object, settings);
+	Count(kind, changed);
+	return changed;
+}
+
+
+void StateCache::Count(StateKind kind, bool issued)
+{
+	if (issued)  mFrameStats.issued[static_cast<int>(kind)]++;
+	else         mFrameStats.skipped[static_cast<int>(kind)]++;
+}
+
+
+void StateCache::Invalidate()
+{
+	for (int kind = 0; kind < NUM_STATE_KINDS; ++kind)  Invalidate(static_cast<StateKind>(kind));
+}
+
+void StateCache::Invalidate(StateKind kind)
+{
+	for (auto& binding : mBindings[static_cast<int>(kind)])  binding.known = false;
+}
+
+
+void StateCache::NewFrame()
+{
+	Invalidate();
+	mLastFrameStats = mFrameStats;
+	mFrameStats = StateFilterStats();
+}
+
+
+uint64_t StateCache::Hash(const void* data, size_t size)
+{
+	return HashBytes(data, size);
+}
@@ -0,0 +1,314 @@
+//--------------------------------------------------------------------------------------
+// Filtering out redundant pipeline state changes
+//--------------------------------------------------------------------------------------
+// The rendering code sets every state it needs before each draw - RenderSceneFromCamera, FullScreenPostProcess,
+// SaveBaseSceneTexture, MergeTextures etc. each select the 2D quad vertex shader, no blending, no culling, no input
+// layout and their samplers again, even when the previous pass left exactly the same things bound. Each of those calls
+// still costs CPU time in the runtime and driver.
+//
+// StateFilter sits in front of the device context and takes the same state-setting calls. It remembers what is bound
+// (StateCache) and only passes on calls that change something - for the slot ranges (textures, samplers, constant
+// buffers) only the part of the range that changed is passed on. Calls issued and skipped are counted for each frame.
+//
+// Things that change state without going through the filter must tell it with Invalidate:
+// - Model::Render binds its own geometry, input layout and per-model constant buffer
+// - Binding render targets makes DirectX unbind any shader resource views of the same textures, so changing the render
+//   targets forgets the views bound (done by the filter itself)
+// NewFrame forgets everything, so state changed elsewhere between frames (e.g. ImGui) can never be missed.
+//
+// The filter is a template on an "API" struct giving the context and object types, so it can be put in front of the
+// DirectX context or anything with the same methods (e.g. a context that records calls, for testing on any platform).
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _STATE_CACHE_H_INCLUDED_
+#define _STATE_CACHE_H_INCLUDED_
+
+#include <cstddef>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// State tracking
+//--------------------------------------------------------------------------------------
+
+// The kinds of state tracked
+enum class StateKind
+{
+	VertexShader,
+	GeometryShader,
+	PixelShader,
+	InputLayout,
+	PrimitiveTopology,
+	VSConstantBuffer,
+	GSConstantBuffer,
+	PSConstantBuffer,
+	VSResource,
+	PSResource,
+	PSSampler,
+	RasterizerState,
+	Viewport,
+	ScissorRect,
+	BlendState,
+	DepthStencilState,
+	RenderTargets,
+
+	Count
+};
+const int NUM_STATE_KINDS = static_cast<int>(StateKind::Count);
+
+// Slots tracked for each kind, calls for slots beyond these are always passed on
+const int MAX_STATE_SLOTS = 16;
+
+// Name of a kind of state, for display
+const char* StateKindName(StateKind kind);
+
+
+// Calls passed on and skipped for each kind of state
+struct StateFilterStats
+{
+	int issued[NUM_STATE_KINDS]  = {};
+	int skipped[NUM_STATE_KINDS] = {};
+
+	int TotalIssued() const;
+	int TotalSkipped() const;
+};
+
+
+// What is bound in each slot of each kind of state. A binding is an object pointer plus a value for any other settings
+// of the call (e.g. blend factor, stencil reference, a hash of viewports)
+class StateCache
+{
+public:
+	StateCache()  { Invalidate(); }
+
+	// Whether a slot is known to hold the given binding
+	bool Matches(StateKind kind, unsigned int slot, const void* object, uint64_t settings = 0) const;
+
+	// Note what a slot now holds. Slots beyond MAX_STATE_SLOTS are ignored
+	void Record(StateKind kind, unsigned int slot, const void* object, uint64_t settings = 0);
+
+	// Check a binding against a slot, recording it and counting the call. Returns true if the call must be passed on
+	bool Set(StateKind kind, unsigned int slot, const void* object, uint64_t settings = 0);
+
+	// Count a call made for a kind of state
+	void Count(StateKind kind, bool issued);
+
+	// Forget what is bound, for everything or one kind of state - the next call for it will always be passed on
+	void Invalidate();
+	void Invalidate(StateKind kind);
+
+	// Forget everything and start counting a new frame. The previous frame's counts stay available
+	void NewFrame();
+
+	const StateFilterStats& FrameStats() const      { return mFrameStats; }     // Counts so far this frame
+	const StateFilterStats& LastFrameStats() const  { return mLastFrameStats; } // Counts for the whole of the last frame
+
+	// Hash some bytes into a settings value (e.g. an array of viewports)
+	static uint64_t Hash(const void* data, size_t size);
+
+private:
+	struct Binding
+	{
+		bool        known;
+		const void* object;
+		uint64_t    settings;
+	};
+	Binding mBindings[NUM_STATE_KINDS][MAX_STATE_SLOTS];
+
+	StateFilterStats mFrameStats;
+	StateFilterStats mLastFrameStats;
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Filter
+//--------------------------------------------------------------------------------------
+
+// Takes the state-setting calls of a device context and passes on those that change something. Api is a struct giving
+// the types used (see D3D11StateApi in Scene.cpp):
+//   Context, VertexShader, GeometryShader, PixelShader, InputLayout, PrimitiveTopology, Buffer, ShaderResourceView,
+//   SamplerState, RasterizerState, Viewport, Rect, BlendState, DepthStencilState, RenderTargetView, DepthStencilView
+// Class instances (the middle parameters of the shader calls) aren't used in this project so only nullptr is accepted
+template <typename Api>
+class StateFilter
+{
+public:
+	using Context = typename Api::Context;
+
+	// Choose the context to pass calls on to. Forgets all state
+	void SetContext(Context* context)  { mContext = context; mCache.Invalidate(); }
+	Context* GetContext()              { return mContext; }
+
+	StateCache& Cache()  { return mCache; }
+
+	void NewFrame()                      { mCache.NewFrame(); }
+	void Invalidate()                    { mCache.Invalidate(); }
+	void Invalidate(StateKind kind)      { mCache.Invalidate(kind); }
+
+
+	//-------------------------------------
+	// Shaders
+	//-------------------------------------
+
+	void VSSetShader(typename Api::VertexShader* shader, std::nullptr_t, unsigned int)
+	{
+		if (mCache.Set(StateKind::VertexShader, 0, shader))  mContext->VSSetShader(shader, nullptr, 0);
+	}
+	void GSSetShader(typename Api::GeometryShader* shader, std::nullptr_t, unsigned int)
+	{
+		if (mCache.Set(StateKind::GeometryShader, 0, shader))  mContext->GSSetShader(shader, nullptr, 0);
+	}
+	void PSSetShader(typename Api::PixelShader* shader, std::nullptr_t, unsigned int)
+	{
+		if (mCache.Set(StateKind::PixelShader, 0, shader))  mContext->PSSetShader(shader, nullptr, 0);
+	}
+
+
+	//-------------------------------------
+	// Input assembler
+	//-------------------------------------
+
+	void IASetInputLayout(typename Api::InputLayout* layout)
+	{
+		if (mCache.Set(StateKind::InputLayout, 0, layout))  mContext->IASetInputLayout(layout);
+	}
+	void IASetPrimitiveTopology(typename Api::PrimitiveTopology topology)
+	{
+		if (mCache.Set(StateKind::PrimitiveTopology, 0, nullptr, static_cast<uint64_t>(topology)))  mContext->IASetPrimitiveTopology(topology);
+	}
+
+
+	//-------------------------------------
+	// Slot ranges
+	//-------------------------------------
+
+	void VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, typename Api::Buffer* const* buffers)
+	{
+		int first, count;
+		if (ChangedRange(StateKind::VSConstantBuffer, startSlot, numBuffers, buffers, first, count))
+		{
+			mContext->VSSetConstantBuffers(startSlot + first, count, buffers + first);
+		}
+	}
+	void GSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, typename Api::Buffer* const* buffers)
+	{
+		int first, count;
+		if (ChangedRange(StateKind::GSConstantBuffer, startSlot, numBuffers, buffers, first, count))
+		{
+			mContext->GSSetConstantBuffers(startSlot + first, count, buffers + first);
+		}
+	}
+	void PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, typename Api::Buffer* const* buffers)
+	{
+		int first, count;
+		if (ChangedRange(StateKind::PSConstantBuffer, startSlot, numBuffers, buffers, first, count))
+		{
+			mContext->PSSetConstantBuffers(startSlot + first, count, buffers + first);
+		}
+	}
+	void VSSetShaderResources(unsigned int startSlot, unsigned int numViews, typename Api::ShaderResourceView* const* views)
+	{
+		int first, count;
+		if (ChangedRange(StateKind::VSResource, startSlot, numViews, views, first, count))
+		{
+			mContext->VSSetShaderResources(startSlot + first, count, views + first);
+		}
+	}
+	void PSSetShaderResources(unsigned int startSlot, unsigned int numViews, typename Api::ShaderResourceView* const* views)
+	{
+		int first, count;
+		if (ChangedRange(StateKind::PSResource, startSlot, numViews, views, first, count))
+		{
+			mContext->PSSetShaderResources(startSlot + first, count, views + first);
+		}
+	}
+	void PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, typename Api::SamplerState* const* samplers)
+	{
+		int first, count;
+		if (ChangedRange(StateKind::PSSampler, startSlot, numSamplers, samplers, first, count))
+		{
+			mContext->PSSetSamplers(startSlot + first, count, samplers + first);
+		}
+	}
+
+
+	//-------------------------------------
+	// Rasterizer
+	//-------------------------------------
+
+	void RSSetState(typename Api::RasterizerState* state)
+	{
+		if (mCache.Set(StateKind::RasterizerState, 0, state))  mContext->RSSetState(state);
+	}
+	void RSSetViewports(unsigned int numViewports, const typename Api::Viewport* viewports)
+	{
+		uint64_t settings = StateCache::Hash(viewports, numViewports * sizeof(*viewports)) + numViewports;
+		if (mCache.Set(StateKind::Viewport, 0, nullptr, settings))  mContext->RSSetViewports(numViewports, viewports);
+	}
+	void RSSetScissorRects(unsigned int numRects, const typename Api::Rect* rects)
+	{
+		uint64_t settings = StateCache::Hash(rects, numRects * sizeof(*rects)) + numRects;
+		if (mCache.Set(StateKind::ScissorRect, 0, nullptr, settings))  mContext->RSSetScissorRects(numRects, rects);
+	}
+
+
+	//-------------------------------------
+	// Output merger
+	//-------------------------------------
+
+	void OMSetBlendState(typename Api::BlendState* state, const float blendFactor[4], unsigned int sampleMask)
+	{
+		// A null blend factor means 1,1,1,1
+		const float defaultFactor[4] = { 1, 1, 1, 1 };
+		const float* factor = blendFactor ? blendFactor : defaultFactor;
+		uint64_t settings = StateCache::Hash(factor, 4 * sizeof(float)) ^ sampleMask;
+		if (mCache.Set(StateKind::BlendState, 0, state, settings))  mContext->OMSetBlendState(state, blendFactor, sampleMask);
+	}
+	void OMSetDepthStencilState(typename Api::DepthStencilState* state, unsigned int stencilRef)
+	{
+		if (mCache.Set(StateKind::DepthStencilState, 0, state, stencilRef))  mContext->OMSetDepthStencilState(state, stencilRef);
+	}
+	void OMSetRenderTargets(unsigned int numViews, typename Api::RenderTargetView* const* renderTargets,
+	                        typename Api::DepthStencilView* depthStencil)
+	{
+		uint64_t settings = StateCache::Hash(renderTargets, numViews * sizeof(*renderTargets)) + numViews;
+		if (mCache.Set(StateKind::RenderTargets, 0, depthStencil, settings))
+		{
+			mContext->OMSetRenderTargets(numViews, renderTargets, depthStencil);
+
+			// DirectX unbinds views of textures that are now render targets, rather than work out which, forget them all
+			mCache.Invalidate(StateKind::VSResource);
+			mCache.Invalidate(StateKind::PSResource);
+		}
+	}
+
+
+private:
+	// Find the part of a range of slots that is changing, recording the new bindings and counting one call. Returns false
+	// if nothing changes, otherwise first and count give the range to pass on (relative to the start slot)
+	template <typename Object>
+	bool ChangedRange(StateKind kind, unsigned int startSlot, unsigned int numSlots, Object* const* objects, int& first, int& count)
+	{
+		first = -1;
+		int last = -1;
+		for (unsigned int i = 0; i < numSlots; ++i)
+		{
+			if (!mCache.Matches(kind, startSlot + i, objects[i]))
+			{
+				if (first < 0)  first = i;
+				last = i;
+				mCache.Record(kind, startSlot + i, objects[i]);
+			}
+		}
+		mCache.Count(kind, first >= 0);
+		count = last - first + 1;
+		return first >= 0;
+	}
+
+	Context*   mContext = nullptr;
+	StateCache mCache;
+};
+
+
+#endif //_STATE_CACHE_H_INCLUDED_
@@ -0,0 +1,717 @@
+//--------------------------------------------------------------------------------------
+// Benchmarks of the portable parts of the project
+//--------------------------------------------------------------------------------------
+// Each benchmark times a part of the project against the code it replaced, or at a couple of sizes, and prints the
+// results. They aren't run by ctest - the times depend on the machine, so there is nothing to pass or fail, and some
+// take a few seconds. Runs all of them, or those named on the command line, e.g.
+//   Benchmarks blur
+
+#include "CpuPostProcess.h"
+#include "CpuBlur.h"
+#include "CpuBloom.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+#include "MeshCache.h"
+#include "Camera.h"
+#include "MatrixSimd.h"
+#include "BlurKernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Stand-ins for the app
+//--------------------------------------------------------------------------------------
+// Camera::Control reads the keyboard (Input.cpp) and the speeds set in Scene.cpp. None of the benchmarks move the
+// camera with the keys
+
+extern const float ROTATION_SPEED = 1.5f;
+extern const float MOVEMENT_SPEED = 50.0f;
+
+bool KeyHeld(KeyCode)
+{
+	return false;
+}
+
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	float MsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+
+	//-------------------------------------
+	// CPU blur
+	//-------------------------------------
+
+	// Time a separable blur (a BlurH pass followed by a BlurV pass) on the CPU engine over a generated image of the given
+	// size, averaged over numFrames runs
+	void TimeCpuBlur(int width, int height, int strength, float sigma, BlurMode mode, bool linearSampling, int numFrames)
+	{
+		// A pattern with plenty of detail so the blur is doing real work
+		CpuImage source(width, height);
+		for (int y = 0; y < height; ++y)
+		{
+			CpuColour* row = source.Row(y);
+			for (int x = 0; x < width; ++x)
+			{
+				row[x] = { (x % 17) / 16.0f, (y % 13) / 12.0f, ((x ^ y) & 31) / 31.0f, 1.0f };
+			}
+		}
+		CpuImage blurredH(width, height);
+		CpuImage blurredHV(width, height);
+
+		const BlurKernel& kernel = GetBlurKernel(strength, sigma, linearSampling);
+		PostProcessingConstants constants = {};
+		PackBlurKernel(kernel, constants);
+		CpuBlurSettings blur;
+		blur.mode = mode;
+		blur.deviation = kernel.deviation;
+		CpuPostProcessTextures textures;
+
+		// One untimed run first so the worker threads are awake and the images are in cache as far as they can be
+		CpuFullScreenPostProcess(PostProcess::BlurH, constants, textures, source, blurredH, blur);
+
+		auto start = Clock::now();
+		for (int frame = 0; frame < numFrames; ++frame)
+		{
+			CpuFullScreenPostProcess(PostProcess::BlurH, constants, textures, source, blurredH, blur);
+			CpuFullScreenPostProcess(PostProcess::BlurV, constants, textures, blurredH, blurredHV, blur);
+		}
+		float msPerFrame = MsSince(start) / numFrames;
+
+		// Texture fetches per pixel over both passes (for the Gaussian, the same count the GPU shaders make)
+		int tapsPerPixel = 2 * (mode == BlurMode::Gaussian ? static_cast<int>(kernel.taps.size()) : CpuBlurReadsPerPixel(mode));
+		const char* modeName = (mode == BlurMode::Box) ? "box" : (mode == BlurMode::Recursive) ? "recursive" :
+		                       linearSampling ? "gaussian linear" : "gaussian point";
+		std::printf("  %dx%d %s: %d taps/pixel, %.2fms/frame\n", width, height, modeName, tapsPerPixel, msPerFrame);
+	}
+
+	// The bloom-strength blur at 1280x960 and 3840x2160 (4K), for the Gaussian with point and linear sampling and for
+	// the constant-time modes
+	void BlurBenchmark()
+	{
+		const int sizes[2][2] = { { 1280, 960 }, { 3840, 2160 } };
+		for (const auto& size : sizes)
+		{
+			TimeCpuBlur(size[0], size[1], 90, 40.0f, BlurMode::Gaussian,  false, 1);
+			TimeCpuBlur(size[0], size[1], 90, 40.0f, BlurMode::Gaussian,  true,  1);
+			TimeCpuBlur(size[0], size[1], 90, 40.0f, BlurMode::Box,       false, 1);
+			TimeCpuBlur(size[0], size[1], 90, 40.0f, BlurMode::Recursive, false, 1);
+		}
+	}
+
+
+	//-------------------------------------
+	// CPU bloom
+	//-------------------------------------
+
+	// Bytes per pixel of the scene textures (R8G8B8A8_UNORM) and the bloom chain textures (R16G16B16A16_FLOAT)
+	const double SCENE_PIXEL_BYTES = 4;
+	const double BLOOM_PIXEL_BYTES = 8;
+
+	// Estimate the GPU memory traffic of one frame of bloom, assuming each draw reads each of its textures once (the
+	// texture cache handles neighbouring taps) and counting blending as a read and a write of the target. Also counts the
+	// draws
+	double BloomGpuBytes(int width, int height, bool mipChain, int& numDraws)
+	{
+		double scene = static_cast<double>(width) * height * SCENE_PIXEL_BYTES;
+		double total = 0;
+		numDraws = 0;
+		auto draw = [&](double bytesRead, double bytesWritten)
+		{
+			total += bytesRead + bytesWritten;
+			++numDraws;
+		};
+
+		if (!mipChain)
+		{
+			// Every pass draws to its target and again to the back buffer (see FullScreenPostProcess). Bloom2 also reads
+			// the base scene saved by the first copy
+			const int passReads[] = { 1,   // Save base scene
+			                          1,   // Bloom1
+			                          1,   // BlurH
+			                          1,   // BlurV
+			                          2,   // Bloom2
+			                          1 }; // Copy to fix ping-pong order
+			for (int reads : passReads)
+			{
+				draw(reads * scene, scene);
+				draw(reads * scene, scene);
+			}
+			return total;
+		}
+
+		double levelBytes[NUM_BLOOM_LEVELS];
+		for (int level = 0; level < NUM_BLOOM_LEVELS; ++level)
+		{
+			int levelWidth, levelHeight;
+			BloomLevelSize(level, width, height, levelWidth, levelHeight);
+			levelBytes[level] = static_cast<double>(levelWidth) * levelHeight * BLOOM_PIXEL_BYTES;
+		}
+
+		draw(scene, levelBytes[0]);
+		for (int level = 1; level < NUM_BLOOM_LEVELS; ++level)
+		{
+			draw(levelBytes[level - 1], levelBytes[level]);
+		}
+		for (int level = NUM_BLOOM_LEVELS - 1; level > 0; --level)
+		{
+			draw(levelBytes[level] + levelBytes[level - 1], levelBytes[level - 1]); // Additive blending reads the target too
+		}
+		draw(scene + levelBytes[0], scene); // Composite, drawn to the scene texture and to the back buffer
+		draw(scene + levelBytes[0], scene);
+		return total;
+	}
+
+	// Time bloom on the CPU engine over a generated image of the given size, averaged over numFrames runs. Either the
+	// bloom chain or the five full size passes (Bloom1, BlurH, BlurV, Bloom2 and the copies around them) it replaced
+	void TimeCpuBloom(int width, int height, bool mipChain, int numFrames)
+	{
+		// A dim pattern with small bright spots for the threshold to pick out
+		CpuImage scene(width, height);
+		for (int y = 0; y < height; ++y)
+		{
+			CpuColour* row = scene.Row(y);
+			for (int x = 0; x < width; ++x)
+			{
+				bool bright = (x % 64 < 6) && (y % 48 < 6);
+				float level = bright ? 1.0f : ((x ^ y) & 31) / 62.0f;
+				row[x] = { level, level, level * 0.8f, 1.0f };
+			}
+		}
+		CpuImage result(width, height);
+
+		// Settings as a new bloom entry would have them, and as the old chain forced the blur (strength 90, Gaussian)
+		Constants settings;
+		settings.blurStrength = 90;
+		PostProcessingConstants constants = {};
+		UpdatePostProcessConstants(PostProcess::Bloom1, settings, 0, width, height, constants);
+		UpdatePostProcessConstants(PostProcess::BlurH,  settings, 0, width, height, constants);
+		constants.IsFullScreen = true;
+
+		CpuImage base, pingA, pingB;
+		CpuPostProcessTextures textures;
+		textures.bloomBase = &base;
+		auto runFrame = [&]()
+		{
+			if (mipChain)
+			{
+				CpuBloomPostProcess(constants, scene, result);
+				return;
+			}
+			CpuFullScreenPostProcess(PostProcess::Copy,   constants, textures, scene, base);
+			CpuFullScreenPostProcess(PostProcess::Bloom1, constants, textures, scene, pingA);
+			CpuFullScreenPostProcess(PostProcess::BlurH,  constants, textures, pingA, pingB);
+			CpuFullScreenPostProcess(PostProcess::BlurV,  constants, textures, pingB, pingA);
+			CpuFullScreenPostProcess(PostProcess::Bloom2, constants, textures, pingA, pingB);
+			CpuFullScreenPostProcess(PostProcess::Copy,   constants, textures, pingB, result);
+		};
+
+		// One untimed run first so the worker threads are awake and all the images are allocated
+		runFrame();
+
+		auto start = Clock::now();
+		for (int frame = 0; frame < numFrames; ++frame)
+		{
+			runFrame();
+		}
+		float msPerFrame = MsSince(start) / numFrames;
+
+		int numDraws;
+		double gpuMegabytes = BloomGpuBytes(width, height, mipChain, numDraws) / (1024.0 * 1024.0);
+		std::printf("  %dx%d %s: %d draws, %.1fMB GPU traffic, %.2fms/frame CPU\n", width, height,
+		            mipChain ? "bloom chain" : "full size passes", numDraws, gpuMegabytes, msPerFrame);
+	}
+
+	// Both bloom methods at 1280x960 and 3840x2160 (4K)
+	void BloomBenchmark()
+	{
+		const int sizes[2][2] = { { 1280, 960 }, { 3840, 2160 } };
+		for (const auto& size : sizes)
+		{
+			TimeCpuBloom(size[0], size[1], false, 1);
+			TimeCpuBloom(size[0], size[1], true,  1);
+		}
+	}
+
+
+	//-------------------------------------
+	// Texture decoding
+	//-------------------------------------
+
+	// Write an uncompressed 32-bit .dds file (DXGI_FORMAT_R8G8B8A8_UNORM, one mip level) filled with a pattern
+	void WriteDDSFile(const std::string& fileName, uint32_t width, uint32_t height)
+	{
+		uint32_t header[31] = {};
+		header[0]  = sizeof(header);
+		header[1]  = 0x1007;  // Caps, height, width, pixel format
+		header[2]  = height;
+		header[3]  = width;
+		header[6]  = 1;       // Mip count
+		header[18] = 32;      // Pixel format size
+		header[19] = 0x4;     // Four CC
+		header[20] = 0x30315844; // "DX10"
+		const uint32_t headerDX10[5] = { 28, 3, 0, 1, 0 }; // R8G8B8A8_UNORM, 2D, no flags, array size 1
+
+		std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+		for (size_t b = 0; b < pixels.size(); ++b)  pixels[b] = static_cast<uint8_t>(b * 7 + 3);
+
+		std::ofstream file(fileName, std::ios::binary);
+		file.write("DDS ", 4);
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(headerDX10), sizeof(headerDX10));
+		file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+	}
+
+	bool DecodeDDSFile(const std::string& fileName, DecodedTexture& texture, std::string& error)
+	{
+		std::vector<uint8_t> file;
+		if (!ReadFileBytes(fileName, file))
+		{
+			error = "couldn't read file";
+			return false;
+		}
+		return DecodeDDSTexture(file, texture, error);
+	}
+
+	// Time decoding a set of generated .dds files one at a time on this thread and then all at once on the thread pool
+	// (as AsyncTextureLoader does), taking the best of a number of repeats. The other formats the app loads are decoded
+	// with WIC, which is Windows only
+	void TextureDecodeBenchmark()
+	{
+		const int NUM_FILES = 32;
+		const int REPEATS = 3;
+		auto directory = std::filesystem::temp_directory_path() / "TextureDecodeBenchmark";
+		std::filesystem::create_directories(directory);
+		std::vector<std::string> fileNames;
+		for (int f = 0; f < NUM_FILES; ++f)
+		{
+			fileNames.push_back((directory / ("Texture" + std::to_string(f) + ".dds")).string());
+			WriteDDSFile(fileNames.back(), 1024, 1024);
+		}
+
+		std::vector<DecodedTexture> textures(NUM_FILES);
+		std::vector<int> decoded(NUM_FILES, 0);
+		auto decodeFiles = [&](int first, int last)
+		{
+			for (int f = first; f < last; ++f)
+			{
+				std::string error;
+				decoded[f] = DecodeDDSFile(fileNames[f], textures[f], error);
+				textures[f] = DecodedTexture(); // Keep memory use down, only the time matters
+			}
+		};
+
+		float serialMs = 0, parallelMs = 0;
+		for (int repeat = 0; repeat < REPEATS; ++repeat)
+		{
+			auto serialStart = Clock::now();
+			decodeFiles(0, NUM_FILES);
+			float ms = MsSince(serialStart);
+			if (repeat == 0 || ms < serialMs)  serialMs = ms;
+
+			auto parallelStart = Clock::now();
+			gThreadPool.ParallelFor(0, NUM_FILES, decodeFiles, 1);
+			ms = MsSince(parallelStart);
+			if (repeat == 0 || ms < parallelMs)  parallelMs = ms;
+		}
+
+		// Sizes come from one more decode of each file, outside the timing
+		size_t decodedBytes = 0;
+		int numFailed = 0;
+		for (auto& fileName : fileNames)
+		{
+			std::string error;
+			DecodedTexture texture;
+			if (DecodeDDSFile(fileName, texture, error))  decodedBytes += texture.data.size();
+			else                                         numFailed++;
+		}
+		std::filesystem::remove_all(directory);
+
+		float megabytes = decodedBytes / 1048576.0f;
+		std::printf("  %d files, %.1fMB: serial %.1fms (%.0fMB/s), %d threads %.1fms (%.0fMB/s)%s\n", NUM_FILES, megabytes,
+		            serialMs, megabytes / (serialMs / 1000.0f), static_cast<int>(gThreadPool.NumThreads()), parallelMs,
+		            megabytes / (parallelMs / 1000.0f), numFailed > 0 ? ", some failed" : "");
+	}
+
+
+	//-------------------------------------
+	// Mesh loading
+	//-------------------------------------
+
+	// Write a grid of the given size as text, one vertex per line (position, normal, uv) followed by one triangle per
+	// line, so parsing it costs about what parsing a text .x mesh of that size does
+	void WriteTextGrid(const std::string& fileName, int size)
+	{
+		std::ofstream file(fileName, std::ios::binary);
+		file << size * size << " " << (size - 1) * (size - 1) * 2 << "\n";
+		for (int z = 0; z < size; ++z)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				float height = ((x * 7 + z * 13) % 29) / 29.0f;
+				file << x << ".0 " << height << " " << z << ".0 0.0 1.0 0.0 " << x / (size - 1.0f) << " " << z / (size - 1.0f) << "\n";
+			}
+		}
+		for (int z = 0; z + 1 < size; ++z)
+		{
+			for (int x = 0; x + 1 < size; ++x)
+			{
+				int corner = z * size + x;
+				file << corner << " " << corner + size << " " << corner + 1 << "\n";
+				file << corner + 1 << " " << corner + size << " " << corner + size + 1 << "\n";
+			}
+		}
+	}
+
+	// Parse a file written by WriteTextGrid, standing in for the importer Mesh uses
+	bool ParseTextGrid(const std::string& fileName, MeshData& mesh, std::string& error)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		char* next = text.data();
+		unsigned long numVertices = std::strtoul(next, &next, 10);
+		unsigned long numTriangles = std::strtoul(next, &next, 10);
+		if (numVertices == 0 || numTriangles == 0)
+		{
+			error = "no geometry in " + fileName;
+			return false;
+		}
+
+		mesh = MeshData();
+		mesh.vertices.resize(numVertices);
+		for (auto& vertex : mesh.vertices)
+		{
+			for (float* value : { &vertex.position[0], &vertex.position[1], &vertex.position[2],
+			                      &vertex.normal[0], &vertex.normal[1], &vertex.normal[2], &vertex.uv[0], &vertex.uv[1] })
+			{
+				*value = std::strtof(next, &next);
+			}
+		}
+		mesh.indices.resize(numTriangles * 3);
+		for (auto& index : mesh.indices)  index = static_cast<uint32_t>(std::strtoul(next, &next, 10));
+		mesh.hasNormals = true;
+		mesh.hasUVs = true;
+		return true;
+	}
+
+	// Time loading meshes cold (no cache, so parsing the source and writing the cache) against warm (hashing the source
+	// and mapping the cache), taking the best of a number of repeats. Cold times don't include reading the source from
+	// disk, the operating system already holds it in memory after writing it
+	void MeshLoadBenchmark()
+	{
+		const int REPEATS = 3;
+		auto directory = std::filesystem::temp_directory_path() / "MeshLoadBenchmark";
+		std::filesystem::create_directories(directory);
+
+		for (int size : { 16, 128, 512 })
+		{
+			std::string fileName = (directory / ("Grid" + std::to_string(size) + ".txt")).string();
+			std::string cacheFileName = MeshCacheFileName(fileName);
+			WriteTextGrid(fileName, size);
+
+			float coldMs = 0, warmMs = 0;
+			uint32_t numVertices = 0, numIndices = 0;
+			bool loaded = true;
+			for (int repeat = 0; repeat < REPEATS && loaded; ++repeat)
+			{
+				std::filesystem::remove(cacheFileName);
+
+				std::string error;
+				CachedMesh cold;
+				auto coldStart = Clock::now();
+				loaded = cold.Load(fileName, ParseTextGrid, error);
+				float ms = MsSince(coldStart);
+				if (repeat == 0 || ms < coldMs)  coldMs = ms;
+				cold.Release();
+
+				CachedMesh warm;
+				auto warmStart = Clock::now();
+				loaded = loaded && warm.Load(fileName, ParseTextGrid, error) && warm.FromCache();
+				ms = MsSince(warmStart);
+				if (repeat == 0 || ms < warmMs)  warmMs = ms;
+				numVertices = warm.NumVertices();
+				numIndices = warm.NumIndices();
+			}
+			if (!loaded)
+			{
+				std::printf("  %dx%d grid: failed to load\n", size, size);
+				continue;
+			}
+			float sourceMegabytes = std::filesystem::file_size(fileName) / 1048576.0f;
+			float cacheMegabytes = std::filesystem::file_size(cacheFileName) / 1048576.0f;
+			std::printf("  %dx%d grid, %u vertices, %u indices (%.2fMB text, %.2fMB cache): cold %.2fms, warm %.2fms\n", size, size,
+			            numVertices, numIndices, sourceMegabytes, cacheMegabytes, coldMs, warmMs);
+		}
+		std::filesystem::remove_all(directory);
+	}
+
+
+	//-------------------------------------
+	// Camera matrices
+	//-------------------------------------
+
+	// Time the camera matrix work of a number of frames, with the matrices rebuilt on every fetch (as before they were
+	// cached) and then once per change. Each frame turns the camera then fetches its matrices the given number of times.
+	// Returns the sum of the matrix elements fetched so the work isn't optimised away
+	float TimeCameraFrames(int numFrames, int fetchesPerFrame, bool cached)
+	{
+		Camera camera({ 25, 18, -45 }, { 0.2f, 0.1f, 0 });
+		float sum = 0;
+		auto start = Clock::now();
+		for (int frame = 0; frame < numFrames; ++frame)
+		{
+			camera.SetRotation({ 0.2f, 0.1f + frame * 0.001f, 0 });
+			for (int fetch = 0; fetch < fetchesPerFrame; ++fetch)
+			{
+				if (!cached)  camera.SetPosition(camera.Position()); // Forces a rebuild, as every fetch used to do
+				sum += camera.ViewProjectionMatrix().e30;
+			}
+		}
+		float msPerFrame = MsSince(start) / numFrames;
+		std::printf("  %s: %.1f rebuilds, %.2fus/frame\n", cached ? "cached" : "uncached",
+		            static_cast<float>(camera.NumMatrixUpdates()) / numFrames, msPerFrame * 1000.0f);
+		return sum;
+	}
+
+	// A frame of the scene fetches four matrices for the depth pass, four for the main pass and one per polygon
+	// post-process point
+	void CameraMatrixBenchmark()
+	{
+		const int NUM_FRAMES = 10000;
+		const int FETCHES_PER_FRAME = 8 + 64;
+		std::printf("  %d fetches/frame\n", FETCHES_PER_FRAME);
+		volatile float sum = TimeCameraFrames(NUM_FRAMES, FETCHES_PER_FRAME, false);
+		sum = sum + TimeCameraFrames(NUM_FRAMES, FETCHES_PER_FRAME, true);
+	}
+
+
+	//-------------------------------------
+	// Matrix SIMD
+	//-------------------------------------
+
+	float MaxDifference(const float* a, const float* b, int count)
+	{
+		float difference = 0;
+		for (int i = 0; i < count; ++i)  difference = std::max(difference, std::abs(a[i] - b[i]));
+		return difference;
+	}
+
+	// A camera-like matrix - rotation, non-uniform scale and translation
+	CMatrix4x4 CameraLikeMatrix(float angle)
+	{
+		return MatrixRotationZ(angle * 0.3f) * MatrixRotationX(angle) * MatrixRotationY(angle * 1.7f) *
+		       MatrixTranslation({ 25.0f + angle, 18.0f, -45.0f });
+	}
+
+	void PrintMatrixTimes(const char* operation, float scalarNs, float simdNs, float maxError)
+	{
+		std::printf("  %s: scalar %.2fns, SIMD %.2fns (x%.1f), max error %g\n", operation, scalarNs, simdNs,
+		            simdNs > 0 ? scalarNs / simdNs : 0.0f, maxError);
+	}
+
+	// Time multiply, inverse-affine, single point transforms and batched point transforms with the CMatrix4x4 / CVector4
+	// operators against the SIMD functions, per operation
+	void MatrixBenchmark()
+	{
+		const int REPEATS = 2000;
+		auto nanoseconds = [](Clock::time_point start, int count)
+		{
+			return std::chrono::duration<float, std::nano>(Clock::now() - start).count() / count;
+		};
+
+		// A set of matrices and points to work through, so the compiler can't hoist the work out of the loops
+		const int NUM_MATRICES = 64;
+		const int NUM_POINTS = 1024;
+		std::vector<CMatrix4x4> matrices(NUM_MATRICES);
+		for (int i = 0; i < NUM_MATRICES; ++i)  matrices[i] = CameraLikeMatrix(i * 0.1f);
+		std::vector<CVector3> points(NUM_POINTS);
+		for (int i = 0; i < NUM_POINTS; ++i)  points[i] = { i * 0.5f - 200.0f, (i % 37) * 1.5f, (i % 101) * -2.0f };
+		std::vector<CVector4> scalarPoints(NUM_POINTS);
+		std::vector<CVector4> simdPoints(NUM_POINTS);
+		CMatrix4x4 scalarMatrix = {};
+		CMatrix4x4 simdMatrix = {};
+		float sink = 0;
+
+		// Matrix multiply
+		int count = REPEATS * NUM_MATRICES;
+		auto start = Clock::now();
+		for (int r = 0; r < REPEATS; ++r)
+		{
+			for (int i = 0; i < NUM_MATRICES; ++i)  { scalarMatrix = matrices[i] * matrices[(i + r) % NUM_MATRICES];  sink += scalarMatrix.e30; }
+		}
+		float scalarNs = nanoseconds(start, count);
+		start = Clock::now();
+		for (int r = 0; r < REPEATS; ++r)
+		{
+			for (int i = 0; i < NUM_MATRICES; ++i)  { simdMatrix = MultiplySimd(matrices[i], matrices[(i + r) % NUM_MATRICES]);  sink += simdMatrix.e30; }
+		}
+		PrintMatrixTimes("Multiply", scalarNs, nanoseconds(start, count), MaxDifference(&scalarMatrix.e00, &simdMatrix.e00, 16));
+
+		// Inverse affine
+		start = Clock::now();
+		for (int r = 0; r < REPEATS; ++r)
+		{
+			for (int i = 0; i < NUM_MATRICES; ++i)  { scalarMatrix = InverseAffine(matrices[i]);  sink += scalarMatrix.e30; }
+		}
+		scalarNs = nanoseconds(start, count);
+		start = Clock::now();
+		for (int r = 0; r < REPEATS; ++r)
+		{
+			for (int i = 0; i < NUM_MATRICES; ++i)  { simdMatrix = InverseAffineSimd(matrices[i]);  sink += simdMatrix.e30; }
+		}
+		PrintMatrixTimes("InverseAffine", scalarNs, nanoseconds(start, count), MaxDifference(&scalarMatrix.e00, &simdMatrix.e00, 16));
+
+		// Points one at a time, as the per-point loops do
+		count = REPEATS * NUM_POINTS;
+		start = Clock::now();
+		for (int r = 0; r < REPEATS; ++r)
+		{
+			const CMatrix4x4& m = matrices[r % NUM_MATRICES];
+			for (int p = 0; p < NUM_POINTS; ++p)  scalarPoints[p] = CVector4(points[p], 1.0f) * m;
+			sink += scalarPoints[r % NUM_POINTS].x;
+		}
+		scalarNs = nanoseconds(start, count);
+		start = Clock::now();
+		for (int r = 0; r < REPEATS; ++r)
+		{
+			const CMatrix4x4& m = matrices[r % NUM_MATRICES];
+			for (int p = 0; p < NUM_POINTS; ++p)  simdPoints[p] = TransformSimd(CVector4(points[p], 1.0f), m);
+			sink += simdPoints[r % NUM_POINTS].x;
+		}
+		PrintMatrixTimes("Point transform", scalarNs, nanoseconds(start, count), MaxDifference(&scalarPoints[0].x, &simdPoints[0].x, NUM_POINTS * 4));
+
+		// The same points as one batch, against the same scalar loop
+		start = Clock::now();
+		for (int r = 0; r < REPEATS; ++r)
+		{
+			TransformPoints(points.data(), NUM_POINTS, matrices[r % NUM_MATRICES], simdPoints.data());
+			sink += simdPoints[r % NUM_POINTS].x;
+		}
+		PrintMatrixTimes("Batched points", scalarNs, nanoseconds(start, count), MaxDifference(&scalarPoints[0].x, &simdPoints[0].x, NUM_POINTS * 4));
+
+		// Keep the results alive
+		volatile float keep = sink;
+		(void)keep;
+	}
+
+
+	//-------------------------------------
+	// Screen projection
+	//-------------------------------------
+
+	// Placing area effects at many points - each projected with PixelFromWorldPt, PixelSizeInWorldSpace and the depth
+	// sum, against one ProjectToScreen batch. Points are on a spiral around the camera, some in view, some off to the
+	// side and some behind. Best of a number of repeats
+	void ScreenProjectionBenchmark()
+	{
+		const unsigned int WIDTH = 1280;
+		const unsigned int HEIGHT = 960;
+		const int NUM_POINTS = 1000;
+		const int REPEATS = 50;
+
+		Camera camera({ 25, 18, -45 }, { 0.2f, 0.1f, 0 });
+		std::vector<CVector3> points(NUM_POINTS);
+		for (int i = 0; i < NUM_POINTS; ++i)
+		{
+			float angle = i * 0.37f;
+			float radius = 5.0f + (i % 200) * 1.5f;
+			points[i] = { 25 + radius * std::sin(angle), 18 + (i % 23) - 11.0f, -45 + radius * std::cos(angle) };
+		}
+
+		std::vector<CVector3> perPoint(NUM_POINTS);
+		std::vector<CVector2> perPointSize(NUM_POINTS);
+		std::vector<float> perPointDepth(NUM_POINTS);
+		ScreenPoints batch;
+		float perPointMs = 1e9f;
+		float batchMs = 1e9f;
+		for (int repeat = 0; repeat < REPEATS; ++repeat)
+		{
+			auto start = Clock::now();
+			for (int i = 0; i < NUM_POINTS; ++i)
+			{
+				perPoint[i] = camera.PixelFromWorldPt(points[i], WIDTH, HEIGHT);
+				if (perPoint[i].z < camera.NearClip())  continue;
+				CVector2 pixelSize = camera.PixelSizeInWorldSpace(perPoint[i].z, WIDTH, HEIGHT);
+				perPointSize[i] = { 1.0f / pixelSize.x, 1.0f / pixelSize.y };
+				perPointDepth[i] = camera.FarClip() * (perPoint[i].z - camera.NearClip()) / (camera.FarClip() - camera.NearClip()) / perPoint[i].z;
+			}
+			perPointMs = std::min(perPointMs, MsSince(start));
+
+			start = Clock::now();
+			camera.ProjectToScreen(points.data(), NUM_POINTS, WIDTH, HEIGHT, batch);
+			batchMs = std::min(batchMs, MsSince(start));
+		}
+
+		float maxPixelError = 0;
+		int numOnScreen = 0;
+		for (int i = 0; i < NUM_POINTS; ++i)
+		{
+			if (!batch.OnScreen(i))  continue;
+			maxPixelError = std::max({ maxPixelError, std::abs(batch.x[i] - perPoint[i].x), std::abs(batch.y[i] - perPoint[i].y) });
+			numOnScreen++;
+		}
+		std::printf("  %d points (%d on screen): per point %.1fus, batch %.1fus (x%.1f), max difference %.3f pixels\n",
+		            NUM_POINTS, numOnScreen, perPointMs * 1000.0f, batchMs * 1000.0f, batchMs > 0 ? perPointMs / batchMs : 0.0f,
+		            maxPixelError);
+	}
+
+
+	struct Benchmark
+	{
+		const char* name;
+		const char* description;
+		void (*run)();
+	};
+
+	const Benchmark BENCHMARKS[] =
+	{
+		{ "blur",       "CPU blur at 1280x960 and 4K, Gaussian against the constant-time modes",                BlurBenchmark },
+		{ "bloom",      "CPU bloom chain against the full size passes it replaced, with GPU traffic estimates", BloomBenchmark },
+		{ "textures",   "Decoding .dds files one at a time and on the thread pool",                             TextureDecodeBenchmark },
+		{ "meshes",     "Loading meshes through the mesh cache, cold against warm",                             MeshLoadBenchmark },
+		{ "camera",     "Camera matrices rebuilt on every fetch against once per change",                       CameraMatrixBenchmark },
+		{ "matrices",   "Matrix and point operations, CMatrix4x4 operators against the SIMD versions",          MatrixBenchmark },
+		{ "projection", "Projecting points for area effects one at a time against one batch",                   ScreenProjectionBenchmark },
+	};
+}
+
+
+int main(int argc, char** argv)
+{
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		auto named = [&](const Benchmark& benchmark) { return std::strcmp(benchmark.name, argv[arg]) == 0; };
+		if (std::none_of(std::begin(BENCHMARKS), std::end(BENCHMARKS), named))
+		{
+			std::printf("Unknown benchmark \"%s\", the benchmarks are:\n", argv[arg]);
+			for (auto& benchmark : BENCHMARKS)  std::printf("  %s - %s\n", benchmark.name, benchmark.description);
+			return 1;
+		}
+	}
+
+	for (auto& benchmark : BENCHMARKS)
+	{
+		bool selected = (argc == 1);
+		for (int arg = 1; arg < argc; ++arg)  selected |= (std::strcmp(benchmark.name, argv[arg]) == 0);
+		if (!selected)  continue;
+
+		std::printf("%s - %s\n", benchmark.name, benchmark.description);
+		benchmark.run();
+	}
+	return 0;
+}
@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------
+// Test of the camera's matrix caching (Camera.h)
+//--------------------------------------------------------------------------------------
+// Changes each camera setting in turn and checks the matrices are rebuilt exactly once however many times they are
+// fetched afterwards, and that they match those of a camera constructed fresh with the same settings bit for bit - so
+// rebuilding only the world or only the projection part gives the same result as rebuilding everything. The keyboard
+// and the speeds Control reads are stubbed in place of Input.cpp and Scene.cpp.
+
+#include "Camera.h"
+#include "Check.h"
+
+#include <cstring>
+
+
+//--------------------------------------------------------------------------------------
+// Stand-ins for the app
+//--------------------------------------------------------------------------------------
+
+extern const float ROTATION_SPEED = 1.5f;
+extern const float MOVEMENT_SPEED = 50.0f;
+
+namespace
+{
+	bool gKeysHeld[256] = {};
+}
+
+bool KeyHeld(KeyCode key)
+{
+	return gKeysHeld[key];
+}
+
+
+namespace
+{
+	bool SameBits(const CMatrix4x4& a, const CMatrix4x4& b)
+	{
+		return std::memcmp(&a, &b, sizeof(CMatrix4x4)) == 0;
+	}
+
+	// Fetch every matrix a few times, along with the picking functions that use them, and check they all match a fresh
+	// camera with the same settings. Returns false on a mismatch
+	bool MatchesFreshCamera(Camera& camera)
+	{
+		Camera fresh(camera.Position(), camera.Rotation(), camera.FOV(), 4.0f / 3.0f, camera.NearClip(), camera.FarClip());
+		bool same = true;
+		for (int fetch = 0; fetch < 3; ++fetch)
+		{
+			same = same && SameBits(camera.WorldMatrix(),          fresh.WorldMatrix());
+			same = same && SameBits(camera.ViewMatrix(),           fresh.ViewMatrix());
+			same = same && SameBits(camera.ProjectionMatrix(),     fresh.ProjectionMatrix());
+			same = same && SameBits(camera.ViewProjectionMatrix(), fresh.ViewProjectionMatrix());
+		}
+		CVector3 pixel = camera.PixelFromWorldPt({ 10, 5, 60 }, 1280, 960);
+		CVector3 freshPixel = fresh.PixelFromWorldPt({ 10, 5, 60 }, 1280, 960);
+		CVector2 size = camera.PixelSizeInWorldSpace(20, 1280, 960);
+		CVector2 freshSize = fresh.PixelSizeInWorldSpace(20, 1280, 960);
+		return same && std::memcmp(&pixel, &freshPixel, sizeof(pixel)) == 0 && std::memcmp(&size, &freshSize, sizeof(size)) == 0;
+	}
+
+	void Control(Camera& camera)
+	{
+		camera.Control(0.016f, Key_Up, Key_Down, Key_Left, Key_Right, Key_W, Key_S, Key_A, Key_D);
+	}
+}
+
+
+int main()
+{
+	Camera camera({ 25, 18, -45 }, { 0.2f, 0.1f, 0 });
+
+	// The first fetch builds the matrices, later fetches with nothing changed don't
+	CHECK(camera.NumMatrixUpdates() == 0);
+	CHECK(MatchesFreshCamera(camera));
+	CHECK(camera.NumMatrixUpdates() == 1);
+	CHECK(MatchesFreshCamera(camera));
+	CHECK(camera.NumMatrixUpdates() == 1);
+
+	// Each setting, changed a few times, costs exactly one rebuild however many fetches follow
+	for (int change = 1; change <= 3; ++change)
+	{
+		float step = static_cast<float>(change);
+		int numUpdates = camera.NumMatrixUpdates();
+		camera.SetPosition({ 25 + step, 18 - step, -45 + 2 * step });
+		CHECK(MatchesFreshCamera(camera));
+		CHECK(camera.NumMatrixUpdates() == numUpdates + 1);
+
+		numUpdates = camera.NumMatrixUpdates();
+		camera.SetRotation({ 0.2f + 0.05f * step, 0.1f - 0.3f * step, 0.01f * step });
+		CHECK(MatchesFreshCamera(camera));
+		CHECK(camera.NumMatrixUpdates() == numUpdates + 1);
+
+		numUpdates = camera.NumMatrixUpdates();
+		camera.SetFOV(PI / 3 + 0.1f * step);
+		CHECK(MatchesFreshCamera(camera));
+		CHECK(camera.NumMatrixUpdates() == numUpdates + 1);
+
+		numUpdates = camera.NumMatrixUpdates();
+		camera.SetNearClip(0.1f + 0.5f * step);
+		CHECK(MatchesFreshCamera(camera));
+		CHECK(camera.NumMatrixUpdates() == numUpdates + 1);
+
+		numUpdates = camera.NumMatrixUpdates();
+		camera.SetFarClip(10000.0f - 1000.0f * step);
+		CHECK(MatchesFreshCamera(camera));
+		CHECK(camera.NumMatrixUpdates() == numUpdates + 1);
+	}
+
+	// Several settings changed between fetches are still one rebuild
+	int numUpdates = camera.NumMatrixUpdates();
+	camera.SetPosition({ 0, 10, -20 });
+	camera.SetFOV(PI / 4);
+	camera.SetFarClip(500.0f);
+	CHECK(MatchesFreshCamera(camera));
+	CHECK(camera.NumMatrixUpdates() == numUpdates + 1);
+
+	// Moving with the keys rebuilds, a frame with no keys held doesn't
+	numUpdates = camera.NumMatrixUpdates();
+	Control(camera);
+	CHECK(MatchesFreshCamera(camera));
+	CHECK(camera.NumMatrixUpdates() == numUpdates);
+
+	for (KeyCode key : { Key_W, Key_Right, Key_Up, Key_A })
+	{
+		gKeysHeld[key] = true;
+		numUpdates = camera.NumMatrixUpdates();
+		Control(camera);
+		CHECK(MatchesFreshCamera(camera));
+		CHECK(camera.NumMatrixUpdates() == numUpdates + 1);
+		gKeysHeld[key] = false;
+	}
+
+	std::printf("CameraTest: %d checks failed\n", gNumFailedChecks);
+	return gNumFailedChecks;
+}
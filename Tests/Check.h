@@ -0,0 +1,29 @@
+//--------------------------------------------------------------------------------------
+// Checks for the headless tests
+//--------------------------------------------------------------------------------------
+// Each test is a program that runs its checks and returns the number that failed, so it passes with exit code 0.
+// A failed check is printed with its file and line.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _CHECK_H_INCLUDED_
+#define _CHECK_H_INCLUDED_
+
+#include <cstdio>
+
+
+inline int gNumFailedChecks = 0;
+
+inline bool Check(bool passed, const char* condition, const char* file, int line)
+{
+	if (!passed)
+	{
+		std::printf("%s(%d): check failed: %s\n", file, line, condition);
+		gNumFailedChecks++;
+	}
+	return passed;
+}
+
+#define CHECK(condition)  Check((condition), #condition, __FILE__, __LINE__)
+
+
+#endif //_CHECK_H_INCLUDED_
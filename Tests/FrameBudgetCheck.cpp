@@ -0,0 +1,29 @@
+//--------------------------------------------------------------------------------------
+// Check of the post-processing frame budgets (FrameBudget.h)
+//--------------------------------------------------------------------------------------
+// Records the default budgets' post-process lists through the same pass code the app draws with (PostProcessPasses.h)
+// and fails if any list costs more than its budget, printing what went over. Run after changing a pass to see its cost.
+
+#include "FrameBudget.h"
+
+#include <cstdio>
+#include <vector>
+
+
+int main()
+{
+	int numOverBudget = 0;
+	std::vector<FrameBudgetResult> results = CheckFrameBudgets(DefaultFrameBudgets(), 1280, 720);
+	for (auto& result : results)
+	{
+		const RecordedFrame& frame = result.frame;
+		std::printf("%-32s draws %d, state calls %d, constants %.1fKB, render target switches %d: %s%s\n",
+		            result.name.c_str(), frame.numDraws, frame.TotalStateCalls(), frame.constantBytes / 1024.0f,
+		            frame.numRenderTargetSwitches, result.withinBudget ? "within budget" : "over budget - ",
+		            result.overBudget.c_str());
+		if (!result.withinBudget)  numOverBudget++;
+	}
+
+	std::printf("FrameBudgetCheck: %d of %d lists over budget\n", numOverBudget, static_cast<int>(results.size()));
+	return numOverBudget;
+}
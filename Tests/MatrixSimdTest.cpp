@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------------
+// Test of the SIMD matrix and vector operations (MatrixSimd.h)
+//--------------------------------------------------------------------------------------
+// Compares each SIMD function against the CMatrix4x4 / CVector4 operators it replaces, over camera-like matrices
+// (rotation, scale and translation) and, for the multiply and transforms, a projection matrix. The results only need
+// to match to within rounding as the sums are done in a different order. The batches are run at every count from 0 to
+// 17 so the tails left over after whole groups of 4 or 8 points are covered, and checked not to write past the end.
+
+#include "MatrixSimd.h"
+#include "Check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace
+{
+	// Allowed difference between the scalar and SIMD results, relative to the largest value in the result (rounding in
+	// the larger terms of a sum shows up in all of it)
+	const float TOLERANCE = 1e-5f;
+
+	bool Near(const float* a, const float* b, int count)
+	{
+		float scale = 1.0f;
+		for (int i = 0; i < count; ++i)  scale = std::max({ scale, std::abs(a[i]), std::abs(b[i]) });
+		for (int i = 0; i < count; ++i)
+		{
+			if (std::abs(a[i] - b[i]) > TOLERANCE * scale)  return false;
+		}
+		return true;
+	}
+
+	bool Near(const CVector4& a, const CVector4& b)      { return Near(&a.x, &b.x, 4); }
+	bool Near(const CMatrix4x4& a, const CMatrix4x4& b)  { return Near(&a.e00, &b.e00, 16); }
+
+	bool Same(const CVector4& a, const CVector4& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+	}
+
+
+	// A camera-like matrix - rotation, non-uniform scale and translation
+	CMatrix4x4 AffineMatrix(float angle)
+	{
+		return MatrixScaling({ 1.0f + angle * 0.1f, 2.0f, 0.5f }) * MatrixRotationZ(angle * 0.3f) * MatrixRotationX(angle) *
+		       MatrixRotationY(angle * 1.7f) * MatrixTranslation({ 25.0f + angle, 18.0f, -45.0f * angle });
+	}
+
+	// A perspective projection as built by Camera, so w isn't 1
+	CMatrix4x4 ProjectionMatrix()
+	{
+		return { 1.7f, 0.0f,  0.0f,    0.0f,
+		         0.0f, 2.3f,  0.0f,    0.0f,
+		         0.0f, 0.0f,  1.001f,  1.0f,
+		         0.0f, 0.0f, -0.1001f, 0.0f };
+	}
+
+	CVector3 TestPoint(int i)
+	{
+		return { i * 3.5f - 20.0f, (i % 7) * -1.5f + 4.0f, (i % 5) * 12.0f - 30.0f };
+	}
+}
+
+
+int main()
+{
+	std::vector<CMatrix4x4> matrices;
+	for (int i = 0; i < 20; ++i)  matrices.push_back(AffineMatrix(i * 0.37f));
+	const CMatrix4x4 projection = ProjectionMatrix();
+
+
+	//-------------------------------------
+	// Single operations
+	//-------------------------------------
+
+	for (size_t i = 0; i < matrices.size(); ++i)
+	{
+		const CMatrix4x4& a = matrices[i];
+		const CMatrix4x4& b = matrices[(i + 7) % matrices.size()];
+		CHECK(Near(MultiplySimd(a, b), a * b));
+		CHECK(Near(MultiplySimd(a, projection), a * projection));
+		CHECK(Near(MultiplySimd(projection, a), projection * a));
+
+		CHECK(Near(InverseAffineSimd(a), InverseAffine(a)));
+
+		for (int p = 0; p < 4; ++p)
+		{
+			CVector4 point(TestPoint(p), 1.0f);
+			CVector4 vector(TestPoint(p + 10), 0.0f);
+			CHECK(Near(TransformSimd(point, a), point * a));
+			CHECK(Near(TransformSimd(vector, a), vector * a));
+			CHECK(Near(TransformSimd(point, projection), point * projection));
+		}
+	}
+
+
+	//-------------------------------------
+	// Batches
+	//-------------------------------------
+
+	const int MAX_COUNT = 17;
+	const CVector4 UNTOUCHED = { -1234.5f, 6789.0f, -1.0f, 42.0f };
+	for (const CMatrix4x4& m : { matrices[3], matrices[11], projection })
+	{
+		for (int count = 0; count <= MAX_COUNT; ++count)
+		{
+			std::vector<CVector3> points(count);
+			for (int p = 0; p < count; ++p)  points[p] = TestPoint(p);
+
+			// Points to a separate array with a spare entry on the end, which must be left alone
+			std::vector<CVector4> results(count + 1, UNTOUCHED);
+			TransformPoints(points.data(), count, m, results.data());
+			bool allNear = true;
+			for (int p = 0; p < count; ++p)  allNear = allNear && Near(results[p], CVector4(points[p], 1.0f) * m);
+			CHECK(allNear);
+			CHECK(Same(results[count], UNTOUCHED));
+
+			// Vectors with mixed w transformed in place, again with a spare entry
+			std::vector<CVector4> vectors(count + 1, UNTOUCHED);
+			std::vector<CVector4> expected(count);
+			for (int v = 0; v < count; ++v)
+			{
+				vectors[v] = CVector4(points[v], (v % 3) * 0.5f);
+				expected[v] = vectors[v] * m;
+			}
+			TransformVectors(vectors.data(), count, m, vectors.data());
+			allNear = true;
+			for (int v = 0; v < count; ++v)  allNear = allNear && Near(vectors[v], expected[v]);
+			CHECK(allNear);
+			CHECK(Same(vectors[count], UNTOUCHED));
+
+			// And to a separate array, leaving the source as it was
+			std::vector<CVector4> source(vectors.begin(), vectors.begin() + count);
+			std::vector<CVector4> transformed(count + 1, UNTOUCHED);
+			TransformVectors(source.data(), count, m, transformed.data());
+			allNear = true;
+			for (int v = 0; v < count; ++v)  allNear = allNear && Near(transformed[v], vectors[v] * m) && Same(source[v], vectors[v]);
+			CHECK(allNear);
+			CHECK(Same(transformed[count], UNTOUCHED));
+		}
+	}
+
+	std::printf("MatrixSimdTest: %d checks failed\n", gNumFailedChecks);
+	return gNumFailedChecks;
+}
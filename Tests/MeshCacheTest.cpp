@@ -0,0 +1,231 @@
+//--------------------------------------------------------------------------------------
+// Test of the binary cache of mesh geometry (MeshCache.h)
+//--------------------------------------------------------------------------------------
+// Loads mesh files written to a temporary directory, with a stub importer in place of the one Mesh uses. The stub
+// builds a fan of triangles with a vertex for each character of the source, so the geometry shows which version of a
+// source it came from, and counts its calls so the test can tell a load from the cache from a cold one.
+
+#include "MeshCache.h"
+#include "Check.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+	void Save(const std::string& fileName, const std::string& text)
+	{
+		std::ofstream(fileName, std::ios::binary) << text;
+	}
+
+	std::vector<uint8_t> LoadBytes(const std::string& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	void SaveBytes(const std::string& fileName, const std::vector<uint8_t>& bytes)
+	{
+		std::ofstream(fileName, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	}
+
+
+	// Stands in for Mesh's importer. Sources containing "error" fail, those containing "empty" give no geometry, and
+	// those containing "u" have texture coordinates
+	struct StubImporter
+	{
+		int numParsed = 0;
+
+		MeshParseFunction Function()
+		{
+			return [this](const std::string& fileName, MeshData& mesh, std::string& error)
+			{
+				numParsed++;
+				std::vector<uint8_t> bytes = LoadBytes(fileName);
+				std::string source(bytes.begin(), bytes.end());
+				if (source.find("error") != std::string::npos)
+				{
+					error = "syntax error";
+					return false;
+				}
+				mesh = MeshData();
+				if (source.find("empty") != std::string::npos)  return true;
+
+				mesh.hasNormals = true;
+				mesh.hasUVs = source.find('u') != std::string::npos;
+				for (size_t c = 0; c < source.size(); ++c)
+				{
+					MeshVertex vertex = {};
+					vertex.position[0] = static_cast<float>(c);
+					vertex.position[1] = static_cast<float>(source[c]);
+					vertex.normal[2] = 1;
+					if (mesh.hasUVs)  vertex.uv[0] = static_cast<float>(c) / source.size();
+					mesh.vertices.push_back(vertex);
+				}
+				for (uint32_t v = 1; v + 1 < mesh.vertices.size(); ++v)
+				{
+					mesh.indices.insert(mesh.indices.end(), { 0, v, v + 1 });
+				}
+				return true;
+			};
+		}
+	};
+
+
+	// Check a loaded mesh holds the geometry the stub builds from the given source
+	bool HasGeometryOf(const CachedMesh& mesh, const std::string& source)
+	{
+		uint32_t numVertices = static_cast<uint32_t>(source.size());
+		if (mesh.NumVertices() != numVertices || mesh.NumIndices() != (numVertices - 2) * 3)  return false;
+		if (!mesh.HasNormals() || mesh.HasUVs() != (source.find('u') != std::string::npos))  return false;
+		for (uint32_t v = 0; v < numVertices; ++v)
+		{
+			const MeshVertex& vertex = mesh.Vertices()[v];
+			if (vertex.position[0] != v || vertex.position[1] != source[v] || vertex.normal[2] != 1)  return false;
+		}
+		for (uint32_t t = 0; t < numVertices - 2; ++t)
+		{
+			const uint32_t* triangle = mesh.Indices() + t * 3;
+			if (triangle[0] != 0 || triangle[1] != t + 1 || triangle[2] != t + 2)  return false;
+		}
+		return true;
+	}
+
+	bool IsAligned(const void* data)
+	{
+		return reinterpret_cast<uintptr_t>(data) % MESH_CACHE_ALIGNMENT == 0;
+	}
+}
+
+
+int main()
+{
+	auto directory = std::filesystem::temp_directory_path() / "MeshCacheTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	const std::string meshFile = (directory / "Cube.x").string();
+	const std::string cacheFile = MeshCacheFileName(meshFile);
+
+	StubImporter importer;
+	std::string error;
+
+
+	//-------------------------------------
+	// Cold and warm loads
+	//-------------------------------------
+
+	// No cache yet - the source is parsed and a cache written
+	const std::string source = "cube with uvs";
+	Save(meshFile, source);
+	{
+		CachedMesh mesh;
+		CHECK(mesh.Load(meshFile, importer.Function(), error));
+		CHECK(importer.numParsed == 1);
+		CHECK(!mesh.FromCache());
+		CHECK(HasGeometryOf(mesh, source));
+		CHECK(std::filesystem::exists(cacheFile));
+	}
+
+	// Now the cache is used without parsing, with the vertices and indices aligned for creating buffers from
+	{
+		CachedMesh mesh;
+		CHECK(mesh.Load(meshFile, importer.Function(), error));
+		CHECK(importer.numParsed == 1);
+		CHECK(mesh.FromCache());
+		CHECK(HasGeometryOf(mesh, source));
+		CHECK(IsAligned(mesh.Vertices()) && IsAligned(mesh.Indices()));
+
+		mesh.Release();
+		CHECK(mesh.Vertices() == nullptr && mesh.Indices() == nullptr && mesh.NumVertices() == 0 && mesh.NumIndices() == 0);
+		CHECK(!mesh.FromCache());
+
+		// Loading again into the same object
+		CHECK(mesh.Load(meshFile, importer.Function(), error));
+		CHECK(importer.numParsed == 1 && mesh.FromCache() && HasGeometryOf(mesh, source));
+	}
+
+
+	//-------------------------------------
+	// Invalidation
+	//-------------------------------------
+
+	// A changed source is parsed again, whether or not its size changed, and its new cache used after that
+	const std::string sameSize = "cube with UVs";
+	const std::string resized = "bigger cube, no normal maps";
+	for (const std::string& changed : { sameSize, resized })
+	{
+		Save(meshFile, changed);
+		CachedMesh mesh;
+		int numParsed = importer.numParsed;
+		CHECK(mesh.Load(meshFile, importer.Function(), error));
+		CHECK(importer.numParsed == numParsed + 1);
+		CHECK(!mesh.FromCache() && HasGeometryOf(mesh, changed));
+
+		CachedMesh warm;
+		CHECK(warm.Load(meshFile, importer.Function(), error));
+		CHECK(importer.numParsed == numParsed + 1);
+		CHECK(warm.FromCache() && HasGeometryOf(warm, changed));
+	}
+
+	// A cache from another version of the format or with a different vertex layout is rebuilt, as is a broken one
+	auto headerField = [](std::vector<uint8_t>& bytes, size_t offset) { return reinterpret_cast<uint32_t*>(bytes.data() + offset); };
+	const std::vector<uint8_t> goodCache = LoadBytes(cacheFile);
+	std::vector<std::vector<uint8_t>> badCaches(4, goodCache);
+	*headerField(badCaches[0], offsetof(MeshCacheHeader, magic)) = 0;
+	*headerField(badCaches[1], offsetof(MeshCacheHeader, version)) = MESH_CACHE_VERSION + 1;
+	*headerField(badCaches[2], offsetof(MeshCacheHeader, vertexSize)) = sizeof(MeshVertex) + 4;
+	badCaches[3].resize(goodCache.size() - 4); // Last index cut off
+	for (auto& badCache : badCaches)
+	{
+		SaveBytes(cacheFile, badCache);
+		CachedMesh mesh;
+		int numParsed = importer.numParsed;
+		CHECK(mesh.Load(meshFile, importer.Function(), error));
+		CHECK(importer.numParsed == numParsed + 1);
+		CHECK(!mesh.FromCache() && HasGeometryOf(mesh, resized));
+		CHECK(LoadBytes(cacheFile) == goodCache);
+	}
+
+
+	//-------------------------------------
+	// Missing sources and failures
+	//-------------------------------------
+
+	// With the source gone the cache is used as it is
+	std::filesystem::remove(meshFile);
+	{
+		CachedMesh mesh;
+		int numParsed = importer.numParsed;
+		CHECK(mesh.Load(meshFile, importer.Function(), error));
+		CHECK(importer.numParsed == numParsed);
+		CHECK(mesh.FromCache() && HasGeometryOf(mesh, resized));
+	}
+
+	// Without either there is nothing to load
+	std::filesystem::remove(cacheFile);
+	{
+		CachedMesh mesh;
+		error.clear();
+		CHECK(!mesh.Load(meshFile, importer.Function(), error));
+		CHECK(!error.empty() && mesh.NumIndices() == 0);
+	}
+
+	// Importer failures and sources with no geometry are reported, and leave no cache behind
+	for (const std::string& bad : { std::string("syntax error"), std::string("empty mesh") })
+	{
+		Save(meshFile, bad);
+		CachedMesh mesh;
+		error.clear();
+		CHECK(!mesh.Load(meshFile, importer.Function(), error));
+		CHECK(!error.empty() && mesh.Vertices() == nullptr && mesh.NumIndices() == 0);
+		CHECK(!std::filesystem::exists(cacheFile));
+	}
+
+	std::filesystem::remove_all(directory);
+	std::printf("MeshCacheTest: %d checks failed\n", gNumFailedChecks);
+	return gNumFailedChecks;
+}
@@ -0,0 +1,223 @@
+//--------------------------------------------------------------------------------------
+// Test of projecting batches of points onto the screen (ScreenProjection.h)
+//--------------------------------------------------------------------------------------
+// Projects sets of points with Camera::ProjectToScreen and checks each point's masks, distance, depth and pixel size
+// against the per-point functions it replaced (PixelFromWorldPt and PixelSizeInWorldSpace), at counts that leave a
+// partial group of four and cross a mask word. Then checks the boundaries exactly: points on the near clip, points on
+// the viewport edges, and shapes for AllOffScreen that straddle the near clip. The keyboard and the speeds
+// Camera::Control reads are stubbed in place of Input.cpp and Scene.cpp.
+
+#include "Camera.h"
+#include "Check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Stand-ins for the app
+//--------------------------------------------------------------------------------------
+
+extern const float ROTATION_SPEED = 1.5f;
+extern const float MOVEMENT_SPEED = 50.0f;
+
+bool KeyHeld(KeyCode)
+{
+	return false;
+}
+
+
+namespace
+{
+	const unsigned int WIDTH = 1280;
+	const unsigned int HEIGHT = 960;
+
+	bool Near(float a, float b, float tolerance)
+	{
+		return std::abs(a - b) <= tolerance * std::max({ 1.0f, std::abs(a), std::abs(b) });
+	}
+
+	// Points scattered around the camera - in view, off each edge, behind and close to the near clip
+	std::vector<CVector3> ScatteredPoints(int numPoints)
+	{
+		std::vector<CVector3> points(numPoints);
+		for (int i = 0; i < numPoints; ++i)
+		{
+			points[i] = { 25 + (i % 11 - 5) * 10.0f, 18 + (i % 7 - 3) * 5.0f, -45 + (i % 13 - 6) * 20.0f };
+		}
+		return points;
+	}
+
+	// Check every point of a batch against the per-point functions, returns false on a mismatch. Points within a
+	// rounding error of the near clip or a viewport edge are left to the exact tests below
+	bool MatchesPerPoint(Camera& camera, const std::vector<CVector3>& points, const ScreenPoints& batch)
+	{
+		int numPoints = static_cast<int>(points.size());
+		if (batch.NumPoints() != numPoints)  return false;
+		for (int i = 0; i < numPoints; ++i)
+		{
+			CVector3 pixel = camera.PixelFromWorldPt(points[i], WIDTH, HEIGHT);
+			if (!Near(batch.z[i], pixel.z, 1e-5f))  return false;
+			if (std::abs(pixel.z - camera.NearClip()) < 1e-3f)  continue;
+
+			bool inFront = pixel.z >= camera.NearClip();
+			if (batch.InFront(i) != inFront)  return false;
+			if (!inFront)
+			{
+				if (batch.OnScreen(i))  return false;
+				continue;
+			}
+
+			if (!Near(batch.x[i], pixel.x, 1e-5f) || !Near(batch.y[i], pixel.y, 1e-5f))  return false;
+			const float EDGE = 0.01f;
+			bool nearEdge = std::abs(pixel.x) < EDGE || std::abs(pixel.x - WIDTH) < EDGE ||
+			                std::abs(pixel.y) < EDGE || std::abs(pixel.y - HEIGHT) < EDGE;
+			bool onScreen = pixel.x >= 0 && pixel.x <= WIDTH && pixel.y >= 0 && pixel.y <= HEIGHT;
+			if (!nearEdge && batch.OnScreen(i) != onScreen)  return false;
+
+			float depth = camera.FarClip() * (pixel.z - camera.NearClip()) / (camera.FarClip() - camera.NearClip()) / pixel.z;
+			if (!Near(batch.depth[i], depth, 1e-5f))  return false;
+
+			CVector2 pixelSize = camera.PixelSizeInWorldSpace(pixel.z, WIDTH, HEIGHT);
+			CVector2 size = batch.PixelSize(i, { 2, 3 });
+			if (!Near(size.x, 2 / pixelSize.x, 1e-5f) || !Near(size.y, 3 / pixelSize.y, 1e-5f))  return false;
+		}
+
+		// Mask bits past the last point are clear
+		int usedBits = numPoints % 32;
+		if (usedBits != 0)
+		{
+			uint32_t unused = ~((1u << usedBits) - 1);
+			if ((batch.inFront.back() & unused) != 0 || (batch.onScreen.back() & unused) != 0)  return false;
+		}
+		return true;
+	}
+}
+
+
+int main()
+{
+	//-------------------------------------
+	// Against the per-point functions
+	//-------------------------------------
+
+	Camera camera({ 25, 18, -45 }, { 0.2f, 0.1f, 0 });
+	CMatrix4x4 viewProjection = camera.ViewProjectionMatrix();
+	for (int numPoints : { 1, 2, 3, 4, 5, 6, 7, 9, 13, 31, 32, 33, 77 })
+	{
+		std::vector<CVector3> points = ScatteredPoints(numPoints);
+		std::vector<CVector4> clipPoints(numPoints + 1, CVector4(-1, -2, -3, -4));
+		ScreenPoints batch;
+		camera.ProjectToScreen(points.data(), numPoints, WIDTH, HEIGHT, batch, clipPoints.data());
+		CHECK(MatchesPerPoint(camera, points, batch));
+
+		bool clipMatches = true;
+		for (int i = 0; i < numPoints; ++i)
+		{
+			CVector4 clip = CVector4(points[i], 1.0f) * viewProjection;
+			clipMatches = clipMatches && Near(clipPoints[i].x, clip.x, 1e-5f) && Near(clipPoints[i].y, clip.y, 1e-5f) &&
+			                             Near(clipPoints[i].z, clip.z, 1e-5f) && Near(clipPoints[i].w, clip.w, 1e-5f);
+		}
+		CHECK(clipMatches);
+		CHECK(clipPoints[numPoints].x == -1 && clipPoints[numPoints].w == -4); // Nothing written past the end
+	}
+
+	// The same points given in model space with a world matrix placing them
+	{
+		const int NUM_POINTS = 19;
+		std::vector<CVector3> worldPoints = ScatteredPoints(NUM_POINTS);
+		CMatrix4x4 worldMatrix = MatrixRotationY(0.7f) * MatrixTranslation({ 5, -2, 10 });
+		CMatrix4x4 modelMatrix = InverseAffine(worldMatrix);
+		std::vector<CVector3> modelPoints(NUM_POINTS);
+		for (int i = 0; i < NUM_POINTS; ++i)
+		{
+			CVector4 model = CVector4(worldPoints[i], 1.0f) * modelMatrix;
+			modelPoints[i] = { model.x, model.y, model.z };
+		}
+		ScreenPoints batch;
+		camera.ProjectToScreen(modelPoints.data(), NUM_POINTS, worldMatrix, WIDTH, HEIGHT, batch);
+		CHECK(MatchesPerPoint(camera, worldPoints, batch));
+	}
+
+
+	//-------------------------------------
+	// Near clip
+	//-------------------------------------
+
+	// A camera at the origin looking down z, so camera space z is exactly world z. A point on the near clip is in
+	// front, as PixelFromWorldPt takes it to be, and the next float closer is behind
+	Camera axisCamera({ 0, 0, 0 }, { 0, 0, 0 }, PI / 3, 4.0f / 3.0f, 0.5f, 1000.0f);
+	{
+		float nearClip = axisCamera.NearClip();
+		std::vector<CVector3> points = { { 0, 0, nearClip }, { 0, 0, std::nextafter(nearClip, 0.0f) },
+		                                 { 0, 0, std::nextafter(nearClip, 1.0f) }, { 0, 0, -nearClip }, { 0.1f, 0.1f, nearClip } };
+		ScreenPoints batch;
+		axisCamera.ProjectToScreen(points.data(), static_cast<int>(points.size()), WIDTH, HEIGHT, batch);
+		for (int i = 0; i < static_cast<int>(points.size()); ++i)
+		{
+			CVector3 pixel = axisCamera.PixelFromWorldPt(points[i], WIDTH, HEIGHT);
+			CHECK(batch.z[i] == pixel.z);
+			CHECK(batch.InFront(i) == (pixel.z >= nearClip));
+		}
+		CHECK(batch.InFront(0) && !batch.InFront(1) && batch.InFront(2) && !batch.InFront(3) && batch.InFront(4));
+		CHECK(batch.OnScreen(0) && !batch.OnScreen(1) && batch.OnScreen(2) && !batch.OnScreen(3));
+	}
+
+
+	//-------------------------------------
+	// Viewport edges
+	//-------------------------------------
+
+	// A projection that maps x / z and y / z straight to -1 -> 1, so points with x or y equal to a power of two z land
+	// exactly on the viewport edges. The edges count as on screen, a fraction of a pixel out doesn't
+	{
+		CMatrix4x4 projection = { 1, 0,  0, 0,
+		                          0, 1,  0, 0,
+		                          0, 0,  1, 1,
+		                          0, 0, -1, 0 };
+		const float Z = 4;
+		const float OUT = Z + 1.0f / 1024; // About a sixth of a pixel out
+		std::vector<CVector3> points = { { -Z, 0, Z }, { Z, 0, Z }, { 0, Z, Z }, { 0, -Z, Z }, { -Z, Z, Z }, { Z, -Z, Z },
+		                                 { -OUT, 0, Z }, { OUT, 0, Z }, { 0, OUT, Z }, { 0, -OUT, Z } };
+		ScreenPoints batch;
+		ProjectToScreen(points.data(), static_cast<int>(points.size()), projection, projection, 1.0f, WIDTH, HEIGHT, batch);
+		CHECK(batch.x[0] == 0 && batch.x[1] == WIDTH && batch.y[2] == 0 && batch.y[3] == HEIGHT);
+		for (int i = 0; i < 6; ++i)   CHECK(batch.InFront(i) && batch.OnScreen(i));
+		for (int i = 6; i < 10; ++i)  CHECK(batch.InFront(i) && !batch.OnScreen(i));
+		CHECK(batch.x[6] < 0 && batch.x[7] > WIDTH && batch.y[8] < 0 && batch.y[9] > HEIGHT);
+	}
+
+
+	//-------------------------------------
+	// Shapes
+	//-------------------------------------
+
+	// Quads for AllOffScreen, as runs of four corners, with the axis camera (the view is about 1.15 units across at
+	// distance 1)
+	{
+		std::vector<CVector3> points =
+		{
+			{ -50, -1, 10 }, { -40, -1, 10 }, { -40, 1, 10 }, { -50, 1, 10 }, // 0: in front, all off the left
+			{  40, -1, 10 }, {  50, -1, 10 }, {  50, 1, 10 }, {  40, 1, 10 }, // 4: in front, all off the right
+			{ -50, -1, 10 }, {  50, -1, 10 }, {  50, 1, 10 }, { -50, 1, 10 }, // 8: in front, off both sides so across the view
+			{  -1, -1, -5 }, {   1, -1, -5 }, {   1, 1, -5 }, {  -1, 1, -5 }, // 12: all behind
+			{ -50, -1, 10 }, { -40, -1, 10 }, { -40, 1, -5 }, { -50, 1, -5 }, // 16: off the left but straddling the near clip
+			{  -1, -1, 10 }, {   1, -1, 10 }, {   1, 1, -5 }, {  -1, 1, -5 }, // 20: on screen and straddling the near clip
+			{  -1, 50, 10 }, {   1, 50, 10 }, {   1, 60, 10 }, {  -1, 60, 10 }, // 24: in front, all above
+		};
+		ScreenPoints batch;
+		axisCamera.ProjectToScreen(points.data(), static_cast<int>(points.size()), WIDTH, HEIGHT, batch);
+		CHECK(batch.AllOffScreen(0, 4));
+		CHECK(batch.AllOffScreen(4, 4));
+		CHECK(!batch.AllOffScreen(8, 4));
+		CHECK(batch.AllOffScreen(12, 4));
+		CHECK(!batch.AllOffScreen(16, 4)); // Points behind the camera can project anywhere, so it may still be seen
+		CHECK(!batch.AllOffScreen(20, 4));
+		CHECK(batch.AllOffScreen(24, 4));
+		CHECK(!batch.InFront(18) && batch.InFront(16) && !batch.OnScreen(16));
+	}
+
+	std::printf("ScreenProjectionTest: %d checks failed\n", gNumFailedChecks);
+	return gNumFailedChecks;
+}
@@ -0,0 +1,185 @@
+//--------------------------------------------------------------------------------------
+// Test of reloading shaders when their source changes (ShaderHotReload.h)
+//--------------------------------------------------------------------------------------
+// Runs the watcher over shader files written to a temporary directory, with a stub compiler in place of ReloadShader
+// in Shader.cpp. The stub "compiles" a shader by keeping a copy of its source, and fails if the source contains
+// "error" - leaving the copy it had, as ReloadShader keeps the old shader object.
+
+#include "ShaderHotReload.h"
+#include "Check.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+	// Write a file, moving its modification time on by a second so the change is seen however coarse the file
+	// system's clock is
+	void Save(const std::string& fileName, const std::string& text)
+	{
+		std::error_code error;
+		auto oldTime = std::filesystem::last_write_time(fileName, error);
+		std::ofstream(fileName, std::ios::binary) << text;
+		if (!error)  std::filesystem::last_write_time(fileName, oldTime + std::chrono::seconds(1));
+	}
+
+	std::string Load(const std::string& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	bool Contains(const std::vector<std::string>& names, const std::string& name)
+	{
+		return std::find(names.begin(), names.end(), name) != names.end();
+	}
+
+
+	// Stands in for the GPU compiler, keeping the source of each shader loaded
+	struct StubCompiler
+	{
+		std::map<std::string, std::string> loaded; // Source of the shader in use for each name
+		std::vector<std::string> compiled;          // Every shader compiled, in order, including failures
+
+		ReloadShaderFunction Function()
+		{
+			return [this](const std::string& shaderName, std::string& error)
+			{
+				compiled.push_back(shaderName);
+				std::string source = Load(shaderName + ".hlsl");
+				if (source.find("error") != std::string::npos)
+				{
+					error = "syntax error";
+					return false;
+				}
+				loaded[shaderName] = source;
+				return true;
+			};
+		}
+	};
+}
+
+
+int main()
+{
+	// The watcher uses paths relative to the current directory, as the app does
+	auto directory = std::filesystem::temp_directory_path() / "ShaderHotReloadTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	std::filesystem::current_path(directory);
+
+	// A_pp and C_pp include Common.hlsli, which includes Inner.hlsli. B_pp includes nothing
+	Save("Inner.hlsli",  "static const float inner = 1;\n");
+	Save("Common.hlsli", "#include \"Inner.hlsli\"\n");
+	Save("A_pp.hlsl",    "#include \"Common.hlsli\"\nfloat4 main() : SV_Target { return 0; }\n");
+	Save("B_pp.hlsl",    "float4 main() : SV_Target { return 0; }\n");
+	Save("C_pp.hlsl",    "  #include \"Common.hlsli\"\nfloat4 main() : SV_Target { return 1; }\n");
+
+	std::vector<std::string> includes = ShaderSourceIncludes("A_pp.hlsl");
+	CHECK(includes.size() == 2 && Contains(includes, "Common.hlsli") && Contains(includes, "Inner.hlsli"));
+
+	StubCompiler compiler;
+	ReloadShaderFunction reload = compiler.Function();
+	ShaderHotReload hotReload;
+	for (const char* shader : { "A_pp", "B_pp", "C_pp", "Missing_pp" })
+	{
+		hotReload.Watch(shader);
+		compiler.loaded[shader] = Load(std::string(shader) + ".hlsl");
+	}
+
+
+	// Nothing saved, nothing compiled
+	ShaderSourceChanges changes = hotReload.CheckNow(reload);
+	CHECK(changes.files.empty() && changes.shaders.empty() && !changes.includesChanged);
+	CHECK(compiler.compiled.empty());
+
+	// Saving a shader reloads just that shader
+	Save("B_pp.hlsl", "float4 main() : SV_Target { return 0.5; }\n");
+	changes = hotReload.CheckNow(reload);
+	CHECK(changes.files == std::vector<std::string>{ "B_pp.hlsl" });
+	CHECK(changes.shaders == std::vector<std::string>{ "B_pp" });
+	CHECK(!changes.includesChanged);
+	CHECK(compiler.loaded["B_pp"] == Load("B_pp.hlsl"));
+
+	// Seen once only
+	compiler.compiled.clear();
+	changes = hotReload.CheckNow(reload);
+	CHECK(changes.files.empty() && compiler.compiled.empty());
+
+
+	// Saving an include reloads each shader using it once, including through an include of an include
+	for (const char* include : { "Common.hlsli", "Inner.hlsli" })
+	{
+		compiler.compiled.clear();
+		Save(include, Load(include) + "// Changed\n");
+		changes = hotReload.CheckNow(reload);
+		CHECK(changes.files == std::vector<std::string>{ include });
+		CHECK(changes.includesChanged);
+		CHECK(changes.shaders.size() == 2 && Contains(changes.shaders, "A_pp") && Contains(changes.shaders, "C_pp"));
+		CHECK(compiler.compiled.size() == 2 && !Contains(compiler.compiled, "B_pp"));
+	}
+
+	// Saving a shader and its include together still compiles it once
+	compiler.compiled.clear();
+	Save("A_pp.hlsl", Load("A_pp.hlsl") + "// Changed\n");
+	Save("Common.hlsli", Load("Common.hlsli") + "// Changed again\n");
+	changes = hotReload.CheckNow(reload);
+	CHECK(changes.files.size() == 2);
+	CHECK(std::count(compiler.compiled.begin(), compiler.compiled.end(), "A_pp") == 1);
+
+	// An include added to a shader is watched once the shader has been reloaded
+	Save("Extra.hlsli", "static const float extra = 2;\n");
+	Save("B_pp.hlsl", "#include \"Extra.hlsli\"\nfloat4 main() : SV_Target { return extra; }\n");
+	changes = hotReload.CheckNow(reload);
+	CHECK(changes.shaders == std::vector<std::string>{ "B_pp" });
+	Save("Extra.hlsli", "static const float extra = 3;\n");
+	changes = hotReload.CheckNow(reload);
+	CHECK(changes.shaders == std::vector<std::string>{ "B_pp" });
+
+
+	// A shader that fails to compile keeps the version it had, and the error is reported
+	std::string workingSource = compiler.loaded["C_pp"];
+	int numFailures = hotReload.Stats().numFailures;
+	int numReloads = hotReload.Stats().numReloads;
+	Save("C_pp.hlsl", "float4 main() : SV_Target { error }\n");
+	changes = hotReload.CheckNow(reload);
+	CHECK(changes.files == std::vector<std::string>{ "C_pp.hlsl" });
+	CHECK(changes.shaders.empty());
+	CHECK(compiler.loaded["C_pp"] == workingSource);
+	CHECK(hotReload.Stats().numFailures == numFailures + 1);
+	CHECK(hotReload.Stats().numReloads == numReloads);
+	CHECK(hotReload.Stats().lastError == "C_pp: syntax error");
+
+	// When another shader sharing the include fails the rest are still reloaded
+	compiler.compiled.clear();
+	Save("Inner.hlsli", Load("Inner.hlsli") + "// Changed\n");
+	changes = hotReload.CheckNow(reload);
+	CHECK(changes.shaders == std::vector<std::string>{ "A_pp" });
+	CHECK(compiler.compiled.size() == 2);
+	CHECK(compiler.loaded["C_pp"] == workingSource);
+
+	// Once fixed it is swapped in and the error cleared
+	Save("C_pp.hlsl", "  #include \"Common.hlsli\"\nfloat4 main() : SV_Target { return 2; }\n");
+	changes = hotReload.CheckNow(reload);
+	CHECK(changes.shaders == std::vector<std::string>{ "C_pp" });
+	CHECK(compiler.loaded["C_pp"] == Load("C_pp.hlsl"));
+	CHECK(hotReload.Stats().lastError.empty());
+
+
+	// Update only checks every POLL_INTERVAL
+	Save("B_pp.hlsl", "float4 main() : SV_Target { return 0.25; }\n");
+	changes = hotReload.Update(reload);
+	CHECK(changes.files.empty());
+	changes = hotReload.CheckNow(reload);
+	CHECK(changes.shaders == std::vector<std::string>{ "B_pp" });
+
+	std::filesystem::current_path(directory.parent_path());
+	std::filesystem::remove_all(directory);
+	std::printf("ShaderHotReloadTest: %d checks failed\n", gNumFailedChecks);
+	return gNumFailedChecks;
+}
@@ -0,0 +1,199 @@
+//--------------------------------------------------------------------------------------
+// Test of filtering out redundant pipeline state changes (StateCache.h)
+//--------------------------------------------------------------------------------------
+// Puts a StateFilter in front of a RecordingContext with logging on, and checks which calls reach the context: repeated
+// bindings are dropped, slot ranges are narrowed to the part that changed, and shader resource views are sent again
+// after the render targets change (DirectX unbinds views of textures that become render targets).
+
+#include "StateCache.h"
+#include "RecordingContext.h"
+#include "Check.h"
+
+#include <string>
+#include <vector>
+
+
+namespace
+{
+	// The calls that reached the context since the last call, then clear the log
+	std::vector<std::string> Calls(RecordingContext& context)
+	{
+		std::vector<std::string> calls = context.Log();
+		context.NewFrame();
+		return calls;
+	}
+
+	using Lines = std::vector<std::string>;
+}
+
+
+int main()
+{
+	RecordingContext context;
+	context.SetLogging(true);
+	StateFilter<RecordingApi> filter;
+	filter.SetContext(&context);
+
+	RecordedObject vertexShader { "VS" }, pixelShader { "PS" }, otherPixelShader { "PS2" };
+	RecordedObject noBlending { "NoBlending" }, additive { "Additive" }, depthReadOnly { "DepthReadOnly" };
+	RecordedObject pointSampler { "Point" }, trilinear { "Trilinear" };
+	RecordedObject sceneTexture { "SceneTexture" }, depthTexture { "DepthTexture" }, lut { "Lut" }, noise { "Noise" };
+	RecordedObject sceneTarget { "SceneTarget" }, backBuffer { "BackBuffer" }, depthBuffer { "DepthBuffer" };
+	RecordedObject* null = nullptr;
+
+
+	//-------------------------------------
+	// Repeated bindings
+	//-------------------------------------
+
+	// The first call for each state always gets through, the same call again doesn't
+	filter.VSSetShader(&vertexShader, nullptr, 0);
+	filter.PSSetShader(&pixelShader, nullptr, 0);
+	filter.IASetPrimitiveTopology(RecordedTopology::TriangleStrip);
+	filter.OMSetDepthStencilState(&depthReadOnly, 0);
+	CHECK(Calls(context).size() == 4);
+
+	filter.VSSetShader(&vertexShader, nullptr, 0);
+	filter.PSSetShader(&pixelShader, nullptr, 0);
+	filter.IASetPrimitiveTopology(RecordedTopology::TriangleStrip);
+	filter.OMSetDepthStencilState(&depthReadOnly, 0);
+	CHECK(Calls(context).empty());
+
+	// A different object or setting gets through, including a null object
+	filter.PSSetShader(&otherPixelShader, nullptr, 0);
+	filter.IASetPrimitiveTopology(RecordedTopology::TriangleList);
+	filter.OMSetDepthStencilState(&depthReadOnly, 1);
+	filter.GSSetShader(nullptr, nullptr, 0);
+	filter.GSSetShader(nullptr, nullptr, 0);
+	CHECK((Calls(context) == Lines{ "PSSetShader PS2", "IASetPrimitiveTopology list", "OMSetDepthStencilState DepthReadOnly",
+	                                "GSSetShader null" }));
+
+	// Blend states are told apart by their factor and mask too. A null factor is the same as 1,1,1,1
+	const float ones[4] = { 1, 1, 1, 1 }, halves[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+	filter.OMSetBlendState(&noBlending, nullptr, 0xffffff);
+	filter.OMSetBlendState(&noBlending, ones, 0xffffff);
+	filter.OMSetBlendState(&noBlending, halves, 0xffffff);
+	filter.OMSetBlendState(&noBlending, halves, 0xff);
+	filter.OMSetBlendState(&additive, halves, 0xff);
+	CHECK(Calls(context).size() == 4);
+
+	// Viewports and scissors are compared by value, not by address
+	RecordedViewport viewport = { 0, 0, 1280, 720, 0, 1 };
+	RecordedViewport sameViewport = viewport;
+	RecordedRect scissor = { 10, 20, 110, 220 };
+	filter.RSSetViewports(1, &viewport);
+	filter.RSSetViewports(1, &sameViewport);
+	filter.RSSetScissorRects(1, &scissor);
+	scissor.right = 120;
+	filter.RSSetScissorRects(1, &scissor);
+	CHECK((Calls(context) == Lines{ "RSSetViewports 1280x720", "RSSetScissorRects 10,20 - 110,220", "RSSetScissorRects 10,20 - 120,220" }));
+
+
+	//-------------------------------------
+	// Slot ranges
+	//-------------------------------------
+
+	// Only the part of a range that changed is passed on - from the first changed slot to the last
+	RecordedObject* textures[4] = { &sceneTexture, &depthTexture, &lut, &noise };
+	filter.PSSetShaderResources(0, 4, textures);
+	CHECK((Calls(context) == Lines{ "PSSetShaderResources 0: SceneTexture DepthTexture Lut Noise" }));
+
+	filter.PSSetShaderResources(0, 4, textures);
+	CHECK(Calls(context).empty());
+
+	RecordedObject* changedMiddle[4] = { &sceneTexture, &noise, &lut, &noise };
+	filter.PSSetShaderResources(0, 4, changedMiddle);
+	CHECK((Calls(context) == Lines{ "PSSetShaderResources 1: Noise" }));
+
+	RecordedObject* changedEnds[4] = { &depthTexture, &noise, &lut, &sceneTexture };
+	filter.PSSetShaderResources(0, 4, changedEnds);
+	CHECK((Calls(context) == Lines{ "PSSetShaderResources 0: DepthTexture Noise Lut SceneTexture" }));
+
+	// A range starting part way through, and unbinding with nulls
+	filter.PSSetShaderResources(2, 1, &null);
+	filter.PSSetShaderResources(1, 3, changedEnds + 1);
+	CHECK((Calls(context) == Lines{ "PSSetShaderResources 2: null", "PSSetShaderResources 2: Lut" }));
+
+	// Each kind of state has its own slots
+	RecordedObject* samplers[2] = { &pointSampler, &trilinear };
+	filter.PSSetSamplers(0, 2, samplers);
+	filter.VSSetShaderResources(0, 1, textures);
+	samplers[0] = &trilinear;
+	filter.PSSetSamplers(0, 2, samplers);
+	CHECK((Calls(context) == Lines{ "PSSetSamplers 0: Point Trilinear", "VSSetShaderResources 0: SceneTexture", "PSSetSamplers 0: Trilinear" }));
+
+	// Slots past those tracked are always passed on
+	filter.PSSetShaderResources(MAX_STATE_SLOTS, 1, textures);
+	filter.PSSetShaderResources(MAX_STATE_SLOTS, 1, textures);
+	CHECK(Calls(context).size() == 2);
+
+
+	//-------------------------------------
+	// Render targets
+	//-------------------------------------
+
+	// Binding render targets forgets the views bound, so the same views are sent again afterwards
+	RecordedObject* sceneTargets[1] = { &sceneTarget };
+	RecordedObject* backBuffers[1] = { &backBuffer };
+	filter.OMSetRenderTargets(1, sceneTargets, &depthBuffer);
+	filter.PSSetShaderResources(0, 1, textures);
+	filter.VSSetShaderResources(0, 1, textures);
+	CHECK((Calls(context) == Lines{ "OMSetRenderTargets SceneTarget depth DepthBuffer", "PSSetShaderResources 0: SceneTexture",
+	                                "VSSetShaderResources 0: SceneTexture" }));
+
+	// The same render targets again are dropped, and leave the views known
+	filter.OMSetRenderTargets(1, sceneTargets, &depthBuffer);
+	filter.PSSetShaderResources(0, 1, textures);
+	CHECK(Calls(context).empty());
+
+	// A different depth buffer counts as a change
+	filter.OMSetRenderTargets(1, sceneTargets, nullptr);
+	filter.PSSetShaderResources(0, 1, textures);
+	CHECK(Calls(context).size() == 2);
+
+	// Other state is kept across render target changes
+	filter.OMSetRenderTargets(1, backBuffers, nullptr);
+	filter.PSSetShader(&otherPixelShader, nullptr, 0);
+	filter.PSSetSamplers(0, 2, samplers);
+	filter.PSSetShaderResources(0, 1, textures);
+	CHECK((Calls(context) == Lines{ "OMSetRenderTargets BackBuffer depth null", "PSSetShaderResources 0: SceneTexture" }));
+
+
+	//-------------------------------------
+	// Forgetting state and counting
+	//-------------------------------------
+
+	// State changed outside the filter (e.g. by Model::Render) must be forgotten for the next call to get through
+	filter.Invalidate(StateKind::PixelShader);
+	filter.PSSetShader(&otherPixelShader, nullptr, 0);
+	filter.VSSetShader(&vertexShader, nullptr, 0);
+	CHECK((Calls(context) == Lines{ "PSSetShader PS2" }));
+
+	// Calls issued and skipped are counted for each kind of state, and a new frame forgets everything
+	filter.NewFrame();
+	filter.VSSetShader(&vertexShader, nullptr, 0);
+	filter.VSSetShader(&vertexShader, nullptr, 0);
+	filter.VSSetShader(&vertexShader, nullptr, 0);
+	filter.PSSetShaderResources(0, 4, textures);
+	filter.PSSetShaderResources(0, 4, changedMiddle);
+	filter.PSSetShaderResources(0, 4, changedMiddle);
+	const StateFilterStats& stats = filter.Cache().FrameStats();
+	CHECK(stats.issued[static_cast<int>(StateKind::VertexShader)] == 1);
+	CHECK(stats.skipped[static_cast<int>(StateKind::VertexShader)] == 2);
+	CHECK(stats.issued[static_cast<int>(StateKind::PSResource)] == 2);
+	CHECK(stats.skipped[static_cast<int>(StateKind::PSResource)] == 1);
+	CHECK(stats.TotalIssued() == 3 && stats.TotalSkipped() == 3);
+	CHECK(context.Frame().TotalStateCalls() == stats.TotalIssued());
+	Calls(context);
+
+	filter.NewFrame();
+	CHECK(filter.Cache().LastFrameStats().TotalIssued() == 3 && filter.Cache().FrameStats().TotalIssued() == 0);
+
+	// Changing the context forgets everything too
+	filter.SetContext(&context);
+	filter.VSSetShader(&vertexShader, nullptr, 0);
+	CHECK(Calls(context).size() == 1);
+
+	std::printf("StateFilterTest: %d checks failed\n", gNumFailedChecks);
+	return gNumFailedChecks;
+}
@@ -0,0 +1,372 @@
+//--------------------------------------------------------------------------------------
+// Test of decoding .dds files and loading textures in the background (TextureLoader.h)
+//--------------------------------------------------------------------------------------
+// The .dds files are built in memory: every format DecodeDDSTexture supports, the layout of their mip levels, and the
+// files it must turn down so that Texture.cpp falls back to loading them the old way (cube maps, volumes, arrays,
+// other formats) or reports them as broken. Then a set of files is written out and loaded on the thread pool.
+
+#include "TextureLoader.h"
+#include "Check.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+	//-------------------------------------
+	// Building .dds files
+	//-------------------------------------
+
+	constexpr uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+	}
+
+	// Fields of the 124 byte header that follows the "DDS " magic number, as offsets in 32-bit words
+	const int SIZE = 0, FLAGS = 1, HEIGHT = 2, WIDTH = 3, DEPTH = 5, MIP_COUNT = 6;
+	const int PF_SIZE = 18, PF_FLAGS = 19, PF_FOURCC = 20, PF_BIT_COUNT = 21, PF_R_MASK = 22, PF_G_MASK = 23, PF_B_MASK = 24, PF_A_MASK = 25;
+	const int CAPS2 = 27;
+	const int HEADER_WORDS = 31;
+
+	// Fields of the DX10 header
+	const int DX10_FORMAT = 0, DX10_DIMENSION = 1, DX10_MISC_FLAG = 2, DX10_ARRAY_SIZE = 3;
+
+	const uint32_t DDS_FOURCC = 0x4, DDS_RGB = 0x40, DDS_ALPHA_PIXELS = 0x1;
+	const uint32_t DDS_HEADER_DEPTH = 0x800000, DDS_CUBEMAP = 0x200;
+	const uint32_t DIMENSION_2D = 3, DIMENSION_3D = 4, MISC_TEXTURECUBE = 0x4;
+
+	// Header size with and without the DX10 header, including the magic number
+	const size_t LEGACY_DATA_START = 4 + HEADER_WORDS * 4;
+	const size_t DX10_DATA_START = LEGACY_DATA_START + 5 * 4;
+
+
+	struct DDSFile
+	{
+		uint32_t header[HEADER_WORDS] = {};
+		bool     dx10 = false;
+		uint32_t headerDX10[5] = {};
+		size_t   dataBytes = 0; // Bytes of pixel data after the headers, filled with a pattern
+
+		std::vector<uint8_t> Bytes() const
+		{
+			std::vector<uint8_t> bytes(4);
+			std::memcpy(bytes.data(), "DDS ", 4);
+			auto append = [&](const uint32_t* words, int numWords)
+			{
+				size_t start = bytes.size();
+				bytes.resize(start + numWords * 4);
+				std::memcpy(bytes.data() + start, words, numWords * 4);
+			};
+			append(header, HEADER_WORDS);
+			if (dx10)  append(headerDX10, 5);
+			for (size_t b = 0; b < dataBytes; ++b)  bytes.push_back(static_cast<uint8_t>(b * 7 + 3));
+			return bytes;
+		}
+	};
+
+	DDSFile BaseDDS(uint32_t width, uint32_t height, uint32_t numMips, size_t dataBytes)
+	{
+		DDSFile file;
+		file.header[SIZE] = HEADER_WORDS * 4;
+		file.header[FLAGS] = 0x1007; // Caps, height, width, pixel format
+		file.header[WIDTH] = width;
+		file.header[HEIGHT] = height;
+		file.header[MIP_COUNT] = numMips;
+		file.header[PF_SIZE] = 32;
+		file.dataBytes = dataBytes;
+		return file;
+	}
+
+	DDSFile FourCCDDS(uint32_t fourCC, uint32_t width, uint32_t height, uint32_t numMips, size_t dataBytes)
+	{
+		DDSFile file = BaseDDS(width, height, numMips, dataBytes);
+		file.header[PF_FLAGS] = DDS_FOURCC;
+		file.header[PF_FOURCC] = fourCC;
+		return file;
+	}
+
+	DDSFile RGBDDS(uint32_t bitCount, uint32_t rMask, uint32_t gMask, uint32_t bMask, uint32_t aMask,
+	               uint32_t width, uint32_t height, size_t dataBytes)
+	{
+		DDSFile file = BaseDDS(width, height, 1, dataBytes);
+		file.header[PF_FLAGS] = DDS_RGB | (aMask != 0 ? DDS_ALPHA_PIXELS : 0);
+		file.header[PF_BIT_COUNT] = bitCount;
+		file.header[PF_R_MASK] = rMask;
+		file.header[PF_G_MASK] = gMask;
+		file.header[PF_B_MASK] = bMask;
+		file.header[PF_A_MASK] = aMask;
+		return file;
+	}
+
+	DDSFile DX10DDS(uint32_t dxgiFormat, uint32_t width, uint32_t height, uint32_t numMips, size_t dataBytes)
+	{
+		DDSFile file = FourCCDDS(FourCC('D', 'X', '1', '0'), width, height, numMips, dataBytes);
+		file.dx10 = true;
+		file.headerDX10[DX10_FORMAT] = dxgiFormat;
+		file.headerDX10[DX10_DIMENSION] = DIMENSION_2D;
+		file.headerDX10[DX10_ARRAY_SIZE] = 1;
+		return file;
+	}
+
+
+	//-------------------------------------
+	// Checking
+	//-------------------------------------
+
+	// Decode a file that should be supported, checking it has a single level of the given format and size
+	bool DecodesAs(const DDSFile& file, TextureFormat format, bool srgb, uint32_t width, uint32_t height)
+	{
+		DecodedTexture texture;
+		std::string error;
+		if (!DecodeDDSTexture(file.Bytes(), texture, error))  return false;
+		return texture.format == format && texture.srgb == srgb && texture.Width() == width && texture.Height() == height &&
+		       !texture.generateMips && error.empty();
+	}
+
+	// Decode a file that should be turned down, checking an error is given and nothing is left in the texture
+	bool IsRejected(const std::vector<uint8_t>& bytes, const char* expectedError)
+	{
+		DecodedTexture texture;
+		texture.mips.resize(1);
+		std::string error;
+		if (DecodeDDSTexture(bytes, texture, error))  return false;
+		return error == expectedError && texture.mips.empty() && texture.data.empty();
+	}
+
+
+	bool DecodeDDSFile(const std::string& fileName, DecodedTexture& texture, std::string& error)
+	{
+		std::vector<uint8_t> file;
+		if (!ReadFileBytes(fileName, file))
+		{
+			error = "couldn't read file";
+			return false;
+		}
+		return DecodeDDSTexture(file, texture, error);
+	}
+}
+
+
+int main()
+{
+	//-------------------------------------
+	// Formats
+	//-------------------------------------
+
+	// Legacy block compressed files, by fourCC (DXT2 and DXT4 are the premultiplied alpha versions of DXT3 and DXT5)
+	struct LegacyFormat { uint32_t fourCC; TextureFormat format; };
+	const LegacyFormat legacyFormats[] =
+	{
+		{ FourCC('D', 'X', 'T', '1'), TextureFormat::BC1 },
+		{ FourCC('D', 'X', 'T', '2'), TextureFormat::BC2 },
+		{ FourCC('D', 'X', 'T', '3'), TextureFormat::BC2 },
+		{ FourCC('D', 'X', 'T', '4'), TextureFormat::BC3 },
+		{ FourCC('D', 'X', 'T', '5'), TextureFormat::BC3 },
+		{ FourCC('A', 'T', 'I', '1'), TextureFormat::BC4 },
+		{ FourCC('B', 'C', '4', 'U'), TextureFormat::BC4 },
+		{ FourCC('A', 'T', 'I', '2'), TextureFormat::BC5 },
+		{ FourCC('B', 'C', '5', 'U'), TextureFormat::BC5 },
+	};
+	for (auto& legacy : legacyFormats)
+	{
+		size_t bytes = 4 * TextureFormatBlockBytes(legacy.format); // 8x8 is 2x2 blocks
+		CHECK(DecodesAs(FourCCDDS(legacy.fourCC, 8, 8, 1, bytes), legacy.format, false, 8, 8));
+	}
+
+	// Legacy uncompressed files, in either channel order
+	CHECK(DecodesAs(RGBDDS(32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000, 4, 2, 32), TextureFormat::RGBA8, false, 4, 2));
+	CHECK(DecodesAs(RGBDDS(32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000, 4, 2, 32), TextureFormat::BGRA8, false, 4, 2));
+
+	// DX10 files, by DXGI_FORMAT
+	struct DX10Format { uint32_t dxgiFormat; TextureFormat format; bool srgb; };
+	const DX10Format dx10Formats[] =
+	{
+		{ 28, TextureFormat::RGBA8, false }, { 29, TextureFormat::RGBA8, true },
+		{ 87, TextureFormat::BGRA8, false }, { 91, TextureFormat::BGRA8, true },
+		{ 71, TextureFormat::BC1,   false }, { 72, TextureFormat::BC1,   true },
+		{ 74, TextureFormat::BC2,   false }, { 75, TextureFormat::BC2,   true },
+		{ 77, TextureFormat::BC3,   false }, { 78, TextureFormat::BC3,   true },
+		{ 80, TextureFormat::BC4,   false },
+		{ 83, TextureFormat::BC5,   false },
+		{ 98, TextureFormat::BC7,   false }, { 99, TextureFormat::BC7,   true },
+	};
+	for (auto& dx10 : dx10Formats)
+	{
+		int blockBytes = TextureFormatBlockBytes(dx10.format);
+		size_t bytes = blockBytes > 0 ? 4 * blockBytes : 8 * 8 * 4;
+		CHECK(DecodesAs(DX10DDS(dx10.dxgiFormat, 8, 8, 1, bytes), dx10.format, dx10.srgb, 8, 8));
+	}
+
+
+	//-------------------------------------
+	// Mip levels
+	//-------------------------------------
+
+	// BC1 8x8 with a full chain - 2x2 blocks then one block for each of 4x4, 2x2 and 1x1
+	{
+		std::vector<uint8_t> bytes = FourCCDDS(FourCC('D', 'X', 'T', '1'), 8, 8, 4, 56).Bytes();
+		DecodedTexture texture;
+		std::string error;
+		CHECK(DecodeDDSTexture(bytes, texture, error));
+		CHECK(texture.mips.size() == 4);
+		if (texture.mips.size() == 4)
+		{
+			const size_t   offsets[]   = { 0, 32, 40, 48 };
+			const uint32_t sizes[]     = { 8, 4, 2, 1 };
+			const uint32_t rowPitches[] = { 16, 8, 8, 8 };
+			for (int mip = 0; mip < 4; ++mip)
+			{
+				CHECK(texture.mips[mip].offset == offsets[mip]);
+				CHECK(texture.mips[mip].width == sizes[mip] && texture.mips[mip].height == sizes[mip]);
+				CHECK(texture.mips[mip].rowPitch == rowPitches[mip]);
+			}
+			CHECK(texture.mips[0].slicePitch == 32 && texture.mips[3].slicePitch == 8);
+		}
+		CHECK(texture.data.size() == 56);
+		CHECK(texture.data == std::vector<uint8_t>(bytes.begin() + LEGACY_DATA_START, bytes.end()));
+	}
+
+	// Uncompressed, not square - 4x2 then 2x1
+	{
+		std::vector<uint8_t> bytes = DX10DDS(28, 4, 2, 2, 40).Bytes();
+		DecodedTexture texture;
+		std::string error;
+		CHECK(DecodeDDSTexture(bytes, texture, error));
+		CHECK(texture.mips.size() == 2);
+		if (texture.mips.size() == 2)
+		{
+			CHECK(texture.mips[0].rowPitch == 16 && texture.mips[0].slicePitch == 32);
+			CHECK(texture.mips[1].offset == 32 && texture.mips[1].width == 2 && texture.mips[1].height == 1);
+			CHECK(texture.mips[1].rowPitch == 8 && texture.mips[1].slicePitch == 8);
+		}
+		CHECK(texture.data == std::vector<uint8_t>(bytes.begin() + DX10_DATA_START, bytes.end()));
+	}
+
+	// Sizes that aren't a multiple of 4 take whole blocks, a mip count of 0 means one level, and data after the last
+	// level is ignored
+	{
+		DecodedTexture texture;
+		std::string error;
+		CHECK(DecodeDDSTexture(FourCCDDS(FourCC('D', 'X', 'T', '5'), 5, 3, 0, 32 + 10).Bytes(), texture, error));
+		CHECK(texture.mips.size() == 1);
+		if (texture.mips.size() == 1)  CHECK(texture.mips[0].rowPitch == 32 && texture.mips[0].slicePitch == 32);
+		CHECK(texture.data.size() == 32);
+	}
+
+
+	//-------------------------------------
+	// Files turned down
+	//-------------------------------------
+
+	// Not a .dds file or a broken one
+	std::vector<uint8_t> valid = FourCCDDS(FourCC('D', 'X', 'T', '1'), 8, 8, 1, 32).Bytes();
+	CHECK(IsRejected({}, "file too small for a DDS header"));
+	CHECK(IsRejected(std::vector<uint8_t>(valid.begin(), valid.begin() + 100), "file too small for a DDS header"));
+	std::vector<uint8_t> badMagic = valid;
+	badMagic[0] = 'X';
+	CHECK(IsRejected(badMagic, "not a DDS file"));
+	DDSFile badHeader = FourCCDDS(FourCC('D', 'X', 'T', '1'), 8, 8, 1, 32);
+	badHeader.header[SIZE] = 120;
+	CHECK(IsRejected(badHeader.Bytes(), "not a DDS file"));
+	CHECK(IsRejected(FourCCDDS(FourCC('D', 'X', 'T', '1'), 0, 8, 1, 32).Bytes(), "not a DDS file"));
+
+	// Truncated pixel data or DX10 header
+	CHECK(IsRejected(std::vector<uint8_t>(valid.begin(), valid.end() - 1), "DDS file is truncated"));
+	CHECK(IsRejected(FourCCDDS(FourCC('D', 'X', 'T', '1'), 8, 8, 4, 55).Bytes(), "DDS file is truncated"));
+	std::vector<uint8_t> dx10Bytes = DX10DDS(71, 8, 8, 1, 0).Bytes();
+	CHECK(IsRejected(std::vector<uint8_t>(dx10Bytes.begin(), dx10Bytes.begin() + LEGACY_DATA_START + 8), "file too small for a DDS DX10 header"));
+
+	// Formats and layouts loaded the old way instead (see UploadLoadedTextures in Texture.cpp)
+	const char* UNSUPPORTED = "unsupported DDS format";
+	CHECK(IsRejected(FourCCDDS(113, 8, 8, 1, 512).Bytes(), UNSUPPORTED));                        // D3DFMT_A16B16G16R16F
+	CHECK(IsRejected(FourCCDDS(FourCC('A', 'T', 'C', ' '), 8, 8, 1, 32).Bytes(), UNSUPPORTED));   // Unknown fourCC
+	CHECK(IsRejected(RGBDDS(24, 0xff0000, 0x00ff00, 0x0000ff, 0, 4, 4, 48).Bytes(), UNSUPPORTED)); // 24-bit RGB
+	CHECK(IsRejected(RGBDDS(32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0, 4, 4, 64).Bytes(), UNSUPPORTED)); // No alpha (X8R8G8B8)
+	CHECK(IsRejected(RGBDDS(16, 0xf800, 0x07e0, 0x001f, 0, 4, 4, 32).Bytes(), UNSUPPORTED));      // R5G6B5
+
+	DDSFile cube = FourCCDDS(FourCC('D', 'X', 'T', '1'), 8, 8, 1, 6 * 32);
+	cube.header[CAPS2] = DDS_CUBEMAP | 0xfc00; // All six faces
+	CHECK(IsRejected(cube.Bytes(), UNSUPPORTED));
+
+	DDSFile volume = FourCCDDS(FourCC('D', 'X', 'T', '1'), 8, 8, 1, 4 * 32);
+	volume.header[FLAGS] |= DDS_HEADER_DEPTH;
+	volume.header[DEPTH] = 4;
+	CHECK(IsRejected(volume.Bytes(), UNSUPPORTED));
+
+	DDSFile dx10Cube = DX10DDS(71, 8, 8, 1, 6 * 32);
+	dx10Cube.headerDX10[DX10_MISC_FLAG] = MISC_TEXTURECUBE;
+	CHECK(IsRejected(dx10Cube.Bytes(), UNSUPPORTED));
+
+	DDSFile dx10Array = DX10DDS(71, 8, 8, 1, 3 * 32);
+	dx10Array.headerDX10[DX10_ARRAY_SIZE] = 3;
+	CHECK(IsRejected(dx10Array.Bytes(), UNSUPPORTED));
+
+	DDSFile dx10Volume = DX10DDS(71, 8, 8, 1, 4 * 32);
+	dx10Volume.headerDX10[DX10_DIMENSION] = DIMENSION_3D;
+	CHECK(IsRejected(dx10Volume.Bytes(), UNSUPPORTED));
+
+	CHECK(IsRejected(DX10DDS(10, 8, 8, 1, 512).Bytes(), UNSUPPORTED)); // DXGI_FORMAT_R16G16B16A16_FLOAT
+	CHECK(IsRejected(DX10DDS(95, 8, 8, 1, 64).Bytes(),  UNSUPPORTED)); // DXGI_FORMAT_BC6H_UF16
+
+
+	//-------------------------------------
+	// Background loading
+	//-------------------------------------
+
+	// Write out a set of files, one of them broken, and load them on the thread pool
+	auto directory = std::filesystem::temp_directory_path() / "TextureLoaderTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	const int NUM_FILES = 16;
+	const size_t LEVEL_BYTES = 256 * 256 * 4;
+	std::vector<std::string> fileNames;
+	for (int f = 0; f < NUM_FILES; ++f)
+	{
+		std::vector<uint8_t> bytes = DX10DDS(28, 256, 256, 1, LEVEL_BYTES).Bytes();
+		if (f == 5)  bytes.resize(bytes.size() / 2);
+		fileNames.push_back((directory / ("Texture" + std::to_string(f) + ".dds")).string());
+		std::ofstream(fileNames.back(), std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	}
+	fileNames.push_back((directory / "Missing.dds").string());
+	int numFiles = static_cast<int>(fileNames.size());
+
+	{
+		AsyncTextureLoader loader;
+		for (int f = 0; f < numFiles; ++f)  CHECK(loader.Load(fileNames[f], DecodeDDSFile) == f);
+		CHECK(loader.NumPending() == numFiles);
+		loader.Wait();
+
+		std::vector<int> uploaded(numFiles, 0);
+		int numUploaded = loader.Upload([&](DecodedTextureFile& file)
+		{
+			CHECK(file.id >= 0 && file.id < numFiles && file.fileName == fileNames[file.id]);
+			uploaded[file.id]++;
+			bool shouldDecode = (file.id != 5 && file.id != NUM_FILES);
+			CHECK(file.decoded == shouldDecode);
+			if (shouldDecode)  CHECK(file.texture.Width() == 256 && file.texture.data.size() == LEVEL_BYTES);
+			else               CHECK(!file.error.empty());
+		});
+		CHECK(numUploaded == numFiles);
+		CHECK(uploaded == std::vector<int>(numFiles, 1));
+		CHECK(loader.NumPending() == 0);
+		CHECK(loader.Upload([](DecodedTextureFile&) {}) == 0);
+
+		const std::vector<TextureLoadEvent>& trace = loader.Trace();
+		CHECK(static_cast<int>(trace.size()) == numFiles);
+		for (int f = 0; f < static_cast<int>(trace.size()); ++f)
+		{
+			CHECK(trace[f].done && trace[f].failed == (f == 5 || f == NUM_FILES));
+			CHECK(trace[f].queuedMs <= trace[f].decodeStartMs && trace[f].decodeStartMs <= trace[f].decodeEndMs &&
+			      trace[f].decodeEndMs <= trace[f].uploadedMs);
+		}
+	}
+
+	std::filesystem::remove_all(directory);
+	std::printf("TextureLoaderTest: %d checks failed\n", gNumFailedChecks);
+	return gNumFailedChecks;
+}
@@ -0,0 +1,276 @@
+//--------------------------------------------------------------------------------------
+// Loading GPU textures in the background
+//--------------------------------------------------------------------------------------
+
+#include "Texture.h"
+#include "Common.h"
+#include "GraphicsHelpers.h" // LoadTexture
+#include <wincodec.h>
+#include <filesystem>
+#include <map>
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+//**** Update Texture.h if you add things here ****//
+
+AsyncTextureLoader       gTextureLoader;
+std::vector<std::string> gTextureLoadErrors;
+
+
+namespace
+{
+	// Where to put a texture that is loading, by its id in gTextureLoader
+	struct TextureSlot
+	{
+		std::string                fileName;
+		ID3D11Resource**           texture;
+		ID3D11ShaderResourceView** textureSRV;
+	};
+	std::map<int, TextureSlot> gTextureSlots;
+
+	// Put in each slot until its texture arrives. Each slot holds its own reference
+	ID3D11Texture2D*          gPlaceholderTexture    = nullptr;
+	ID3D11ShaderResourceView* gPlaceholderTextureSRV = nullptr;
+
+
+	bool IsDDSFile(const std::string& fileName)
+	{
+		std::string extension = std::filesystem::path(fileName).extension().string();
+		return extension == ".dds" || extension == ".DDS";
+	}
+
+	DXGI_FORMAT GetDXGIFormat(TextureFormat format, bool srgb)
+	{
+		switch (format)
+		{
+			case TextureFormat::RGBA8:  return srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+			case TextureFormat::BGRA8:  return srgb ? DXGI_FORMAT_B8G8R8A8_UNORM_SRGB : DXGI_FORMAT_B8G8R8A8_UNORM;
+			case TextureFormat::BC1:    return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+			case TextureFormat::BC2:    return srgb ? DXGI_FORMAT_BC2_UNORM_SRGB : DXGI_FORMAT_BC2_UNORM;
+			case TextureFormat::BC3:    return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+			case TextureFormat::BC4:    return DXGI_FORMAT_BC4_UNORM;
+			case TextureFormat::BC5:    return DXGI_FORMAT_BC5_UNORM;
+			case TextureFormat::BC7:    return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+			default:                    return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+
+	// Decode an image file with WIC to 32-bit RGBA (top mip level only)
+	bool DecodeWICTexture(const std::string& fileName, DecodedTexture& texture, std::string& error)
+	{
+		// WIC needs COM initialised on each thread that uses it. The workers are initialised the first time they get here
+		// and left that way. If a thread has already initialised COM differently (e.g. the main thread) it can still be used
+		static thread_local bool comInitialised = false;
+		if (!comInitialised)
+		{
+			HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+			if (FAILED(result) && result != RPC_E_CHANGED_MODE)
+			{
+				error = "couldn't initialise COM";
+				return false;
+			}
+			comInitialised = true;
+		}
+
+		IWICImagingFactory*    factory   = nullptr;
+		IWICBitmapDecoder*     decoder   = nullptr;
+		IWICBitmapFrameDecode* frame     = nullptr;
+		IWICFormatConverter*   converter = nullptr;
+		auto release = [&]()
+		{
+			if (converter)  converter->Release();
+			if (frame)      frame->Release();
+			if (decoder)    decoder->Release();
+			if (factory)    factory->Release();
+		};
+
+		std::wstring wideFileName = std::filesystem::path(fileName).wstring();
+		if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))) ||
+		    FAILED(factory->CreateDecoderFromFilename(wideFileName.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder)) ||
+		    FAILED(decoder->GetFrame(0, &frame)))
+		{
+			release();
+			error = "couldn't open image";
+			return false;
+		}
+
+		UINT width, height;
+		if (FAILED(frame->GetSize(&width, &height)) || width == 0 || height == 0 ||
+		    FAILED(factory->CreateFormatConverter(&converter)) ||
+		    FAILED(converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)))
+		{
+			release();
+			error = "couldn't convert image to RGBA";
+			return false;
+		}
+
+		TextureMip level = { 0, width, height, width * 4, width * height * 4 };
+		texture.format = TextureFormat::RGBA8;
+		texture.generateMips = true;
+		texture.mips.push_back(level);
+		texture.data.resize(level.slicePitch);
+		HRESULT result = converter->CopyPixels(nullptr, level.rowPitch, level.slicePitch, texture.data.data());
+		release();
+		if (FAILED(result))
+		{
+			texture = DecodedTexture();
+			error = "couldn't decode image";
+			return false;
+		}
+		return true;
+	}
+
+
+	// Create the 1x1 mid-grey texture used while textures load
+	bool CreatePlaceholderTexture()
+	{
+		const uint32_t grey = 0xff808080;
+
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = 1;
+		textureDesc.Height = 1;
+		textureDesc.MipLevels = 1;
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.SampleDesc.Quality = 0;
+		textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		D3D11_SUBRESOURCE_DATA initialData = { &grey, 4, 4 };
+		if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, &initialData, &gPlaceholderTexture)))  return false;
+		if (FAILED(gD3DDevice->CreateShaderResourceView(gPlaceholderTexture, nullptr, &gPlaceholderTextureSRV)))
+		{
+			gPlaceholderTexture->Release();
+			gPlaceholderTexture = nullptr;
+			return false;
+		}
+		return true;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Texture loading functions
+//--------------------------------------------------------------------------------------
+
+// Decode a texture file into pixels ready for upload - .dds files directly, other formats using WIC
+bool DecodeTextureFile(const std::string& fileName, DecodedTexture& texture, std::string& error)
+{
+	if (!IsDDSFile(fileName))  return DecodeWICTexture(fileName, texture, error);
+
+	std::vector<uint8_t> file;
+	if (!ReadFileBytes(fileName, file))
+	{
+		error = "couldn't read file";
+		return false;
+	}
+	return DecodeDDSTexture(file, texture, error);
+}
+
+
+// Create a GPU texture and shader resource view from decoded pixels
+bool CreateTextureFromDecoded(const DecodedTexture& decoded, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV)
+{
+	if (decoded.mips.empty())  return false;
+
+	// Textures without mip levels get a full chain generated on the GPU, which needs them to be render targets
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = decoded.Width();
+	textureDesc.Height = decoded.Height();
+	textureDesc.MipLevels = decoded.generateMips ? 0 : static_cast<UINT>(decoded.mips.size());
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = GetDXGIFormat(decoded.format, decoded.srgb);
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | (decoded.generateMips ? D3D11_BIND_RENDER_TARGET : 0);
+	textureDesc.MiscFlags = decoded.generateMips ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+	for (auto& mip : decoded.mips)
+	{
+		initialData.push_back({ decoded.data.data() + mip.offset, mip.rowPitch, mip.slicePitch });
+	}
+
+	ID3D11Texture2D* texture2D = nullptr;
+	if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, decoded.generateMips ? nullptr : initialData.data(), &texture2D)))  return false;
+	if (FAILED(gD3DDevice->CreateShaderResourceView(texture2D, nullptr, textureSRV)))
+	{
+		texture2D->Release();
+		return false;
+	}
+
+	if (decoded.generateMips)
+	{
+		gD3DContext->UpdateSubresource(texture2D, 0, nullptr, initialData[0].pSysMem, initialData[0].SysMemPitch, initialData[0].SysMemSlicePitch);
+		gD3DContext->GenerateMips(*textureSRV);
+	}
+	*texture = texture2D;
+	return true;
+}
+
+
+// Start loading a texture in the background, the pointers are set to the placeholder until it arrives
+bool LoadTextureAsync(const std::string& fileName, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV)
+{
+	// Missing files are still reported straight away, as LoadTexture did
+	std::error_code error;
+	if (!std::filesystem::exists(fileName, error))  return false;
+	if (gPlaceholderTexture == nullptr && !CreatePlaceholderTexture())  return false;
+
+	gPlaceholderTexture->AddRef();
+	gPlaceholderTextureSRV->AddRef();
+	*texture = gPlaceholderTexture;
+	*textureSRV = gPlaceholderTextureSRV;
+
+	int id = gTextureLoader.Load(fileName, DecodeTextureFile);
+	gTextureSlots[id] = { fileName, texture, textureSRV };
+	return true;
+}
+
+
+// Upload textures that have finished decoding and put them in place of the placeholder
+int UploadLoadedTextures()
+{
+	return gTextureLoader.Upload([](DecodedTextureFile& file)
+	{
+		auto slot = gTextureSlots.find(file.id);
+		if (slot == gTextureSlots.end())  return;
+
+		ID3D11Resource* texture = nullptr;
+		ID3D11ShaderResourceView* textureSRV = nullptr;
+		bool created = file.decoded && CreateTextureFromDecoded(file.texture, &texture, &textureSRV);
+
+		// DDS formats not handled by DecodeDDSTexture (e.g. cube maps or floating point) are loaded the old way
+		if (!file.decoded && IsDDSFile(file.fileName))  created = LoadTexture(file.fileName, &texture, &textureSRV);
+
+		if (created)
+		{
+			(*slot->second.texture)->Release();
+			(*slot->second.textureSRV)->Release();
+			*slot->second.texture = texture;
+			*slot->second.textureSRV = textureSRV;
+		}
+		else
+		{
+			gTextureLoadErrors.push_back(file.fileName + ": " + (file.decoded ? "couldn't create texture" : file.error));
+		}
+		gTextureSlots.erase(slot);
+	});
+}
+
+
+// Wait for textures still decoding and discard them, then release the placeholder
+void ReleaseTextureLoader()
+{
+	gTextureLoader.Wait();
+	gTextureSlots.clear();
+	gTextureLoader.Upload([](DecodedTextureFile&) {});
+
+	if (gPlaceholderTextureSRV)  gPlaceholderTextureSRV->Release();
+	if (gPlaceholderTexture)     gPlaceholderTexture->Release();
+	gPlaceholderTextureSRV = nullptr;
+	gPlaceholderTexture = nullptr;
+}
@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------
+// Loading GPU textures in the background
+//--------------------------------------------------------------------------------------
+// GPU side of the texture loader (see TextureLoader.h). Files are decoded on the thread pool - .dds files by
+// DecodeDDSTexture, other formats with WIC - and uploaded on the render thread by UploadLoadedTextures. Until then each
+// texture slot holds a shared 1x1 grey placeholder, so nothing using the slot needs to check whether it has loaded.
+#ifndef _TEXTURE_H_INCLUDED_
+#define _TEXTURE_H_INCLUDED_
+
+#include "TextureLoader.h"
+#include <d3d11.h>
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+extern AsyncTextureLoader       gTextureLoader;
+extern std::vector<std::string> gTextureLoadErrors; // Files that couldn't be loaded, they keep the placeholder
+
+
+//--------------------------------------------------------------------------------------
+// Texture loading functions
+//--------------------------------------------------------------------------------------
+
+// Decode a texture file into pixels ready for upload - .dds files directly, other formats using WIC (PNG, JPEG, BMP etc.).
+// Can be called on any thread. Returns false with a message in error on failure
+bool DecodeTextureFile(const std::string& fileName, DecodedTexture& texture, std::string& error);
+
+// Create a GPU texture and shader resource view from decoded pixels. Call on the render thread. Returns false on failure
+bool CreateTextureFromDecoded(const DecodedTexture& decoded, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
+
+// Start loading a texture in the background. The pointers are set to the placeholder straight away, and changed to the
+// real texture by UploadLoadedTextures when it has decoded - so they must stay valid until then (globals are used).
+// Returns false if the file doesn't exist or the placeholder can't be created, otherwise the texture will be released
+// by the caller as with LoadTexture
+bool LoadTextureAsync(const std::string& fileName, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
+
+// Upload textures that have finished decoding and put them in place of the placeholder. Call on the render thread,
+// e.g. at the start of each frame. Returns the number of textures uploaded
+int UploadLoadedTextures();
+
+// Wait for textures still decoding and discard them, leaving the placeholder in their slots, then release the
+// placeholder. Call before releasing the textures loaded
+void ReleaseTextureLoader();
+
+
+#endif //_TEXTURE_H_INCLUDED_
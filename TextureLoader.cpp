@@ -0,0 +1,371 @@
+//--------------------------------------------------------------------------------------
+// Loading textures in the background
+//--------------------------------------------------------------------------------------
+
+#include "TextureLoader.h"
+#include "FrameTrace.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+
+//--------------------------------------------------------------------------------------
+// Decoded textures
+//--------------------------------------------------------------------------------------
+
+// Bytes in one 4x4 block of a block compressed format, 0 for other formats
+int TextureFormatBlockBytes(TextureFormat format)
+{
+	switch (format)
+	{
+		case TextureFormat::BC1:
+		case TextureFormat::BC4:  return 8;
+		case TextureFormat::BC2:
+		case TextureFormat::BC3:
+		case TextureFormat::BC5:
+		case TextureFormat::BC7:  return 16;
+		default:                  return 0;
+	}
+}
+
+
+namespace
+{
+	// Structures at the start of a .dds file (after the "DDS " magic number)
+	struct DDSPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t       size;
+		uint32_t       flags;
+		uint32_t       height;
+		uint32_t       width;
+		uint32_t       pitchOrLinearSize;
+		uint32_t       depth;
+		uint32_t       mipMapCount;
+		uint32_t       reserved1[11];
+		DDSPixelFormat pixelFormat;
+		uint32_t       caps;
+		uint32_t       caps2;
+		uint32_t       caps3;
+		uint32_t       caps4;
+		uint32_t       reserved2;
+	};
+
+	// Follows the header if the pixel format's fourCC is "DX10"
+	struct DDSHeaderDX10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	const uint32_t DDS_MAGIC            = 0x20534444; // "DDS "
+	const uint32_t DDS_FOURCC           = 0x4;        // Pixel format flags
+	const uint32_t DDS_RGB              = 0x40;
+	const uint32_t DDS_HEADER_DEPTH     = 0x800000;   // Header flags
+	const uint32_t DDS_CUBEMAP          = 0x200;      // caps2
+	const uint32_t DDS_DIMENSION_2D     = 3;          // D3D11_RESOURCE_DIMENSION_TEXTURE2D
+	const uint32_t DDS_MISC_TEXTURECUBE = 0x4;        // D3D11_RESOURCE_MISC_TEXTURECUBE
+
+	constexpr uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+	}
+
+	// Get the format of a legacy (non-DX10) .dds file, returns false if it isn't supported
+	bool LegacyDDSFormat(const DDSPixelFormat& pixelFormat, TextureFormat& format)
+	{
+		if (pixelFormat.flags & DDS_FOURCC)
+		{
+			switch (pixelFormat.fourCC)
+			{
+				case FourCC('D', 'X', 'T', '1'):  format = TextureFormat::BC1;  return true;
+				case FourCC('D', 'X', 'T', '2'):
+				case FourCC('D', 'X', 'T', '3'):  format = TextureFormat::BC2;  return true;
+				case FourCC('D', 'X', 'T', '4'):
+				case FourCC('D', 'X', 'T', '5'):  format = TextureFormat::BC3;  return true;
+				case FourCC('A', 'T', 'I', '1'):
+				case FourCC('B', 'C', '4', 'U'):  format = TextureFormat::BC4;  return true;
+				case FourCC('A', 'T', 'I', '2'):
+				case FourCC('B', 'C', '5', 'U'):  format = TextureFormat::BC5;  return true;
+				default:                          return false;
+			}
+		}
+		if ((pixelFormat.flags & DDS_RGB) && pixelFormat.rgbBitCount == 32 && pixelFormat.aBitMask == 0xff000000)
+		{
+			if (pixelFormat.rBitMask == 0x000000ff && pixelFormat.gBitMask == 0x0000ff00 && pixelFormat.bBitMask == 0x00ff0000)
+			{
+				format = TextureFormat::RGBA8;
+				return true;
+			}
+			if (pixelFormat.rBitMask == 0x00ff0000 && pixelFormat.gBitMask == 0x0000ff00 && pixelFormat.bBitMask == 0x000000ff)
+			{
+				format = TextureFormat::BGRA8;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Get the format of a DX10 .dds file from its DXGI_FORMAT value, returns false if it isn't supported
+	bool DX10DDSFormat(uint32_t dxgiFormat, TextureFormat& format, bool& srgb)
+	{
+		struct DXGIFormat { uint32_t dxgiFormat; TextureFormat format; bool srgb; };
+		static const DXGIFormat formats[] =
+		{
+			{ 28, TextureFormat::RGBA8, false }, // DXGI_FORMAT_R8G8B8A8_UNORM
+			{ 29, TextureFormat::RGBA8, true  }, // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+			{ 87, TextureFormat::BGRA8, false }, // DXGI_FORMAT_B8G8R8A8_UNORM
+			{ 91, TextureFormat::BGRA8, true  }, // DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+			{ 71, TextureFormat::BC1,   false }, // DXGI_FORMAT_BC1_UNORM
+			{ 72, TextureFormat::BC1,   true  }, // DXGI_FORMAT_BC1_UNORM_SRGB
+			{ 74, TextureFormat::BC2,   false }, // DXGI_FORMAT_BC2_UNORM
+			{ 75, TextureFormat::BC2,   true  }, // DXGI_FORMAT_BC2_UNORM_SRGB
+			{ 77, TextureFormat::BC3,   false }, // DXGI_FORMAT_BC3_UNORM
+			{ 78, TextureFormat::BC3,   true  }, // DXGI_FORMAT_BC3_UNORM_SRGB
+			{ 80, TextureFormat::BC4,   false }, // DXGI_FORMAT_BC4_UNORM
+			{ 83, TextureFormat::BC5,   false }, // DXGI_FORMAT_BC5_UNORM
+			{ 98, TextureFormat::BC7,   false }, // DXGI_FORMAT_BC7_UNORM
+			{ 99, TextureFormat::BC7,   true  }, // DXGI_FORMAT_BC7_UNORM_SRGB
+		};
+		for (auto& entry : formats)
+		{
+			if (entry.dxgiFormat == dxgiFormat)
+			{
+				format = entry.format;
+				srgb = entry.srgb;
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+
+// Decode a 2D texture from the contents of a .dds file
+bool DecodeDDSTexture(const std::vector<uint8_t>& file, DecodedTexture& texture, std::string& error)
+{
+	texture = DecodedTexture();
+
+	uint32_t magic;
+	DDSHeader header;
+	if (file.size() < sizeof(magic) + sizeof(header))
+	{
+		error = "file too small for a DDS header";
+		return false;
+	}
+	std::memcpy(&magic, file.data(), sizeof(magic));
+	std::memcpy(&header, file.data() + sizeof(magic), sizeof(header));
+	if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || header.width == 0 || header.height == 0)
+	{
+		error = "not a DDS file";
+		return false;
+	}
+
+	size_t dataStart = sizeof(magic) + sizeof(header);
+	bool supported;
+	if ((header.pixelFormat.flags & DDS_FOURCC) && header.pixelFormat.fourCC == FourCC('D', 'X', '1', '0'))
+	{
+		DDSHeaderDX10 headerDX10;
+		if (file.size() < dataStart + sizeof(headerDX10))
+		{
+			error = "file too small for a DDS DX10 header";
+			return false;
+		}
+		std::memcpy(&headerDX10, file.data() + dataStart, sizeof(headerDX10));
+		dataStart += sizeof(headerDX10);
+		supported = headerDX10.resourceDimension == DDS_DIMENSION_2D && headerDX10.arraySize <= 1 &&
+		            !(headerDX10.miscFlag & DDS_MISC_TEXTURECUBE) &&
+		            DX10DDSFormat(headerDX10.dxgiFormat, texture.format, texture.srgb);
+	}
+	else
+	{
+		supported = !(header.caps2 & DDS_CUBEMAP) && !((header.flags & DDS_HEADER_DEPTH) && header.depth > 1) &&
+		            LegacyDDSFormat(header.pixelFormat, texture.format);
+	}
+	if (!supported)
+	{
+		error = "unsupported DDS format";
+		return false;
+	}
+
+	// Lay out the mip levels, each half the size of the one before
+	int blockBytes = TextureFormatBlockBytes(texture.format);
+	uint32_t numMips = std::max(header.mipMapCount, 1u);
+	uint32_t width = header.width;
+	uint32_t height = header.height;
+	size_t offset = 0;
+	for (uint32_t mip = 0; mip < numMips; ++mip)
+	{
+		TextureMip level;
+		level.offset = offset;
+		level.width = width;
+		level.height = height;
+		if (blockBytes > 0)
+		{
+			level.rowPitch   = std::max(1u, (width + 3) / 4) * blockBytes;
+			level.slicePitch = level.rowPitch * std::max(1u, (height + 3) / 4);
+		}
+		else
+		{
+			level.rowPitch   = width * 4;
+			level.slicePitch = level.rowPitch * height;
+		}
+		texture.mips.push_back(level);
+		offset += level.slicePitch;
+
+		width  = std::max(1u, width  / 2);
+		height = std::max(1u, height / 2);
+	}
+	if (file.size() - dataStart < offset)
+	{
+		texture = DecodedTexture();
+		error = "DDS file is truncated";
+		return false;
+	}
+
+	texture.data.assign(file.begin() + dataStart, file.begin() + dataStart + offset);
+	return true;
+}
+
+
+// Read a whole file, returns false if it can't be read
+bool ReadFileBytes(const std::string& fileName, std::vector<uint8_t>& bytes)
+{
+	std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())  return false;
+
+	std::streamoff fileSize = file.tellg();
+	if (fileSize < 0)  return false;
+	file.seekg(0, std::ios::beg);
+	bytes.resize(static_cast<size_t>(fileSize));
+	file.read(reinterpret_cast<char*>(bytes.data()), fileSize);
+	return !file.fail();
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Background loading
+//--------------------------------------------------------------------------------------
+
+float AsyncTextureLoader::MillisecondsSinceStart() const
+{
+	return std::chrono::duration<float, std::milli>(Clock::now() - mStartTime).count();
+}
+
+
+// Start decoding a file on the thread pool. Returns an id for the file, passed back with its result
+int AsyncTextureLoader::Load(const std::string& fileName, const TextureDecodeFunction& decode)
+{
+	if (NumPending() == 0)
+	{
+		mTrace.clear();
+		mStartTime = Clock::now();
+		mTotalMs = 0;
+	}
+
+	int id = static_cast<int>(mTrace.size());
+	TextureLoadEvent event;
+	event.fileName = fileName;
+	event.queuedMs = MillisecondsSinceStart();
+	mTrace.push_back(event);
+
+	mDecodes.push_back(gThreadPool.Submit([this, id, fileName, decode]()
+	{
+		ScopedTraceEvent trace("Textures", "Decode " + fileName);
+		TextureLoadEvent times;
+		times.decodeStartMs = MillisecondsSinceStart();
+
+		DecodedTextureFile file;
+		file.id = id;
+		file.fileName = fileName;
+		file.decoded = decode(fileName, file.texture, file.error);
+		times.decodeEndMs = MillisecondsSinceStart();
+		times.decodedBytes = file.texture.data.size();
+		times.failed = !file.decoded;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto thread = std::find(mThreads.begin(), mThreads.end(), std::this_thread::get_id());
+		times.thread = static_cast<int>(thread - mThreads.begin());
+		if (thread == mThreads.end())  mThreads.push_back(std::this_thread::get_id());
+		mDecoded.push_back(std::move(file));
+		mDecodeTimes.push_back(times);
+	}));
+	return id;
+}
+
+
+// Pass each file that has finished decoding since the last call to upload, in the order they finished
+int AsyncTextureLoader::Upload(const std::function<void(DecodedTextureFile& file)>& upload)
+{
+	// Take the finished files so the workers aren't held up while they are uploaded
+	std::vector<DecodedTextureFile> decoded;
+	std::vector<TextureLoadEvent> decodeTimes;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		decoded.swap(mDecoded);
+		decodeTimes.swap(mDecodeTimes);
+	}
+
+	for (size_t f = 0; f < decoded.size(); ++f)
+	{
+		{
+			ScopedTraceEvent trace("Textures", "Upload " + decoded[f].fileName);
+			upload(decoded[f]);
+		}
+
+		TextureLoadEvent& event = mTrace[decoded[f].id];
+		event.decodeStartMs = decodeTimes[f].decodeStartMs;
+		event.decodeEndMs   = decodeTimes[f].decodeEndMs;
+		event.decodedBytes  = decodeTimes[f].decodedBytes;
+		event.thread        = decodeTimes[f].thread;
+		event.failed        = decodeTimes[f].failed;
+		event.uploadedMs    = MillisecondsSinceStart();
+		event.done          = true;
+	}
+
+	if (!decoded.empty() && NumPending() == 0)
+	{
+		mTotalMs = MillisecondsSinceStart();
+		mDecodes.clear();
+	}
+	return static_cast<int>(decoded.size());
+}
+
+
+// Number of files queued that haven't been passed to Upload yet
+int AsyncTextureLoader::NumPending() const
+{
+	int numPending = 0;
+	for (auto& event : mTrace)
+	{
+		if (!event.done)  ++numPending;
+	}
+	return numPending;
+}
+
+
+// Wait for all the files queued to finish decoding
+void AsyncTextureLoader::Wait()
+{
+	for (auto& decode : mDecodes)
+	{
+		if (decode.valid())  decode.wait();
+	}
+}
@@ -0,0 +1,158 @@
+//--------------------------------------------------------------------------------------
+// Loading textures in the background
+//--------------------------------------------------------------------------------------
+// InitGeometry used to load each texture in turn, decoding every JPEG and PNG before the app could start. Loading is now
+// split in two:
+// - decoding (reading the file and turning it into pixels, the slow part) runs on the thread pool, all files at once
+// - uploading (creating the GPU texture from the pixels) runs on the render thread, as each file finishes decoding
+// Until its texture arrives each texture slot holds a 1x1 placeholder, so the scene can be drawn straight away (see
+// Texture.h for the GPU side).
+//
+// Each file's progress is recorded (TextureLoadEvent) to show where startup time goes. Decoding is done by a function
+// passed in, so the loader can be run without a GPU - DecodeDDSTexture is portable, the other formats are decoded with
+// WIC on Windows.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _TEXTURE_LOADER_H_INCLUDED_
+#define _TEXTURE_LOADER_H_INCLUDED_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Decoded textures
+//--------------------------------------------------------------------------------------
+
+// Pixel formats a decoded texture can have
+enum class TextureFormat
+{
+	RGBA8,
+	BGRA8,
+	BC1, // Block compressed formats (DXT1 - DXT5 are BC1 - BC3)
+	BC2,
+	BC3,
+	BC4,
+	BC5,
+	BC7,
+};
+
+// Bytes in one 4x4 block of a block compressed format, 0 for other formats
+int TextureFormatBlockBytes(TextureFormat format);
+
+
+// One mip level of a decoded texture
+struct TextureMip
+{
+	size_t   offset;     // Start of the level in DecodedTexture::data
+	uint32_t width;
+	uint32_t height;
+	uint32_t rowPitch;   // Bytes from one row of pixels (or blocks) to the next
+	uint32_t slicePitch; // Bytes in the whole level
+};
+
+// Pixels of a texture ready to be uploaded to the GPU
+struct DecodedTexture
+{
+	TextureFormat           format = TextureFormat::RGBA8;
+	bool                    srgb = false;
+	bool                    generateMips = false; // Only the top level is here, the GPU should generate the others
+	std::vector<TextureMip> mips;
+	std::vector<uint8_t>    data;
+
+	uint32_t Width()  const  { return mips.empty() ? 0 : mips[0].width; }
+	uint32_t Height() const  { return mips.empty() ? 0 : mips[0].height; }
+};
+
+
+// Decode a texture file. Returns false with a message in error on failure
+using TextureDecodeFunction = std::function<bool(const std::string& fileName, DecodedTexture& texture, std::string& error)>;
+
+// Decode a 2D texture from the contents of a .dds file - uncompressed 32-bit or block compressed, with any mip levels.
+// Cube maps, arrays and volume textures are not supported. Returns false with a message in error on failure
+bool DecodeDDSTexture(const std::vector<uint8_t>& file, DecodedTexture& texture, std::string& error);
+
+// Read a whole file, returns false if it can't be read
+bool ReadFileBytes(const std::string& fileName, std::vector<uint8_t>& bytes);
+
+
+
+//--------------------------------------------------------------------------------------
+// Background loading
+//--------------------------------------------------------------------------------------
+
+// Progress of one file through the loader. Times are in milliseconds from the first file being queued
+struct TextureLoadEvent
+{
+	std::string fileName;
+	float       queuedMs       = 0;
+	float       decodeStartMs  = 0;
+	float       decodeEndMs    = 0;
+	float       uploadedMs     = 0; // When the texture was handed to the render thread
+	int         thread         = 0; // Worker that decoded it, numbered in the order they started work
+	size_t      decodedBytes   = 0;
+	bool        failed         = false;
+	bool        done           = false; // Handed to the render thread
+};
+
+// A file that has finished decoding, handed to the render thread to upload
+struct DecodedTextureFile
+{
+	int            id; // Returned by AsyncTextureLoader::Load
+	std::string    fileName;
+	DecodedTexture texture;
+	bool           decoded;
+	std::string    error;
+};
+
+
+class AsyncTextureLoader
+{
+public:
+	// Waits for any files still decoding
+	~AsyncTextureLoader()  { Wait(); }
+
+	// Start decoding a file on the thread pool. Returns an id for the file, passed back with its result
+	int Load(const std::string& fileName, const TextureDecodeFunction& decode);
+
+	// Pass each file that has finished decoding since the last call to upload, in the order they finished. Call on the
+	// render thread. Returns the number of files passed
+	int Upload(const std::function<void(DecodedTextureFile& file)>& upload);
+
+	// Number of files queued that haven't been passed to Upload yet
+	int NumPending() const;
+
+	// Wait for all the files queued to finish decoding (they still need passing to Upload)
+	void Wait();
+
+	// Progress of each file queued, in the order they were queued
+	const std::vector<TextureLoadEvent>& Trace() const  { return mTrace; }
+
+	// Time from the first file being queued to the last file being passed to Upload, 0 while files are pending
+	float TotalMs() const  { return mTotalMs; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+	float MillisecondsSinceStart() const;
+
+	Clock::time_point              mStartTime;
+	std::vector<TextureLoadEvent>  mTrace;      // Only touched by the thread calling Load and Upload
+	std::vector<std::future<void>> mDecodes;
+	float                          mTotalMs = 0;
+
+	// Shared with the workers
+	mutable std::mutex              mMutex;
+	std::vector<DecodedTextureFile> mDecoded;     // Finished, waiting for Upload
+	std::vector<TextureLoadEvent>   mDecodeTimes; // Decode times of the files in mDecoded
+	std::vector<std::thread::id>    mThreads;     // Workers seen, to number them
+};
+
+
+#endif //_TEXTURE_LOADER_H_INCLUDED_
@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------
+// Simple worker thread pool
+//--------------------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+
+// Pool shared by the whole app
+ThreadPool gThreadPool;
+
+
+//--------------------------------------------------------------------------------------
+// Construction
+//--------------------------------------------------------------------------------------
+
+// Create the given number of worker threads, 0 means one per hardware thread
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned int t = 0; t < numThreads; ++t)
+	{
+		mThreads.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+
+// Waits for queued jobs to finish then stops the worker threads
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mJobAvailable.notify_all();
+
+	for (auto& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+
+// Function run by each worker thread, takes jobs from the queue until the pool is destroyed
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJobAvailable.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+			if (mStopping && mJobs.empty())  return;
+
+			job = std::move(mJobs.front());
+			mJobs.pop();
+		}
+		job();
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Usage
+//--------------------------------------------------------------------------------------
+
+// Run body(first, last) over the range [begin, end) split into chunks of roughly chunkSize items spread over
+// the worker threads. The calling thread also does some of the work and the function returns when all
+// chunks are complete. A chunkSize of 0 picks a size that gives a few chunks per thread
+void ThreadPool::ParallelFor(int begin, int end, const std::function<void(int, int)>& body, int chunkSize)
+{
+	int count = end - begin;
+	if (count <= 0)  return;
+
+	if (chunkSize <= 0)
+	{
+		const int chunksPerThread = 4; // Several chunks per thread evens out uneven workloads (e.g. area effects)
+		chunkSize = std::max(1, count / static_cast<int>(NumThreads() * chunksPerThread));
+	}
+	int numChunks = (count + chunkSize - 1) / chunkSize;
+
+	// Small ranges are not worth the overhead of waking other threads
+	if (numChunks == 1)
+	{
+		body(begin, end);
+		return;
+	}
+
+	// Chunks are claimed from a shared counter by the helpers and by this thread, so no thread sits idle while others still have work.
+	// We wait on a count of finished chunks rather than on the helper jobs themselves so that a ParallelFor called from inside a
+	// worker thread cannot deadlock waiting for helpers that are still queued - they will find no chunks left and return at once
+	struct SharedState
+	{
+		std::atomic<int>        nextChunk{ 0 };
+		int                     chunksDone = 0;
+		std::mutex              mutex;
+		std::condition_variable allDone;
+	};
+	auto state = std::make_shared<SharedState>();
+	auto runChunks = [=, &body]()
+	{
+		int chunk;
+		while ((chunk = state->nextChunk.fetch_add(1)) < numChunks)
+		{
+			int first = begin + chunk * chunkSize;
+			body(first, std::min(first + chunkSize, end));
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+			if (++state->chunksDone == numChunks)  state->allDone.notify_all();
+		}
+	};
+
+	int numHelpers = std::min(static_cast<int>(NumThreads()), numChunks - 1);
+	for (int h = 0; h < numHelpers; ++h)
+	{
+		Submit(runChunks);
+	}
+
+	runChunks();
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->allDone.wait(lock, [&]() { return state->chunksDone == numChunks; });
+}
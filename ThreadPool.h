@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------------------
+// Simple worker thread pool
+//--------------------------------------------------------------------------------------
+// A fixed set of worker threads that run queued jobs. Used by the CPU post-processing engine to split
+// images into bands of rows, and by any other system that wants to spread work over the available cores.
+// Portable C++ - no Windows or DirectX dependencies
+
+#ifndef _THREAD_POOL_H_INCLUDED_
+#define _THREAD_POOL_H_INCLUDED_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool
+{
+public:
+	//-------------------------------------
+	// Construction
+	//-------------------------------------
+
+	// Create the given number of worker threads, 0 means one per hardware thread
+	ThreadPool(unsigned int numThreads = 0);
+
+	// Waits for queued jobs to finish then stops the worker threads
+	~ThreadPool();
+
+	// Prevent copying, the pool owns threads
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+
+	//-------------------------------------
+	// Usage
+	//-------------------------------------
+
+	// Number of worker threads in the pool
+	unsigned int NumThreads()  { return static_cast<unsigned int>(mThreads.size()); }
+
+	// Queue a job to run on a worker thread. Returns a future that holds the job's result once it has finished
+	template <class Job>
+	auto Submit(Job job) -> std::future<decltype(job())>
+	{
+		using Result = decltype(job());
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+		std::future<Result> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mJobs.push([task]() { (*task)(); });
+		}
+		mJobAvailable.notify_one();
+		return result;
+	}
+
+	// Run body(first, last) over the range [begin, end) split into chunks of roughly chunkSize items spread over
+	// the worker threads. The calling thread also does some of the work and the function returns when all
+	// chunks are complete. A chunkSize of 0 picks a size that gives a few chunks per thread
+	void ParallelFor(int begin, int end, const std::function<void(int, int)>& body, int chunkSize = 0);
+
+
+//-------------------------------------
+// Private members
+//-------------------------------------
+private:
+	// Function run by each worker thread, takes jobs from the queue until the pool is destroyed
+	void WorkerLoop();
+
+	std::vector<std::thread>          mThreads;
+	std::queue<std::function<void()>> mJobs;
+	std::mutex                        mMutex;
+	std::condition_variable           mJobAvailable;
+	bool                              mStopping = false;
+};
+
+
+// Pool shared by the whole app, created with one worker per hardware thread
+extern ThreadPool gThreadPool;
+
+
+#endif //_THREAD_POOL_H_INCLUDED_
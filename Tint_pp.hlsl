@@ -25,7 +25,7 @@ float4 main(PostProcessingInput input) : SV_Target
 	// Sample a pixel from the scene texture and multiply it with the tint colour (comes from a constant buffer defined in Common.hlsli)
     float3 finalColour = float3(1.0, 0.0, 0.0);
     
-    if (gMidLineEnabled == false || gIsFullScreen == false || gMidLineEnabled == true && input.sceneUV.x < (gMidLine - 0.002))
+    if (EffectSideOfMidLine(input.sceneUV))
     {
         finalColour.r = lerp(gtintTopColour.r, gtintBottomColour.r, input.sceneUV.y);
         finalColour.g = lerp(gtintTopColour.g, gtintBottomColour.g, input.sceneUV.y);